@@ -0,0 +1,269 @@
+/**
+ * @file Message_Batch.c
+ * @brief 多数据流批量解析与多帧批量校验 - 功能实现
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <string.h>
+#include "Message_Batch.h"
+#include "Parse_RTCM.h"
+#include "Parse_Unicore_Binary.h"
+
+#if defined(__GNUC__)
+#define SEMP_PREFETCH(address)  __builtin_prefetch(address)
+#else
+#define SEMP_PREFETCH(address)
+#endif
+
+//----------------------------------------
+// 批量校验的CRC类型
+//----------------------------------------
+
+// CRC of the built-in span validation routines
+typedef struct _SEMP_BATCH_CRC
+{
+    SEMP_VALIDATE_FRAME validate;   // Span routine of the frames
+    bool crc24q;                    // CRC-24Q over the frame, else CRC-32 followed by the CRC
+    uint32_t initial;               // CRC-32 initial value and final XOR
+    uint16_t minimumLength;         // Shorter frames are invalid
+} SEMP_BATCH_CRC;
+
+static const SEMP_BATCH_CRC sempBatchCrcs[] =
+{
+    {sempRtcmValidate, true, 0, 0},
+    {sempUnicoreBinaryValidate, false, 0, sizeof(SEMP_UNICORE_HEADER) + 4},
+    {sempCustomValidate, false, 0xffffffff, sizeof(SEMP_CUSTOM_HEADER) + 4},
+};
+
+#define SEMP_BATCH_CRC_KINDS    (sizeof(sempBatchCrcs) / sizeof(sempBatchCrcs[0]))
+
+// Frames waiting for a CRC kind
+typedef struct _SEMP_BATCH_CRC_FRAMES
+{
+    SEMP_FRAME *frames[SEMP_BATCH_CRC_QUEUE];
+    size_t count;
+} SEMP_BATCH_CRC_FRAMES;
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+static size_t sempBatchGroupLanes(size_t first, size_t count)
+{
+    return ((count - first) < SEMP_BATCH_LANES) ? (count - first) : SEMP_BATCH_LANES;
+}
+
+// Start loading the per byte and per frame fields of the parsers
+static void sempBatchPrefetchParsers(const SEMP_BATCH_LANE *lanes, size_t count)
+{
+    size_t index;
+
+    for (index = 0; index < count; index++)
+    {
+        if (lanes[index].length)
+        {
+            SEMP_PREFETCH(lanes[index].parse);
+            SEMP_PREFETCH((const uint8_t *)lanes[index].parse + SEMP_CACHE_LINE_BYTES);
+            SEMP_PREFETCH(lanes[index].data);
+        }
+    }
+}
+
+// Start loading the end of the partial frames, the parsers are loaded
+static void sempBatchPrefetchBuffers(const SEMP_BATCH_LANE *lanes, size_t count)
+{
+    const SEMP_PARSE_STATE *parse;
+    size_t index;
+
+    for (index = 0; index < count; index++)
+    {
+        if (lanes[index].length)
+        {
+            parse = lanes[index].parse;
+            SEMP_PREFETCH(&parse->buffer[parse->msg_length]);
+            if (parse->scratchPad != (const void *)&parse->scratch)
+                SEMP_PREFETCH(parse->scratchPad);
+        }
+    }
+}
+
+// Compute the CRCs of up to SEMP_BATCH_CRC_LANES frames, a full set of
+// lanes runs interleaved over the length of the shortest frame
+static size_t sempBatchCrcLanes(const SEMP_BATCH_CRC *kind, SEMP_FRAME **frames, int count)
+{
+    const uint8_t *data[SEMP_BATCH_CRC_LANES];
+    uint16_t spanBytes[SEMP_BATCH_CRC_LANES];
+    uint32_t crc[SEMP_BATCH_CRC_LANES];
+    uint32_t crcRx;
+    uint16_t common = 0;
+    uint16_t offset;
+    size_t validFrames = 0;
+    int lane;
+
+    for (lane = 0; lane < count; lane++)
+    {
+        data[lane] = frames[lane]->buffer;
+        spanBytes[lane] = kind->crc24q ? frames[lane]->length : frames[lane]->length - 4;
+        crc[lane] = kind->initial;
+        if ((!lane) || (spanBytes[lane] < common))
+            common = spanBytes[lane];
+    }
+
+    // Independent table lookups of the lanes overlap
+    if (count < SEMP_BATCH_CRC_LANES)
+        common = 0;
+    else if (kind->crc24q)
+    {
+        for (offset = 0; offset < common; offset++)
+            for (lane = 0; lane < SEMP_BATCH_CRC_LANES; lane++)
+                crc[lane] = (crc[lane] << 8)
+                          ^ semp_crc24qTable[data[lane][offset] ^ ((crc[lane] >> 16) & 0xff)];
+    }
+    else
+    {
+        for (offset = 0; offset < common; offset++)
+            for (lane = 0; lane < SEMP_BATCH_CRC_LANES; lane++)
+                crc[lane] = (uint32_t)(semp_crc32Table[(crc[lane] ^ data[lane][offset]) & 0xff]
+                                       ^ (crc[lane] >> 8));
+    }
+
+    // Finish the longer frames one at a time
+    for (lane = 0; lane < count; lane++)
+    {
+        if (kind->crc24q)
+        {
+            for (offset = common; offset < spanBytes[lane]; offset++)
+                crc[lane] = (crc[lane] << 8)
+                          ^ semp_crc24qTable[data[lane][offset] ^ ((crc[lane] >> 16) & 0xff)];
+
+            // The CRC over the message including the CRC bytes is zero
+            frames[lane]->verdict = (crc[lane] & 0x00ffffff) ? SEMP_FRAME_BAD_CRC : SEMP_FRAME_VALID;
+        }
+        else
+        {
+            crc[lane] = semp_util_crc32(crc[lane], &data[lane][common], spanBytes[lane] - common);
+            memcpy(&crcRx, &data[lane][spanBytes[lane]], sizeof(crcRx));
+            frames[lane]->verdict = ((crc[lane] ^ kind->initial) == crcRx)
+                                  ? SEMP_FRAME_VALID : SEMP_FRAME_BAD_CRC;
+        }
+        if (frames[lane]->verdict == SEMP_FRAME_VALID)
+            validFrames++;
+    }
+    return validFrames;
+}
+
+// Validate the queued frames, similar lengths share the lanes
+static size_t sempBatchCrcFlush(const SEMP_BATCH_CRC *kind, SEMP_BATCH_CRC_FRAMES *queue)
+{
+    SEMP_FRAME *frame;
+    size_t validFrames = 0;
+    size_t index;
+    size_t slot;
+    size_t lanes;
+
+    // Insertion sort by length
+    for (index = 1; index < queue->count; index++)
+    {
+        frame = queue->frames[index];
+        for (slot = index; slot && (queue->frames[slot - 1]->length > frame->length); slot--)
+            queue->frames[slot] = queue->frames[slot - 1];
+        queue->frames[slot] = frame;
+    }
+
+    for (index = 0; index < queue->count; index += lanes)
+    {
+        lanes = queue->count - index;
+        if (lanes > SEMP_BATCH_CRC_LANES)
+            lanes = SEMP_BATCH_CRC_LANES;
+        validFrames += sempBatchCrcLanes(kind, &queue->frames[index], (int)lanes);
+    }
+    queue->count = 0;
+    return validFrames;
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Parse the groups of lanes, the parsers of the group after next and the
+// buffers of the next group load while the current group is parsed
+void sempParseBatch(const SEMP_BATCH_LANE *lanes, size_t count)
+{
+    size_t group;
+    size_t index;
+    size_t next;
+
+    if ((!lanes) || (!count))
+        return;
+
+    sempBatchPrefetchParsers(lanes, sempBatchGroupLanes(0, count));
+    if (count > SEMP_BATCH_LANES)
+        sempBatchPrefetchParsers(&lanes[SEMP_BATCH_LANES], sempBatchGroupLanes(SEMP_BATCH_LANES, count));
+    sempBatchPrefetchBuffers(lanes, sempBatchGroupLanes(0, count));
+
+    for (group = 0; group < count; group += SEMP_BATCH_LANES)
+    {
+        next = group + 2 * SEMP_BATCH_LANES;
+        if (next < count)
+            sempBatchPrefetchParsers(&lanes[next], sempBatchGroupLanes(next, count));
+        next = group + SEMP_BATCH_LANES;
+        if (next < count)
+            sempBatchPrefetchBuffers(&lanes[next], sempBatchGroupLanes(next, count));
+
+        for (index = group; index < (group + sempBatchGroupLanes(group, count)); index++)
+        {
+            if (lanes[index].length)
+                sempParseBuffer(lanes[index].parse, lanes[index].data, lanes[index].length);
+        }
+    }
+}
+
+// Validate many frames, the built-in CRCs are computed several at a time
+size_t sempFrameValidateBatch(SEMP_FRAME *frames, size_t count)
+{
+    SEMP_BATCH_CRC_FRAMES queues[SEMP_BATCH_CRC_KINDS];
+    SEMP_FRAME *frame;
+    size_t validFrames = 0;
+    size_t index;
+    size_t kind;
+
+    if (!frames)
+        return 0;
+
+    for (kind = 0; kind < SEMP_BATCH_CRC_KINDS; kind++)
+        queues[kind].count = 0;
+    for (index = 0; index < count; index++)
+    {
+        frame = &frames[index];
+        if (frame->verdict != SEMP_FRAME_UNVALIDATED)
+        {
+            if (frame->verdict == SEMP_FRAME_VALID)
+                validFrames++;
+            continue;
+        }
+
+        // Queue the frames of the built-in CRCs
+        for (kind = 0; kind < SEMP_BATCH_CRC_KINDS; kind++)
+            if (frame->validate && (frame->validate == sempBatchCrcs[kind].validate))
+                break;
+        if (kind >= SEMP_BATCH_CRC_KINDS)
+        {
+            if (sempFrameValidate(frame))
+                validFrames++;
+            continue;
+        }
+        if (frame->length < sempBatchCrcs[kind].minimumLength)
+        {
+            frame->verdict = SEMP_FRAME_BAD_CRC;
+            continue;
+        }
+        queues[kind].frames[queues[kind].count++] = frame;
+        if (queues[kind].count >= SEMP_BATCH_CRC_QUEUE)
+            validFrames += sempBatchCrcFlush(&sempBatchCrcs[kind], &queues[kind]);
+    }
+
+    for (kind = 0; kind < SEMP_BATCH_CRC_KINDS; kind++)
+        validFrames += sempBatchCrcFlush(&sempBatchCrcs[kind], &queues[kind]);
+    return validFrames;
+}
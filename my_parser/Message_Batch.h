@@ -0,0 +1,74 @@
+/**
+ * @file Message_Batch.h
+ * @brief 多数据流批量解析与多帧批量校验 - 头文件
+ * @details 大量低速数据流 (如NTRIP汇聚的上万个连接) 每次只收到几十到几百
+ *          字节, 单次调用的开销主要是解析器状态和帧缓冲区不在缓存中.
+ *          批量解析把待处理的数据流分成每组SEMP_BATCH_LANES个通道, 以流水线
+ *          方式预取后两组的解析器结构和下一组的帧缓冲区, 再逐通道调用
+ *          sempParseBuffer, 使多个缓存缺失重叠. 输出与逐个数据流调用
+ *          sempParseBuffer完全相同.
+ *
+ *          批量校验延迟校验模式下收集的帧: 内置CRC-24Q (RTCM) 和CRC-32
+ *          (Unicore、Custom) 帧按长度排队, 每SEMP_BATCH_CRC_LANES帧交错
+ *          计算, 各帧的查表依赖链互相独立, 短帧也能占满执行单元.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_BATCH_H
+#define MESSAGE_BATCH_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_BATCH_LANES    16      // Streams per group
+#define SEMP_BATCH_CRC_LANES 4      // Frames whose CRCs are computed together
+#define SEMP_BATCH_CRC_QUEUE 64     // Frames sorted by length per CRC kind
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+// Input span of one stream
+typedef struct _SEMP_BATCH_LANE
+{
+    SEMP_PARSE_STATE *parse;    // Parser of the stream
+    const uint8_t *data;        // Received data
+    size_t length;              // Received bytes, 0 to skip the stream
+} SEMP_BATCH_LANE;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 批量解析多个数据流收到的数据
+ * @details 各通道的解析器必须互不相同, 帧按通道顺序交付到各解析器的
+ *          eomCallback
+ * @param lanes 各数据流的输入
+ * @param count 通道数量
+ */
+void sempParseBatch(const SEMP_BATCH_LANE *lanes, size_t count);
+
+/**
+ * @brief 批量校验多个帧
+ * @details 结果与逐帧调用sempFrameValidate相同, 保存在各帧的verdict中.
+ *          其他校验方式的帧逐帧校验.
+ * @param frames 帧引用, 由sempGetFrame得到
+ * @param count 帧数量
+ * @return 有效帧数量
+ */
+size_t sempFrameValidateBatch(SEMP_FRAME *frames, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_BATCH_H
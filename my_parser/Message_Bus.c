@@ -0,0 +1,397 @@
+/**
+ * @file Message_Bus.c
+ * @brief 多进程共享内存帧总线 - 功能实现
+ * @details 共享内存依次为头部、描述符环和帧数据环. 数据环的位置单调递增,
+ *          帧不跨越环的末尾. 写入者先作废描述符并预留数据区, 再写入数据和
+ *          描述符, 最后发布序号; 消费者按顺序锁 (seqlock) 方式读取描述符,
+ *          并以预留位置判断数据是否已被覆盖.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#define _GNU_SOURCE     // memfd_create
+#include "Message_Bus.h"
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The shared counters are updated from several processes
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The bus needs address free 64-bit atomics");
+
+//----------------------------------------
+// 共享内存布局
+//----------------------------------------
+
+#define SEMP_BUS_MAGIC          0x53425553  // "SBUS"
+#define SEMP_BUS_NAME_BYTES     64
+
+typedef struct _SEMP_BUS_HEADER
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frameCount;            // Descriptors, a power of 2
+    uint32_t dataBytes;             // Frame data area
+    uint64_t mapBytes;              // Size of the shared memory
+    _Alignas(SEMP_CACHE_LINE_BYTES) _Atomic uint64_t published;   // Next frame number
+    _Alignas(SEMP_CACHE_LINE_BYTES) _Atomic uint64_t reserved;    // End of the written data
+} SEMP_BUS_HEADER;
+
+typedef struct _SEMP_BUS_DESCRIPTOR
+{
+    _Atomic uint64_t sequence;      // Frame number + 1, 0 while written
+    uint64_t timestamp;
+    uint64_t offset;                // Data position, data area offset modulo dataBytes
+    uint16_t length;
+    uint16_t stream;
+    uint16_t messageId;
+    uint8_t protocol;
+    uint8_t reserved;
+} SEMP_BUS_DESCRIPTOR;
+
+//----------------------------------------
+// 进程内状态
+//----------------------------------------
+
+struct _SEMP_BUS
+{
+    SEMP_BUS_HEADER *header;
+    SEMP_BUS_DESCRIPTOR *descriptors;
+    uint8_t *data;
+    uint64_t mapBytes;
+    uint64_t mask;                  // frameCount - 1
+    uint64_t next;                  // Writer: next frame, reader: next frame to read
+    uint64_t position;              // Writer: end of the written data
+    int fd;
+    bool writer;
+    SEMP_BUS_STATS stats;
+    SEMP_PRINTF_CALLBACK printError;
+    char name[SEMP_BUS_NAME_BYTES]; // Writer: name to remove when closed
+};
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+// Map the shared memory and locate the areas
+static SEMP_BUS * sempBusMap(int fd, uint64_t mapBytes, bool writer, SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_BUS *bus;
+    void *map;
+
+    map = mmap(nullptr, mapBytes, writer ? (PROT_READ | PROT_WRITE) : PROT_READ,
+               MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        sempPrintln(printError, "SEMP: Failed to map the bus");
+        return nullptr;
+    }
+    bus = (SEMP_BUS *)semp_util_malloc(sizeof(SEMP_BUS));
+    if (!bus)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the bus structure");
+        munmap(map, mapBytes);
+        return nullptr;
+    }
+    memset(bus, 0, sizeof(SEMP_BUS));
+    bus->header = (SEMP_BUS_HEADER *)map;
+    bus->descriptors = (SEMP_BUS_DESCRIPTOR *)((uint8_t *)map + sizeof(SEMP_BUS_HEADER));
+    bus->mapBytes = mapBytes;
+    bus->fd = fd;
+    bus->writer = writer;
+    bus->printError = printError;
+    return bus;
+}
+
+// Size of the shared memory
+static uint64_t sempBusBytes(uint32_t frameCount, uint32_t dataBytes)
+{
+    return sizeof(SEMP_BUS_HEADER) + (uint64_t)frameCount * sizeof(SEMP_BUS_DESCRIPTOR) + dataBytes;
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Create the bus
+SEMP_BUS * sempBusCreate(const char *name,
+                         uint32_t frameCount,
+                         uint32_t dataBytes,
+                         SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_BUS_HEADER *header;
+    SEMP_BUS *bus;
+    uint64_t mapBytes;
+    uint32_t count;
+    int fd;
+
+    if (name && (strlen(name) >= SEMP_BUS_NAME_BYTES))
+    {
+        sempPrintf(printError, "SEMP: Bus name must be less than %d characters",
+                   SEMP_BUS_NAME_BYTES);
+        return nullptr;
+    }
+    if (frameCount < SEMP_BUS_MINIMUM_FRAMES)
+        frameCount = SEMP_BUS_MINIMUM_FRAMES;
+    for (count = 1; count < frameCount; count <<= 1)
+        ;
+    if (dataBytes < SEMP_BUS_MINIMUM_BYTES)
+        dataBytes = SEMP_BUS_MINIMUM_BYTES;
+    dataBytes = SEMP_ALIGN(dataBytes);
+    mapBytes = sempBusBytes(count, dataBytes);
+
+    // Create the shared memory
+    if (name)
+        fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+    else
+        fd = memfd_create("semp_bus", 0);
+    if (fd < 0)
+    {
+        sempPrintln(printError, "SEMP: Failed to create the bus shared memory");
+        return nullptr;
+    }
+
+    // Discard the contents of an earlier bus with the same name
+    if (ftruncate(fd, 0) || ftruncate(fd, mapBytes))
+    {
+        sempPrintln(printError, "SEMP: Failed to size the bus shared memory");
+        close(fd);
+        if (name)
+            shm_unlink(name);
+        return nullptr;
+    }
+    bus = sempBusMap(fd, mapBytes, true, printError);
+    if (!bus)
+    {
+        close(fd);
+        if (name)
+            shm_unlink(name);
+        return nullptr;
+    }
+    if (name)
+        strcpy(bus->name, name);
+
+    // Initialize the header last, the readers check the magic value
+    header = bus->header;
+    header->version = SEMP_BUS_VERSION;
+    header->frameCount = count;
+    header->dataBytes = dataBytes;
+    header->mapBytes = mapBytes;
+    atomic_init(&header->published, 0);
+    atomic_init(&header->reserved, 0);
+    bus->data = (uint8_t *)&bus->descriptors[count];
+    bus->mask = count - 1;
+    atomic_thread_fence(memory_order_release);
+    header->magic = SEMP_BUS_MAGIC;
+    return bus;
+}
+
+// Open the bus as a reader
+SEMP_BUS * sempBusOpen(const char *name,
+                       int fd,
+                       bool fromOldest,
+                       SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_BUS_HEADER *header;
+    struct stat status;
+    SEMP_BUS *bus;
+    uint64_t published;
+
+    if (name)
+    {
+        fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0)
+        {
+            sempPrintf(printError, "SEMP: Failed to open the bus %s", name);
+            return nullptr;
+        }
+    }
+    else
+    {
+        // Use a private descriptor, the caller keeps its own
+        fd = dup(fd);
+        if (fd < 0)
+        {
+            sempPrintln(printError, "SEMP: Invalid bus file descriptor");
+            return nullptr;
+        }
+    }
+    if (fstat(fd, &status) || (status.st_size < (off_t)sizeof(SEMP_BUS_HEADER)))
+    {
+        sempPrintln(printError, "SEMP: The bus is not initialized");
+        close(fd);
+        return nullptr;
+    }
+    bus = sempBusMap(fd, status.st_size, false, printError);
+    if (!bus)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    // Verify the layout
+    header = bus->header;
+    if ((header->magic != SEMP_BUS_MAGIC) || (header->version != SEMP_BUS_VERSION)
+        || (header->mapBytes != (uint64_t)status.st_size)
+        || (sempBusBytes(header->frameCount, header->dataBytes) != header->mapBytes))
+    {
+        sempPrintln(printError, "SEMP: The bus is not initialized or has a different version");
+        sempBusClose(&bus);
+        return nullptr;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    bus->data = (uint8_t *)&bus->descriptors[header->frameCount];
+    bus->mask = header->frameCount - 1;
+
+    // Start with the oldest frame still in the ring or the next frame
+    published = atomic_load_explicit(&header->published, memory_order_acquire);
+    bus->next = published;
+    if (fromOldest)
+        bus->next = (published > bus->mask) ? (published - bus->mask) : 0;
+    return bus;
+}
+
+// Write the frame once for all of the readers
+bool sempBusPublish(SEMP_BUS *bus,
+                    uint16_t stream,
+                    SEMP_FRAME *frame,
+                    uint16_t messageId,
+                    uint64_t timestamp)
+{
+    SEMP_BUS_DESCRIPTOR *descriptor;
+    SEMP_BUS_HEADER *header;
+    uint64_t position;
+    uint32_t offset;
+
+    if ((!bus) || (!bus->writer) || (!frame))
+        return false;
+    header = bus->header;
+    if ((!sempFrameValidate(frame)) || (frame->length > (header->dataBytes / 4)))
+    {
+        bus->stats.rejectedFrames++;
+        return false;
+    }
+
+    // Frames do not wrap around the end of the data area
+    position = bus->position;
+    offset = position % header->dataBytes;
+    if ((offset + frame->length) > header->dataBytes)
+    {
+        position += header->dataBytes - offset;
+        offset = 0;
+    }
+
+    // Invalidate the descriptor and reserve the data before overwriting them
+    descriptor = &bus->descriptors[bus->next & bus->mask];
+    atomic_store_explicit(&descriptor->sequence, 0, memory_order_relaxed);
+    atomic_store_explicit(&header->reserved, position + frame->length, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(&bus->data[offset], frame->buffer, frame->length);
+    descriptor->timestamp = timestamp;
+    descriptor->offset = position;
+    descriptor->length = frame->length;
+    descriptor->stream = stream;
+    descriptor->messageId = messageId;
+    descriptor->protocol = (uint8_t)frame->type;
+    atomic_store_explicit(&descriptor->sequence, bus->next + 1, memory_order_release);
+
+    bus->position = position + frame->length;
+    bus->next++;
+    atomic_store_explicit(&header->published, bus->next, memory_order_release);
+    bus->stats.frames++;
+    return true;
+}
+
+// Read the next frame
+bool sempBusRead(SEMP_BUS *bus, SEMP_BUS_FRAME *frame)
+{
+    SEMP_BUS_DESCRIPTOR *descriptor;
+    SEMP_BUS_HEADER *header;
+    uint64_t published;
+    uint64_t sequence;
+    uint64_t reserved;
+
+    if ((!bus) || bus->writer || (!frame))
+        return false;
+    header = bus->header;
+    for (;;)
+    {
+        published = atomic_load_explicit(&header->published, memory_order_acquire);
+        if (bus->next >= published)
+            return false;
+
+        // Lapped, skip to the newer half of the ring
+        if ((published - bus->next) > bus->mask)
+        {
+            bus->stats.lostFrames += published - (bus->mask + 1) / 2 - bus->next;
+            bus->next = published - (bus->mask + 1) / 2;
+        }
+
+        // Copy the descriptor, then verify that it was not rewritten
+        descriptor = &bus->descriptors[bus->next & bus->mask];
+        sequence = atomic_load_explicit(&descriptor->sequence, memory_order_acquire);
+        frame->timestamp = descriptor->timestamp;
+        frame->offset = descriptor->offset;
+        frame->length = descriptor->length;
+        frame->stream = descriptor->stream;
+        frame->messageId = descriptor->messageId;
+        frame->protocol = descriptor->protocol;
+        atomic_thread_fence(memory_order_acquire);
+        reserved = atomic_load_explicit(&header->reserved, memory_order_relaxed);
+        if ((sequence != (bus->next + 1))
+            || (atomic_load_explicit(&descriptor->sequence, memory_order_relaxed) != sequence)
+            || ((reserved - frame->offset) > header->dataBytes))
+        {
+            // Overwritten while reading
+            bus->stats.lostFrames++;
+            bus->next++;
+            continue;
+        }
+
+        frame->data = &bus->data[frame->offset % header->dataBytes];
+        frame->sequence = bus->next++;
+        bus->stats.frames++;
+        return true;
+    }
+}
+
+// Verify that the writer has not reused the frame data
+bool sempBusFrameValid(SEMP_BUS *bus, const SEMP_BUS_FRAME *frame)
+{
+    uint64_t reserved;
+
+    if ((!bus) || (!frame))
+        return false;
+    atomic_thread_fence(memory_order_acquire);
+    reserved = atomic_load_explicit(&bus->header->reserved, memory_order_relaxed);
+    return ((reserved - frame->offset) <= bus->header->dataBytes);
+}
+
+// Get the file descriptor of the shared memory
+int sempBusGetFd(SEMP_BUS *bus)
+{
+    return bus ? bus->fd : -1;
+}
+
+// Read the statistics of this process
+void sempBusGetStats(SEMP_BUS *bus, SEMP_BUS_STATS *stats)
+{
+    if (bus && stats)
+        *stats = bus->stats;
+}
+
+// Unmap the bus
+void sempBusClose(SEMP_BUS **bus)
+{
+    if (bus && *bus)
+    {
+        munmap((*bus)->header, (*bus)->mapBytes);
+        close((*bus)->fd);
+        if ((*bus)->writer && (*bus)->name[0])
+            shm_unlink((*bus)->name);
+        semp_util_free(*bus);
+        *bus = nullptr;
+    }
+}
@@ -0,0 +1,140 @@
+/**
+ * @file Message_Bus.h
+ * @brief 多进程共享内存帧总线 - 头文件
+ * @details 多个进程 (RTK引擎、记录器、监视器) 使用同一数据流时, 解析进程把
+ *          校验通过的帧写入一次共享内存环形缓冲区, 各消费进程直接读取
+ *          共享内存中的帧, 不再各自解析原始数据流.
+ *          - 共享内存由shm_open (按名称) 或memfd_create (按文件描述符) 创建
+ *          - 每帧一个描述符: 序号、数据流编号、协议 (解析器表索引)、
+ *            消息编号、时间戳、数据偏移和长度
+ *          - 只有一个写入者, 消费者以只读方式映射, 读取位置保存在各自进程中
+ *          - 写入者从不等待消费者, 落后超过一圈的消费者跳到较新的帧并统计
+ *            丢失的帧数
+ *          - 零拷贝读取的帧使用完后以sempBusFrameValid确认未被覆盖
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_BUS_H
+#define MESSAGE_BUS_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_BUS_VERSION            1
+#define SEMP_BUS_MINIMUM_FRAMES     64          // Minimum descriptors
+#define SEMP_BUS_MINIMUM_BYTES      (64 * 1024) // Minimum frame data area
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_BUS SEMP_BUS;
+
+// Frame read from the bus, the data points into the shared memory
+typedef struct _SEMP_BUS_FRAME
+{
+    const uint8_t *data;        // Frame bytes in the shared memory
+    uint64_t sequence;          // Frame number on the bus
+    uint64_t timestamp;         // Set by the publisher
+    uint64_t offset;            // Position in the data area, for sempBusFrameValid
+    uint16_t length;            // Frame length in bytes
+    uint16_t stream;            // Stream number set by the publisher
+    uint16_t messageId;         // Message number set by the publisher
+    uint8_t protocol;           // Parser table index of the frame
+} SEMP_BUS_FRAME;
+
+// Bus statistics of this process
+typedef struct _SEMP_BUS_STATS
+{
+    uint64_t frames;            // Frames published or read
+    uint64_t lostFrames;        // Reader: frames overwritten before being read
+    uint64_t rejectedFrames;    // Publisher: bad CRC or too long
+} SEMP_BUS_STATS;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 创建总线, 调用进程为唯一的写入者
+ * @param name shm_open名称 (例如 "/semp_bus"), nullptr使用memfd_create,
+ *             文件描述符由sempBusGetFd得到并传给消费进程 (fork继承或
+ *             UNIX域套接字传递)
+ * @param frameCount 描述符数量, 向上取为2的幂
+ * @param dataBytes 帧数据区大小, 单帧最多占四分之一
+ * @param printError 错误输出回调
+ * @return 总线指针, 失败返回nullptr
+ */
+SEMP_BUS * sempBusCreate(const char *name,
+                         uint32_t frameCount,
+                         uint32_t dataBytes,
+                         SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 以消费者身份打开总线
+ * @param name shm_open名称, nullptr时使用fd
+ * @param fd sempBusGetFd得到的文件描述符
+ * @param fromOldest true从仍保留的最早帧开始读, false只读此后发布的帧
+ * @param printError 错误输出回调
+ * @return 总线指针, 失败返回nullptr
+ */
+SEMP_BUS * sempBusOpen(const char *name,
+                       int fd,
+                       bool fromOldest,
+                       SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 发布一帧
+ * @details 未校验的帧 (延迟校验模式) 在此处校验, 校验失败的帧不发布.
+ *          通常在eomCallback中调用.
+ * @param bus 写入者打开的总线
+ * @param stream 数据流编号
+ * @param frame 帧引用, 由sempGetFrame得到
+ * @param messageId 消息编号 (RTCM消息号, UBX Class/ID等)
+ * @param timestamp 时间戳, 单位由应用约定
+ * @return 发布返回true
+ */
+bool sempBusPublish(SEMP_BUS *bus,
+                    uint16_t stream,
+                    SEMP_FRAME *frame,
+                    uint16_t messageId,
+                    uint64_t timestamp);
+
+/**
+ * @brief 读取下一帧, 不等待
+ * @param bus 消费者打开的总线
+ * @param frame 输出的帧, 数据指向共享内存
+ * @return 读到帧返回true, 没有新帧返回false
+ */
+bool sempBusRead(SEMP_BUS *bus, SEMP_BUS_FRAME *frame);
+
+/**
+ * @brief 确认零拷贝读取的帧数据在使用期间未被写入者覆盖
+ * @param bus 消费者打开的总线
+ * @param frame sempBusRead读到的帧
+ * @return 数据仍然有效返回true
+ */
+bool sempBusFrameValid(SEMP_BUS *bus, const SEMP_BUS_FRAME *frame);
+
+// Get the file descriptor of the shared memory
+int sempBusGetFd(SEMP_BUS *bus);
+
+// Read the statistics of this process
+void sempBusGetStats(SEMP_BUS *bus, SEMP_BUS_STATS *stats);
+
+// Unmap the bus and set the pointer to nullptr, the writer also removes the name
+void sempBusClose(SEMP_BUS **bus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_BUS_H
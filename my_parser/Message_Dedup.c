@@ -0,0 +1,248 @@
+/**
+ * @file Message_Dedup.c
+ * @brief 冗余链路消息去重 - 功能实现
+ * @details 以帧内容的64位哈希、协议索引和消息编号为键, 在按帧数滑动的窗口内
+ *          记录已交付的帧.  哈希表按桶加锁, 多条链路的解析线程可以并发提交.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_Dedup.h"
+#include <stdatomic.h>
+
+//----------------------------------------
+// 内部类型
+//----------------------------------------
+
+// A bucket holds the most recent keys that hash to it
+typedef struct _SEMP_DEDUP_BUCKET
+{
+    atomic_flag lock;                          // Bucket spin lock
+    uint64_t key[SEMP_DEDUP_BUCKET_SLOTS];      // Frame keys, 0 when empty
+    uint32_t sequence[SEMP_DEDUP_BUCKET_SLOTS]; // Insertion sequence numbers
+} SEMP_DEDUP_BUCKET;
+
+typedef struct _SEMP_DEDUP_LINK
+{
+    atomic_uint frames;
+    atomic_uint wins;
+    atomic_uint duplicates;
+    atomic_uint badCrc;
+    atomic_uint evicted;
+} SEMP_DEDUP_LINK;
+
+struct _SEMP_DEDUP
+{
+    atomic_uint sequence;      // Number of distinct frames recorded
+    uint32_t windowFrames;     // Frames remembered before a key expires
+    uint32_t bucketMask;       // Number of buckets - 1
+    uint8_t linkCount;         // Number of links
+    SEMP_DEDUP_LINK links[SEMP_DEDUP_MAX_LINKS];
+    SEMP_DEDUP_BUCKET *buckets;
+};
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+// Build the key from the frame contents, protocol and message number
+static uint64_t sempDedupKey(const SEMP_FRAME *frame, uint16_t messageId)
+{
+    uint64_t key;
+
+    key = semp_util_hash64(frame->buffer, frame->length,
+                           (((uint64_t)frame->type) << 16) | messageId);
+
+    // Zero marks an empty slot
+    return key ? key : 1;
+}
+
+// Record the key, returns true when the key was not in the window.
+// Sets evicted when the replaced key was still within the window.
+static bool sempDedupInsert(SEMP_DEDUP *dedup, uint64_t key, bool *evicted)
+{
+    SEMP_DEDUP_BUCKET *bucket;
+    uint32_t age;
+    uint32_t oldestAge;
+    int oldest;
+    uint32_t now;
+    int slot;
+
+    bucket = &dedup->buckets[(key >> 32) & dedup->bucketMask];
+    while (atomic_flag_test_and_set_explicit(&bucket->lock, memory_order_acquire))
+        ;
+
+    // Look for the key within the window, remember the oldest slot
+    now = atomic_load_explicit(&dedup->sequence, memory_order_relaxed);
+    oldest = 0;
+    oldestAge = 0;
+    for (slot = 0; slot < SEMP_DEDUP_BUCKET_SLOTS; slot++)
+    {
+        if (!bucket->key[slot])
+        {
+            // Empty slot, nothing older exists
+            oldest = slot;
+            oldestAge = UINT32_MAX;
+            continue;
+        }
+        age = now - bucket->sequence[slot];
+        if ((bucket->key[slot] == key) && (age < dedup->windowFrames))
+        {
+            atomic_flag_clear_explicit(&bucket->lock, memory_order_release);
+            return false;
+        }
+        if (age > oldestAge)
+        {
+            oldest = slot;
+            oldestAge = age;
+        }
+    }
+
+    // First copy of this frame, replace the oldest entry
+    *evicted = (oldestAge < dedup->windowFrames);
+    bucket->key[oldest] = key;
+    bucket->sequence[oldest] = atomic_fetch_add_explicit(&dedup->sequence, 1,
+                                                         memory_order_relaxed);
+    atomic_flag_clear_explicit(&bucket->lock, memory_order_release);
+    return true;
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Allocate the deduplicator
+SEMP_DEDUP * sempDedupBegin(uint32_t windowFrames,
+                            uint8_t linkCount,
+                            SEMP_PRINTF_CALLBACK printError)
+{
+    uint32_t bucketCount;
+    SEMP_DEDUP *dedup;
+    uint32_t index;
+
+    if ((!linkCount) || (linkCount > SEMP_DEDUP_MAX_LINKS))
+    {
+        sempPrintf(printError, "SEMP: Dedup link count must be 1 - %d",
+                   SEMP_DEDUP_MAX_LINKS);
+        return nullptr;
+    }
+    if (windowFrames < SEMP_DEDUP_MINIMUM_WINDOW)
+        windowFrames = SEMP_DEDUP_MINIMUM_WINDOW;
+
+    // Size the table so the window fills it at most half way
+    bucketCount = 1;
+    while ((bucketCount * SEMP_DEDUP_BUCKET_SLOTS) < (windowFrames * 2))
+        bucketCount <<= 1;
+
+    dedup = (SEMP_DEDUP *)semp_util_malloc(sizeof(SEMP_DEDUP));
+    if (!dedup)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the dedup structure");
+        return nullptr;
+    }
+    dedup->buckets = (SEMP_DEDUP_BUCKET *)semp_util_malloc(bucketCount * sizeof(SEMP_DEDUP_BUCKET));
+    if (!dedup->buckets)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the dedup table");
+        semp_util_free(dedup);
+        return nullptr;
+    }
+
+    // Initialize the structure
+    atomic_init(&dedup->sequence, 0);
+    dedup->windowFrames = windowFrames;
+    dedup->bucketMask = bucketCount - 1;
+    dedup->linkCount = linkCount;
+    for (index = 0; index < SEMP_DEDUP_MAX_LINKS; index++)
+    {
+        atomic_init(&dedup->links[index].frames, 0);
+        atomic_init(&dedup->links[index].wins, 0);
+        atomic_init(&dedup->links[index].duplicates, 0);
+        atomic_init(&dedup->links[index].badCrc, 0);
+        atomic_init(&dedup->links[index].evicted, 0);
+    }
+    for (index = 0; index < bucketCount; index++)
+    {
+        atomic_flag_clear(&dedup->buckets[index].lock);
+        memset(dedup->buckets[index].key, 0, sizeof(dedup->buckets[index].key));
+        memset(dedup->buckets[index].sequence, 0, sizeof(dedup->buckets[index].sequence));
+    }
+    return dedup;
+}
+
+// Determine if this frame is the first copy
+bool sempDedupFrame(SEMP_DEDUP *dedup,
+                    uint8_t link,
+                    SEMP_FRAME *frame,
+                    uint16_t messageId)
+{
+    SEMP_DEDUP_LINK *stats;
+    bool evicted;
+
+    if ((!dedup) || (!frame) || (link >= dedup->linkCount))
+        return false;
+    stats = &dedup->links[link];
+    atomic_fetch_add_explicit(&stats->frames, 1, memory_order_relaxed);
+
+    // Never record a damaged copy, the other link may deliver a good one
+    if (!sempFrameValidate(frame))
+    {
+        atomic_fetch_add_explicit(&stats->badCrc, 1, memory_order_relaxed);
+        return false;
+    }
+
+    if (sempDedupInsert(dedup, sempDedupKey(frame, messageId), &evicted))
+    {
+        atomic_fetch_add_explicit(&stats->wins, 1, memory_order_relaxed);
+        if (evicted)
+            atomic_fetch_add_explicit(&stats->evicted, 1, memory_order_relaxed);
+        return true;
+    }
+    atomic_fetch_add_explicit(&stats->duplicates, 1, memory_order_relaxed);
+    return false;
+}
+
+// Read the link statistics
+void sempDedupGetStats(SEMP_DEDUP *dedup, uint8_t link, SEMP_DEDUP_LINK_STATS *stats)
+{
+    if (dedup && stats && (link < dedup->linkCount))
+    {
+        stats->frames = atomic_load(&dedup->links[link].frames);
+        stats->wins = atomic_load(&dedup->links[link].wins);
+        stats->duplicates = atomic_load(&dedup->links[link].duplicates);
+        stats->badCrc = atomic_load(&dedup->links[link].badCrc);
+        stats->evicted = atomic_load(&dedup->links[link].evicted);
+    }
+}
+
+// Print the per link statistics
+void sempDedupPrintStats(SEMP_DEDUP *dedup, SEMP_PRINTF_CALLBACK print)
+{
+    SEMP_DEDUP_LINK_STATS stats;
+    uint8_t link;
+
+    if (print && dedup)
+    {
+        sempPrintf(print, "Dedup: window %d frames, %d buckets",
+                   dedup->windowFrames, dedup->bucketMask + 1);
+        for (link = 0; link < dedup->linkCount; link++)
+        {
+            sempDedupGetStats(dedup, link, &stats);
+            sempPrintf(print, "    link %d: %u frames, %u wins (%u%%), %u duplicates, %u bad CRC, %u evicted",
+                       link, stats.frames, stats.wins,
+                       stats.frames ? (uint32_t)((100ull * stats.wins) / stats.frames) : 0,
+                       stats.duplicates, stats.badCrc, stats.evicted);
+        }
+    }
+}
+
+// Free the deduplicator
+void sempDedupStop(SEMP_DEDUP **dedup)
+{
+    if (dedup && *dedup)
+    {
+        semp_util_free((*dedup)->buckets);
+        semp_util_free(*dedup);
+        *dedup = nullptr;
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file Message_Dedup.h
+ * @brief 冗余链路消息去重 - 头文件
+ * @details 同一数据流经多条独立链路(电台/蜂窝)到达时, 只交付最先到达的副本,
+ *          并统计每条链路的领先次数
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_DEDUP_H
+#define MESSAGE_DEDUP_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_DEDUP_MAX_LINKS        8
+#define SEMP_DEDUP_BUCKET_SLOTS     8   // Keys per hash bucket
+#define SEMP_DEDUP_MINIMUM_WINDOW   64  // Minimum number of remembered frames
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_DEDUP SEMP_DEDUP;
+
+// Per link statistics
+typedef struct _SEMP_DEDUP_LINK_STATS
+{
+    uint32_t frames;     // Frames offered by this link
+    uint32_t wins;       // First copies, delivered downstream
+    uint32_t duplicates; // Copies already delivered by another link
+    uint32_t badCrc;     // Frames that failed validation
+    uint32_t evicted;    // Keys still in the window displaced by this link's frames
+} SEMP_DEDUP_LINK_STATS;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 分配去重器
+ * @param windowFrames 滑动窗口大小, 以不同帧的数量计
+ * @param linkCount 链路数量, 最大SEMP_DEDUP_MAX_LINKS
+ * @param printError 错误输出回调
+ * @return 去重器指针, 失败返回nullptr
+ */
+SEMP_DEDUP * sempDedupBegin(uint32_t windowFrames,
+                            uint8_t linkCount,
+                            SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 判断帧是否为第一个到达的副本
+ * @details 可从多个线程同时调用, 每条链路应由单一线程提交.
+ *          未校验的帧(惰性模式)在此处完成校验, 校验失败的帧不会被记录.
+ *          每个哈希桶最多记录SEMP_DEDUP_BUCKET_SLOTS个键, 桶满时替换最早的键,
+ *          即使该键仍在窗口内; 此后到达的该帧副本会再次交付, 并计入evicted.
+ * @param dedup 去重器
+ * @param link 链路编号
+ * @param frame 已捕获的帧 (sempGetFrame)
+ * @param messageId 消息编号 (RTCM消息号, UBX Class/ID等)
+ * @return 第一个副本返回true, 重复或校验失败返回false
+ */
+bool sempDedupFrame(SEMP_DEDUP *dedup,
+                    uint8_t link,
+                    SEMP_FRAME *frame,
+                    uint16_t messageId);
+
+/**
+ * @brief 读取链路统计
+ * @param dedup 去重器
+ * @param link 链路编号
+ * @param stats 输出统计
+ */
+void sempDedupGetStats(SEMP_DEDUP *dedup, uint8_t link, SEMP_DEDUP_LINK_STATS *stats);
+
+// Print the per link statistics
+void sempDedupPrintStats(SEMP_DEDUP *dedup, SEMP_PRINTF_CALLBACK print);
+
+// Free the deduplicator and set the pointer to nullptr
+void sempDedupStop(SEMP_DEDUP **dedup);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_DEDUP_H
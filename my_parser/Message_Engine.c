@@ -0,0 +1,319 @@
+/**
+ * @file Message_Engine.c
+ * @brief 整块数据解析引擎 - 功能实现
+ * @details sempParseBuffer的三种实现, 编译时通过SEMP_ENGINE选择:
+ *          - goto (GCC/Clang默认): 状态为小整数, 整个多协议状态机在一个函数中,
+ *            以标签地址表 (labels-as-values) 分派
+ *          - switch: 同上, 以switch分派, 供不支持标签地址的编译器使用
+ *          - pointer: 逐字节调用sempParseNextByte
+ *          载荷与语句正文状态在循环中直接处理, 长度、CRC和剩余字节数保存在
+ *          局部变量中, 一段数据处理完再写回解析器. 帧头、CRC字节、前导符
+ *          搜索等其他状态调用原状态函数, 因此输出与sempParseNextByte完全相同.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stddef.h>
+#include "Message_Parser.h"
+#include "Parse_NMEA.h"
+#include "Parse_RTCM.h"
+#include "Parse_UBLOX.h"
+#include "Parse_Unicore_Binary.h"
+#include "Parse_Unicore_Hash.h"
+#include "Message_Framing.h"
+
+#if !defined(SEMP_ENGINE_POINTER) && !defined(SEMP_ENGINE_SWITCH) && !defined(__GNUC__)
+#define SEMP_ENGINE_SWITCH
+#endif
+
+#ifndef SEMP_ENGINE_POINTER
+
+// Bytes kept free at the end of the buffer while reading sentence text,
+// more than the NMEA and Unicore hash sentence overheads
+#define SEMP_ENGINE_TEXT_MARGIN     8
+
+//----------------------------------------
+// 引擎状态
+//----------------------------------------
+
+// States handled in the engine loop, all other states call the state routine
+typedef enum
+{
+    SEMP_ENGINE_ROUTINE = 0,    // Call parse->state through sempParseNextByte
+    SEMP_ENGINE_NMEA_TEXT,      // sempNmeaFindAsterisk
+    SEMP_ENGINE_RTCM_DATA,      // sempRtcmReadData
+    SEMP_ENGINE_UBLOX_PAYLOAD,  // sempUbloxPayload
+    SEMP_ENGINE_UNICORE_DATA,   // sempUnicoreBinaryReadData
+    SEMP_ENGINE_HASH_TEXT,      // sempUnicoreHashFindAsterisk
+    SEMP_ENGINE_CUSTOM_DATA,    // sempCustomReadData
+    SEMP_ENGINE_FRAMING_BODY,   // sempFramingBody
+    SEMP_ENGINE_STATES
+} SEMP_ENGINE_STATE;
+
+// Protocol state table entries handled by the engine.  The state tables
+// are append only, the index of a state never changes.
+typedef struct _SEMP_ENGINE_ENTRY
+{
+    const SEMP_PROTOCOL_STATES *protocol;
+    uint8_t index;              // Index into the protocol's state table
+    uint8_t engineState;        // SEMP_ENGINE_STATE
+} SEMP_ENGINE_ENTRY;
+
+static const SEMP_ENGINE_ENTRY sempEngineEntries[] =
+{
+    {&sempRtcmProtocolStates,           4, SEMP_ENGINE_RTCM_DATA},
+    {&sempUbloxProtocolStates,          5, SEMP_ENGINE_UBLOX_PAYLOAD},
+    {&sempUnicoreBinaryProtocolStates,  3, SEMP_ENGINE_UNICORE_DATA},
+    {&sempCustomProtocolStates,         3, SEMP_ENGINE_CUSTOM_DATA},
+    {&sempNmeaProtocolStates,           1, SEMP_ENGINE_NMEA_TEXT},
+    {&sempUnicoreHashProtocolStates,    1, SEMP_ENGINE_HASH_TEXT},
+    {&sempFramingProtocolStates,        2, SEMP_ENGINE_FRAMING_BODY},
+};
+
+#define SEMP_ENGINE_ENTRY_COUNT (sizeof(sempEngineEntries) / sizeof(sempEngineEntries[0]))
+
+// The Unicore binary and custom data states share one loop
+_Static_assert(offsetof(SEMP_SCRATCH_PAD, unicoreBinary.bytesRemaining)
+               == offsetof(SEMP_SCRATCH_PAD, custom.bytesRemaining),
+               "Unicore binary and custom bytesRemaining offsets differ");
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+// Translate the state routine into an engine state
+static uint8_t sempEngineState(const SEMP_PARSE_STATE *parse)
+{
+    const SEMP_ENGINE_ENTRY *entry;
+    SEMP_PARSE_ROUTINE state = parse->state;
+
+    if (state == sempFirstByte)
+        return SEMP_ENGINE_ROUTINE;
+    for (entry = sempEngineEntries; entry < &sempEngineEntries[SEMP_ENGINE_ENTRY_COUNT]; entry++)
+    {
+        if (state == entry->protocol->states[entry->index])
+        {
+            // The inline CRC must match the routine that the preamble set
+            if (parse->computeCrc && (parse->computeCrc != entry->protocol->computeCrc))
+                return SEMP_ENGINE_ROUTINE;
+            return entry->engineState;
+        }
+    }
+    return SEMP_ENGINE_ROUTINE;
+}
+
+// Number of bytes that may be consumed without a state change, the byte
+// ending the field and the byte filling the buffer go to the routine
+static size_t sempEngineRoom(const SEMP_PARSE_STATE *parse, size_t available, uint32_t fieldBytes)
+{
+    size_t room;
+
+    if (parse->msg_length >= parse->buffer_length)
+        return 0;
+    room = parse->buffer_length - parse->msg_length;
+    if (room > fieldBytes)
+        room = fieldBytes;
+    return (room < available) ? room : available;
+}
+
+// Number of sentence text bytes that may be consumed before the length check
+static size_t sempEngineTextRoom(const SEMP_PARSE_STATE *parse, size_t available)
+{
+    size_t room;
+
+    if ((uint32_t)(parse->msg_length + SEMP_ENGINE_TEXT_MARGIN) > parse->buffer_length)
+        return 0;
+    room = parse->buffer_length - SEMP_ENGINE_TEXT_MARGIN - parse->msg_length;
+    return (room < available) ? room : available;
+}
+
+//----------------------------------------
+// 分派宏
+//----------------------------------------
+
+#ifdef SEMP_ENGINE_SWITCH
+#define SEMP_ENGINE_DISPATCH(state)     switch (state)
+#define SEMP_ENGINE_CASE(state)         case state:
+#define SEMP_ENGINE_DEFAULT             default:
+#else
+#define SEMP_ENGINE_DISPATCH(state)     goto *labels[state];
+#define SEMP_ENGINE_CASE(state)         state##_LABEL:
+#define SEMP_ENGINE_DEFAULT
+#endif
+
+#endif // SEMP_ENGINE_POINTER
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+#ifdef SEMP_ENGINE_POINTER
+
+// Parse a block of data, byte by byte
+void sempParseBuffer(SEMP_PARSE_STATE *parse, const uint8_t *data, size_t length)
+{
+    if (parse && data)
+    {
+        parse->inputStart = data;
+        while (length--)
+        {
+            parse->inputByte = data;
+            sempParseNextByte(parse, *data++);
+        }
+        parse->inputStart = nullptr;
+        parse->inputByte = nullptr;
+    }
+}
+
+#else
+
+// Parse a block of data
+void sempParseBuffer(SEMP_PARSE_STATE *parse, const uint8_t *data, size_t length)
+{
+#ifndef SEMP_ENGINE_SWITCH
+    static const void * const labels[SEMP_ENGINE_STATES] =
+    {
+        &&SEMP_ENGINE_ROUTINE_LABEL,
+        &&SEMP_ENGINE_NMEA_TEXT_LABEL,
+        &&SEMP_ENGINE_RTCM_DATA_LABEL,
+        &&SEMP_ENGINE_UBLOX_PAYLOAD_LABEL,
+        &&SEMP_ENGINE_UNICORE_DATA_LABEL,
+        &&SEMP_ENGINE_HASH_TEXT_LABEL,
+        &&SEMP_ENGINE_CUSTOM_DATA_LABEL,
+        &&SEMP_ENGINE_FRAMING_BODY_LABEL,
+    };
+#endif
+    SEMP_SCRATCH_PAD *scratchPad;
+    const uint8_t *end;
+    uint8_t *buffer;
+    size_t count;
+    size_t index;
+    uint32_t crc;
+    uint8_t ck_a;
+    uint8_t ck_b;
+    uint8_t byte;
+
+    if ((!parse) || (!data))
+        return;
+    parse->inputStart = data;
+    end = data + length;
+    while (data < end)
+    {
+        scratchPad = (SEMP_SCRATCH_PAD *)parse->scratchPad;
+        buffer = &parse->buffer[parse->msg_length];
+        SEMP_ENGINE_DISPATCH(sempEngineState(parse))
+        {
+        SEMP_ENGINE_CASE(SEMP_ENGINE_NMEA_TEXT)
+        SEMP_ENGINE_CASE(SEMP_ENGINE_HASH_TEXT)
+            // Checksum the sentence text up to the asterisk
+            count = sempEngineTextRoom(parse, end - data);
+            crc = parse->crc;
+            for (index = 0; (index < count) && (data[index] != '*'); index++)
+            {
+                byte = data[index];
+                buffer[index] = byte;
+                crc ^= byte;
+            }
+            parse->crc = crc;
+            parse->msg_length += index;
+            data += index;
+            goto routine;
+
+        SEMP_ENGINE_CASE(SEMP_ENGINE_RTCM_DATA)
+            // The message data, the last byte starts the CRC
+            if (scratchPad->rtcm.bytesRemaining <= 1)
+                goto routine;
+            count = sempEngineRoom(parse, end - data, scratchPad->rtcm.bytesRemaining - 1);
+            if (parse->computeCrc && (!parse->lazyCrc))
+            {
+                crc = parse->crc;
+                for (index = 0; index < count; index++)
+                {
+                    byte = data[index];
+                    buffer[index] = byte;
+                    crc = ((crc << 8) ^ semp_crc24qTable[byte ^ ((crc >> 16) & 0xff)]) & 0x00ffffff;
+                }
+                parse->crc = crc;
+            }
+            else
+                memcpy(buffer, data, count);
+            scratchPad->rtcm.bytesRemaining -= count;
+            parse->msg_length += count;
+            data += count;
+            goto routine;
+
+        SEMP_ENGINE_CASE(SEMP_ENGINE_UBLOX_PAYLOAD)
+            // The payload, the byte following it is CK_A
+            count = sempEngineRoom(parse, end - data, scratchPad->ublox.bytesRemaining);
+            if (!parse->lazyCrc)
+            {
+                ck_a = scratchPad->ublox.ck_a;
+                ck_b = scratchPad->ublox.ck_b;
+                for (index = 0; index < count; index++)
+                {
+                    byte = data[index];
+                    buffer[index] = byte;
+                    ck_a += byte;
+                    ck_b += ck_a;
+                }
+                scratchPad->ublox.ck_a = ck_a;
+                scratchPad->ublox.ck_b = ck_b;
+            }
+            else
+                memcpy(buffer, data, count);
+            scratchPad->ublox.bytesRemaining -= count;
+            parse->msg_length += count;
+            data += count;
+            goto routine;
+
+        SEMP_ENGINE_CASE(SEMP_ENGINE_UNICORE_DATA)
+        SEMP_ENGINE_CASE(SEMP_ENGINE_CUSTOM_DATA)
+            // The message data, the last byte starts the CRC
+            if (scratchPad->unicoreBinary.bytesRemaining <= 1)
+                goto routine;
+            count = sempEngineRoom(parse, end - data, scratchPad->unicoreBinary.bytesRemaining - 1);
+            if (parse->computeCrc && (!parse->lazyCrc))
+            {
+                crc = parse->crc;
+                for (index = 0; index < count; index++)
+                {
+                    byte = data[index];
+                    buffer[index] = byte;
+                    crc = (uint32_t)(semp_crc32Table[(crc ^ byte) & 0xff] ^ (crc >> 8));
+                }
+                parse->crc = crc;
+            }
+            else
+                memcpy(buffer, data, count);
+            scratchPad->unicoreBinary.bytesRemaining -= count;
+            parse->msg_length += count;
+            data += count;
+            goto routine;
+
+        SEMP_ENGINE_CASE(SEMP_ENGINE_FRAMING_BODY)
+            // Described protocols, the span check follows the last byte
+            if (scratchPad->framing.bytesRemaining <= 1)
+                goto routine;
+            count = sempEngineRoom(parse, end - data, scratchPad->framing.bytesRemaining - 1);
+            memcpy(buffer, data, count);
+            scratchPad->framing.bytesRemaining -= count;
+            parse->msg_length += count;
+            data += count;
+            goto routine;
+
+        SEMP_ENGINE_CASE(SEMP_ENGINE_ROUTINE)
+        SEMP_ENGINE_DEFAULT
+        routine:
+            // State changes, headers, CRC bytes and the preamble search
+            if (data < end)
+            {
+                parse->inputByte = data;
+                sempParseNextByte(parse, *data++);
+            }
+        }
+    }
+    parse->inputStart = nullptr;
+    parse->inputByte = nullptr;
+}
+
+#endif // SEMP_ENGINE_POINTER
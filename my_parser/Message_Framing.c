@@ -0,0 +1,266 @@
+/**
+ * @file Message_Framing.c
+ * @brief 描述表驱动的通用二进制帧解析 - 功能实现
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_Framing.h"
+#include "Parse_RTCM.h"
+#include "Parse_UBLOX.h"
+#include "Parse_Unicore_Binary.h"
+#include "../lib/semp_crc_sbf.h" // 包含CRC-16-CCITT查找表
+
+//----------------------------------------
+// 内置协议描述表
+//----------------------------------------
+
+const SEMP_FRAMING_DESCRIPTOR sempFramingRtcm =
+{
+    "RTCM", {0xd3}, 1, 3, 1, 2, true, false, 0x03ff, 2, 0, 3, sempRtcmValidate
+};
+
+const SEMP_FRAMING_DESCRIPTOR sempFramingUblox =
+{
+    "UBLOX", {0xb5, 0x62}, 2, 6, 4, 2, false, false, 0xffff, 0, 0, 2, sempUbloxValidate
+};
+
+const SEMP_FRAMING_DESCRIPTOR sempFramingUnicoreBinary =
+{
+    "Unicore", {0xaa, 0x44, 0xb5}, 3, sizeof(SEMP_UNICORE_HEADER), 6, 2, false, false,
+    0xffff, 0, 0, 4, sempUnicoreBinaryValidate
+};
+
+const SEMP_FRAMING_DESCRIPTOR sempFramingCustom =
+{
+    "Custom", {0xaa, 0x44, 0x18}, 3, sizeof(SEMP_CUSTOM_HEADER), 12, 2, false, false,
+    0xffff, 0, 0, 4, sempCustomValidate
+};
+
+// The SBF length counts the whole block including the 8 byte header,
+// the CRC follows the sync bytes and covers the ID, length and payload
+const SEMP_FRAMING_DESCRIPTOR sempFramingSbf =
+{
+    "SBF", {'$', '@'}, 2, 8, 6, 2, false, true, 0xffff, 8, 4, 0, sempSbfValidate
+};
+
+SEMP_FRAMING_PREAMBLE(sempFramingRtcmPreamble, sempFramingRtcm)
+SEMP_FRAMING_PREAMBLE(sempFramingUbloxPreamble, sempFramingUblox)
+SEMP_FRAMING_PREAMBLE(sempFramingUnicoreBinaryPreamble, sempFramingUnicoreBinary)
+SEMP_FRAMING_PREAMBLE(sempFramingCustomPreamble, sempFramingCustom)
+SEMP_FRAMING_PREAMBLE(sempFramingSbfPreamble, sempFramingSbf)
+
+// 校验整帧CRC (ID到负载末尾)
+bool sempSbfValidate(const uint8_t *buffer, uint16_t length)
+{
+    const uint8_t *data;
+    uint16_t crc = 0;
+
+    if (length < 8)
+        return false;
+    for (data = &buffer[4]; data < &buffer[length]; data++)
+        crc = semp_ccitt_crc_update(crc, *data);
+    return (crc == (buffer[2] | (buffer[3] << 8)));
+}
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+static const SEMP_FRAMING_DESCRIPTOR * sempFramingDescriptor(const SEMP_SCRATCH_PAD *scratchPad)
+{
+    const SEMP_FRAMING_DESCRIPTOR *descriptor;
+
+    memcpy(&descriptor, scratchPad->framing.descriptor, sizeof(descriptor));
+    return descriptor;
+}
+
+//----------------------------------------
+// 通用分帧状态机函数
+//----------------------------------------
+static bool sempFramingBody(SEMP_PARSE_STATE *parse, uint8_t data);
+static bool sempFramingHeader(SEMP_PARSE_STATE *parse, uint8_t data);
+static bool sempFramingSync(SEMP_PARSE_STATE *parse, uint8_t data);
+
+// 校验整帧并交付
+static bool sempFramingEndOfFrame(SEMP_PARSE_STATE *parse, const SEMP_FRAMING_DESCRIPTOR *descriptor)
+{
+    // A restored snapshot does not carry the span routine
+    parse->validateFrame = descriptor->validateFrame;
+
+    if (parse->lazyCrc && descriptor->validateFrame)
+    {
+        // Framed by length only, the CRC is checked by sempValidateFrame
+        parse->verdict = SEMP_FRAME_UNVALIDATED;
+        sempEndOfFrame(parse);
+    }
+    else if ((!descriptor->validateFrame)
+             || descriptor->validateFrame(parse->buffer, parse->msg_length)
+             || (parse->config->badCrc && (!parse->config->badCrc(parse))))
+    {
+        sempEndOfFrame(parse);
+    }
+    else
+    {
+        sempPrintf(parse->printDebug, "SEMP %s: %s, 0x%04x (%d) bytes, bad CRC",
+                   parse->config->parserName, descriptor->name,
+                   parse->msg_length, parse->msg_length);
+    }
+
+    parse->state = sempFirstByte;
+    return false;
+}
+
+// 读取负载和帧尾, 长度已知, 只计数
+static bool sempFramingBody(SEMP_PARSE_STATE *parse, uint8_t data)
+{
+    SEMP_SCRATCH_PAD *scratchPad = (SEMP_SCRATCH_PAD *)parse->scratchPad;
+
+    if (--scratchPad->framing.bytesRemaining)
+        return true;
+    return sempFramingEndOfFrame(parse, sempFramingDescriptor(scratchPad));
+}
+
+// 读取帧头, 帧头完整后取出长度字段
+static bool sempFramingHeader(SEMP_PARSE_STATE *parse, uint8_t data)
+{
+    SEMP_SCRATCH_PAD *scratchPad = (SEMP_SCRATCH_PAD *)parse->scratchPad;
+    const SEMP_FRAMING_DESCRIPTOR *descriptor = sempFramingDescriptor(scratchPad);
+    const uint8_t *field;
+    uint32_t frameLength;
+    uint16_t length;
+
+    if (parse->msg_length < descriptor->headerBytes)
+        return true;
+
+    field = &parse->buffer[descriptor->lengthOffset];
+    length = field[0];
+    if (descriptor->lengthBytes == 2)
+        length = descriptor->lengthBigEndian ? ((field[0] << 8) | field[1])
+                                             : (field[0] | (field[1] << 8));
+    frameLength = descriptor->lengthIsFrame
+                ? length
+                : (uint32_t)(descriptor->headerBytes + length + descriptor->trailerBytes);
+
+    // Verify the length and that the frame fits in the buffer
+    if ((length & (~descriptor->lengthMask)) || (length < descriptor->minimumLength)
+        || (frameLength < descriptor->headerBytes)
+        || (descriptor->frameMultiple && (frameLength % descriptor->frameMultiple))
+        || (frameLength > parse->buffer_length))
+    {
+        sempPrintf(parse->printDebug, "SEMP %s: %s invalid length %d",
+                   parse->config->parserName, descriptor->name, length);
+        sempResync(parse);
+        return false;
+    }
+
+    // Jump to the end of the frame
+    scratchPad->framing.bytesRemaining = frameLength - descriptor->headerBytes;
+    if (!scratchPad->framing.bytesRemaining)
+        return sempFramingEndOfFrame(parse, descriptor);
+    parse->state = sempFramingBody;
+    return true;
+}
+
+// 读取其余同步字节
+static bool sempFramingSync(SEMP_PARSE_STATE *parse, uint8_t data)
+{
+    SEMP_SCRATCH_PAD *scratchPad = (SEMP_SCRATCH_PAD *)parse->scratchPad;
+    const SEMP_FRAMING_DESCRIPTOR *descriptor = sempFramingDescriptor(scratchPad);
+
+    if (data != descriptor->sync[parse->msg_length - 1])
+        // Invalid sync byte, start searching for a preamble byte
+        return sempFirstByte(parse, data);
+
+    if (parse->msg_length == descriptor->syncBytes)
+        parse->state = sempFramingHeader;
+    return true;
+}
+
+// 检查第一个同步字节
+bool sempFramingPreamble(SEMP_PARSE_STATE *parse,
+                         uint8_t data,
+                         const SEMP_FRAMING_DESCRIPTOR *descriptor)
+{
+    SEMP_SCRATCH_PAD *scratchPad = (SEMP_SCRATCH_PAD *)parse->scratchPad;
+
+    if (data != descriptor->sync[0])
+        return false;
+
+    scratchPad->framing.bytesRemaining = 0;
+    memcpy(scratchPad->framing.descriptor, &descriptor, sizeof(descriptor));
+    parse->validateFrame = descriptor->validateFrame;
+    parse->state = (descriptor->syncBytes > 1) ? sempFramingSync : sempFramingHeader;
+    return true;
+}
+
+// 状态表, 快照中以表索引保存状态, 新状态只能追加在表尾
+static const SEMP_PARSE_ROUTINE sempFramingStates[] =
+{
+    sempFramingSync,
+    sempFramingHeader,
+    sempFramingBody,
+};
+
+static const char * const sempFramingStateNames[] =
+{
+    "sempFramingSync",
+    "sempFramingHeader",
+    "sempFramingBody",
+};
+
+const SEMP_PROTOCOL_STATES sempFramingProtocolStates =
+{
+    SEMP_PROTOCOL_FRAMING,
+    nullptr,
+    nullptr,
+    nullptr,
+    sempFramingStates,
+    sempFramingStateNames,
+    sizeof(sempFramingStates) / sizeof(sempFramingStates[0]),
+};
+
+// 由解析器表重新取得部分帧的描述表
+const SEMP_FRAMING_DESCRIPTOR * sempFramingReplay(const SEMP_PARSE_STATE *parse,
+                                                  uint8_t parserType,
+                                                  const uint8_t *frame,
+                                                  uint16_t length,
+                                                  SEMP_SCRATCH_PAD *scratchPad)
+{
+    const SEMP_FRAMING_DESCRIPTOR *descriptor;
+    SEMP_PARSE_STATE replay;
+    uint8_t firstByte;
+    uint8_t index;
+
+    if ((!parse) || (!frame) || (!length) || (parserType >= parse->config->parsers_count))
+        return nullptr;
+
+    // Pass the first byte to the preamble as sempFirstByte does
+    memset(&replay, 0, sizeof(replay));
+    firstByte = frame[0];
+    replay.state = sempFirstByte;
+    replay.buffer = &firstByte;
+    replay.buffer_length = 1;
+    replay.msg_length = 1;
+    replay.scratchPad = &replay.scratch;
+    replay.parser_type = parserType;
+    replay.config = parse->config;
+    if (!parse->config->parsers_table[parserType](&replay, firstByte))
+        return nullptr;
+
+    // The table entry must be a described protocol
+    for (index = 0; index < sizeof(sempFramingStates) / sizeof(sempFramingStates[0]); index++)
+        if (replay.state == sempFramingStates[index])
+            break;
+    if (index >= sizeof(sempFramingStates) / sizeof(sempFramingStates[0]))
+        return nullptr;
+
+    // Its sync bytes must match the bytes received
+    descriptor = sempFramingDescriptor(&replay.scratch);
+    for (index = 1; (index < descriptor->syncBytes) && (index < length); index++)
+        if (frame[index] != descriptor->sync[index])
+            return nullptr;
+
+    memcpy(scratchPad->framing.descriptor, &descriptor, sizeof(descriptor));
+    return descriptor;
+}
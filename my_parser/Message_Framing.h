@@ -0,0 +1,129 @@
+/**
+ * @file Message_Framing.h
+ * @brief 描述表驱动的通用二进制帧解析 - 头文件
+ * @details 多数二进制协议的帧结构相同: 同步字节、固定偏移处的长度字段、
+ *          帧头、负载和帧尾CRC. 用SEMP_FRAMING_DESCRIPTOR描述这些参数,
+ *          由一组通用状态函数完成分帧: 长度已知后直接按字节数跳到帧尾,
+ *          帧结束时对整帧做一次span校验, 不逐字节计算CRC. 新的厂商格式
+ *          只需一个描述表和一行前导函数定义, 即可使用sempParseBuffer的
+ *          快速路径. 超过缓冲区的帧不分段输出, span校验需要整帧.
+ *
+ *          描述表地址保存在暂存区中, 只在进程内有效. 快照不保存该地址,
+ *          恢复时由sempFramingReplay从目标解析器的解析器表重新取得.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_FRAMING_H
+#define MESSAGE_FRAMING_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_FRAMING_MAX_SYNC_BYTES     4
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+// Frame layout of a binary protocol: sync bytes, header holding the
+// length field, payload and trailing CRC.  The total frame length is
+// headerBytes + length + trailerBytes, or the length itself when
+// lengthIsFrame is set.
+typedef struct _SEMP_FRAMING_DESCRIPTOR
+{
+    const char *name;                   // Protocol name for the debug output
+    uint8_t sync[SEMP_FRAMING_MAX_SYNC_BYTES]; // Sync bytes starting the frame
+    uint8_t syncBytes;                  // Number of sync bytes, 1 - 4
+    uint8_t headerBytes;                // Bytes preceding the payload, sync bytes included
+    uint8_t lengthOffset;               // Offset of the length field in the header
+    uint8_t lengthBytes;                // Width of the length field, 1 or 2
+    bool lengthBigEndian;               // Byte order of the length field
+    bool lengthIsFrame;                 // Length counts the whole frame, not the payload
+    uint16_t lengthMask;                // Length bits, the other bits must be zero
+    uint16_t minimumLength;             // Smallest valid length value
+    uint8_t frameMultiple;              // Frame length multiple, 0 for any length
+    uint8_t trailerBytes;               // CRC bytes following the payload
+    SEMP_VALIDATE_FRAME validateFrame;  // Span check of the frame, nullptr if none
+} SEMP_FRAMING_DESCRIPTOR;
+
+// Define the parsers table routine of a described protocol
+#define SEMP_FRAMING_PREAMBLE(routine, descriptor)                  \
+    bool routine(SEMP_PARSE_STATE *parse, uint8_t data)             \
+    {                                                               \
+        return sempFramingPreamble(parse, data, &(descriptor));     \
+    }
+
+//----------------------------------------
+// 内置协议描述表
+//----------------------------------------
+
+extern const SEMP_FRAMING_DESCRIPTOR sempFramingRtcm;           // D3, 10 bit length, CRC-24Q
+extern const SEMP_FRAMING_DESCRIPTOR sempFramingUblox;          // B5 62, length at 4, Fletcher
+extern const SEMP_FRAMING_DESCRIPTOR sempFramingUnicoreBinary;  // AA 44 B5, length at 6, CRC-32
+extern const SEMP_FRAMING_DESCRIPTOR sempFramingCustom;         // AA 44 18, length at 12, CRC-32
+extern const SEMP_FRAMING_DESCRIPTOR sempFramingSbf;            // $@, length at 6, CRC-16-CCITT
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 检查传入字节是否为描述表中协议的第一个同步字节
+ * @details 在parsers table的前导函数中调用, 见SEMP_FRAMING_PREAMBLE
+ * @param parse 解析器
+ * @param data 传入的字节
+ * @param descriptor 协议描述表, 解析期间必须有效
+ * @return 是第一个同步字节返回true
+ */
+bool sempFramingPreamble(SEMP_PARSE_STATE *parse,
+                         uint8_t data,
+                         const SEMP_FRAMING_DESCRIPTOR *descriptor);
+
+/**
+ * @brief 校验完整SBF帧的CRC-16-CCITT
+ * @param buffer 帧起始地址 (同步字符'$')
+ * @param length 帧长度
+ * @return CRC正确返回true
+ */
+bool sempSbfValidate(const uint8_t *buffer, uint16_t length);
+
+// 内置协议的前导函数, 可直接放入parsers table
+bool sempFramingRtcmPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
+bool sempFramingUbloxPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
+bool sempFramingUnicoreBinaryPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
+bool sempFramingCustomPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
+bool sempFramingSbfPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
+
+/**
+ * @brief 由解析器表重新取得部分帧的协议描述表
+ * @details 在临时解析器上用parsers table中的前导函数重放帧的第一个字节,
+ *          再核对已收到的其余同步字节. 用于快照恢复, 描述表地址不随快照保存
+ * @param parse 目标解析器
+ * @param parserType 部分帧的解析器表索引
+ * @param frame 已收到的帧字节
+ * @param length 已收到的字节数
+ * @param scratchPad 暂存区, 成功时写入描述表地址
+ * @return 描述表, 表项不是通用分帧协议或同步字节不符时返回nullptr
+ */
+const SEMP_FRAMING_DESCRIPTOR * sempFramingReplay(const SEMP_PARSE_STATE *parse,
+                                                  uint8_t parserType,
+                                                  const uint8_t *frame,
+                                                  uint16_t length,
+                                                  SEMP_SCRATCH_PAD *scratchPad);
+
+// 状态表, 用于解析器快照和状态名称
+extern const SEMP_PROTOCOL_STATES sempFramingProtocolStates;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_FRAMING_H
@@ -0,0 +1,553 @@
+/**
+ * @file Message_Merge.c
+ * @brief 多接收机数据流按GNSS历元的时间顺序合并 - 功能实现
+ * @details 每个输入一个解析线程, 帧复制到该输入的有界队列中.
+ *          没有时间标签的帧沿用本输入上一帧的历元, 因此同一输入内的顺序保持不变.
+ *          所有键值均为GPS时间: 北斗周内秒加14秒, GLONASS日内时间减3小时得到
+ *          UTC, UTC日内时间加闰秒. 日内时间取本输入最近的周内秒所在的日期;
+ *          只有日内时间的输入 (NMEA) 由合并线程按最近输出的帧确定日期.
+ *          周内秒与日内时间的翻转分别按输入展开, 保证键值单调.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_Merge.h"
+#include <pthread.h>
+
+#define SEMP_MERGE_DAY_MSEC     (24ull * 60 * 60 * 1000)
+#define SEMP_MERGE_WEEK_MSEC    (7ull * SEMP_MERGE_DAY_MSEC)
+#define SEMP_MERGE_NO_WEEK      SEMP_EPOCH_NO_WEEK
+#define SEMP_MERGE_BDS_MSEC     14000   // GPS time - BeiDou time
+#define SEMP_MERGE_BDS_WEEK     1356    // GPS week of BeiDou week 0
+#define SEMP_MERGE_GLONASS_MSEC (3ull * 60 * 60 * 1000) // Moscow time - UTC
+
+//----------------------------------------
+// 内部类型
+//----------------------------------------
+
+// Queued frame
+typedef struct _SEMP_MERGE_SLOT
+{
+    uint8_t *data;                // Frame bytes, bufferLength available
+    uint64_t epoch;               // Ordering key in milliseconds
+    SEMP_VALIDATE_FRAME validate; // Span CRC routine
+    uint16_t length;              // Frame length in bytes
+    uint16_t type;                // Index into the parsers table
+    uint8_t verdict;              // SEMP_FRAME_VERDICT
+    bool floating;                // Time of day epoch, the day is not known yet
+} SEMP_MERGE_SLOT;
+
+// Per input state, the queue is written by the input thread only
+typedef struct _SEMP_MERGE_INPUT
+{
+    SEMP_MERGE *merge;            // Owning merge structure
+    SEMP_MERGE_READ read;         // Read routine
+    void *context;                // Read routine context
+    SEMP_PARSE_STATE *parse;      // Parser for this input
+    pthread_t thread;             // Parsing thread
+    pthread_mutex_t lock;         // Protects head, count and finished
+    pthread_cond_t notEmpty;      // Signaled when a frame is queued
+    pthread_cond_t notFull;       // Signaled when a frame is released
+    SEMP_MERGE_SLOT *slots;       // Queue of frames
+    uint16_t head;                // Next frame to merge
+    uint16_t tail;                // Next free slot
+    uint16_t count;               // Frames in the queue
+    bool finished;                // Input thread is done
+    uint64_t towBase;             // Milliseconds added to the time of week
+    uint64_t towEpoch;            // Epoch of the previous time of week frame
+    uint64_t todEpoch;            // Epoch of the previous time of day frame
+    uint64_t lastEpoch;           // Epoch of the previous frame
+    uint16_t week;                // Week matching towBase, or SEMP_MERGE_NO_WEEK
+    bool haveTow;                 // towEpoch is set
+    bool haveTod;                 // todEpoch is set
+    bool floating;                // lastEpoch is a time of day without a day
+    bool anchored;                // Merge thread, dayOffset is set
+    int64_t dayOffset;            // Merge thread, added to the floating epochs
+    uint8_t index;                // Input number
+} SEMP_MERGE_INPUT;
+
+struct _SEMP_MERGE
+{
+    const SEMP_PARSE_ROUTINE *parsersTable;
+    const char * const *parserNamesTable;
+    uint8_t parsersCount;
+    uint16_t bufferLength;
+    uint16_t queueFrames;
+    SEMP_MERGE_OUTPUT output;
+    void *outputContext;
+    SEMP_PRINTF_CALLBACK printError;
+    uint16_t week;                // Reference week, or SEMP_MERGE_NO_WEEK
+    uint32_t leapMsec;            // GPS time - UTC
+    bool haveOutput;              // outputEpoch is set
+    uint64_t outputEpoch;         // Epoch of the last frame output
+    uint8_t inputCount;
+    SEMP_MERGE_INPUT *inputs[SEMP_MERGE_MAX_INPUTS];
+};
+
+//----------------------------------------
+// 历元
+//----------------------------------------
+
+// Place time within half a period of the reference
+static uint64_t sempMergeNearest(uint64_t reference, uint64_t time, uint64_t period)
+{
+    uint64_t offset;
+    uint64_t epoch;
+
+    // Distance from the reference to the next matching time
+    offset = (time + period - (reference % period)) % period;
+    epoch = reference + offset;
+    if ((offset >= (period / 2)) && (epoch >= period))
+        epoch -= period;
+    return epoch;
+}
+
+// Compute a monotonic ordering key for the frame in GPS time
+static uint64_t sempMergeEpoch(SEMP_MERGE_INPUT *input, uint16_t type, bool *floating)
+{
+    SEMP_EPOCH frameEpoch;
+    uint64_t epoch;
+    uint64_t time;
+    uint16_t week;
+
+    frameEpoch = sempGetFrameEpoch(input->parse, type);
+    time = frameEpoch.milliseconds;
+    week = frameEpoch.week;
+    switch (frameEpoch.timeBase)
+    {
+    default:
+        // Frames without a time tag stay with the previous frame
+        *floating = input->floating;
+        return input->lastEpoch;
+
+    case SEMP_EPOCH_GPS_TOW:
+        break;
+
+    case SEMP_EPOCH_BDS_TOW:
+        // Convert to GPS time
+        if (week != SEMP_MERGE_NO_WEEK)
+            week += SEMP_MERGE_BDS_WEEK;
+        time += SEMP_MERGE_BDS_MSEC;
+        if (time >= SEMP_MERGE_WEEK_MSEC)
+        {
+            time -= SEMP_MERGE_WEEK_MSEC;
+            if (week != SEMP_MERGE_NO_WEEK)
+                week++;
+        }
+        break;
+
+    case SEMP_EPOCH_GLONASS_TOD:
+        // Moscow time to UTC
+        time += SEMP_MERGE_DAY_MSEC - SEMP_MERGE_GLONASS_MSEC;
+        // Fall through
+
+    case SEMP_EPOCH_UTC_TOD:
+        // UTC to GPS time of day
+        time = (time + input->merge->leapMsec) % SEMP_MERGE_DAY_MSEC;
+
+        // Take the day from the time of week frames of this input.  Until
+        // then the time of day floats, the merge thread picks the day.
+        if (input->haveTow)
+        {
+            epoch = sempMergeNearest(input->towEpoch, time, SEMP_MERGE_DAY_MSEC);
+            input->floating = false;
+        }
+        else if (input->haveTod)
+            epoch = sempMergeNearest(input->todEpoch, time, SEMP_MERGE_DAY_MSEC);
+        else
+        {
+            // Leave a day below the first epoch to go back to
+            epoch = input->towBase + SEMP_MERGE_DAY_MSEC + time;
+            input->floating = true;
+        }
+        input->todEpoch = epoch;
+        input->haveTod = true;
+        input->lastEpoch = epoch;
+        *floating = input->floating;
+        return epoch;
+    }
+
+    // Follow the week number when the frame carries one.  Without a
+    // reference week the first week seen becomes the zero point.
+    if (week != SEMP_MERGE_NO_WEEK)
+    {
+        if (input->week == SEMP_MERGE_NO_WEEK)
+            input->week = week;
+        input->towBase += ((int64_t)week - input->week) * (int64_t)SEMP_MERGE_WEEK_MSEC;
+        input->week = week;
+    }
+    epoch = input->towBase + time;
+
+    // Unwrap the time of week rollover
+    if ((week == SEMP_MERGE_NO_WEEK) && input->haveTow
+        && ((epoch + (SEMP_MERGE_WEEK_MSEC / 2)) < input->towEpoch))
+    {
+        input->towBase += SEMP_MERGE_WEEK_MSEC;
+        epoch += SEMP_MERGE_WEEK_MSEC;
+        if (input->week != SEMP_MERGE_NO_WEEK)
+            input->week++;
+    }
+    input->towEpoch = epoch;
+    input->haveTow = true;
+    input->floating = false;
+    input->lastEpoch = epoch;
+    *floating = false;
+    return epoch;
+}
+
+//----------------------------------------
+// 输入线程
+//----------------------------------------
+
+// Queue the frame, waits while the queue is full
+static void sempMergeEomCallback(SEMP_PARSE_STATE *parse, uint16_t type)
+{
+    SEMP_MERGE_INPUT *input = (SEMP_MERGE_INPUT *)parse->userContext;
+    SEMP_MERGE_SLOT *slot;
+
+    pthread_mutex_lock(&input->lock);
+    while (input->count == input->merge->queueFrames)
+        pthread_cond_wait(&input->notFull, &input->lock);
+    slot = &input->slots[input->tail];
+    pthread_mutex_unlock(&input->lock);
+
+    // The tail slot belongs to this thread until count is incremented
+    memcpy(slot->data, parse->buffer, parse->msg_length);
+    slot->length = parse->msg_length;
+    slot->type = type;
+    slot->validate = parse->validateFrame;
+    slot->verdict = parse->verdict;
+    slot->epoch = sempMergeEpoch(input, type, &slot->floating);
+
+    pthread_mutex_lock(&input->lock);
+    input->tail = (input->tail + 1) % input->merge->queueFrames;
+    input->count++;
+    pthread_cond_signal(&input->notEmpty);
+    pthread_mutex_unlock(&input->lock);
+}
+
+// Parse the input until the read routine reports the end
+static void * sempMergeInputThread(void *arg)
+{
+    SEMP_MERGE_INPUT *input = (SEMP_MERGE_INPUT *)arg;
+    uint8_t data[SEMP_MERGE_READ_BYTES];
+    size_t bytes;
+
+    while ((bytes = input->read(input->context, data, sizeof(data))) > 0)
+        sempParseBuffer(input->parse, data, bytes);
+
+    pthread_mutex_lock(&input->lock);
+    input->finished = true;
+    pthread_cond_signal(&input->notEmpty);
+    pthread_mutex_unlock(&input->lock);
+    return nullptr;
+}
+
+//----------------------------------------
+// 合并
+//----------------------------------------
+
+// Wait for the next frame, returns nullptr at the end of the input
+static SEMP_MERGE_SLOT * sempMergeHead(SEMP_MERGE_INPUT *input)
+{
+    SEMP_MERGE_SLOT *slot = nullptr;
+
+    pthread_mutex_lock(&input->lock);
+    while ((!input->count) && (!input->finished))
+        pthread_cond_wait(&input->notEmpty, &input->lock);
+    if (input->count)
+        slot = &input->slots[input->head];
+    pthread_mutex_unlock(&input->lock);
+    return slot;
+}
+
+// Move a floating epoch to the day nearest the reference, the first
+// floating frame of the input sets the offset for the following ones
+static void sempMergeAnchor(SEMP_MERGE_INPUT *input,
+                            SEMP_MERGE_SLOT *slot,
+                            bool haveReference,
+                            uint64_t reference)
+{
+    if ((!slot) || (!slot->floating))
+        return;
+    if (!input->anchored)
+    {
+        if (haveReference)
+            input->dayOffset = (int64_t)sempMergeNearest(reference,
+                                                         slot->epoch % SEMP_MERGE_DAY_MSEC,
+                                                         SEMP_MERGE_DAY_MSEC)
+                             - (int64_t)slot->epoch;
+        input->anchored = true;
+    }
+    slot->epoch += input->dayOffset;
+    slot->floating = false;
+}
+
+// Release the head frame back to the input thread
+static void sempMergeRelease(SEMP_MERGE_INPUT *input)
+{
+    pthread_mutex_lock(&input->lock);
+    input->head = (input->head + 1) % input->merge->queueFrames;
+    input->count--;
+    pthread_cond_signal(&input->notFull);
+    pthread_mutex_unlock(&input->lock);
+}
+
+// Heap order, earlier epoch first then lower input number
+static bool sempMergeBefore(SEMP_MERGE_SLOT **heads, uint8_t a, uint8_t b)
+{
+    if (heads[a]->epoch != heads[b]->epoch)
+        return heads[a]->epoch < heads[b]->epoch;
+    return a < b;
+}
+
+// Restore the heap property below position
+static void sempMergeSiftDown(uint8_t *heap, uint8_t count, SEMP_MERGE_SLOT **heads, uint8_t position)
+{
+    uint8_t child;
+    uint8_t entry;
+
+    while ((child = (position * 2) + 1) < count)
+    {
+        if (((child + 1) < count) && sempMergeBefore(heads, heap[child + 1], heap[child]))
+            child++;
+        if (!sempMergeBefore(heads, heap[child], heap[position]))
+            break;
+        entry = heap[child];
+        heap[child] = heap[position];
+        heap[position] = entry;
+        position = child;
+    }
+}
+
+// Merge the input queues until all inputs are exhausted
+static void sempMergeFrames(SEMP_MERGE *merge)
+{
+    SEMP_MERGE_SLOT *heads[SEMP_MERGE_MAX_INPUTS];
+    uint8_t heap[SEMP_MERGE_MAX_INPUTS];
+    SEMP_MERGE_INPUT *input;
+    SEMP_MERGE_SLOT *slot;
+    SEMP_FRAME frame;
+    bool haveReference;
+    uint64_t reference;
+    uint8_t count;
+    int index;
+
+    // Build the heap from the first frame of each input
+    count = 0;
+    haveReference = false;
+    reference = 0;
+    for (index = 0; index < merge->inputCount; index++)
+    {
+        heads[index] = sempMergeHead(merge->inputs[index]);
+        if (heads[index])
+        {
+            heap[count++] = index;
+            if ((!heads[index]->floating) && ((!haveReference) || (heads[index]->epoch < reference)))
+            {
+                reference = heads[index]->epoch;
+                haveReference = true;
+            }
+        }
+    }
+
+    // Inputs starting with a time of day take the day of the earliest
+    // time of week
+    for (index = 0; index < merge->inputCount; index++)
+        sempMergeAnchor(merge->inputs[index], heads[index], haveReference, reference);
+    for (index = (count / 2) - 1; index >= 0; index--)
+        sempMergeSiftDown(heap, count, heads, index);
+
+    while (count)
+    {
+        // Output the earliest frame
+        input = merge->inputs[heap[0]];
+        slot = heads[heap[0]];
+        frame.buffer = slot->data;
+        frame.length = slot->length;
+        frame.type = slot->type;
+        frame.validate = slot->validate;
+        frame.verdict = slot->verdict;
+        merge->output(merge->outputContext, input->index, &frame, slot->epoch);
+        merge->outputEpoch = slot->epoch;
+        merge->haveOutput = true;
+        sempMergeRelease(input);
+
+        // Replace it with the next frame from the same input
+        heads[heap[0]] = sempMergeHead(input);
+        sempMergeAnchor(input, heads[heap[0]], merge->haveOutput, merge->outputEpoch);
+        if (!heads[heap[0]])
+            heap[0] = heap[--count];
+        sempMergeSiftDown(heap, count, heads, 0);
+    }
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Allocate the merge structure
+SEMP_MERGE * sempMergeBegin(const SEMP_PARSE_ROUTINE *parsersTable,
+                            uint8_t parsersCount,
+                            const char * const *parserNamesTable,
+                            uint16_t bufferLength,
+                            uint16_t queueFrames,
+                            SEMP_MERGE_OUTPUT output,
+                            void *outputContext,
+                            SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_MERGE *merge;
+
+    if ((!parsersTable) || (!parserNamesTable) || (!parsersCount) || (!output))
+    {
+        sempPrintln(printError, "SEMP: Please specify the parser tables and an output routine");
+        return nullptr;
+    }
+    merge = (SEMP_MERGE *)semp_util_malloc(sizeof(SEMP_MERGE));
+    if (!merge)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the merge structure");
+        return nullptr;
+    }
+    memset(merge, 0, sizeof(*merge));
+    if (bufferLength < SEMP_MINIMUM_BUFFER_LENGTH)
+        bufferLength = SEMP_MINIMUM_BUFFER_LENGTH;
+    if (queueFrames < SEMP_MERGE_MINIMUM_QUEUE)
+        queueFrames = SEMP_MERGE_MINIMUM_QUEUE;
+    merge->parsersTable = parsersTable;
+    merge->parserNamesTable = parserNamesTable;
+    merge->parsersCount = parsersCount;
+    merge->bufferLength = bufferLength;
+    merge->queueFrames = queueFrames;
+    merge->output = output;
+    merge->outputContext = outputContext;
+    merge->printError = printError;
+    merge->week = SEMP_MERGE_NO_WEEK;
+    merge->leapMsec = SEMP_MERGE_LEAP_SECONDS * 1000;
+    return merge;
+}
+
+// Add an input stream
+bool sempMergeAddInput(SEMP_MERGE *merge, SEMP_MERGE_READ read, void *context)
+{
+    SEMP_MERGE_INPUT *input;
+    uint8_t *data;
+    uint16_t index;
+
+    if ((!merge) || (!read))
+        return false;
+    if (merge->inputCount >= SEMP_MERGE_MAX_INPUTS)
+    {
+        sempPrintf(merge->printError, "SEMP: Merge supports at most %d inputs",
+                   SEMP_MERGE_MAX_INPUTS);
+        return false;
+    }
+
+    // Allocate the input, its queue slots and the frame storage together
+    input = (SEMP_MERGE_INPUT *)semp_util_malloc(SEMP_ALIGN(sizeof(SEMP_MERGE_INPUT))
+                                  + (merge->queueFrames * sizeof(SEMP_MERGE_SLOT))
+                                  + (merge->queueFrames * merge->bufferLength));
+    if (!input)
+    {
+        sempPrintln(merge->printError, "SEMP: Failed to allocate the merge input");
+        return false;
+    }
+    memset(input, 0, sizeof(*input));
+    input->slots = (SEMP_MERGE_SLOT *)((uint8_t *)input + SEMP_ALIGN(sizeof(SEMP_MERGE_INPUT)));
+    data = (uint8_t *)&input->slots[merge->queueFrames];
+    for (index = 0; index < merge->queueFrames; index++)
+        input->slots[index].data = &data[index * merge->bufferLength];
+
+    input->parse = sempBeginParser("Merge", merge->parsersTable, merge->parsersCount,
+                                   merge->parserNamesTable, merge->parsersCount,
+                                   0, merge->bufferLength, sempMergeEomCallback,
+                                   merge->printError, nullptr, nullptr);
+    if (!input->parse)
+    {
+        semp_util_free(input);
+        return false;
+    }
+    input->parse->userContext = input;
+    input->merge = merge;
+    input->read = read;
+    input->context = context;
+    input->index = merge->inputCount;
+    input->week = merge->week;
+    if (merge->week != SEMP_MERGE_NO_WEEK)
+        input->towBase = merge->week * SEMP_MERGE_WEEK_MSEC;
+    pthread_mutex_init(&input->lock, nullptr);
+    pthread_cond_init(&input->notEmpty, nullptr);
+    pthread_cond_init(&input->notFull, nullptr);
+    merge->inputs[merge->inputCount++] = input;
+    return true;
+}
+
+// Set the reference week
+void sempMergeSetWeek(SEMP_MERGE *merge, uint16_t week)
+{
+    if (merge)
+        merge->week = week;
+}
+
+// Set the GPS - UTC leap seconds
+void sempMergeSetLeapSeconds(SEMP_MERGE *merge, uint8_t seconds)
+{
+    if (merge)
+        merge->leapMsec = seconds * 1000;
+}
+
+// Read callback for stdio files
+size_t sempMergeReadFile(void *context, uint8_t *buffer, size_t length)
+{
+    return fread(buffer, 1, length, (FILE *)context);
+}
+
+// Start the input threads and merge the frames
+bool sempMergeRun(SEMP_MERGE *merge)
+{
+    uint8_t started;
+    uint8_t index;
+
+    if (!merge)
+        return false;
+
+    for (started = 0; started < merge->inputCount; started++)
+        if (pthread_create(&merge->inputs[started]->thread, nullptr,
+                           sempMergeInputThread, merge->inputs[started]))
+        {
+            sempPrintln(merge->printError, "SEMP: Failed to start the merge input thread");
+            break;
+        }
+
+    // Inputs without a thread are treated as empty
+    for (index = started; index < merge->inputCount; index++)
+        merge->inputs[index]->finished = true;
+
+    sempMergeFrames(merge);
+
+    for (index = 0; index < started; index++)
+        pthread_join(merge->inputs[index]->thread, nullptr);
+    return (started == merge->inputCount);
+}
+
+// Free the merge structure
+void sempMergeStop(SEMP_MERGE **merge)
+{
+    SEMP_MERGE_INPUT *input;
+    uint8_t index;
+
+    if (merge && *merge)
+    {
+        for (index = 0; index < (*merge)->inputCount; index++)
+        {
+            input = (*merge)->inputs[index];
+            sempStopParser(&input->parse);
+            pthread_mutex_destroy(&input->lock);
+            pthread_cond_destroy(&input->notEmpty);
+            pthread_cond_destroy(&input->notFull);
+            semp_util_free(input);
+        }
+        semp_util_free(*merge);
+        *merge = nullptr;
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * @file Message_Merge.h
+ * @brief 多接收机数据流按GNSS历元的时间顺序合并 - 头文件
+ * @details 每个输入在独立线程中解析, 帧经有界队列送入合并线程,
+ *          合并线程以各输入队首帧的历元为键进行k路堆合并. 键值为GPS时间,
+ *          GLONASS和UTC日内时间按所在输入的周内秒或其他输入的时间确定日期.
+ *          内存占用只与输入数量、队列深度和缓冲区长度有关, 与文件大小无关.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_MERGE_H
+#define MESSAGE_MERGE_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_MERGE_MAX_INPUTS       64
+#define SEMP_MERGE_MINIMUM_QUEUE    4     // Minimum frames per input queue
+#define SEMP_MERGE_READ_BYTES       4096  // Bytes read per input call
+#define SEMP_MERGE_LEAP_SECONDS     18    // Default GPS - UTC, since 2017
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_MERGE SEMP_MERGE;
+
+// Read up to length bytes from the input, return 0 at the end of the input
+typedef size_t (*SEMP_MERGE_READ)(void *context, uint8_t *buffer, size_t length);
+
+// Deliver the next frame in epoch order.  The frame buffer is only valid
+// during the call.  epoch is the ordering key in milliseconds.
+typedef void (*SEMP_MERGE_OUTPUT)(void *context,
+                                  uint8_t input,
+                                  const SEMP_FRAME *frame,
+                                  uint64_t epoch);
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 分配合并器
+ * @param parsersTable 解析器表, 所有输入共用
+ * @param parsersCount 解析器数量
+ * @param parserNamesTable 解析器名称表
+ * @param bufferLength 每个解析器的缓冲区长度, 也是队列中每帧的最大长度
+ * @param queueFrames 每个输入的队列深度 (帧数)
+ * @param output 输出回调
+ * @param outputContext 输出回调的上下文
+ * @param printError 错误输出回调
+ * @return 合并器指针, 失败返回nullptr
+ */
+SEMP_MERGE * sempMergeBegin(const SEMP_PARSE_ROUTINE *parsersTable,
+                            uint8_t parsersCount,
+                            const char * const *parserNamesTable,
+                            uint16_t bufferLength,
+                            uint16_t queueFrames,
+                            SEMP_MERGE_OUTPUT output,
+                            void *outputContext,
+                            SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 添加输入
+ * @param merge 合并器
+ * @param read 读取回调
+ * @param context 读取回调的上下文 (例如 FILE *)
+ * @return 成功返回true
+ */
+bool sempMergeAddInput(SEMP_MERGE *merge, SEMP_MERGE_READ read, void *context);
+
+/**
+ * @brief 设置参考GPS周
+ * @details 未设置时, 各输入的历元均相对于各自第一个时间标签所在的周,
+ *          适用于同一时段录制的数据. 设置后, 不含周数的输入(RTCM, UBX NAV)
+ *          以参考周为起点, 与含周数的输入(和芯星通二进制)按绝对时间比较.
+ *          需在sempMergeAddInput之前调用.
+ * @param merge 合并器
+ * @param week GPS周
+ */
+void sempMergeSetWeek(SEMP_MERGE *merge, uint16_t week);
+
+/**
+ * @brief 设置GPS时间与UTC之差
+ * @details NMEA (UTC) 和GLONASS (莫斯科时间) 的日内时间加上闰秒转换为GPS时间,
+ *          默认SEMP_MERGE_LEAP_SECONDS. 需在sempMergeRun之前调用.
+ * @param merge 合并器
+ * @param seconds 闰秒数
+ */
+void sempMergeSetLeapSeconds(SEMP_MERGE *merge, uint8_t seconds);
+
+// Read callback for stdio files, pass the FILE * as the context
+size_t sempMergeReadFile(void *context, uint8_t *buffer, size_t length);
+
+/**
+ * @brief 启动输入线程并合并, 直到所有输入结束
+ * @param merge 合并器
+ * @return 所有线程正常启动和结束返回true
+ */
+bool sempMergeRun(SEMP_MERGE *merge);
+
+// Free the merge structure and set the pointer to nullptr
+void sempMergeStop(SEMP_MERGE **merge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_MERGE_H
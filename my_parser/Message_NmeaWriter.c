@@ -0,0 +1,307 @@
+/**
+ * @file Message_NmeaWriter.c
+ * @brief NMEA语句生成器 (GGA/RMC) - 功能实现
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_NmeaWriter.h"
+
+//----------------------------------------
+// 内部类型
+//----------------------------------------
+
+typedef struct _SEMP_NMEA_WRITER
+{
+    char *next;             // Next character to write
+    uint8_t checksum;       // XOR of the characters following '$'
+} SEMP_NMEA_WRITER;
+
+// Two ASCII digits for each value 0 - 99
+static const char sempNmeaDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char sempNmeaHex[] = "0123456789ABCDEF";
+
+//----------------------------------------
+// 字段写入
+//----------------------------------------
+
+static inline void sempNmeaPutChar(SEMP_NMEA_WRITER *writer, char data)
+{
+    *writer->next++ = data;
+    writer->checksum ^= (uint8_t)data;
+}
+
+// Write a zero padded value with the given number of digits
+static void sempNmeaPutDigits(SEMP_NMEA_WRITER *writer, uint32_t value, uint8_t digits)
+{
+    char *digit = writer->next + digits;
+    const char *pair;
+
+    writer->next = digit;
+
+    // Convert two digits per division, from the right
+    while (digits >= 2)
+    {
+        pair = &sempNmeaDigitPairs[(value % 100) * 2];
+        value /= 100;
+        *--digit = pair[1];
+        *--digit = pair[0];
+        writer->checksum ^= (uint8_t)(pair[0] ^ pair[1]);
+        digits -= 2;
+    }
+    if (digits)
+    {
+        *--digit = (char)('0' + (value % 10));
+        writer->checksum ^= (uint8_t)*digit;
+    }
+}
+
+// Write a value without leading zeros
+static void sempNmeaPutUnsigned(SEMP_NMEA_WRITER *writer, uint32_t value)
+{
+    uint8_t digits = 1;
+    uint32_t limit = 10;
+
+    while ((digits < 10) && (value >= limit))
+    {
+        digits++;
+        limit *= 10;
+    }
+    sempNmeaPutDigits(writer, value, digits);
+}
+
+// Write a fixed point value, scale is 10 ^ decimals
+static void sempNmeaPutFixed(SEMP_NMEA_WRITER *writer, int64_t value, uint32_t scale, uint8_t decimals)
+{
+    uint64_t magnitude;
+
+    if (value < 0)
+    {
+        sempNmeaPutChar(writer, '-');
+        magnitude = (uint64_t)-value;
+    }
+    else
+        magnitude = (uint64_t)value;
+    sempNmeaPutUnsigned(writer, (uint32_t)(magnitude / scale));
+    sempNmeaPutChar(writer, '.');
+    sempNmeaPutDigits(writer, (uint32_t)(magnitude % scale), decimals);
+}
+
+// Write hhmmss.ss
+static void sempNmeaPutTime(SEMP_NMEA_WRITER *writer, uint32_t timeMs)
+{
+    uint32_t seconds = timeMs / 1000;
+
+    sempNmeaPutDigits(writer, seconds / 3600, 2);
+    sempNmeaPutDigits(writer, (seconds / 60) % 60, 2);
+    sempNmeaPutDigits(writer, seconds % 60, 2);
+    sempNmeaPutChar(writer, '.');
+    sempNmeaPutDigits(writer, (timeMs % 1000) / 10, 2);
+}
+
+// Write (d)ddmm.mmmmmmm,H from 1e-7 degrees, exact without rounding
+static void sempNmeaPutAngle(SEMP_NMEA_WRITER *writer,
+                             int32_t angle,
+                             uint8_t degreeDigits,
+                             char positive,
+                             char negative)
+{
+    uint32_t magnitude = (angle < 0) ? -(uint32_t)angle : (uint32_t)angle;
+    uint32_t minutes = (magnitude % 10000000) * 60;   // 1e-7 minutes
+
+    sempNmeaPutDigits(writer, magnitude / 10000000, degreeDigits);
+    sempNmeaPutDigits(writer, minutes / 10000000, 2);
+    sempNmeaPutChar(writer, '.');
+    sempNmeaPutDigits(writer, minutes % 10000000, 7);
+    sempNmeaPutChar(writer, ',');
+    sempNmeaPutChar(writer, (angle < 0) ? negative : positive);
+}
+
+// Start the sentence, the checksum excludes the '$'
+static void sempNmeaBegin(SEMP_NMEA_WRITER *writer, char *buffer, const char *talker, const char *name)
+{
+    buffer[0] = '$';
+    writer->next = &buffer[1];
+    writer->checksum = 0;
+    sempNmeaPutChar(writer, talker[0]);
+    sempNmeaPutChar(writer, talker[1]);
+    while (*name)
+        sempNmeaPutChar(writer, *name++);
+}
+
+// Append the checksum, CR LF and the zero termination
+static uint16_t sempNmeaEnd(SEMP_NMEA_WRITER *writer,
+                            char *sentence,
+                            char *buffer,
+                            size_t length)
+{
+    uint16_t sentenceLength;
+
+    writer->next[0] = '*';
+    writer->next[1] = sempNmeaHex[writer->checksum >> 4];
+    writer->next[2] = sempNmeaHex[writer->checksum & 0xf];
+    writer->next[3] = '\r';
+    writer->next[4] = '\n';
+    writer->next[5] = 0;
+    sentenceLength = (uint16_t)(writer->next + 5 - sentence);
+
+    // Short caller buffers receive the sentence from the local buffer
+    if (sentence != buffer)
+    {
+        if (length <= sentenceLength)
+            return 0;
+        memcpy(buffer, sentence, sentenceLength + 1);
+    }
+    return sentenceLength;
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// 由浮点数设置位置
+void sempNmeaSetPosition(SEMP_NMEA_FIX *fix, double latitude, double longitude, double altitude)
+{
+    latitude *= 10000000;
+    longitude *= 10000000;
+    altitude *= 1000;
+    fix->latitude = (int32_t)((latitude < 0) ? (latitude - 0.5) : (latitude + 0.5));
+    fix->longitude = (int32_t)((longitude < 0) ? (longitude - 0.5) : (longitude + 0.5));
+    fix->altitude = (int32_t)((altitude < 0) ? (altitude - 0.5) : (altitude + 0.5));
+}
+
+// 生成GGA语句
+uint16_t sempNmeaWriteGga(char *buffer, size_t length, const char *talker, const SEMP_NMEA_FIX *fix)
+{
+    char local[SEMP_NMEA_MAX_SENTENCE];
+    SEMP_NMEA_WRITER writer;
+    char *sentence;
+
+    if ((!buffer) || (!talker) || (!fix))
+        return 0;
+
+    // Write in place when the buffer holds the longest sentence
+    sentence = (length >= SEMP_NMEA_MAX_SENTENCE) ? buffer : local;
+    sempNmeaBegin(&writer, sentence, talker, "GGA,");
+    sempNmeaPutTime(&writer, fix->timeMs);
+    sempNmeaPutChar(&writer, ',');
+
+    // Position fields are empty without a fix
+    if (fix->quality)
+    {
+        sempNmeaPutAngle(&writer, fix->latitude, 2, 'N', 'S');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutAngle(&writer, fix->longitude, 3, 'E', 'W');
+        sempNmeaPutChar(&writer, ',');
+    }
+    else
+    {
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, ',');
+    }
+    sempNmeaPutUnsigned(&writer, fix->quality);
+    sempNmeaPutChar(&writer, ',');
+    sempNmeaPutDigits(&writer, fix->satellites, (fix->satellites >= 100) ? 3 : 2);
+    sempNmeaPutChar(&writer, ',');
+    sempNmeaPutFixed(&writer, fix->hdop, 100, 2);
+    sempNmeaPutChar(&writer, ',');
+    if (fix->quality)
+    {
+        sempNmeaPutFixed(&writer, fix->altitude, 1000, 3);
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, 'M');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutFixed(&writer, fix->geoidSeparation, 1000, 3);
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, 'M');
+        sempNmeaPutChar(&writer, ',');
+    }
+    else
+    {
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, 'M');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, 'M');
+        sempNmeaPutChar(&writer, ',');
+    }
+
+    // Differential age and station only for differential fixes
+    if (fix->differentialAge)
+    {
+        sempNmeaPutFixed(&writer, fix->differentialAge, 10, 1);
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutDigits(&writer, fix->station % 10000, 4);
+    }
+    else
+        sempNmeaPutChar(&writer, ',');
+    return sempNmeaEnd(&writer, sentence, buffer, length);
+}
+
+// 生成RMC语句
+uint16_t sempNmeaWriteRmc(char *buffer, size_t length, const char *talker, const SEMP_NMEA_FIX *fix)
+{
+    char local[SEMP_NMEA_MAX_SENTENCE];
+    SEMP_NMEA_WRITER writer;
+    char *sentence;
+    char mode;
+
+    if ((!buffer) || (!talker) || (!fix))
+        return 0;
+
+    // Mode indicator from the GGA fix quality
+    switch (fix->quality)
+    {
+    case 0:  mode = 'N'; break;
+    case 2:  mode = 'D'; break;
+    case 4:  mode = 'R'; break;
+    case 5:  mode = 'F'; break;
+    case 6:  mode = 'E'; break;
+    default: mode = 'A'; break;
+    }
+
+    sentence = (length >= SEMP_NMEA_MAX_SENTENCE) ? buffer : local;
+    sempNmeaBegin(&writer, sentence, talker, "RMC,");
+    sempNmeaPutTime(&writer, fix->timeMs);
+    sempNmeaPutChar(&writer, ',');
+    sempNmeaPutChar(&writer, fix->quality ? 'A' : 'V');
+    sempNmeaPutChar(&writer, ',');
+    if (fix->quality)
+    {
+        sempNmeaPutAngle(&writer, fix->latitude, 2, 'N', 'S');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutAngle(&writer, fix->longitude, 3, 'E', 'W');
+        sempNmeaPutChar(&writer, ',');
+
+        // Millimeters per second to thousandths of a knot
+        sempNmeaPutFixed(&writer, (((uint64_t)fix->speed * 3600) + 926) / 1852, 1000, 3);
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutFixed(&writer, fix->course, 100, 2);
+        sempNmeaPutChar(&writer, ',');
+    }
+    else
+    {
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, ',');
+        sempNmeaPutChar(&writer, ',');
+    }
+    sempNmeaPutDigits(&writer, fix->day, 2);
+    sempNmeaPutDigits(&writer, fix->month, 2);
+    sempNmeaPutDigits(&writer, fix->year % 100, 2);
+
+    // No magnetic variation
+    sempNmeaPutChar(&writer, ',');
+    sempNmeaPutChar(&writer, ',');
+    sempNmeaPutChar(&writer, ',');
+    sempNmeaPutChar(&writer, mode);
+    return sempNmeaEnd(&writer, sentence, buffer, length);
+}
@@ -0,0 +1,86 @@
+/**
+ * @file Message_NmeaWriter.h
+ * @brief NMEA语句生成器 (GGA/RMC) - 头文件
+ * @details 定点数格式化全部使用整数运算和两位数字查表, 不调用snprintf;
+ *          XOR校验和在写入字符的同时累计, 语句直接写入调用者的缓冲区.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_NMEA_WRITER_H
+#define MESSAGE_NMEA_WRITER_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_NMEA_MAX_SENTENCE      128 // Longest GGA or RMC sentence, with CR LF and zero
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+// Position fix in fixed point units
+typedef struct _SEMP_NMEA_FIX
+{
+    uint32_t timeMs;            // UTC time of day, milliseconds
+    uint8_t day;                // UTC date, 1 - 31
+    uint8_t month;              // 1 - 12
+    uint16_t year;              // 4 digit year
+    int32_t latitude;           // 1e-7 degrees, north positive
+    int32_t longitude;          // 1e-7 degrees, east positive
+    int32_t altitude;           // Millimeters above mean sea level
+    int32_t geoidSeparation;    // Millimeters
+    uint8_t quality;            // GGA fix quality, 0 = no fix
+    uint8_t satellites;         // Satellites used
+    uint16_t hdop;              // 0.01 units
+    uint16_t differentialAge;   // 0.1 seconds, 0 when not differential
+    uint16_t station;           // Differential reference station ID
+    uint32_t speed;             // Ground speed, millimeters per second
+    uint16_t course;            // Course over ground, 0.01 degrees
+} SEMP_NMEA_FIX;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 由浮点数设置位置, 转换为定点数
+ * @param fix 定位结果
+ * @param latitude 纬度, 度
+ * @param longitude 经度, 度
+ * @param altitude 海拔高度, 米
+ */
+void sempNmeaSetPosition(SEMP_NMEA_FIX *fix, double latitude, double longitude, double altitude);
+
+/**
+ * @brief 生成GGA语句
+ * @param buffer 输出缓冲区, 以CR LF和'\0'结尾
+ * @param length 缓冲区长度, SEMP_NMEA_MAX_SENTENCE字节总是足够
+ * @param talker 两字符发送者标识, 例如"GP"或"GN"
+ * @param fix 定位结果
+ * @return 语句长度(不含'\0'), 缓冲区不足时返回0
+ */
+uint16_t sempNmeaWriteGga(char *buffer, size_t length, const char *talker, const SEMP_NMEA_FIX *fix);
+
+/**
+ * @brief 生成RMC语句 (NMEA 2.3, 含模式指示)
+ * @param buffer 输出缓冲区, 以CR LF和'\0'结尾
+ * @param length 缓冲区长度, SEMP_NMEA_MAX_SENTENCE字节总是足够
+ * @param talker 两字符发送者标识
+ * @param fix 定位结果
+ * @return 语句长度(不含'\0'), 缓冲区不足时返回0
+ */
+uint16_t sempNmeaWriteRmc(char *buffer, size_t length, const char *talker, const SEMP_NMEA_FIX *fix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_NMEA_WRITER_H
@@ -6,6 +6,7 @@
  * @date 2024-12
  */
 
+#include <stddef.h>
 #include "Message_Parser.h"
 
 //----------------------------------------
@@ -14,10 +15,10 @@
 
 const char* semp_getProtocolName(const SEMP_PARSE_STATE *parse, uint16_t protocolIndex)
 {
-    if (!parse || protocolIndex >= parse->parsers_count) {
+    if (!parse || protocolIndex >= parse->config->parsers_count) {
         return "Unknown";
     }
-    return parse->parserNames_table[protocolIndex];
+    return parse->config->parserNames_table[protocolIndex];
 }
 
 const char* semp_getProtocolDescription(uint16_t protocolIndex)
@@ -27,63 +28,94 @@ const char* semp_getProtocolDescription(uint16_t protocolIndex)
     return "Description Removed";
 }
 
+//----------------------------------------
+// 大帧分段输出
+//----------------------------------------
+
+// Pass a piece of the frame in the buffer to the chunk callback
+static void sempStreamChunk(SEMP_PARSE_STATE *parse, uint16_t length, bool final, uint8_t verdict)
+{
+    SEMP_CHUNK chunk;
+
+    chunk.data = parse->buffer;
+    chunk.length = length;
+    chunk.offset = parse->streamOffset;
+    chunk.type = parse->parser_type;
+    chunk.final = final;
+    chunk.verdict = verdict;
+    parse->chunkCallback(parse, &chunk);
+    parse->streamOffset = final ? 0 : (parse->streamOffset + length);
+}
+
+// The buffer is full, pass all but the tail bytes to the chunk callback.
+// The tail stays in the buffer for the CRC and checksum states which look
+// back at the last few bytes of the frame.
+static void sempStreamSpill(SEMP_PARSE_STATE *parse)
+{
+    uint16_t length;
+
+    length = parse->msg_length - SEMP_STREAM_TAIL_BYTES;
+    sempStreamChunk(parse, length, false, SEMP_FRAME_UNVALIDATED);
+    memmove(parse->buffer, &parse->buffer[length], SEMP_STREAM_TAIL_BYTES);
+    parse->msg_length = SEMP_STREAM_TAIL_BYTES;
+}
+
 //----------------------------------------
 // 主状态机
 //----------------------------------------
-SEMP_PARSE_STATE * sempBeginParser(
-    const char *parserName, \
-    const SEMP_PARSE_ROUTINE *parsersTable, \
-    uint8_t parsersCount, \
-    const char * const *parserNamesTable, \
-    uint8_t parserNamesCount, \
-    uint16_t scratchPadBytes, \
-    uint16_t bufferLength, \
-    SEMP_EOM_CALLBACK eomCallback, \
-    SEMP_PRINTF_CALLBACK printError, \
-    SEMP_PRINTF_CALLBACK printDebug, \
-    SEMP_BAD_CRC_CALLBACK badCrcCallback)
+
+// The per byte fields and the scratch pad fit in the first cache line
+_Static_assert(offsetof(SEMP_PARSE_STATE, scratch) + sizeof(SEMP_SCRATCH_PAD) <= SEMP_CACHE_LINE_BYTES,
+               "SEMP_PARSE_STATE hot fields exceed a cache line");
+
+SEMP_PARSE_STATE * sempBeginSharedParser(
+    const SEMP_PARSER_CONFIG *config,
+    uint16_t scratchPadBytes,
+    uint16_t bufferLength,
+    SEMP_PRINTF_CALLBACK printError,
+    SEMP_PRINTF_CALLBACK printDebug)
 {
     SEMP_PARSE_STATE *parse = NULL;
 
     do
     {
-        // Validate the parse type names table
-        if (parsersCount != parserNamesCount)
+        // Validate the configuration address is not nullptr
+        if (!config)
         {
-            sempPrintln(printError, "SEMP: Please fix parserTable and parserNameTable parserCount != parserNameCount");
+            sempPrintln(printError, "SEMP: Please specify a parser configuration");
             break;
         }
 
         // Validate the parserTable address is not nullptr
-        if (!parsersTable)
+        if (!config->parsers_table)
         {
             sempPrintln(printError, "SEMP: Please specify a parserTable data structure");
             break;
         }
 
         // Validate the parserNameTable address is not nullptr
-        if (!parserNamesTable)
+        if (!config->parserNames_table)
         {
             sempPrintln(printError, "SEMP: Please specify a parserNameTable data structure");
             break;
         }
 
         // Validate the end-of-message callback routine address is not nullptr
-        if (!eomCallback)
+        if (!config->eomCallback)
         {
             sempPrintln(printError, "SEMP: Please specify an eomCallback routine");
             break;
         }
 
         // Verify the parser name
-        if ((!parserName) || (!strlen(parserName)))
+        if ((!config->parserName) || (!strlen(config->parserName)))
         {
             sempPrintln(printError, "SEMP: Please provide a name for the parser");
             break;
         }
 
         // Verify that there is at least one parser in the table
-        if (!parsersCount)
+        if (!config->parsers_count)
         {
             sempPrintln(printError, "SEMP: Please provide at least one parser in parserTable");
             break;
@@ -99,13 +131,8 @@ SEMP_PARSE_STATE * sempBeginParser(
 
         // Initialize the parser
         parse->printError = printError;
-        parse->parsers_table = parsersTable;
-        parse->parsers_count = parsersCount;
-        parse->parserNames_table = parserNamesTable;
+        parse->config = config;
         parse->state = sempFirstByte;
-        parse->eomCallback = eomCallback;
-        parse->parserName = parserName;
-        parse->badCrc = badCrcCallback;
 
         // Display the parser configuration
         sempPrintParserConfiguration(parse, parse->printDebug);
@@ -115,24 +142,129 @@ SEMP_PARSE_STATE * sempBeginParser(
     return parse;
 }
 
+SEMP_PARSE_STATE * sempBeginParser(
+    const char *parserName, \
+    const SEMP_PARSE_ROUTINE *parsersTable, \
+    uint8_t parsersCount, \
+    const char * const *parserNamesTable, \
+    uint8_t parserNamesCount, \
+    uint16_t scratchPadBytes, \
+    uint16_t bufferLength, \
+    SEMP_EOM_CALLBACK eomCallback, \
+    SEMP_PRINTF_CALLBACK printError, \
+    SEMP_PRINTF_CALLBACK printDebug, \
+    SEMP_BAD_CRC_CALLBACK badCrcCallback)
+{
+    SEMP_PARSER_CONFIG config;
+    SEMP_PARSE_STATE *parse;
+
+    // Validate the parse type names table
+    if (parsersCount != parserNamesCount)
+    {
+        sempPrintln(printError, "SEMP: Please fix parserTable and parserNameTable parserCount != parserNameCount");
+        return nullptr;
+    }
+
+    config.parserName = parserName;
+    config.parsers_table = parsersTable;
+    config.parserNames_table = parserNamesTable;
+    config.eomCallback = eomCallback;
+    config.badCrc = badCrcCallback;
+    config.parsers_count = parsersCount;
+    parse = sempBeginSharedParser(&config, scratchPadBytes, bufferLength, printError, printDebug);
+
+    // The parser keeps its own copy of the configuration
+    if (parse)
+    {
+        parse->ownConfig = config;
+        parse->config = &parse->ownConfig;
+    }
+    return parse;
+}
+
+// Return to the full scan of the parsers table
+static void sempAdaptiveUnlock(SEMP_PARSE_STATE *parse)
+{
+    if (parse->lockedType < parse->config->parsers_count)
+    {
+        parse->lockedType = parse->config->parsers_count;
+        parse->adaptiveStats.fallbacks++;
+    }
+    parse->consecutiveFrames = 0;
+    parse->budgetUsed = 0;
+}
+
 bool sempFirstByte(SEMP_PARSE_STATE *parse, uint8_t data)
 {
     uint8_t index;
+    uint8_t type;
     SEMP_PARSE_ROUTINE parseRoutine;
 
     if (parse)
     {
+        // A streamed frame ended early, the current byte is not part of it
+        if (parse->streamOffset)
+            sempStreamChunk(parse, parse->msg_length ? parse->msg_length - 1 : 0,
+                            true, SEMP_FRAME_BAD_CRC);
+
+        // The previous preamble did not lead to a frame
+        if (parse->lockFrames)
+        {
+            if ((parse->parser_type < parse->config->parsers_count) && (!parse->frameDelivered))
+                sempAdaptiveUnlock(parse);
+            parse->frameDelivered = false;
+        }
+
         // Add this byte to the buffer
         parse->crc = 0;
         parse->computeCrc = nullptr;
+        parse->validateFrame = nullptr;
+        parse->verdict = SEMP_FRAME_VALID;
+        parse->epoch.timeBase = SEMP_EPOCH_NONE;
         parse->msg_length = 0;
-        parse->parser_type = parse->parsers_count;
+        parse->parser_type = parse->config->parsers_count;
         parse->buffer[parse->msg_length++] = data;
 
+        // Pinned to one protocol, a single preamble check
+        if (parse->lockFrames && (parse->lockedType < parse->config->parsers_count))
+        {
+            if (parse->config->parsers_table[parse->lockedType](parse, data))
+            {
+                parse->parser_type = parse->lockedType;
+                return true;
+            }
+
+            // Skip the byte until the budget is used up
+            if (parse->budgetUsed < parse->byteBudget)
+            {
+                parse->budgetUsed++;
+                parse->adaptiveStats.skippedBytes++;
+                parse->state = sempFirstByte;
+                return false;
+            }
+            sempAdaptiveUnlock(parse);
+        }
+
+        // Walk through the parse table in order of frame frequency
+        if (parse->sortInterval)
+        {
+            for (index = 0; index < parse->config->parsers_count; index++)
+            {
+                type = parse->probeOrder[index];
+                if (parse->config->parsers_table[type](parse, data))
+                {
+                    parse->parser_type = type;
+                    return true;
+                }
+            }
+            parse->state = sempFirstByte;
+            return false;
+        }
+
         // Walk through the parse table
-        for (index = 0; index < parse->parsers_count; index++)
+        for (index = 0; index < parse->config->parsers_count; index++)
         {
-            parseRoutine = parse->parsers_table[index];
+            parseRoutine = parse->config->parsers_table[index];
             if (parseRoutine(parse, data))
             {
                 parse->parser_type = index;
@@ -149,14 +281,21 @@ bool sempFirstByte(SEMP_PARSE_STATE *parse, uint8_t data)
 // Parse the next byte
 void sempParseNextByte(SEMP_PARSE_STATE *parse, uint8_t data)
 {
+    uint16_t length;
+
     if (parse)
     {
+        // Stream binary frames that do not fit in the buffer
+        if ((parse->msg_length >= parse->buffer_length) && parse->chunkCallback
+            && parse->validateFrame && (parse->state != sempFirstByte))
+            sempStreamSpill(parse);
+
         // Verify that enough space exists in the buffer
         if (parse->msg_length >= parse->buffer_length)
         {
             // Message too long
             sempPrintf(parse->printError, "SEMP %s: Message too long, increase the buffer size > %d\r\n",
-                       parse->parserName,
+                       parse->config->parserName,
                        parse->buffer_length);
 
             // Start searching for a preamble byte
@@ -167,22 +306,281 @@ void sempParseNextByte(SEMP_PARSE_STATE *parse, uint8_t data)
         // Save the data byte
         parse->buffer[parse->msg_length++] = data;
 
-        // Compute the CRC value for the message
-        if (parse->computeCrc)
+        // Compute the CRC value for the message, deferred in lazy mode
+        if (parse->computeCrc && (!parse->lazyCrc))
             parse->crc = parse->computeCrc(parse, data);
 
         // Update the parser state based on the incoming byte
+        length = parse->msg_length;
         parse->state(parse, data);
+
+        // The CRC of a streamed frame failed, the last bytes are still
+        // in the buffer even when the parser cleared the length
+        if ((parse->state == sempFirstByte) && parse->streamOffset)
+        {
+            parse->msg_length = length;
+            sempStreamChunk(parse, length, true, SEMP_FRAME_BAD_CRC);
+            parse->msg_length = 0;
+        }
+    }
+}
+
+// Restart the preamble search at the byte following the current preamble.
+// Called by the parsers when the framing proves inconsistent, for example
+// a length field larger than the buffer, so that a real preamble hidden
+// in the header bytes is not skipped.
+void sempResync(SEMP_PARSE_STATE *parse)
+{
+    uint8_t replay[SEMP_RESYNC_BYTES];
+    const uint8_t *inputByte;
+    uint16_t length;
+    uint16_t index;
+
+    if (parse && parse->msg_length)
+    {
+        // Frames found in the replayed bytes are not at the input byte
+        inputByte = parse->inputByte;
+        parse->inputByte = nullptr;
+
+        // Save the bytes following the preamble, the header is short
+        length = parse->msg_length - 1;
+        if (length > sizeof(replay))
+            length = sizeof(replay);
+        memcpy(replay, &parse->buffer[1], length);
+
+        // Start searching for a preamble byte
+        parse->state = sempFirstByte;
+        parse->msg_length = 0;
+        for (index = 0; index < length; index++)
+            sempParseNextByte(parse, replay[index]);
+        parse->inputByte = inputByte;
+    }
+}
+
+// Enable or disable lazy CRC validation
+void sempEnableLazyValidation(SEMP_PARSE_STATE *parse, bool enable)
+{
+    if (parse)
+    {
+        if (enable && parse->chunkCallback)
+        {
+            sempPrintf(parse->printError, "SEMP %s: Lazy validation is not available while streaming",
+                       parse->config->parserName);
+            return;
+        }
+        parse->lazyCrc = enable;
+    }
+}
+
+// Enable or disable streaming of large frames
+void sempEnableStreaming(SEMP_PARSE_STATE *parse, SEMP_CHUNK_CALLBACK chunkCallback)
+{
+    if (parse)
+    {
+        // Finish a frame that is being streamed
+        if (parse->streamOffset && (!chunkCallback))
+        {
+            sempStreamChunk(parse, parse->msg_length, true, SEMP_FRAME_BAD_CRC);
+            parse->state = sempFirstByte;
+            parse->msg_length = 0;
+        }
+        parse->chunkCallback = chunkCallback;
+        if (chunkCallback)
+            parse->lazyCrc = false;
+    }
+}
+
+// Count the frame toward the adaptive lock-in
+static void sempAdaptiveFrame(SEMP_PARSE_STATE *parse)
+{
+    parse->frameDelivered = true;
+    parse->budgetUsed = 0;
+    if (parse->lockedType < parse->config->parsers_count)
+    {
+        parse->adaptiveStats.hits++;
+        return;
+    }
+
+    // Pin the parser after enough consecutive frames of one protocol
+    if (parse->consecutiveFrames && (parse->candidateType == parse->parser_type))
+        parse->consecutiveFrames++;
+    else
+    {
+        parse->candidateType = parse->parser_type;
+        parse->consecutiveFrames = 1;
+    }
+    if (parse->consecutiveFrames >= parse->lockFrames)
+    {
+        parse->lockedType = parse->parser_type;
+        parse->adaptiveStats.locks++;
+    }
+}
+
+// Sort the probe order by the recent frame counts
+static void sempSortProbeOrder(SEMP_PARSE_STATE *parse)
+{
+    uint8_t index;
+    uint8_t slot;
+    uint8_t type;
+
+    // Insertion sort, stable so equal counts keep the table order
+    for (index = 1; index < parse->config->parsers_count; index++)
+    {
+        type = parse->probeOrder[index];
+        for (slot = index; slot && (parse->frameCounts[parse->probeOrder[slot - 1]]
+                                    < parse->frameCounts[type]); slot--)
+            parse->probeOrder[slot] = parse->probeOrder[slot - 1];
+        parse->probeOrder[slot] = type;
+    }
+
+    // Age the counts to follow changes in the mix
+    for (index = 0; index < parse->config->parsers_count; index++)
+        parse->frameCounts[index] >>= 1;
+    parse->framesUntilSort = parse->sortInterval;
+}
+
+// Deliver the complete frame
+void sempEndOfFrame(SEMP_PARSE_STATE *parse)
+{
+    if (parse->lockFrames)
+        sempAdaptiveFrame(parse);
+    if (parse->sortInterval)
+    {
+        parse->frameCounts[parse->parser_type]++;
+        if (!--parse->framesUntilSort)
+            sempSortProbeOrder(parse);
+    }
+    if (parse->streamOffset)
+        sempStreamChunk(parse, parse->msg_length, true, parse->verdict);
+    else
+        parse->config->eomCallback(parse, parse->parser_type);
+}
+
+// Enable adaptive protocol lock-in
+void sempEnableAdaptiveLock(SEMP_PARSE_STATE *parse, uint16_t lockFrames, uint32_t byteBudget)
+{
+    if (parse)
+    {
+        parse->lockFrames = lockFrames;
+        parse->byteBudget = byteBudget;
+        parse->budgetUsed = 0;
+        parse->consecutiveFrames = 0;
+        parse->frameDelivered = false;
+        parse->lockedType = parse->config->parsers_count;
+        memset(&parse->adaptiveStats, 0, sizeof(parse->adaptiveStats));
+    }
+}
+
+// Enable probing the parsers table in order of frame frequency
+void sempEnableAdaptiveOrder(SEMP_PARSE_STATE *parse, uint16_t sortInterval)
+{
+    uint8_t index;
+
+    if (parse)
+    {
+        if (sortInterval && (parse->config->parsers_count > SEMP_PROBE_ORDER_PARSERS))
+        {
+            sempPrintf(parse->printError, "SEMP %s: Adaptive order supports up to %d parsers",
+                       parse->config->parserName, SEMP_PROBE_ORDER_PARSERS);
+            return;
+        }
+
+        // Start from the table order
+        for (index = 0; index < parse->config->parsers_count; index++)
+        {
+            parse->probeOrder[index] = index;
+            parse->frameCounts[index] = 0;
+        }
+        parse->sortInterval = sortInterval;
+        parse->framesUntilSort = sortInterval;
+    }
+}
+
+// Get the adaptive lock-in counters
+void sempGetAdaptiveStats(SEMP_PARSE_STATE *parse, SEMP_ADAPTIVE_STATS *stats)
+{
+    if (parse && stats)
+    {
+        *stats = parse->adaptiveStats;
+        stats->lockedType = parse->lockFrames ? parse->lockedType : parse->config->parsers_count;
+    }
+}
+
+// Validate the frame in the buffer
+bool sempValidateFrame(SEMP_PARSE_STATE *parse)
+{
+    bool valid;
+
+    if (!parse)
+        return false;
+    if (parse->verdict == SEMP_FRAME_UNVALIDATED)
+    {
+        valid = (!parse->validateFrame)
+              || parse->validateFrame(parse->buffer, parse->msg_length);
+
+        // Give the upper layer a chance to accept the frame
+        if ((!valid) && parse->config->badCrc && (!parse->config->badCrc(parse)))
+            valid = true;
+        parse->verdict = valid ? SEMP_FRAME_VALID : SEMP_FRAME_BAD_CRC;
+    }
+    return (parse->verdict == SEMP_FRAME_VALID);
+}
+
+// Get the GNSS time tag of the frame in the buffer
+SEMP_EPOCH sempGetFrameEpoch(SEMP_PARSE_STATE *parse, uint16_t type)
+{
+    SEMP_EPOCH none = {0, SEMP_EPOCH_NO_WEEK, SEMP_EPOCH_NONE};
+
+    if ((!parse) || (type != parse->parser_type))
+        return none;
+    return parse->epoch;
+}
+
+// Capture a reference to the frame in the buffer
+void sempGetFrame(SEMP_PARSE_STATE *parse, uint16_t type, SEMP_FRAME *frame)
+{
+    if (parse && frame)
+    {
+        frame->buffer = parse->buffer;
+        frame->length = parse->msg_length;
+        frame->type = type;
+        frame->validate = parse->validateFrame;
+        frame->verdict = parse->verdict;
     }
 }
 
+// Get the address of the frame in the data passed to sempParseBuffer
+const uint8_t * sempGetFrameInput(const SEMP_PARSE_STATE *parse)
+{
+    // Only the binary frames are copied unchanged from the input
+    if ((!parse) || (!parse->inputByte) || (!parse->validateFrame) || parse->streamOffset
+        || ((size_t)(parse->inputByte + 1 - parse->inputStart) < parse->msg_length))
+        return nullptr;
+    return parse->inputByte + 1 - parse->msg_length;
+}
+
+// Validate a captured frame
+bool sempFrameValidate(SEMP_FRAME *frame)
+{
+    if (!frame)
+        return false;
+    if (frame->verdict == SEMP_FRAME_UNVALIDATED)
+    {
+        if ((!frame->validate) || frame->validate(frame->buffer, frame->length))
+            frame->verdict = SEMP_FRAME_VALID;
+        else
+            frame->verdict = SEMP_FRAME_BAD_CRC;
+    }
+    return (frame->verdict == SEMP_FRAME_VALID);
+}
+
 // Shutdown the parser
 void sempStopParser(SEMP_PARSE_STATE **parse)
 {
     // Free the parse structure if it was specified
     if (parse && *parse)
     {
-        semp_util_free(*parse);
+        semp_util_aligned_free(*parse);
         *parse = nullptr;
     }
 }
@@ -212,8 +610,16 @@ SEMP_PARSE_STATE * sempAllocateParseStructure(
     sempPrintf(printDebug, "scratchPadBytes: 0x%04x (%d) bytes",
                scratchPadBytes, scratchPadBytes);
 
+    // The scratch pad inside the parse structure is used when it is large enough
+    if (scratchPadBytes <= sizeof(SEMP_SCRATCH_PAD))
+    {
+        scratchPadBytes = 0;
+        sempPrintf(printDebug, "scratchPadBytes: using the %d bytes in the parse structure",
+                   (int)sizeof(SEMP_SCRATCH_PAD));
+    }
+
     // Align the scratch patch area
-    if (scratchPadBytes < SEMP_ALIGN(scratchPadBytes))
+    else if (scratchPadBytes < SEMP_ALIGN(scratchPadBytes))
     {
         scratchPadBytes = SEMP_ALIGN(scratchPadBytes);
         sempPrintf(printDebug,
@@ -221,15 +627,6 @@ SEMP_PARSE_STATE * sempAllocateParseStructure(
                    scratchPadBytes, scratchPadBytes);
     }
 
-    // Determine the minimum length for the scratch pad
-    length = SEMP_ALIGN(sizeof(SEMP_SCRATCH_PAD));
-    if (scratchPadBytes < length)
-    {
-        scratchPadBytes = length;
-        sempPrintf(printDebug,
-                   "scratchPadBytes: 0x%04x (%d) bytes after mimimum size adjustment",
-                   scratchPadBytes, scratchPadBytes);
-    }
     parseBytes = SEMP_ALIGN(sizeof(SEMP_PARSE_STATE));
     sempPrintf(printDebug, "parseBytes: 0x%04x (%d)", parseBytes, parseBytes);
 
@@ -244,7 +641,7 @@ SEMP_PARSE_STATE * sempAllocateParseStructure(
 
     // Allocate the parser
     length = parseBytes + scratchPadBytes;
-    parse = (SEMP_PARSE_STATE *)semp_util_malloc(length + bufferLength);
+    parse = (SEMP_PARSE_STATE *)semp_util_aligned_malloc(length + bufferLength);
     sempPrintf(printDebug, "parse: %p", (void *)parse);
 
     // Initialize the parse structure
@@ -254,13 +651,14 @@ SEMP_PARSE_STATE * sempAllocateParseStructure(
         memset(parse, 0, length);
 
         // Set the scratch pad area address
-        parse->scratchPad = ((uint8_t *)parse) + parseBytes;
+        parse->scratchPad = scratchPadBytes ? (void *)(((uint8_t *)parse) + parseBytes)
+                                            : (void *)&parse->scratch;
         parse->printDebug = printDebug;
         sempPrintf(parse->printDebug, "parse->scratchPad: %p", parse->scratchPad);
 
         // Set the buffer address and length
         parse->buffer_length = bufferLength;
-        parse->buffer = ((uint8_t *)parse->scratchPad + scratchPadBytes);
+        parse->buffer = ((uint8_t *)parse) + length;
         sempPrintf(parse->printDebug, "parse->buffer: %p", parse->buffer);
     }
     return parse;
@@ -278,6 +676,31 @@ void semp_util_free(void *ptr)
     }
 }
 
+// The address from semp_util_malloc is kept just below the aligned block
+void * semp_util_aligned_malloc(size_t size)
+{
+    uint8_t *memory;
+    uintptr_t aligned;
+
+    memory = (uint8_t *)semp_util_malloc(size + sizeof(void *) + SEMP_CACHE_LINE_BYTES - 1);
+    if (!memory)
+        return nullptr;
+    aligned = ((uintptr_t)(memory + sizeof(void *)) + SEMP_CACHE_LINE_BYTES - 1)
+            & ~(uintptr_t)(SEMP_CACHE_LINE_BYTES - 1);
+    memcpy((uint8_t *)aligned - sizeof(void *), &memory, sizeof(void *));
+    return (void *)aligned;
+}
+
+void semp_util_aligned_free(void *ptr)
+{
+    void *memory;
+
+    if (ptr) {
+        memcpy(&memory, (uint8_t *)ptr - sizeof(void *), sizeof(void *));
+        semp_util_free(memory);
+    }
+}
+
 // Translate the type value into an ASCII type name
 const char * sempGetTypeName(SEMP_PARSE_STATE *parse, uint16_t type)
 {
@@ -285,10 +708,10 @@ const char * sempGetTypeName(SEMP_PARSE_STATE *parse, uint16_t type)
 
     if (parse)
     {
-        if (type == parse->parsers_count)
+        if (type == parse->config->parsers_count)
             name = "No active parser, scanning for preamble";
-        else if (parse->parserNames_table && (type < parse->parsers_count))
-            name = parse->parserNames_table[type];
+        else if (parse->config->parserNames_table && (type < parse->config->parsers_count))
+            name = parse->config->parserNames_table[type];
     }
     return name;
 }
@@ -298,19 +721,25 @@ void sempPrintParserConfiguration(SEMP_PARSE_STATE *parse, SEMP_PRINTF_CALLBACK
     if (print && parse)
     {
         sempPrintln(print, "SparkFun Extensible Message Parser");
-        sempPrintf(print, "    Name: %p (%s)", parse->parserName, parse->parserName);
-        sempPrintf(print, "    parsers: %p", (void *)parse->parsers_table);
-        sempPrintf(print, "    parserNames: %p", (void *)parse->parserNames_table);
-        sempPrintf(print, "    parserCount: %d", parse->parsers_count);
+        sempPrintf(print, "    Name: %p (%s)", parse->config->parserName, parse->config->parserName);
+        sempPrintf(print, "    parsers: %p", (void *)parse->config->parsers_table);
+        sempPrintf(print, "    parserNames: %p", (void *)parse->config->parserNames_table);
+        sempPrintf(print, "    parserCount: %d", parse->config->parsers_count);
         sempPrintf(print, "    printError: %p", parse->printError);
         sempPrintf(print, "    printDebug: %p", parse->printDebug);
         sempPrintf(print, "    Scratch Pad: %p (%ld bytes)",
-                   (void *)parse->scratchPad, parse->buffer - (uint8_t *)parse->scratchPad);
+                   (void *)parse->scratchPad,
+                   (parse->scratchPad == (void *)&parse->scratch)
+                   ? (long)sizeof(SEMP_SCRATCH_PAD)
+                   : (long)(parse->buffer - (uint8_t *)parse->scratchPad));
         sempPrintf(print, "    computeCrc: %p", (void *)parse->computeCrc);
         sempPrintf(print, "    crc: 0x%08x", parse->crc);
+        sempPrintf(print, "    lazyCrc: %s", parse->lazyCrc ? "true" : "false");
+        sempPrintf(print, "    chunkCallback: %p", (void *)parse->chunkCallback);
+        sempPrintf(print, "    lockFrames: %d", parse->lockFrames);
         sempPrintf(print, "    State: %p%s", (void *)parse->state,
                    (parse->state == sempFirstByte) ? " (sempFirstByte)" : "");
-        sempPrintf(print, "    EomCallback: %p", (void *)parse->eomCallback);
+        sempPrintf(print, "    EomCallback: %p", (void *)parse->config->eomCallback);
         sempPrintf(print, "    Buffer: %p (%d bytes)",
                    (void *)parse->buffer, parse->buffer_length);
         sempPrintf(print, "    length: %d message bytes", parse->msg_length);
@@ -455,6 +884,63 @@ uint8_t semp_util_calculateChecksum(const uint8_t *data, uint16_t length)
     return checksum;
 }
 
+/**
+ * @brief 计算数据段的CRC32
+ * @param crc 初始CRC值
+ * @param data 输入数据
+ * @param length 数据长度
+ * @return 更新后的CRC值
+ */
+uint32_t semp_util_crc32(uint32_t crc, const uint8_t *data, uint16_t length)
+{
+    const uint8_t *end = data + length;
+
+    while (data < end)
+        crc = semp_crc32Table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+/**
+ * @brief 计算数据段的64位快速哈希
+ * @param data 输入数据
+ * @param length 数据长度
+ * @param seed 哈希种子
+ * @return 64位哈希值
+ */
+uint64_t semp_util_hash64(const uint8_t *data, uint16_t length, uint64_t seed)
+{
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+    uint64_t hash = seed ^ (length * multiplier);
+    uint64_t word;
+
+    // Mix eight bytes at a time
+    while (length >= 8)
+    {
+        memcpy(&word, data, sizeof(word));
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
+        data += 8;
+        length -= 8;
+    }
+
+    // Mix the remaining bytes
+    if (length)
+    {
+        word = 0;
+        memcpy(&word, data, length);
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
 /**
  * @brief 解析分隔符字段
  * @param sentence 输入字符串
@@ -40,6 +40,10 @@ extern const unsigned long semp_crc32Table[256];
 #define SEMP_MAX_PARSER_NAME_LEN 32
 #define SEMP_MINIMUM_BUFFER_LENGTH 256
 #define SEMP_ALIGNMENT_MASK 7
+#define SEMP_RESYNC_BYTES 32
+#define SEMP_STREAM_TAIL_BYTES 8   // Frame bytes kept in the buffer after a chunk
+#define SEMP_CACHE_LINE_BYTES 64   // Size of the per byte block of the parse structure
+#define SEMP_PROBE_ORDER_PARSERS 16 // Parsers table entries reordered by frame frequency
 
 #define SEMP_ALIGN(x) ((x + SEMP_ALIGNMENT_MASK) & (~SEMP_ALIGNMENT_MASK))
 
@@ -82,6 +86,44 @@ typedef bool (*SEMP_BAD_CRC_CALLBACK)(SEMP_PARSE_STATE *parse); // Parser state
 // 调试输出回调
 typedef void (*SEMP_PRINTF_CALLBACK)(const char *format, ...);
 
+// Span validation routine, checks the CRC or checksum of a complete frame
+// in a single pass over the buffer.  Returns true when the frame is valid.
+typedef bool (*SEMP_VALIDATE_FRAME)(const uint8_t *buffer, uint16_t length);
+
+// Frame validation result
+typedef enum
+{
+    SEMP_FRAME_VALID = 0,       // CRC or checksum verified
+    SEMP_FRAME_UNVALIDATED,     // Lazy mode, CRC not yet checked
+    SEMP_FRAME_BAD_CRC,         // CRC or checksum failed
+} SEMP_FRAME_VERDICT;
+
+// Reference to a framed message.  The buffer is owned by the caller,
+// validate and verdict carry the deferred CRC check along with the frame.
+typedef struct _SEMP_FRAME
+{
+    const uint8_t *buffer;        // Start of the frame, preamble included
+    uint16_t length;              // Number of bytes in the frame
+    uint16_t type;                // Index into the parsers table
+    SEMP_VALIDATE_FRAME validate; // Span CRC routine, nullptr if none
+    uint8_t verdict;              // SEMP_FRAME_VERDICT, memoized
+} SEMP_FRAME;
+
+// Piece of a frame larger than the buffer.  The chunks arrive in order,
+// the last one has final set and carries the verdict of the whole frame.
+typedef struct _SEMP_CHUNK
+{
+    const uint8_t *data;    // Frame bytes, valid during the callback only
+    uint16_t length;        // Number of bytes in this chunk
+    uint32_t offset;        // Offset of the chunk from the start of the frame
+    uint16_t type;          // Index into the parsers table
+    bool final;             // Last chunk of the frame
+    uint8_t verdict;        // SEMP_FRAME_VERDICT, set in the final chunk
+} SEMP_CHUNK;
+
+// Large frame callback routine
+typedef void (*SEMP_CHUNK_CALLBACK)(SEMP_PARSE_STATE *parse, const SEMP_CHUNK *chunk);
+
 // Length of the sentence name array
 #define SEMP_NMEA_SENTENCE_NAME_BYTES    16
 
@@ -134,6 +176,14 @@ typedef struct _SEMP_CUSTOM_VALUES
     uint16_t bytesRemaining; // Bytes remaining in RTCM CRC calculation
 } SEMP_CUSTOM_VALUES;
 
+// Generic framing engine scratch area, the descriptor address is kept as
+// bytes so that the scratch pad stays 4 byte aligned in the first cache line
+typedef struct _SEMP_FRAMING_VALUES
+{
+    uint32_t bytesRemaining;            // Bytes remaining in the frame
+    uint8_t descriptor[sizeof(void *)]; // SEMP_FRAMING_DESCRIPTOR address
+} SEMP_FRAMING_VALUES;
+
 // Overlap the scratch areas since only one parser is active at a time
 typedef union
 {
@@ -143,38 +193,138 @@ typedef union
     SEMP_UNICORE_BINARY_VALUES unicoreBinary; // Unicore binary specific values
     SEMP_UNICORE_HASH_VALUES unicoreHash;     // Unicore hash (#) specific values
     SEMP_CUSTOM_VALUES custom;
+    SEMP_FRAMING_VALUES framing;  // Generic framing engine values
 } SEMP_SCRATCH_PAD;
+// Time base of a frame's GNSS time tag
+typedef enum
+{
+    SEMP_EPOCH_NONE = 0,    // Frame carries no time tag
+    SEMP_EPOCH_GPS_TOW,     // GPS (Galileo, QZSS) time of week
+    SEMP_EPOCH_BDS_TOW,     // BeiDou time of week, GPS - 14 seconds
+    SEMP_EPOCH_GLONASS_TOD, // GLONASS time of day, UTC + 3 hours
+    SEMP_EPOCH_UTC_TOD,     // UTC time of day
+} SEMP_EPOCH_TIME_BASE;
+
+#define SEMP_EPOCH_NO_WEEK      0xffff
+
+// GNSS time tag of a frame
+typedef struct _SEMP_EPOCH
+{
+    uint32_t milliseconds; // Time of week or time of day in milliseconds
+    uint16_t week;         // Week number, SEMP_EPOCH_NO_WEEK when not in the frame
+    uint8_t timeBase;      // SEMP_EPOCH_TIME_BASE
+} SEMP_EPOCH;
+
 //----------------------------------------
 // 主解析器状态结构体
 //----------------------------------------
 
-typedef struct _SEMP_PARSE_STATE {
-  // 解析器配置
-  const char *parserName; // Name of parser
-
+// Adaptive lock-in counters, see sempEnableAdaptiveLock
+typedef struct _SEMP_ADAPTIVE_STATS
+{
+    uint32_t locks;             // Times the parser pinned to one protocol
+    uint32_t hits;              // Frames delivered while pinned
+    uint32_t fallbacks;         // Returns to the full parsers table scan
+    uint32_t skippedBytes;      // Bytes not offered to the other protocols
+    uint8_t lockedType;         // Pinned parser type, parsers_count when scanning
+} SEMP_ADAPTIVE_STATS;
+
+// Parser configuration, may be shared by many parsers of the same kind
+typedef struct _SEMP_PARSER_CONFIG
+{
+  const char *parserName;                  // Name of parser
   const SEMP_PARSE_ROUTINE *parsers_table; // Table of parsers
   const char *const *parserNames_table;    // Table of parser names
-  uint8_t parsers_count;   // Number of parsers
-  uint8_t parser_type;      // Current parser type
-
+  SEMP_EOM_CALLBACK eomCallback;           // End of message callback routine
+  SEMP_BAD_CRC_CALLBACK badCrc;            // Bad CRC callback routine
+  uint8_t parsers_count;                   // Number of parsers
+} SEMP_PARSER_CONFIG;
+
+// The fields used for every byte and the scratch pad of the built-in
+// parsers fill the first SEMP_CACHE_LINE_BYTES of the structure, followed
+// by the per frame fields.  The configuration is shared through a pointer,
+// so parsers of the same kind also share its cache line.  The structure
+// starts on a cache line boundary, so the first block is a single line.
+typedef struct _SEMP_PARSE_STATE {
+  // 逐字节访问, 第一个缓存行
   SEMP_PARSE_ROUTINE state;      // Parser state routine
-  SEMP_EOM_CALLBACK eomCallback; // End of message callback routine
-  SEMP_BAD_CRC_CALLBACK badCrc;  // Bad CRC callback routine
   SEMP_COMPUTE_CRC computeCrc;   // Routine to compute the CRC when set
-
+  uint8_t *buffer;               // 消息缓冲区
+  void *scratchPad;              // Parser scratchpad area
+  uint32_t crc;                  // 当前CRC值
+  uint16_t msg_length;           // 当前消息长度
+  uint16_t buffer_length;        // 缓冲区总长度
+  uint8_t parser_type;           // Current parser type
+  uint8_t verdict;               // SEMP_FRAME_VERDICT of the current frame
+  bool lazyCrc;                  // Skip per-byte CRC, validate on demand
+  SEMP_SCRATCH_PAD scratch;      // Scratch pad unless a larger one is requested
+
+  // 每帧访问
+  const SEMP_PARSER_CONFIG *config;  // Tables, names and callbacks
+  SEMP_VALIDATE_FRAME validateFrame; // Span CRC routine for lazy validation
+  SEMP_CHUNK_CALLBACK chunkCallback; // Large frame chunks, nullptr when disabled
+  uint32_t streamOffset;         // Frame bytes already passed to chunkCallback
+  SEMP_EPOCH epoch;              // Time tag captured at the end of the frame
+  void *userContext;             // Application context, not used by the parser
+  const uint8_t *inputStart;     // Data passed to sempParseBuffer, nullptr otherwise
+  const uint8_t *inputByte;      // Byte passed to the state routine by sempParseBuffer
+
+  // 自适应协议锁定, 每帧访问
+  uint16_t lockFrames;           // Consecutive frames before pinning, 0 when disabled
+  uint16_t consecutiveFrames;    // Consecutive frames of candidateType
+  uint8_t candidateType;         // Parser type of the last frame
+  uint8_t lockedType;            // Pinned parser type, parsers_count when scanning
+  bool frameDelivered;           // The current preamble led to a frame
+  uint32_t byteBudget;           // Unclaimed bytes skipped while pinned
+  uint32_t budgetUsed;           // Bytes skipped since the last frame
+  SEMP_ADAPTIVE_STATS adaptiveStats; // Lock-in counters
+
+  // 按帧频率排序的前导探测顺序, 每帧访问
+  uint16_t sortInterval;         // Frames between sorts, 0 for the table order
+  uint16_t framesUntilSort;      // Frames left before the next sort
+  uint8_t probeOrder[SEMP_PROBE_ORDER_PARSERS];   // Parsers table indices in probe order
+  uint32_t frameCounts[SEMP_PROBE_ORDER_PARSERS]; // Recent frames of each parser type
+
+  // 调试与错误输出
   SEMP_PRINTF_CALLBACK printError; // 错误输出
   SEMP_PRINTF_CALLBACK printDebug; // 调试输出
 
-  void *scratchPad; // Parser scratchpad area
-  // CRC计算
-  uint32_t crc; // 当前CRC值
+  SEMP_PARSER_CONFIG ownConfig;  // Configuration passed to sempBeginParser
+} SEMP_PARSE_STATE;
 
-  // 缓冲区管理
-  uint8_t *buffer;       // 消息缓冲区
-  uint16_t msg_length;   // 当前消息长度
-  uint16_t buffer_length; // 缓冲区总长度
+//----------------------------------------
+// Parser state tables
+//----------------------------------------
 
-} SEMP_PARSE_STATE;
+// Protocol identifiers, stored in parser snapshots, never renumber
+typedef enum
+{
+    SEMP_PROTOCOL_NONE = 0,         // Searching for a preamble, sempFirstByte
+    SEMP_PROTOCOL_NMEA,
+    SEMP_PROTOCOL_RTCM,
+    SEMP_PROTOCOL_UBLOX,
+    SEMP_PROTOCOL_UNICORE_BINARY,
+    SEMP_PROTOCOL_UNICORE_HASH,
+    SEMP_PROTOCOL_CUSTOM,
+    SEMP_PROTOCOL_FRAMING,          // Generic framing engine, Message_Framing.c
+} SEMP_PROTOCOL_ID;
+
+// Stable state ID, the protocol in the high byte and the index into the
+// protocol's state table in the low byte.  sempFirstByte is state ID 0.
+#define SEMP_STATE_ID(protocol, index)  ((uint16_t)(((protocol) << 8) | (index)))
+
+// State routines of a protocol.  New states are appended to the tables
+// so that the index of an existing state never changes.
+typedef struct _SEMP_PROTOCOL_STATES
+{
+    uint8_t protocol;                   // SEMP_PROTOCOL_ID
+    SEMP_PARSE_ROUTINE preamble;        // Routine in the parsers table, nullptr for any
+    SEMP_COMPUTE_CRC computeCrc;        // CRC routine set by the preamble
+    SEMP_VALIDATE_FRAME validateFrame;  // Span CRC routine set by the preamble
+    const SEMP_PARSE_ROUTINE *states;   // State routines in ID order
+    const char * const *stateNames;     // State routine names in ID order
+    uint8_t stateCount;                 // Number of states
+} SEMP_PROTOCOL_STATES;
 
 //----------------------------------------
 // Protocol specific types
@@ -239,6 +389,16 @@ SEMP_PARSE_STATE * sempBeginParser(
     SEMP_PRINTF_CALLBACK printDebug, \
     SEMP_BAD_CRC_CALLBACK badCrcCallback);
 
+// Allocate a parse data structure using a configuration shared with
+// other parsers, the configuration must remain valid until the parser
+// is stopped
+SEMP_PARSE_STATE * sempBeginSharedParser(
+    const SEMP_PARSER_CONFIG *config,
+    uint16_t scratchPadBytes,
+    uint16_t bufferLength,
+    SEMP_PRINTF_CALLBACK printError,
+    SEMP_PRINTF_CALLBACK printDebug);
+
 // The routine sempFirstByte is used to determine if the first byte
 // is the preamble for a message.
 bool sempFirstByte(SEMP_PARSE_STATE *parse, uint8_t data);
@@ -246,6 +406,11 @@ bool sempFirstByte(SEMP_PARSE_STATE *parse, uint8_t data);
 // The routine sempParseNextByte is used to parse the next data byte from a raw data stream.
 void sempParseNextByte(SEMP_PARSE_STATE *parse, uint8_t data);
 
+// The routine sempParseBuffer parses a block of raw data.  The output is
+// the same as passing each byte to sempParseNextByte, the engine is
+// selected at build time (SEMP_ENGINE, see Message_Engine.c).
+void sempParseBuffer(SEMP_PARSE_STATE *parse, const uint8_t *data, size_t length);
+
 // The routine sempStopParser frees the parse data structure and sets
 // the pointer value to nullptr to prevent future references to the
 // freed structure.
@@ -267,6 +432,72 @@ const char * sempGetTypeName(SEMP_PARSE_STATE *parse, uint16_t type);
 
 void sempPrintParserConfiguration(SEMP_PARSE_STATE *parse, SEMP_PRINTF_CALLBACK print);
 
+// Enable or disable lazy CRC validation.  In lazy mode frames are
+// delivered to the eomCallback using the length fields only and the
+// verdict is SEMP_FRAME_UNVALIDATED until sempValidateFrame is called.
+void sempEnableLazyValidation(SEMP_PARSE_STATE *parse, bool enable);
+
+// Validate the frame in the buffer, the result is memoized in parse->verdict
+bool sempValidateFrame(SEMP_PARSE_STATE *parse);
+
+// Capture a reference to the frame in the buffer, call from the eomCallback
+void sempGetFrame(SEMP_PARSE_STATE *parse, uint16_t type, SEMP_FRAME *frame);
+
+// Get the address of the frame in the data passed to sempParseBuffer, call
+// from the eomCallback to reference the frame without copying it.  Returns
+// nullptr when the frame is not the last msg_length bytes of that data:
+// text sentences, frames started in an earlier call, streamed frames and
+// frames parsed by sempParseNextByte.  Use parse->buffer in that case.
+const uint8_t * sempGetFrameInput(const SEMP_PARSE_STATE *parse);
+
+// Validate a captured frame, the result is memoized in frame->verdict
+bool sempFrameValidate(SEMP_FRAME *frame);
+
+// Get the GNSS time tag of the frame in the buffer, call from the
+// eomCallback.  The parsers capture the time tag while framing, the
+// timeBase is SEMP_EPOCH_NONE when the frame carries none.
+SEMP_EPOCH sempGetFrameEpoch(SEMP_PARSE_STATE *parse, uint16_t type);
+
+// Restart the preamble search at the byte following the current preamble
+void sempResync(SEMP_PARSE_STATE *parse);
+
+// Enable or disable streaming of frames larger than the buffer.  Binary
+// frames that do not fit are passed to the chunkCallback in pieces
+// instead of being dropped, the CRC is computed as the bytes arrive and
+// the final chunk carries the verdict.  Frames that fit in the buffer
+// still go to the eomCallback.  Lazy validation is turned off since the
+// start of a streamed frame is no longer in the buffer at the end.
+void sempEnableStreaming(SEMP_PARSE_STATE *parse, SEMP_CHUNK_CALLBACK chunkCallback);
+
+// Deliver the complete frame, called by the parsers instead of the
+// eomCallback.  A streamed frame ends with its final chunk.
+void sempEndOfFrame(SEMP_PARSE_STATE *parse);
+
+// Enable adaptive protocol lock-in.  After lockFrames consecutive frames
+// of one protocol, sempFirstByte only offers bytes to that protocol's
+// preamble routine.  A preamble that does not lead to a frame, or more
+// than byteBudget consecutive bytes that the protocol does not claim,
+// return the parser to the full scan of the parsers table.  The default
+// budget of 0 drops no bytes, only bytes matching the preambles of two
+// protocols may go to the pinned protocol instead of the first one in
+// the table.  A lockFrames of 0 disables the mode.  The lock state
+// belongs to the parse structure, it is not saved in snapshots nor
+// carried between the streams of a buffer pool.
+void sempEnableAdaptiveLock(SEMP_PARSE_STATE *parse, uint16_t lockFrames, uint32_t byteBudget);
+
+// Get the adaptive lock-in counters
+void sempGetAdaptiveStats(SEMP_PARSE_STATE *parse, SEMP_ADAPTIVE_STATS *stats);
+
+// Enable probing the parsers table in order of frame frequency.  Every
+// sortInterval frames the probe order is sorted by the recent frame
+// count of each parser, the counts are then halved so the order follows
+// changes in the mix.  The parser types passed to the eomCallback remain
+// the parsers table indices.  Only bytes matching the preambles of two
+// protocols may be claimed by a different protocol than with the table
+// order.  Available for tables of up to SEMP_PROBE_ORDER_PARSERS
+// entries, a sortInterval of 0 restores the table order.
+void sempEnableAdaptiveOrder(SEMP_PARSE_STATE *parse, uint16_t sortInterval);
+
 // Enable or disable debug output
 void sempEnableDebugOutput(SEMP_PARSE_STATE *parse, SEMP_PRINTF_CALLBACK print);
 void sempDisableDebugOutput(SEMP_PARSE_STATE *parse);
@@ -279,6 +510,8 @@ void sempDisableErrorOutput(SEMP_PARSE_STATE *parse);
 // 各协议解析器前导函数声明（在各自的文件中实现）
 //----------------------------------------
 bool sempCustomPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
+bool sempCustomValidate(const uint8_t *buffer, uint16_t length);
+extern const SEMP_PROTOCOL_STATES sempCustomProtocolStates;
 
 //----------------------------------------
 // 工具函数
@@ -288,6 +521,11 @@ bool sempCustomPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
 void * semp_util_malloc(size_t size);
 void semp_util_free(void *ptr);
 
+// SEMP_CACHE_LINE_BYTES aligned memory from semp_util_malloc, release it
+// with semp_util_aligned_free
+void * semp_util_aligned_malloc(size_t size);
+void semp_util_aligned_free(void *ptr);
+
 /**
  * @brief 分配解析结构体
  * @param printDebug 调试输出回调函数
@@ -326,6 +564,24 @@ int semp_util_hexToString(const uint8_t *data, uint16_t length, char *output,
  */
 uint8_t semp_util_calculateChecksum(const uint8_t *data, uint16_t length);
 
+/**
+ * @brief 计算数据段的CRC32 (semp_crc32Table, 无初值/结果取反)
+ * @param crc 初始CRC值
+ * @param data 数据缓冲区
+ * @param length 数据长度
+ * @return 更新后的CRC值
+ */
+uint32_t semp_util_crc32(uint32_t crc, const uint8_t *data, uint16_t length);
+
+/**
+ * @brief 计算数据段的64位快速哈希 (非加密)
+ * @param data 数据缓冲区
+ * @param length 数据长度
+ * @param seed 哈希种子
+ * @return 64位哈希值
+ */
+uint64_t semp_util_hash64(const uint8_t *data, uint16_t length, uint64_t seed);
+
 /**
  * @brief 解析由分隔符分割的字段
  * @param sentence 输入字符串
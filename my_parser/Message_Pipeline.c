@@ -0,0 +1,517 @@
+/**
+ * @file Message_Pipeline.c
+ * @brief 单数据流多核流水线解析 - 功能实现
+ * @details 输入块按环形顺序使用, 分帧线程读满一块并解析后才读下一块.
+ *          帧按顺序流经各级, 所以输入块的引用也按顺序释放, 分帧线程只需等待
+ *          下一个输入块的引用计数归零. 队列的写入位置每SEMP_PIPELINE_BATCH帧
+ *          或每个输入块结束时发布一次, 读取位置每批处理完后发布一次.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#define _GNU_SOURCE     // pthread_setaffinity_np
+#include "Message_Pipeline.h"
+#include "Message_Batch.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+//----------------------------------------
+// 内部类型
+//----------------------------------------
+
+// Reference counted input block, the spill area holds the frames that
+// are not found unchanged in the block data
+struct _SEMP_PIPELINE_BLOCK
+{
+    atomic_uint references;         // Frames in flight plus the framing stage
+    uint8_t *data;                  // Bytes read from the input
+    uint8_t *spill;                 // Copied frames
+    uint32_t spillBytes;            // Bytes used in the spill area
+};
+
+// Single producer, single consumer queue of frame descriptors.  The
+// positions are free running, the slot is the position & mask.  Each
+// line is written by one side only: the published positions, the private
+// positions of each side and the read only slot table.
+typedef struct _SEMP_PIPELINE_QUEUE
+{
+    // Published by the consumer
+    _Alignas(SEMP_CACHE_LINE_BYTES) atomic_size_t head; // Next frame to read
+
+    // Published by the producer
+    _Alignas(SEMP_CACHE_LINE_BYTES) atomic_size_t tail; // Next free slot
+    atomic_bool finished;           // The producer is done
+
+    // Producer only
+    _Alignas(SEMP_CACHE_LINE_BYTES) size_t writeTail;   // Producer position, not yet published
+    size_t headSeen;                // Last head read by the producer
+
+    // Consumer only
+    _Alignas(SEMP_CACHE_LINE_BYTES) size_t readHead;    // Consumer position, not yet published
+
+    // Set by sempPipelineBegin
+    _Alignas(SEMP_CACHE_LINE_BYTES) size_t mask;        // Number of slots - 1
+    SEMP_PIPELINE_FRAME *slots;
+} SEMP_PIPELINE_QUEUE;
+
+typedef struct _SEMP_PIPELINE_STAGE
+{
+    SEMP_PIPELINE *pipeline;
+    pthread_t thread;
+    int cpu;                        // CPU to run on, -1 for any
+    uint8_t index;                  // SEMP_PIPELINE_STAGE_FRAMING - SEMP_PIPELINE_STAGE_SINK
+} SEMP_PIPELINE_STAGE;
+
+struct _SEMP_PIPELINE
+{
+    SEMP_PARSE_STATE *parse;        // Framing stage parser
+    SEMP_PIPELINE_READ read;
+    void *readContext;
+    SEMP_PIPELINE_DECODE decode;
+    SEMP_PIPELINE_OUTPUT output;
+    void *context;
+    SEMP_PRINTF_CALLBACK printError;
+    uint32_t blockBytes;
+    uint32_t spillBytes;            // Size of the spill area of a block
+    uint16_t blockCount;
+    SEMP_PIPELINE_BLOCK *blocks;
+    SEMP_PIPELINE_BLOCK *block;     // Block being framed
+    uint64_t sequence;              // Next frame number
+    SEMP_PIPELINE_QUEUE queues[SEMP_PIPELINE_STAGES - 1]; // Input of stages 2 - 4
+    SEMP_PIPELINE_STAGE stages[SEMP_PIPELINE_STAGES];
+    SEMP_PIPELINE_STATS stats;      // Each field is written by one stage
+};
+
+//----------------------------------------
+// 队列
+//----------------------------------------
+
+// Wait for the other stage
+static void sempPipelinePause(void)
+{
+    sched_yield();
+}
+
+// Make the written frames visible to the consumer
+static void sempPipelinePublish(SEMP_PIPELINE_QUEUE *queue)
+{
+    atomic_store_explicit(&queue->tail, queue->writeTail, memory_order_release);
+}
+
+// Append a frame, publishes full batches and waits while the queue is full.
+// The consumer's line is only read when the last head seen fills the queue.
+static void sempPipelinePush(SEMP_PIPELINE_QUEUE *queue, const SEMP_PIPELINE_FRAME *frame)
+{
+    while ((queue->writeTail - queue->headSeen) > queue->mask)
+    {
+        queue->headSeen = atomic_load_explicit(&queue->head, memory_order_acquire);
+        if ((queue->writeTail - queue->headSeen) <= queue->mask)
+            break;
+        sempPipelinePublish(queue);
+        sempPipelinePause();
+    }
+    queue->slots[queue->writeTail & queue->mask] = *frame;
+    queue->writeTail++;
+    if (!(queue->writeTail % SEMP_PIPELINE_BATCH))
+        sempPipelinePublish(queue);
+}
+
+// Publish the last frames and mark the end of the stream
+static void sempPipelineFinish(SEMP_PIPELINE_QUEUE *queue)
+{
+    sempPipelinePublish(queue);
+    atomic_store_explicit(&queue->finished, true, memory_order_release);
+}
+
+// Wait for frames, returns the number available or 0 at the end of the stream
+static size_t sempPipelineAvailable(SEMP_PIPELINE_QUEUE *queue)
+{
+    size_t count;
+    bool finished;
+
+    for (;;)
+    {
+        finished = atomic_load_explicit(&queue->finished, memory_order_acquire);
+        count = atomic_load_explicit(&queue->tail, memory_order_acquire) - queue->readHead;
+        if (count || finished)
+            return count;
+        sempPipelinePause();
+    }
+}
+
+// Return the slots of the processed frames to the producer
+static void sempPipelineConsume(SEMP_PIPELINE_QUEUE *queue, size_t count)
+{
+    queue->readHead += count;
+    atomic_store_explicit(&queue->head, queue->readHead, memory_order_release);
+}
+
+// Drop a reference to the input block
+static void sempPipelineRelease(SEMP_PIPELINE_BLOCK *block)
+{
+    atomic_fetch_sub_explicit(&block->references, 1, memory_order_release);
+}
+
+//----------------------------------------
+// 各级流水线
+//----------------------------------------
+
+// Queue a descriptor of the frame, the bytes stay in the input block
+static void sempPipelineEomCallback(SEMP_PARSE_STATE *parse, uint16_t type)
+{
+    SEMP_PIPELINE *pipeline = (SEMP_PIPELINE *)parse->userContext;
+    SEMP_PIPELINE_BLOCK *block = pipeline->block;
+    SEMP_PIPELINE_FRAME frame;
+    const uint8_t *input;
+
+    sempGetFrame(parse, type, &frame.frame);
+    input = sempGetFrameInput(parse);
+    if (input)
+        frame.frame.buffer = input;
+    else
+    {
+        // Text sentences and frames started in the previous block
+        if ((block->spillBytes + parse->msg_length) > pipeline->spillBytes)
+        {
+            pipeline->stats.droppedFrames++;
+            sempPrintf(pipeline->printError, "SEMP: Pipeline spill area full, %d byte frame dropped",
+                       parse->msg_length);
+            return;
+        }
+        memcpy(&block->spill[block->spillBytes], parse->buffer, parse->msg_length);
+        frame.frame.buffer = &block->spill[block->spillBytes];
+        block->spillBytes += parse->msg_length;
+        pipeline->stats.copiedFrames++;
+    }
+    frame.sequence = pipeline->sequence++;
+    frame.epoch = sempGetFrameEpoch(parse, type);
+    frame.userData = 0;
+    frame.block = block;
+    atomic_fetch_add_explicit(&block->references, 1, memory_order_relaxed);
+    sempPipelinePush(&pipeline->queues[0], &frame);
+}
+
+// Stage 1: frame the input blocks by their length fields
+static void sempPipelineFraming(SEMP_PIPELINE *pipeline)
+{
+    SEMP_PIPELINE_BLOCK *block;
+    uint16_t next = 0;
+    size_t length;
+
+    for (;;)
+    {
+        // The blocks are released in order, wait for the oldest one
+        block = &pipeline->blocks[next];
+        while (atomic_load_explicit(&block->references, memory_order_acquire))
+            sempPipelinePause();
+
+        length = pipeline->read(pipeline->readContext, block->data, pipeline->blockBytes);
+        if (!length)
+            break;
+        pipeline->stats.bytes += length;
+        atomic_store_explicit(&block->references, 1, memory_order_relaxed);
+        block->spillBytes = 0;
+        pipeline->block = block;
+        sempParseBuffer(pipeline->parse, block->data, length);
+        sempPipelinePublish(&pipeline->queues[0]);
+        sempPipelineRelease(block);
+        next = (next + 1) % pipeline->blockCount;
+    }
+    pipeline->block = nullptr;
+    sempPipelineFinish(&pipeline->queues[0]);
+}
+
+// Stage 2: validate the CRCs of a batch of frames, drop the bad frames
+static void sempPipelineValidate(SEMP_PIPELINE *pipeline)
+{
+    SEMP_PIPELINE_QUEUE *input = &pipeline->queues[0];
+    SEMP_FRAME frames[SEMP_PIPELINE_BATCH];
+    SEMP_PIPELINE_FRAME *frame;
+    size_t count;
+    size_t index;
+
+    while ((count = sempPipelineAvailable(input)))
+    {
+        if (count > SEMP_PIPELINE_BATCH)
+            count = SEMP_PIPELINE_BATCH;
+        for (index = 0; index < count; index++)
+            frames[index] = input->slots[(input->readHead + index) & input->mask].frame;
+        sempFrameValidateBatch(frames, count);
+
+        for (index = 0; index < count; index++)
+        {
+            frame = &input->slots[(input->readHead + index) & input->mask];
+            frame->frame.verdict = frames[index].verdict;
+            if (frame->frame.verdict == SEMP_FRAME_VALID)
+                sempPipelinePush(&pipeline->queues[1], frame);
+            else
+            {
+                pipeline->stats.badFrames++;
+                sempPipelineRelease(frame->block);
+            }
+        }
+        sempPipelineConsume(input, count);
+        sempPipelinePublish(&pipeline->queues[1]);
+    }
+    sempPipelineFinish(&pipeline->queues[1]);
+}
+
+// Stage 3: decode the frames
+static void sempPipelineDecode(SEMP_PIPELINE *pipeline)
+{
+    SEMP_PIPELINE_QUEUE *input = &pipeline->queues[1];
+    SEMP_PIPELINE_FRAME *frame;
+    size_t count;
+    size_t index;
+
+    while ((count = sempPipelineAvailable(input)))
+    {
+        for (index = 0; index < count; index++)
+        {
+            frame = &input->slots[(input->readHead + index) & input->mask];
+            if (pipeline->decode)
+                pipeline->decode(pipeline->context, frame);
+            sempPipelinePush(&pipeline->queues[2], frame);
+        }
+        sempPipelineConsume(input, count);
+        sempPipelinePublish(&pipeline->queues[2]);
+    }
+    sempPipelineFinish(&pipeline->queues[2]);
+}
+
+// Stage 4: output the frames and release the input blocks
+static void sempPipelineSink(SEMP_PIPELINE *pipeline)
+{
+    SEMP_PIPELINE_QUEUE *input = &pipeline->queues[2];
+    SEMP_PIPELINE_FRAME *frame;
+    size_t count;
+    size_t index;
+
+    while ((count = sempPipelineAvailable(input)))
+    {
+        for (index = 0; index < count; index++)
+        {
+            frame = &input->slots[(input->readHead + index) & input->mask];
+            if (pipeline->output)
+                pipeline->output(pipeline->context, frame);
+            pipeline->stats.frames++;
+            sempPipelineRelease(frame->block);
+        }
+        sempPipelineConsume(input, count);
+    }
+}
+
+static void * sempPipelineThread(void *arg)
+{
+    SEMP_PIPELINE_STAGE *stage = (SEMP_PIPELINE_STAGE *)arg;
+#ifdef __linux__
+    cpu_set_t cpus;
+
+    if (stage->cpu >= 0)
+    {
+        CPU_ZERO(&cpus);
+        CPU_SET(stage->cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))
+            sempPrintf(stage->pipeline->printError, "SEMP: Failed to run pipeline stage %d on CPU %d",
+                       stage->index, stage->cpu);
+    }
+#endif
+
+    switch (stage->index)
+    {
+    case SEMP_PIPELINE_STAGE_FRAMING:
+        sempPipelineFraming(stage->pipeline);
+        break;
+    case SEMP_PIPELINE_STAGE_VALIDATE:
+        sempPipelineValidate(stage->pipeline);
+        break;
+    case SEMP_PIPELINE_STAGE_DECODE:
+        sempPipelineDecode(stage->pipeline);
+        break;
+    default:
+        sempPipelineSink(stage->pipeline);
+        break;
+    }
+    return nullptr;
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Allocate the pipeline
+SEMP_PIPELINE * sempPipelineBegin(const SEMP_PARSE_ROUTINE *parsersTable,
+                                  uint8_t parsersCount,
+                                  const char * const *parserNamesTable,
+                                  uint16_t bufferLength,
+                                  uint32_t blockBytes,
+                                  uint16_t blockCount,
+                                  uint32_t queueFrames,
+                                  SEMP_PIPELINE_DECODE decode,
+                                  SEMP_PIPELINE_OUTPUT output,
+                                  void *context,
+                                  SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_PIPELINE *pipeline;
+    size_t slots;
+    size_t length;
+    uint8_t *data;
+    int index;
+
+    if ((!parsersTable) || (!parserNamesTable) || (!parsersCount) || (!blockBytes))
+    {
+        sempPrintln(printError, "SEMP: Please specify the parser tables and the block size");
+        return nullptr;
+    }
+    if (blockCount < SEMP_PIPELINE_MINIMUM_BLOCKS)
+        blockCount = SEMP_PIPELINE_MINIMUM_BLOCKS;
+    if (queueFrames < SEMP_PIPELINE_MINIMUM_QUEUE)
+        queueFrames = SEMP_PIPELINE_MINIMUM_QUEUE;
+    for (slots = 1; slots < queueFrames; slots <<= 1)
+        ;
+
+    // Allocate the pipeline, the queue slots and the blocks together, on a
+    // cache line boundary so that the queue lines are not shared.  The
+    // frames ending in a block are at most a few bytes longer than the
+    // block and the frame carried in from the previous block.
+    length = SEMP_ALIGN(sizeof(SEMP_PIPELINE))
+           + SEMP_ALIGN(blockCount * sizeof(SEMP_PIPELINE_BLOCK))
+           + (SEMP_PIPELINE_STAGES - 1) * slots * sizeof(SEMP_PIPELINE_FRAME);
+    pipeline = (SEMP_PIPELINE *)semp_util_aligned_malloc(length);
+    if (!pipeline)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the pipeline");
+        return nullptr;
+    }
+    memset(pipeline, 0, length);
+    pipeline->blockBytes = blockBytes;
+    pipeline->spillBytes = SEMP_ALIGN(blockBytes + (blockBytes / 4) + bufferLength);
+    pipeline->blockCount = blockCount;
+    pipeline->blocks = (SEMP_PIPELINE_BLOCK *)((uint8_t *)pipeline + SEMP_ALIGN(sizeof(SEMP_PIPELINE)));
+    data = (uint8_t *)pipeline->blocks + SEMP_ALIGN(blockCount * sizeof(SEMP_PIPELINE_BLOCK));
+    for (index = 0; index < (SEMP_PIPELINE_STAGES - 1); index++)
+    {
+        pipeline->queues[index].slots = (SEMP_PIPELINE_FRAME *)data;
+        pipeline->queues[index].mask = slots - 1;
+        data += slots * sizeof(SEMP_PIPELINE_FRAME);
+    }
+    for (index = 0; index < blockCount; index++)
+    {
+        pipeline->blocks[index].data = (uint8_t *)semp_util_malloc(SEMP_ALIGN(blockBytes)
+                                                                   + pipeline->spillBytes);
+        if (!pipeline->blocks[index].data)
+        {
+            sempPrintln(printError, "SEMP: Failed to allocate the pipeline blocks");
+            sempPipelineStop(&pipeline);
+            return nullptr;
+        }
+        pipeline->blocks[index].spill = pipeline->blocks[index].data + SEMP_ALIGN(blockBytes);
+    }
+
+    // The framing stage only frames, the CRCs are checked in bulk later
+    pipeline->parse = sempBeginParser("Pipeline", parsersTable, parsersCount,
+                                      parserNamesTable, parsersCount,
+                                      0, bufferLength, sempPipelineEomCallback,
+                                      printError, nullptr, nullptr);
+    if (!pipeline->parse)
+    {
+        sempPipelineStop(&pipeline);
+        return nullptr;
+    }
+    sempEnableLazyValidation(pipeline->parse, true);
+    pipeline->parse->userContext = pipeline;
+    pipeline->decode = decode;
+    pipeline->output = output;
+    pipeline->context = context;
+    pipeline->printError = printError;
+    for (index = 0; index < SEMP_PIPELINE_STAGES; index++)
+    {
+        pipeline->stages[index].pipeline = pipeline;
+        pipeline->stages[index].cpu = -1;
+        pipeline->stages[index].index = index;
+    }
+    return pipeline;
+}
+
+// Select the CPU of a stage
+bool sempPipelineSetAffinity(SEMP_PIPELINE *pipeline, uint8_t stage, int cpu)
+{
+    if ((!pipeline) || (stage >= SEMP_PIPELINE_STAGES))
+        return false;
+    pipeline->stages[stage].cpu = cpu;
+    return true;
+}
+
+// Run the stages until the input ends
+bool sempPipelineRun(SEMP_PIPELINE *pipeline, SEMP_PIPELINE_READ read, void *readContext)
+{
+    SEMP_PIPELINE_QUEUE *queue;
+    uint8_t started;
+    uint8_t index;
+
+    if ((!pipeline) || (!read))
+        return false;
+
+    // Start with empty queues and free blocks
+    pipeline->read = read;
+    pipeline->readContext = readContext;
+    pipeline->sequence = 0;
+    memset(&pipeline->stats, 0, sizeof(pipeline->stats));
+    for (index = 0; index < (SEMP_PIPELINE_STAGES - 1); index++)
+    {
+        queue = &pipeline->queues[index];
+        atomic_store(&queue->head, 0);
+        atomic_store(&queue->tail, 0);
+        atomic_store(&queue->finished, false);
+        queue->writeTail = 0;
+        queue->readHead = 0;
+    }
+    for (index = 0; index < pipeline->blockCount; index++)
+        atomic_store(&pipeline->blocks[index].references, 0);
+
+    // Start the consumers first
+    for (started = 0; started < SEMP_PIPELINE_STAGES; started++)
+    {
+        index = SEMP_PIPELINE_STAGES - 1 - started;
+        if (pthread_create(&pipeline->stages[index].thread, nullptr,
+                           sempPipelineThread, &pipeline->stages[index]))
+        {
+            sempPrintln(pipeline->printError, "SEMP: Failed to start the pipeline thread");
+            break;
+        }
+    }
+
+    // Stage N feeds queue N, end the input of the stages already running
+    index = SEMP_PIPELINE_STAGES - 1 - started;
+    if ((started < SEMP_PIPELINE_STAGES) && (index < (SEMP_PIPELINE_STAGES - 1)))
+        sempPipelineFinish(&pipeline->queues[index]);
+
+    for (index = 0; index < started; index++)
+        pthread_join(pipeline->stages[SEMP_PIPELINE_STAGES - 1 - index].thread, nullptr);
+    return (started == SEMP_PIPELINE_STAGES);
+}
+
+// Read the statistics of the last run
+void sempPipelineGetStats(SEMP_PIPELINE *pipeline, SEMP_PIPELINE_STATS *stats)
+{
+    if (pipeline && stats)
+        *stats = pipeline->stats;
+}
+
+// Free the pipeline
+void sempPipelineStop(SEMP_PIPELINE **pipeline)
+{
+    uint16_t index;
+
+    if (pipeline && *pipeline)
+    {
+        if ((*pipeline)->parse)
+            sempStopParser(&(*pipeline)->parse);
+        for (index = 0; index < (*pipeline)->blockCount; index++)
+            if ((*pipeline)->blocks[index].data)
+                semp_util_free((*pipeline)->blocks[index].data);
+        semp_util_aligned_free(*pipeline);
+        *pipeline = nullptr;
+    }
+}
@@ -0,0 +1,138 @@
+/**
+ * @file Message_Pipeline.h
+ * @brief 单数据流多核流水线解析 - 头文件
+ * @details 高速数据流 (数百MB/s的记录接收机) 的解析分为四级, 每级一个线程:
+ *          1. 分帧: 延迟校验模式, 只按长度字段分帧, 帧描述符引用输入块
+ *          2. 校验: 成批计算CRC (sempFrameValidateBatch), 丢弃坏帧
+ *          3. 解码: 调用应用的解码回调
+ *          4. 输出: 调用应用的输出回调, 释放输入块
+ *          各级之间以无锁单生产者单消费者队列成批传递帧描述符, 每级按顺序
+ *          处理, 因此输出顺序与数据流中的顺序相同. 输入块带引用计数,
+ *          完整位于输入块内的二进制帧不复制, 文本语句和跨块的帧复制到该块
+ *          的附加区. 各级线程可绑定到指定的CPU核.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_PIPELINE_H
+#define MESSAGE_PIPELINE_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_PIPELINE_STAGES        4       // Framing, validation, decode and sink
+#define SEMP_PIPELINE_BATCH         32      // Frames published to the next stage at once
+#define SEMP_PIPELINE_MINIMUM_QUEUE 64      // Minimum frames per queue
+#define SEMP_PIPELINE_MINIMUM_BLOCKS 2      // Minimum input blocks
+
+// Stage numbers for sempPipelineSetAffinity
+#define SEMP_PIPELINE_STAGE_FRAMING 0
+#define SEMP_PIPELINE_STAGE_VALIDATE 1
+#define SEMP_PIPELINE_STAGE_DECODE  2
+#define SEMP_PIPELINE_STAGE_SINK    3
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_PIPELINE SEMP_PIPELINE;
+typedef struct _SEMP_PIPELINE_BLOCK SEMP_PIPELINE_BLOCK;
+
+// Frame descriptor passed between the stages
+typedef struct _SEMP_PIPELINE_FRAME
+{
+    SEMP_FRAME frame;               // Frame bytes in the input block
+    uint64_t sequence;              // Frame number in stream order
+    SEMP_EPOCH epoch;               // Time tag captured by the parser
+    uint64_t userData;              // Set by the decode routine for the sink
+    SEMP_PIPELINE_BLOCK *block;     // Input block holding the frame bytes
+} SEMP_PIPELINE_FRAME;
+
+// Read up to length bytes from the input, return 0 at the end of the input
+typedef size_t (*SEMP_PIPELINE_READ)(void *context, uint8_t *buffer, size_t length);
+
+// Decode the frame, runs in the decode stage thread
+typedef void (*SEMP_PIPELINE_DECODE)(void *context, SEMP_PIPELINE_FRAME *frame);
+
+// Output the frame, runs in the sink stage thread.  The frame bytes are
+// valid during the call only.
+typedef void (*SEMP_PIPELINE_OUTPUT)(void *context, const SEMP_PIPELINE_FRAME *frame);
+
+// Pipeline statistics
+typedef struct _SEMP_PIPELINE_STATS
+{
+    uint64_t bytes;             // Input bytes read
+    uint64_t frames;            // Frames passed to the sink
+    uint64_t badFrames;         // Frames dropped by the validation stage
+    uint64_t copiedFrames;      // Frames copied to the block spill area
+    uint64_t droppedFrames;     // Frames not fitting in the spill area
+} SEMP_PIPELINE_STATS;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 分配流水线
+ * @param parsersTable 解析器表
+ * @param parsersCount 解析器数量
+ * @param parserNamesTable 解析器名称表
+ * @param bufferLength 解析器缓冲区长度, 最大帧长度
+ * @param blockBytes 每个输入块的大小, 每次读取的最大字节数
+ * @param blockCount 输入块数量, 决定在途数据量
+ * @param queueFrames 各级之间队列的深度 (帧数), 向上取为2的幂
+ * @param decode 解码回调, 可为nullptr
+ * @param output 输出回调, 可为nullptr
+ * @param context 回调的上下文
+ * @param printError 错误输出回调
+ * @return 流水线指针, 失败返回nullptr
+ */
+SEMP_PIPELINE * sempPipelineBegin(const SEMP_PARSE_ROUTINE *parsersTable,
+                                  uint8_t parsersCount,
+                                  const char * const *parserNamesTable,
+                                  uint16_t bufferLength,
+                                  uint32_t blockBytes,
+                                  uint16_t blockCount,
+                                  uint32_t queueFrames,
+                                  SEMP_PIPELINE_DECODE decode,
+                                  SEMP_PIPELINE_OUTPUT output,
+                                  void *context,
+                                  SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 设置一级流水线线程运行的CPU核
+ * @details 在sempPipelineRun之前调用, 不支持的平台上忽略
+ * @param pipeline 流水线
+ * @param stage SEMP_PIPELINE_STAGE_FRAMING 至 SEMP_PIPELINE_STAGE_SINK
+ * @param cpu CPU编号, -1表示不绑定
+ * @return 成功返回true
+ */
+bool sempPipelineSetAffinity(SEMP_PIPELINE *pipeline, uint8_t stage, int cpu);
+
+/**
+ * @brief 启动各级线程解析输入, 直到输入结束且所有帧输出完毕
+ * @param pipeline 流水线
+ * @param read 读取回调
+ * @param readContext 读取回调的上下文 (例如 FILE *)
+ * @return 所有线程正常启动和结束返回true
+ */
+bool sempPipelineRun(SEMP_PIPELINE *pipeline, SEMP_PIPELINE_READ read, void *readContext);
+
+// Read the statistics of the last run
+void sempPipelineGetStats(SEMP_PIPELINE *pipeline, SEMP_PIPELINE_STATS *stats);
+
+// Free the pipeline and set the pointer to nullptr
+void sempPipelineStop(SEMP_PIPELINE **pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_PIPELINE_H
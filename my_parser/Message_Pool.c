@@ -0,0 +1,267 @@
+/**
+ * @file Message_Pool.c
+ * @brief 按需借用缓冲区的多数据流解析 - 功能实现
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_Pool.h"
+#include "Message_Snapshot.h"
+
+#define SEMP_POOL_COMPUTE_CRC       0x01
+#define SEMP_POOL_VALIDATE_FRAME    0x02
+
+// The compact state is what each idle stream costs
+_Static_assert(sizeof(SEMP_COMPACT_STATE) <= 64, "SEMP_COMPACT_STATE exceeds 64 bytes");
+
+//----------------------------------------
+// 内部类型
+//----------------------------------------
+
+// Slab header, the buffers of one size class follow it
+typedef struct _SEMP_POOL_SLAB
+{
+    struct _SEMP_POOL_SLAB *next;   // Next slab of the pool
+} SEMP_POOL_SLAB;
+
+struct _SEMP_BUFFER_POOL
+{
+    SEMP_PARSE_STATE *parse;                    // Worker parser
+    SEMP_POOL_SLAB *slabs;                      // All slabs, freed by sempPoolStop
+    uint8_t *freeBuffers[SEMP_POOL_CLASSES];    // Free buffers of each class
+    uint32_t lentBuffers[SEMP_POOL_CLASSES];    // Buffers held by streams
+    uint32_t slabCount;                         // Number of slabs
+    uint32_t reservedBytes;                     // Bytes allocated for the slabs
+};
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+static uint32_t sempPoolClassBytes(uint8_t sizeClass)
+{
+    return (uint32_t)SEMP_POOL_SMALLEST_BUFFER << sizeClass;
+}
+
+// Allocate a slab of buffers for the class and put them on the free list
+static bool sempPoolAddSlab(SEMP_BUFFER_POOL *pool, uint8_t sizeClass)
+{
+    uint32_t bufferBytes = sempPoolClassBytes(sizeClass);
+    uint32_t bufferCount;
+    uint32_t headerBytes;
+    SEMP_POOL_SLAB *slab;
+    uint8_t *buffer;
+
+    bufferCount = SEMP_POOL_SLAB_BYTES / bufferBytes;
+    if (!bufferCount)
+        bufferCount = 1;
+    headerBytes = SEMP_ALIGN(sizeof(SEMP_POOL_SLAB));
+    slab = (SEMP_POOL_SLAB *)semp_util_malloc(headerBytes + (bufferCount * bufferBytes));
+    if (!slab)
+        return false;
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->slabCount++;
+    pool->reservedBytes += headerBytes + (bufferCount * bufferBytes);
+
+    // Link the free buffers through their first bytes
+    buffer = (uint8_t *)slab + headerBytes;
+    while (bufferCount--)
+    {
+        memcpy(buffer, &pool->freeBuffers[sizeClass], sizeof(uint8_t *));
+        pool->freeBuffers[sizeClass] = buffer;
+        buffer += bufferBytes;
+    }
+    return true;
+}
+
+// Lend the stream a buffer holding at least length bytes
+static bool sempPoolAcquire(SEMP_BUFFER_POOL *pool, SEMP_COMPACT_STATE *stream, uint16_t length)
+{
+    uint8_t sizeClass = 0;
+
+    while (sempPoolClassBytes(sizeClass) < length)
+        sizeClass++;
+    if ((!pool->freeBuffers[sizeClass]) && (!sempPoolAddSlab(pool, sizeClass)))
+        return false;
+    stream->buffer = pool->freeBuffers[sizeClass];
+    memcpy(&pool->freeBuffers[sizeClass], stream->buffer, sizeof(uint8_t *));
+    stream->sizeClass = sizeClass;
+    pool->lentBuffers[sizeClass]++;
+    return true;
+}
+
+// Return the stream's buffer to the free list
+static void sempPoolRelease(SEMP_BUFFER_POOL *pool, SEMP_COMPACT_STATE *stream)
+{
+    if (stream->buffer)
+    {
+        memcpy(stream->buffer, &pool->freeBuffers[stream->sizeClass], sizeof(uint8_t *));
+        pool->freeBuffers[stream->sizeClass] = stream->buffer;
+        pool->lentBuffers[stream->sizeClass]--;
+        stream->buffer = nullptr;
+    }
+}
+
+// Load the stream's state into the worker parser
+static void sempPoolLoad(SEMP_BUFFER_POOL *pool, const SEMP_COMPACT_STATE *stream)
+{
+    const SEMP_PROTOCOL_STATES *protocol;
+    SEMP_PARSE_STATE *parse = pool->parse;
+
+    protocol = sempGetProtocolStates(stream->stateId >> 8);
+    if (!protocol)
+    {
+        // Searching for a preamble
+        parse->state = sempFirstByte;
+        parse->computeCrc = nullptr;
+        parse->validateFrame = nullptr;
+        parse->streamOffset = 0;
+        parse->msg_length = 0;
+        return;
+    }
+
+    parse->state = protocol->states[stream->stateId & 0xff];
+    parse->computeCrc = (stream->flags & SEMP_POOL_COMPUTE_CRC) ? protocol->computeCrc : nullptr;
+    parse->validateFrame = (stream->flags & SEMP_POOL_VALIDATE_FRAME) ? protocol->validateFrame : nullptr;
+    parse->crc = stream->crc;
+    parse->streamOffset = stream->streamOffset;
+    parse->epoch = stream->epoch;
+    parse->parser_type = stream->parser_type;
+    parse->verdict = stream->verdict;
+    parse->msg_length = stream->msg_length;
+    memcpy(parse->scratchPad, &stream->scratchPad, sizeof(SEMP_SCRATCH_PAD));
+    memcpy(parse->buffer, stream->buffer, stream->msg_length);
+}
+
+// Save the worker parser's state, the buffer is only kept for a partial frame
+static void sempPoolSave(SEMP_BUFFER_POOL *pool, SEMP_COMPACT_STATE *stream)
+{
+    const SEMP_PROTOCOL_STATES *protocol;
+    SEMP_PARSE_STATE *parse = pool->parse;
+    uint16_t stateId;
+
+    stateId = sempGetStateId(parse);
+    protocol = sempGetProtocolStates(stateId >> 8);
+    if (protocol && ((stateId & 0xff) >= protocol->stateCount))
+        protocol = nullptr;
+
+    // Keep the partial frame in a buffer of the matching size class
+    if (protocol && stream->buffer
+        && (sempPoolClassBytes(stream->sizeClass) < parse->msg_length))
+        sempPoolRelease(pool, stream);
+    if (protocol && (!stream->buffer) && (!sempPoolAcquire(pool, stream, parse->msg_length)))
+    {
+        sempPrintf(parse->printError, "SEMP %s: Pool out of memory, %d byte frame dropped",
+                   parse->config->parserName, parse->msg_length);
+        protocol = nullptr;
+    }
+
+    // The stream is idle, return the buffer
+    if (!protocol)
+    {
+        sempPoolEndStream(pool, stream);
+        return;
+    }
+
+    stream->crc = parse->crc;
+    stream->streamOffset = parse->streamOffset;
+    stream->epoch = parse->epoch;
+    stream->stateId = stateId;
+    stream->msg_length = parse->msg_length;
+    stream->parser_type = parse->parser_type;
+    stream->verdict = parse->verdict;
+    stream->flags = 0;
+    if (parse->computeCrc)
+        stream->flags |= SEMP_POOL_COMPUTE_CRC;
+    if (parse->validateFrame)
+        stream->flags |= SEMP_POOL_VALIDATE_FRAME;
+    memcpy(&stream->scratchPad, parse->scratchPad, sizeof(SEMP_SCRATCH_PAD));
+    memcpy(stream->buffer, parse->buffer, parse->msg_length);
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// 分配缓冲池
+SEMP_BUFFER_POOL * sempPoolBegin(SEMP_PARSE_STATE *parse)
+{
+    SEMP_BUFFER_POOL *pool;
+
+    if (!parse)
+        return nullptr;
+    pool = (SEMP_BUFFER_POOL *)semp_util_malloc(sizeof(SEMP_BUFFER_POOL));
+    if (!pool)
+    {
+        sempPrintf(parse->printError, "SEMP %s: Failed to allocate the buffer pool",
+                   parse->config->parserName);
+        return nullptr;
+    }
+    memset(pool, 0, sizeof(SEMP_BUFFER_POOL));
+    pool->parse = parse;
+    return pool;
+}
+
+// 解析一个数据流收到的数据
+void sempPoolParse(SEMP_BUFFER_POOL *pool,
+                   SEMP_COMPACT_STATE *stream,
+                   const uint8_t *data,
+                   size_t length,
+                   void *userContext)
+{
+    SEMP_PARSE_STATE *parse;
+
+    if ((!pool) || (!stream) || (!data))
+        return;
+    parse = pool->parse;
+    sempPoolLoad(pool, stream);
+    parse->userContext = userContext;
+    sempParseBuffer(parse, data, length);
+    sempPoolSave(pool, stream);
+}
+
+// 丢弃部分帧并归还缓冲区
+void sempPoolEndStream(SEMP_BUFFER_POOL *pool, SEMP_COMPACT_STATE *stream)
+{
+    if (pool && stream)
+    {
+        sempPoolRelease(pool, stream);
+        memset(stream, 0, sizeof(SEMP_COMPACT_STATE));
+    }
+}
+
+// 读取缓冲池统计
+void sempPoolGetStats(SEMP_BUFFER_POOL *pool, SEMP_POOL_STATS *stats)
+{
+    uint8_t sizeClass;
+
+    if ((!pool) || (!stats))
+        return;
+    memset(stats, 0, sizeof(SEMP_POOL_STATS));
+    for (sizeClass = 0; sizeClass < SEMP_POOL_CLASSES; sizeClass++)
+    {
+        stats->lentBuffers += pool->lentBuffers[sizeClass];
+        stats->lentBytes += pool->lentBuffers[sizeClass] * sempPoolClassBytes(sizeClass);
+    }
+    stats->slabs = pool->slabCount;
+    stats->reservedBytes = pool->reservedBytes;
+}
+
+// 释放缓冲池
+void sempPoolStop(SEMP_BUFFER_POOL **pool)
+{
+    SEMP_POOL_SLAB *slab;
+
+    if (pool && *pool)
+    {
+        while ((*pool)->slabs)
+        {
+            slab = (*pool)->slabs;
+            (*pool)->slabs = slab->next;
+            semp_util_free(slab);
+        }
+        semp_util_free(*pool);
+        *pool = nullptr;
+    }
+}
@@ -0,0 +1,110 @@
+/**
+ * @file Message_Pool.h
+ * @brief 按需借用缓冲区的多数据流解析 - 头文件
+ * @details 大量空闲数据流共用一个工作解析器. 每个数据流只保存不超过64字节的
+ *          紧凑状态, 帧缓冲区从共享的分级slab中借用: 帧跨越两次输入调用时
+ *          借出, 帧结束或重新同步后归还. 常驻内存随在途帧数量增长, 与数据流
+ *          数量无关. 一个缓冲池只能由一个线程使用.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_POOL_H
+#define MESSAGE_POOL_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_POOL_SMALLEST_BUFFER   64              // Size of the smallest class
+#define SEMP_POOL_CLASSES           11              // 64 bytes to 64 KiB
+#define SEMP_POOL_SLAB_BYTES        (16 * 1024)     // Allocation size of a slab
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_BUFFER_POOL SEMP_BUFFER_POOL;
+
+// Parser state of an idle or partially received stream, zero when idle
+typedef struct _SEMP_COMPACT_STATE
+{
+    uint8_t *buffer;            // Borrowed frame buffer, nullptr while idle
+    uint32_t crc;               // CRC of the partial frame
+    uint32_t streamOffset;      // Bytes passed to the chunkCallback
+    SEMP_EPOCH epoch;           // Time tag captured so far
+    uint16_t stateId;           // SEMP_STATE_ID of the parser state
+    uint16_t msg_length;        // Bytes of the partial frame
+    uint8_t parser_type;        // Index into the parsers table
+    uint8_t verdict;            // SEMP_FRAME_VERDICT
+    uint8_t flags;              // computeCrc and validateFrame set
+    uint8_t sizeClass;          // Size class of the borrowed buffer
+    SEMP_SCRATCH_PAD scratchPad; // Protocol specific values
+} SEMP_COMPACT_STATE;
+
+// Buffer pool statistics
+typedef struct _SEMP_POOL_STATS
+{
+    uint32_t lentBuffers;       // Buffers held by streams
+    uint32_t lentBytes;         // Bytes of the buffers held by streams
+    uint32_t slabs;             // Number of slabs allocated
+    uint32_t reservedBytes;     // Bytes allocated for the slabs
+} SEMP_POOL_STATS;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 分配缓冲池
+ * @param parse 工作解析器 (sempBeginParser), 其缓冲区需容纳最大的帧,
+ *              由所有数据流共用, 缓冲池不负责释放
+ * @return 缓冲池指针, 失败返回nullptr
+ */
+SEMP_BUFFER_POOL * sempPoolBegin(SEMP_PARSE_STATE *parse);
+
+/**
+ * @brief 解析一个数据流收到的数据
+ * @details 载入数据流的紧凑状态, 逐字节解析后保存. 帧通过工作解析器的
+ *          eomCallback交付, 回调中parse->userContext为本次调用的userContext.
+ * @param pool 缓冲池
+ * @param stream 数据流状态, 初始化为全零
+ * @param data 数据
+ * @param length 数据长度
+ * @param userContext 本数据流的应用上下文
+ */
+void sempPoolParse(SEMP_BUFFER_POOL *pool,
+                   SEMP_COMPACT_STATE *stream,
+                   const uint8_t *data,
+                   size_t length,
+                   void *userContext);
+
+/**
+ * @brief 丢弃数据流的部分帧并归还缓冲区, 数据流关闭时调用
+ * @param pool 缓冲池
+ * @param stream 数据流状态, 返回时为空闲状态
+ */
+void sempPoolEndStream(SEMP_BUFFER_POOL *pool, SEMP_COMPACT_STATE *stream);
+
+/**
+ * @brief 读取缓冲池统计
+ * @param pool 缓冲池
+ * @param stats 输出统计
+ */
+void sempPoolGetStats(SEMP_BUFFER_POOL *pool, SEMP_POOL_STATS *stats);
+
+// Free the slabs and the pool, set the pointer to nullptr.  Buffers held
+// by streams are freed too, call sempPoolEndStream for the streams first.
+void sempPoolStop(SEMP_BUFFER_POOL **pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_POOL_H
@@ -0,0 +1,435 @@
+/**
+ * @file Message_Relay.c
+ * @brief RTCM差分数据零拷贝转发 - 功能实现
+ * @details 解析器逐字节处理接收缓冲区, 帧结束时帧字节一定是数据流中最后的
+ *          msg_length个字节, 因此完整位于本次接收缓冲区内的帧直接以指针引用.
+ *          跨越两次接收缓冲区的帧(每次调用最多一帧)从解析器缓冲区复制一次.
+ *          流订阅者未能立即写出的数据转入有界缓存, 超出时丢帧而不阻塞转发.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#define _GNU_SOURCE     // sendmmsg
+#include "Message_Relay.h"
+#include "Parse_RTCM.h"
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define SEMP_RELAY_BITS(count)      (((count) + 7) / 8)
+
+//----------------------------------------
+// 内部类型
+//----------------------------------------
+
+typedef struct _SEMP_RELAY_SUBSCRIBER
+{
+    int fd;                     // Output file descriptor
+    uint8_t mode;               // SEMP_RELAY_STREAM or SEMP_RELAY_DATAGRAM
+    bool active;                // Subscriber slot in use
+    bool allStations;           // Accept every reference station
+    bool allMessages;           // Accept every message number
+    uint8_t stations[SEMP_RELAY_BITS(SEMP_RELAY_STATION_IDS)];     // Station bitset
+    uint8_t messages[SEMP_RELAY_BITS(SEMP_RELAY_MESSAGE_NUMBERS)]; // Message bitset
+    uint16_t count;             // Frames in the batch
+    struct iovec iov[SEMP_RELAY_MAX_BATCH]; // Frame references
+    uint8_t *backlog;           // Unsent stream bytes
+    uint32_t backlogHead;       // Offset of the first unsent byte
+    uint32_t backlogLength;     // Number of unsent bytes
+    SEMP_RELAY_STATS stats;
+} SEMP_RELAY_SUBSCRIBER;
+
+struct _SEMP_RELAY
+{
+    SEMP_PARSE_STATE *parse;        // RTCM parser
+    const uint8_t *data;            // Receive buffer being processed
+    size_t position;                // Offset of the byte being parsed
+    uint8_t carry[SEMP_RTCM_MAX_FRAME_BYTES]; // Frame split across receive buffers
+    uint16_t maxSubscribers;
+    uint16_t batchFrames;
+    uint32_t backlogBytes;
+    uint32_t forwarded;             // Deliveries during this input call
+    SEMP_PRINTF_CALLBACK printError;
+    SEMP_RELAY_SUBSCRIBER *subscribers;
+};
+
+static const SEMP_PARSE_ROUTINE sempRelayParsers[] = {sempRtcmPreamble};
+static const char * const sempRelayParserNames[] = {"RTCM"};
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+// Messages carrying the reference station ID (DF003) after the message
+// number: observations, station description, system parameters, text,
+// network auxiliary and FKP, MSM and GLONASS biases.  Ephemerides, SSR,
+// proprietary and other messages hold other fields there.
+static bool sempRelayHasStation(uint16_t message)
+{
+    return ((message >= 1001) && (message <= 1013))
+           || (message == 1029)
+           || ((message >= 1032) && (message <= 1035))
+           || ((message >= 1071) && (message <= 1137)
+               && ((message % 10) >= 1) && ((message % 10) <= 7))
+           || (message == 1230);
+}
+
+// Append bytes to the stream backlog, returns false when there is no room
+static bool sempRelayBacklog(SEMP_RELAY *relay,
+                             SEMP_RELAY_SUBSCRIBER *subscriber,
+                             const uint8_t *data,
+                             size_t length)
+{
+    if ((subscriber->backlogLength + length) > relay->backlogBytes)
+        return false;
+
+    // Move the unsent bytes to the front of the backlog
+    if ((subscriber->backlogHead + subscriber->backlogLength + length) > relay->backlogBytes)
+    {
+        memmove(subscriber->backlog,
+                &subscriber->backlog[subscriber->backlogHead],
+                subscriber->backlogLength);
+        subscriber->backlogHead = 0;
+    }
+    memcpy(&subscriber->backlog[subscriber->backlogHead + subscriber->backlogLength],
+           data, length);
+    subscriber->backlogLength += length;
+    return true;
+}
+
+// Handle a write error, returns the number of bytes written
+static size_t sempRelayWritten(SEMP_RELAY *relay,
+                               SEMP_RELAY_SUBSCRIBER *subscriber,
+                               ssize_t bytes)
+{
+    if (bytes >= 0)
+    {
+        subscriber->stats.bytes += bytes;
+        return bytes;
+    }
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+    {
+        sempPrintf(relay->printError, "SEMP: Relay subscriber fd %d write failed, errno %d",
+                   subscriber->fd, errno);
+        subscriber->active = false;
+    }
+    return 0;
+}
+
+// Write the stream batch, unsent bytes move to the backlog
+static void sempRelayFlushStream(SEMP_RELAY *relay, SEMP_RELAY_SUBSCRIBER *subscriber)
+{
+    size_t written;
+    uint16_t index;
+
+    // Send the older bytes first
+    if (subscriber->backlogLength)
+    {
+        written = sempRelayWritten(relay, subscriber,
+                                   write(subscriber->fd,
+                                         &subscriber->backlog[subscriber->backlogHead],
+                                         subscriber->backlogLength));
+        subscriber->backlogHead += written;
+        subscriber->backlogLength -= written;
+        if (!subscriber->backlogLength)
+            subscriber->backlogHead = 0;
+    }
+
+    // Write the batch straight from the receive buffers
+    written = 0;
+    if ((!subscriber->backlogLength) && subscriber->active)
+        written = sempRelayWritten(relay, subscriber,
+                                   writev(subscriber->fd, subscriber->iov, subscriber->count));
+
+    // Keep what did not fit in the socket
+    for (index = 0; index < subscriber->count; index++)
+    {
+        if (written >= subscriber->iov[index].iov_len)
+        {
+            written -= subscriber->iov[index].iov_len;
+            continue;
+        }
+        if (subscriber->active
+            && sempRelayBacklog(relay, subscriber,
+                                (uint8_t *)subscriber->iov[index].iov_base + written,
+                                subscriber->iov[index].iov_len - written))
+            written = 0;
+        else
+        {
+            subscriber->stats.frames--;
+            subscriber->stats.dropped++;
+            written = 0;
+        }
+    }
+}
+
+// Send the datagram batch, one frame per datagram
+static void sempRelayFlushDatagram(SEMP_RELAY *relay, SEMP_RELAY_SUBSCRIBER *subscriber)
+{
+    uint16_t index;
+    int sent;
+
+#ifdef __linux__
+    struct mmsghdr messages[SEMP_RELAY_MAX_BATCH];
+
+    memset(messages, 0, subscriber->count * sizeof(messages[0]));
+    for (index = 0; index < subscriber->count; index++)
+    {
+        messages[index].msg_hdr.msg_iov = &subscriber->iov[index];
+        messages[index].msg_hdr.msg_iovlen = 1;
+    }
+    sent = sendmmsg(subscriber->fd, messages, subscriber->count, MSG_DONTWAIT);
+    if (sent < 0)
+    {
+        sempRelayWritten(relay, subscriber, sent);
+        sent = 0;
+    }
+    for (index = 0; index < sent; index++)
+        subscriber->stats.bytes += messages[index].msg_len;
+#else
+    for (sent = 0; sent < subscriber->count; sent++)
+        if (!sempRelayWritten(relay, subscriber,
+                              send(subscriber->fd, subscriber->iov[sent].iov_base,
+                                   subscriber->iov[sent].iov_len, MSG_DONTWAIT)))
+            break;
+#endif  // __linux__
+
+    // Datagrams that were not sent are lost
+    subscriber->stats.frames -= subscriber->count - sent;
+    subscriber->stats.dropped += subscriber->count - sent;
+}
+
+// Send the subscriber's batch
+static void sempRelayFlush(SEMP_RELAY *relay, SEMP_RELAY_SUBSCRIBER *subscriber)
+{
+    if (subscriber->count || subscriber->backlogLength)
+    {
+        if (subscriber->mode == SEMP_RELAY_DATAGRAM)
+            sempRelayFlushDatagram(relay, subscriber);
+        else
+            sempRelayFlushStream(relay, subscriber);
+    }
+    subscriber->count = 0;
+}
+
+// Add the validated frame to the batch of each interested subscriber
+static void sempRelayEomCallback(SEMP_PARSE_STATE *parse, uint16_t type)
+{
+    SEMP_RELAY *relay = (SEMP_RELAY *)parse->userContext;
+    SEMP_SCRATCH_PAD *scratchPad = (SEMP_SCRATCH_PAD *)parse->scratchPad;
+    SEMP_RELAY_SUBSCRIBER *subscriber;
+    const uint8_t *frame;
+    uint16_t message;
+    uint16_t station;
+    bool hasStation;
+    uint16_t index;
+
+    // The CRC is checked once here with the span routine
+    if (!sempValidateFrame(parse))
+        return;
+
+    // The frame is the last msg_length bytes of the stream
+    if (relay->position + 1 >= parse->msg_length)
+        frame = &relay->data[relay->position + 1 - parse->msg_length];
+    else
+    {
+        memcpy(relay->carry, parse->buffer, parse->msg_length);
+        frame = relay->carry;
+    }
+
+    // Filter on the header fields only
+    message = scratchPad->rtcm.message;
+    hasStation = sempRelayHasStation(message);
+    station = sempRtcmGetBits(frame, 24 + 12, 12);
+    for (index = 0; index < relay->maxSubscribers; index++)
+    {
+        subscriber = &relay->subscribers[index];
+        if ((!subscriber->active)
+            || ((!subscriber->allMessages)
+                && (!(subscriber->messages[message >> 3] & (1 << (message & 7)))))
+            || (hasStation && (!subscriber->allStations)
+                && (!(subscriber->stations[station >> 3] & (1 << (station & 7))))))
+            continue;
+
+        subscriber->iov[subscriber->count].iov_base = (void *)frame;
+        subscriber->iov[subscriber->count].iov_len = parse->msg_length;
+        subscriber->stats.frames++;
+        relay->forwarded++;
+        if (++subscriber->count >= relay->batchFrames)
+            sempRelayFlush(relay, subscriber);
+    }
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Allocate the relay
+SEMP_RELAY * sempRelayBegin(uint16_t maxSubscribers,
+                            uint16_t batchFrames,
+                            uint32_t backlogBytes,
+                            SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_RELAY *relay;
+    size_t bytes;
+    uint16_t index;
+
+    if (!maxSubscribers)
+    {
+        sempPrintln(printError, "SEMP: Relay needs at least one subscriber");
+        return nullptr;
+    }
+    if ((!batchFrames) || (batchFrames > SEMP_RELAY_MAX_BATCH))
+        batchFrames = SEMP_RELAY_MAX_BATCH;
+    if (backlogBytes < SEMP_RTCM_MAX_FRAME_BYTES)
+        backlogBytes = SEMP_RTCM_MAX_FRAME_BYTES;
+
+    // Allocate the relay, the subscribers and their backlogs together
+    bytes = SEMP_ALIGN(sizeof(SEMP_RELAY))
+          + (maxSubscribers * (SEMP_ALIGN(sizeof(SEMP_RELAY_SUBSCRIBER))
+                               + SEMP_ALIGN(backlogBytes)));
+    relay = (SEMP_RELAY *)semp_util_malloc(bytes);
+    if (!relay)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the relay");
+        return nullptr;
+    }
+    memset(relay, 0, sizeof(*relay));
+    relay->subscribers = (SEMP_RELAY_SUBSCRIBER *)((uint8_t *)relay
+                                                   + SEMP_ALIGN(sizeof(SEMP_RELAY)));
+    for (index = 0; index < maxSubscribers; index++)
+    {
+        memset(&relay->subscribers[index], 0, sizeof(SEMP_RELAY_SUBSCRIBER));
+        relay->subscribers[index].backlog = (uint8_t *)&relay->subscribers[maxSubscribers]
+                                          + (index * SEMP_ALIGN(backlogBytes));
+    }
+    relay->maxSubscribers = maxSubscribers;
+    relay->batchFrames = batchFrames;
+    relay->backlogBytes = backlogBytes;
+    relay->printError = printError;
+
+    // Frame by length, validate once with the span routine
+    relay->parse = sempBeginParser("Relay", sempRelayParsers, 1,
+                                   sempRelayParserNames, 1, 0,
+                                   SEMP_RTCM_MAX_FRAME_BYTES, sempRelayEomCallback,
+                                   printError, nullptr, nullptr);
+    if (!relay->parse)
+    {
+        semp_util_free(relay);
+        return nullptr;
+    }
+    relay->parse->userContext = relay;
+    sempEnableLazyValidation(relay->parse, true);
+    return relay;
+}
+
+// Add a subscriber
+int sempRelayAddSubscriber(SEMP_RELAY *relay, int fd, uint8_t mode)
+{
+    SEMP_RELAY_SUBSCRIBER *subscriber;
+    uint8_t *backlog;
+    int index;
+
+    if ((!relay) || (fd < 0) || (mode > SEMP_RELAY_DATAGRAM))
+        return -1;
+    for (index = 0; index < relay->maxSubscribers; index++)
+    {
+        subscriber = &relay->subscribers[index];
+        if (!subscriber->active)
+        {
+            backlog = subscriber->backlog;
+            memset(subscriber, 0, sizeof(*subscriber));
+            subscriber->backlog = backlog;
+            subscriber->fd = fd;
+            subscriber->mode = mode;
+            subscriber->allStations = true;
+            subscriber->allMessages = true;
+            subscriber->active = true;
+            return index;
+        }
+    }
+    sempPrintf(relay->printError, "SEMP: Relay supports at most %d subscribers",
+               relay->maxSubscribers);
+    return -1;
+}
+
+// Set the subscriber filter
+bool sempRelaySetFilter(SEMP_RELAY *relay,
+                        int subscriber,
+                        const uint16_t *stations,
+                        uint16_t stationCount,
+                        const uint16_t *messages,
+                        uint16_t messageCount)
+{
+    SEMP_RELAY_SUBSCRIBER *entry;
+    uint16_t index;
+
+    if ((!relay) || (subscriber < 0) || (subscriber >= relay->maxSubscribers)
+        || (stationCount && (!stations)) || (messageCount && (!messages)))
+        return false;
+    entry = &relay->subscribers[subscriber];
+
+    // Build the bitsets used for the O(1) lookups
+    memset(entry->stations, 0, sizeof(entry->stations));
+    for (index = 0; index < stationCount; index++)
+        if (stations[index] < SEMP_RELAY_STATION_IDS)
+            entry->stations[stations[index] >> 3] |= 1 << (stations[index] & 7);
+    entry->allStations = (stationCount == 0);
+
+    memset(entry->messages, 0, sizeof(entry->messages));
+    for (index = 0; index < messageCount; index++)
+        if (messages[index] < SEMP_RELAY_MESSAGE_NUMBERS)
+            entry->messages[messages[index] >> 3] |= 1 << (messages[index] & 7);
+    entry->allMessages = (messageCount == 0);
+    return true;
+}
+
+// Remove the subscriber
+void sempRelayRemoveSubscriber(SEMP_RELAY *relay, int subscriber)
+{
+    if (relay && (subscriber >= 0) && (subscriber < relay->maxSubscribers))
+        relay->subscribers[subscriber].active = false;
+}
+
+// Parse the receive buffer and forward the frames
+uint32_t sempRelayInput(SEMP_RELAY *relay, const uint8_t *data, size_t length)
+{
+    uint16_t index;
+
+    if ((!relay) || (!data))
+        return 0;
+
+    relay->forwarded = 0;
+    relay->data = data;
+    for (relay->position = 0; relay->position < length; relay->position++)
+        sempParseNextByte(relay->parse, data[relay->position]);
+
+    // The receive buffer is reused after return, send everything now
+    for (index = 0; index < relay->maxSubscribers; index++)
+        if (relay->subscribers[index].active)
+            sempRelayFlush(relay, &relay->subscribers[index]);
+    relay->data = nullptr;
+    return relay->forwarded;
+}
+
+// Read the subscriber statistics
+void sempRelayGetStats(SEMP_RELAY *relay, int subscriber, SEMP_RELAY_STATS *stats)
+{
+    if (relay && stats && (subscriber >= 0) && (subscriber < relay->maxSubscribers))
+    {
+        *stats = relay->subscribers[subscriber].stats;
+        stats->backlogBytes = relay->subscribers[subscriber].backlogLength;
+    }
+}
+
+// Free the relay
+void sempRelayStop(SEMP_RELAY **relay)
+{
+    if (relay && *relay)
+    {
+        sempStopParser(&(*relay)->parse);
+        semp_util_free(*relay);
+        *relay = nullptr;
+    }
+}
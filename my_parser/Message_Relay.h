@@ -0,0 +1,115 @@
+/**
+ * @file Message_Relay.h
+ * @brief RTCM差分数据零拷贝转发 - 头文件
+ * @details 基准站数据流经RTCM解析器分帧和校验后, 帧以引用的形式加入各订阅者的
+ *          输出批次, 按基准站ID和消息号过滤(只读取帧头, 不解码负载),
+ *          再以writev(流)或sendmmsg(数据报)直接从接收缓冲区批量发送.
+ *          帧字节从不重新组装.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_RELAY_H
+#define MESSAGE_RELAY_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_RELAY_MAX_BATCH        64      // Frames per subscriber batch
+#define SEMP_RELAY_STATION_IDS      4096    // 12-bit reference station ID
+#define SEMP_RELAY_MESSAGE_NUMBERS  4096    // 12-bit message number
+
+// Subscriber output modes
+#define SEMP_RELAY_STREAM           0       // writev, TCP sockets, pipes, files
+#define SEMP_RELAY_DATAGRAM         1       // sendmmsg, one frame per datagram
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_RELAY SEMP_RELAY;
+
+// Per subscriber statistics
+typedef struct _SEMP_RELAY_STATS
+{
+    uint32_t frames;        // Frames sent or queued in the backlog
+    uint64_t bytes;         // Bytes sent
+    uint32_t dropped;       // Frames dropped, slow subscriber or datagram loss
+    uint32_t backlogBytes;  // Bytes waiting for the next flush
+} SEMP_RELAY_STATS;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 分配转发器
+ * @param maxSubscribers 最大订阅者数量
+ * @param batchFrames 每个订阅者每批最多帧数, 最大SEMP_RELAY_MAX_BATCH
+ * @param backlogBytes 流订阅者未发送完数据的缓存大小
+ * @param printError 错误输出回调
+ * @return 转发器指针, 失败返回nullptr
+ */
+SEMP_RELAY * sempRelayBegin(uint16_t maxSubscribers,
+                            uint16_t batchFrames,
+                            uint32_t backlogBytes,
+                            SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 添加订阅者, 默认接收所有基准站的所有消息
+ * @param relay 转发器
+ * @param fd 输出文件描述符, 应为非阻塞
+ * @param mode SEMP_RELAY_STREAM 或 SEMP_RELAY_DATAGRAM (数据报需已connect)
+ * @return 订阅者编号, 失败返回-1
+ */
+int sempRelayAddSubscriber(SEMP_RELAY *relay, int fd, uint8_t mode);
+
+/**
+ * @brief 设置订阅者的过滤条件
+ * @param relay 转发器
+ * @param subscriber 订阅者编号
+ * @param stations 接受的基准站ID列表, stationCount为0时接受全部.
+ *                 不含基准站ID的消息 (星历、SSR、厂商自定义等) 不受此条件限制
+ * @param stationCount 基准站ID数量
+ * @param messages 接受的消息号列表, messageCount为0时接受全部
+ * @param messageCount 消息号数量
+ * @return 成功返回true
+ */
+bool sempRelaySetFilter(SEMP_RELAY *relay,
+                        int subscriber,
+                        const uint16_t *stations,
+                        uint16_t stationCount,
+                        const uint16_t *messages,
+                        uint16_t messageCount);
+
+// Remove the subscriber, the file descriptor is not closed
+void sempRelayRemoveSubscriber(SEMP_RELAY *relay, int subscriber);
+
+/**
+ * @brief 处理接收缓冲区中的数据并转发
+ * @details 返回前所有批次均已发送或转入缓存, 调用者随后可复用接收缓冲区
+ * @param relay 转发器
+ * @param data 接收缓冲区
+ * @param length 数据长度
+ * @return 本次转发的帧数 (按订阅者计)
+ */
+uint32_t sempRelayInput(SEMP_RELAY *relay, const uint8_t *data, size_t length);
+
+// Read the subscriber statistics
+void sempRelayGetStats(SEMP_RELAY *relay, int subscriber, SEMP_RELAY_STATS *stats);
+
+// Free the relay and set the pointer to nullptr, file descriptors are not closed
+void sempRelayStop(SEMP_RELAY **relay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_RELAY_H
@@ -0,0 +1,275 @@
+/**
+ * @file Message_Reorder.c
+ * @brief 并行解码的单数据流重排序缓冲区 - 功能实现
+ * @details 槽位状态为 (序号 << 2) | 状态, 解码线程以CAS从旧序号认领槽位,
+ *          写入数据后标记完成; 输出线程以CAS从旧序号标记超时. 两者对同一
+ *          序号只有一个成功, 迟到的解码线程不会再写槽位. 输出由持有
+ *          draining标志的线程完成, 释放标志后重新检查队首, 避免就绪帧无人输出.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_Reorder.h"
+#include <stdatomic.h>
+
+//----------------------------------------
+// 内部常量与类型
+//----------------------------------------
+
+// Slot states, the low two bits of the slot state
+#define SEMP_REORDER_EMPTY      0   // Not used since allocation
+#define SEMP_REORDER_CLAIMED    1   // Worker writing the item
+#define SEMP_REORDER_COMPLETE   2   // Item ready for output
+#define SEMP_REORDER_TIMED_OUT  3   // Skipped at the head of the line
+
+#define SEMP_REORDER_TAG(sequence, state)   (((sequence) << 2) | (state))
+#define SEMP_REORDER_SEQUENCE(tag)          ((tag) >> 2)
+#define SEMP_REORDER_STATE(tag)             ((tag) & 3)
+
+#define SEMP_REORDER_NO_TIME    UINT64_MAX  // Head wait not started
+
+typedef struct _SEMP_REORDER_SLOT
+{
+    atomic_uint_fast64_t state;     // SEMP_REORDER_TAG of the last sequence
+    void *item;
+} SEMP_REORDER_SLOT;
+
+struct _SEMP_REORDER
+{
+    _Alignas(SEMP_CACHE_LINE_BYTES) atomic_uint_fast64_t head;  // Next sequence to output
+    atomic_flag draining;           // Set while a thread outputs frames
+    uint64_t headSince;             // Poll time when the head wait started
+    _Alignas(SEMP_CACHE_LINE_BYTES) atomic_uint_fast64_t next;  // Next sequence to reserve
+    _Alignas(SEMP_CACHE_LINE_BYTES) uint64_t mask;              // Number of slots - 1
+    uint32_t timeoutMilliseconds;
+    SEMP_REORDER_OUTPUT output;
+    void *context;
+    SEMP_REORDER_SLOT *slots;
+
+    // Statistics, off the read only line
+    _Alignas(SEMP_CACHE_LINE_BYTES) atomic_uint_fast64_t released;
+    atomic_uint_fast64_t dropped;
+    atomic_uint_fast64_t timedOut;
+    atomic_uint_fast64_t lateFrames;
+    atomic_uint_fast64_t fullWindows;
+};
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+// Output the frames at the head, the caller holds the draining flag
+static void sempReorderRelease(SEMP_REORDER *reorder, bool poll, uint64_t milliseconds)
+{
+    SEMP_REORDER_SLOT *slot;
+    uint_fast64_t state;
+    uint64_t reserved;
+    uint64_t head;
+
+    head = atomic_load_explicit(&reorder->head, memory_order_relaxed);
+    reserved = atomic_load_explicit(&reorder->next, memory_order_acquire);
+    while (head < reserved)
+    {
+        slot = &reorder->slots[head & reorder->mask];
+        state = atomic_load(&slot->state);
+        if (state == SEMP_REORDER_TAG(head, SEMP_REORDER_COMPLETE))
+        {
+            if (slot->item)
+            {
+                reorder->output(reorder->context, head, slot->item);
+                atomic_fetch_add_explicit(&reorder->released, 1, memory_order_relaxed);
+            }
+            else
+                atomic_fetch_add_explicit(&reorder->dropped, 1, memory_order_relaxed);
+        }
+        else if (poll && reorder->timeoutMilliseconds
+                 && ((SEMP_REORDER_SEQUENCE(state) < head)
+                     || (SEMP_REORDER_STATE(state) == SEMP_REORDER_EMPTY)))
+        {
+            // Nothing submitted for the head yet, start or check the wait
+            if (reorder->headSince == SEMP_REORDER_NO_TIME)
+            {
+                reorder->headSince = milliseconds;
+                break;
+            }
+            if ((milliseconds - reorder->headSince) < reorder->timeoutMilliseconds)
+                break;
+            if (!atomic_compare_exchange_strong(&slot->state, &state,
+                                                SEMP_REORDER_TAG(head, SEMP_REORDER_TIMED_OUT)))
+                continue;
+            atomic_fetch_add_explicit(&reorder->timedOut, 1, memory_order_relaxed);
+        }
+        else
+            break;
+
+        // The slot is free for sequence head + window once head moves
+        head++;
+        atomic_store_explicit(&reorder->head, head, memory_order_release);
+        reorder->headSince = SEMP_REORDER_NO_TIME;
+    }
+}
+
+// Determine if the head frame is ready for output
+static bool sempReorderHeadReady(SEMP_REORDER *reorder)
+{
+    uint64_t head;
+
+    head = atomic_load(&reorder->head);
+    if (head >= atomic_load(&reorder->next))
+        return false;
+    return (atomic_load(&reorder->slots[head & reorder->mask].state)
+            == SEMP_REORDER_TAG(head, SEMP_REORDER_COMPLETE));
+}
+
+// Output the ready frames unless another thread is already doing it
+static void sempReorderDrain(SEMP_REORDER *reorder, bool poll, uint64_t milliseconds)
+{
+    do
+    {
+        if (atomic_flag_test_and_set(&reorder->draining))
+            return;
+        sempReorderRelease(reorder, poll, milliseconds);
+        atomic_flag_clear(&reorder->draining);
+
+        // A frame completed while the flag was set is output here
+    } while (sempReorderHeadReady(reorder));
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Allocate the reorder buffer
+SEMP_REORDER * sempReorderBegin(uint32_t windowFrames,
+                                uint32_t timeoutMilliseconds,
+                                SEMP_REORDER_OUTPUT output,
+                                void *context,
+                                SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_REORDER *reorder;
+    uint64_t slots;
+    uint64_t index;
+
+    if (!output)
+    {
+        sempPrintln(printError, "SEMP: Please specify the reorder output routine");
+        return nullptr;
+    }
+    if (windowFrames < SEMP_REORDER_MINIMUM_WINDOW)
+        windowFrames = SEMP_REORDER_MINIMUM_WINDOW;
+    for (slots = 1; slots < windowFrames; slots <<= 1)
+        ;
+
+    // Cache line aligned for the _Alignas members
+    reorder = (SEMP_REORDER *)semp_util_aligned_malloc(sizeof(SEMP_REORDER));
+    if (!reorder)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the reorder structure");
+        return nullptr;
+    }
+    reorder->slots = (SEMP_REORDER_SLOT *)semp_util_malloc(slots * sizeof(SEMP_REORDER_SLOT));
+    if (!reorder->slots)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the reorder window");
+        semp_util_aligned_free(reorder);
+        return nullptr;
+    }
+
+    // Initialize the structure
+    atomic_init(&reorder->head, 0);
+    atomic_flag_clear(&reorder->draining);
+    reorder->headSince = SEMP_REORDER_NO_TIME;
+    atomic_init(&reorder->next, 0);
+    reorder->mask = slots - 1;
+    reorder->timeoutMilliseconds = timeoutMilliseconds;
+    reorder->output = output;
+    reorder->context = context;
+    atomic_init(&reorder->released, 0);
+    atomic_init(&reorder->dropped, 0);
+    atomic_init(&reorder->timedOut, 0);
+    atomic_init(&reorder->lateFrames, 0);
+    atomic_init(&reorder->fullWindows, 0);
+    for (index = 0; index < slots; index++)
+    {
+        atomic_init(&reorder->slots[index].state, SEMP_REORDER_TAG(0, SEMP_REORDER_EMPTY));
+        reorder->slots[index].item = nullptr;
+    }
+    return reorder;
+}
+
+// Reserve the sequence number of the next frame
+bool sempReorderReserve(SEMP_REORDER *reorder, uint64_t *sequence)
+{
+    uint64_t next;
+
+    if ((!reorder) || (!sequence))
+        return false;
+    next = atomic_load_explicit(&reorder->next, memory_order_relaxed);
+    if ((next - atomic_load_explicit(&reorder->head, memory_order_acquire)) > reorder->mask)
+    {
+        atomic_fetch_add_explicit(&reorder->fullWindows, 1, memory_order_relaxed);
+        return false;
+    }
+    *sequence = next;
+    atomic_store_explicit(&reorder->next, next + 1, memory_order_release);
+    return true;
+}
+
+// Submit a decoded frame
+bool sempReorderComplete(SEMP_REORDER *reorder, uint64_t sequence, void *item)
+{
+    SEMP_REORDER_SLOT *slot;
+    uint_fast64_t state;
+
+    if ((!reorder) || (sequence >= atomic_load_explicit(&reorder->next, memory_order_acquire)))
+        return false;
+
+    // Claim the slot from an older sequence, fails once the frame timed out
+    slot = &reorder->slots[sequence & reorder->mask];
+    state = atomic_load(&slot->state);
+    do
+    {
+        if ((SEMP_REORDER_SEQUENCE(state) >= sequence)
+            && (SEMP_REORDER_STATE(state) != SEMP_REORDER_EMPTY))
+        {
+            atomic_fetch_add_explicit(&reorder->lateFrames, 1, memory_order_relaxed);
+            return false;
+        }
+    } while (!atomic_compare_exchange_weak(&slot->state, &state,
+                                           SEMP_REORDER_TAG(sequence, SEMP_REORDER_CLAIMED)));
+    slot->item = item;
+    atomic_store(&slot->state, SEMP_REORDER_TAG(sequence, SEMP_REORDER_COMPLETE));
+
+    sempReorderDrain(reorder, false, 0);
+    return true;
+}
+
+// Output the ready frames and skip a head frame waiting too long
+void sempReorderPoll(SEMP_REORDER *reorder, uint64_t milliseconds)
+{
+    if (reorder)
+        sempReorderDrain(reorder, true, milliseconds);
+}
+
+// Read the statistics
+void sempReorderGetStats(SEMP_REORDER *reorder, SEMP_REORDER_STATS *stats)
+{
+    if ((!reorder) || (!stats))
+        return;
+    stats->released = atomic_load_explicit(&reorder->released, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&reorder->dropped, memory_order_relaxed);
+    stats->timedOut = atomic_load_explicit(&reorder->timedOut, memory_order_relaxed);
+    stats->lateFrames = atomic_load_explicit(&reorder->lateFrames, memory_order_relaxed);
+    stats->fullWindows = atomic_load_explicit(&reorder->fullWindows, memory_order_relaxed);
+}
+
+// Free the reorder buffer
+void sempReorderStop(SEMP_REORDER **reorder)
+{
+    if (reorder && *reorder)
+    {
+        semp_util_free((*reorder)->slots);
+        semp_util_aligned_free(*reorder);
+        *reorder = nullptr;
+    }
+}
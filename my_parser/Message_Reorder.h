@@ -0,0 +1,109 @@
+/**
+ * @file Message_Reorder.h
+ * @brief 并行解码的单数据流重排序缓冲区 - 头文件
+ * @details 校验后的帧分给多个线程并行解码 (MSM, RAWX等) 时, 下游仍需按
+ *          数据流中的顺序收到各帧. 分帧线程在eomCallback中为每帧预留递增的
+ *          序号, 解码线程以任意顺序提交完成的帧, 重排序缓冲区按序号顺序
+ *          输出. 每个数据流一个缓冲区:
+ *          - 无锁: 各槽位的状态带序号标记, 以CAS认领, 输出由恰好一个线程完成
+ *          - 有界: 预留的序号最多领先已输出序号一个窗口, 窗口满时预留失败
+ *          - 队首超时: 队首帧等待超过设定时间后跳过, 迟到的帧提交失败
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_REORDER_H
+#define MESSAGE_REORDER_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_REORDER_MINIMUM_WINDOW 16      // Minimum frames in flight
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_REORDER SEMP_REORDER;
+
+// Output a frame in stream order.  The calls never overlap, they are made
+// by the thread completing or polling when the frame reaches the head.
+typedef void (*SEMP_REORDER_OUTPUT)(void *context, uint64_t sequence, void *item);
+
+// Reorder buffer statistics
+typedef struct _SEMP_REORDER_STATS
+{
+    uint64_t released;          // Frames passed to the output routine
+    uint64_t dropped;           // Frames completed without an item
+    uint64_t timedOut;          // Frames skipped at the head of the line
+    uint64_t lateFrames;        // Frames completed after being skipped
+    uint64_t fullWindows;       // Reservations refused, window full
+} SEMP_REORDER_STATS;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 分配重排序缓冲区
+ * @param windowFrames 最多在途的帧数, 向上取为2的幂
+ * @param timeoutMilliseconds 队首帧的最长等待时间, 0表示一直等待
+ * @param output 输出回调
+ * @param context 输出回调的上下文
+ * @param printError 错误输出回调
+ * @return 重排序缓冲区指针, 失败返回nullptr
+ */
+SEMP_REORDER * sempReorderBegin(uint32_t windowFrames,
+                                uint32_t timeoutMilliseconds,
+                                SEMP_REORDER_OUTPUT output,
+                                void *context,
+                                SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 为下一帧预留序号
+ * @details 只能由分帧线程调用 (通常在eomCallback中). 窗口满时返回false,
+ *          调用者可调用sempReorderPoll推进超时后重试, 或丢弃该帧.
+ * @param reorder 重排序缓冲区
+ * @param sequence 输出序号
+ * @return 成功返回true
+ */
+bool sempReorderReserve(SEMP_REORDER *reorder, uint64_t *sequence);
+
+/**
+ * @brief 提交解码完成的帧
+ * @details 可从多个线程同时调用, 每个序号提交一次. 若该帧已到达队首,
+ *          本线程输出所有就绪的帧. 帧超时跳过后其窗口位置可被后续帧复用,
+ *          迟到的解码线程不应再访问按序号索引存放的帧数据.
+ * @param reorder 重排序缓冲区
+ * @param sequence sempReorderReserve预留的序号
+ * @param item 输出给回调的数据, nullptr表示该帧被丢弃 (例如校验失败)
+ * @return 接受返回true, 该帧已超时跳过返回false (item仍属于调用者)
+ */
+bool sempReorderComplete(SEMP_REORDER *reorder, uint64_t sequence, void *item);
+
+/**
+ * @brief 输出就绪的帧并检查队首超时
+ * @details 由消费者线程或分帧线程定期调用, 超时精度为调用间隔
+ * @param reorder 重排序缓冲区
+ * @param milliseconds 当前时间, 毫秒, 单调递增
+ */
+void sempReorderPoll(SEMP_REORDER *reorder, uint64_t milliseconds);
+
+// Read the statistics
+void sempReorderGetStats(SEMP_REORDER *reorder, SEMP_REORDER_STATS *stats);
+
+// Free the reorder buffer and set the pointer to nullptr
+void sempReorderStop(SEMP_REORDER **reorder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_REORDER_H
@@ -0,0 +1,400 @@
+/**
+ * @file Message_Replay.c
+ * @brief 可断点续传的数据文件回放 - 功能实现
+ * @details 检查点文件格式 (多字节字段为小端):
+ *            0  'S' 'R' 'C' 'K'   标识
+ *            4  version, 3字节保留
+ *            8  inputOffset       已处理的输入字节数
+ *           16  outputOffset      输出文件长度
+ *           24  inputSize         输入文件长度, 用于识别输入文件的变化
+ *           32  snapshotLength
+ *           36  解析器快照, CRC-32
+ *          输出文件先落盘, 检查点写入临时文件后再改名, 任何时刻崩溃都留下
+ *          一个完整的检查点.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_Replay.h"
+#include "Message_Snapshot.h"
+#include <signal.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define SEMP_REPLAY_HEADER_BYTES    36
+
+//----------------------------------------
+// 内部类型
+//----------------------------------------
+
+struct _SEMP_REPLAY
+{
+    SEMP_PARSE_STATE *parse;        // Parser fed by the replay
+    FILE *input;                    // Data file
+    FILE *output;                   // Output sink, nullptr if none
+    char *checkpointName;           // Checkpoint file, nullptr if none
+    char *temporaryName;            // Checkpoint file being written
+    uint64_t checkpointBytes;       // Input bytes between checkpoints
+    uint64_t nextCheckpoint;        // Input offset of the next checkpoint
+    uint64_t offset;                // Input bytes processed
+    uint64_t resumeOffset;          // Input offset at sempReplayBegin
+    uint64_t outputOffset;          // Output bytes written
+    uint64_t inputSize;             // Length of the data file
+    volatile sig_atomic_t stopRequested;
+    bool writeFailed;               // Output write error
+    SEMP_PRINTF_CALLBACK printError;
+    uint8_t *checkpoint;            // Checkpoint buffer
+    size_t checkpointLength;        // Size of the checkpoint buffer
+    uint8_t *data;                  // Input read buffer
+};
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+static void sempReplayPut32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+    buffer[2] = (uint8_t)(value >> 16);
+    buffer[3] = (uint8_t)(value >> 24);
+}
+
+static void sempReplayPut64(uint8_t *buffer, uint64_t value)
+{
+    sempReplayPut32(buffer, (uint32_t)value);
+    sempReplayPut32(&buffer[4], (uint32_t)(value >> 32));
+}
+
+static uint32_t sempReplayGet32(const uint8_t *buffer)
+{
+    return buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+static uint64_t sempReplayGet64(const uint8_t *buffer)
+{
+    return sempReplayGet32(buffer) | ((uint64_t)sempReplayGet32(&buffer[4]) << 32);
+}
+
+// CRC-32 of the checkpoint contents
+static uint32_t sempReplayCrc(const uint8_t *buffer, size_t length)
+{
+    uint32_t crc = 0xffffffff;
+
+    while (length)
+    {
+        uint16_t bytes = (length > 0x8000) ? 0x8000 : (uint16_t)length;
+        crc = semp_util_crc32(crc, buffer, bytes);
+        buffer += bytes;
+        length -= bytes;
+    }
+    return ~crc;
+}
+
+// Record the input offset, the parser state and the output position
+static bool sempReplayCheckpoint(SEMP_REPLAY *replay)
+{
+    size_t snapshotLength;
+    size_t length;
+    FILE *file;
+    bool written;
+
+    if (!replay->checkpointName)
+        return true;
+
+    // The output up to the checkpoint must be on the disk first
+    if (replay->output)
+    {
+        if (fflush(replay->output) || fsync(fileno(replay->output)))
+        {
+            sempPrintf(replay->printError, "SEMP: Failed to flush the replay output");
+            return false;
+        }
+    }
+
+    // Build the checkpoint
+    snapshotLength = sempSnapshotSave(replay->parse,
+                                      &replay->checkpoint[SEMP_REPLAY_HEADER_BYTES],
+                                      replay->checkpointLength - SEMP_REPLAY_HEADER_BYTES - 4);
+    if (!snapshotLength)
+        return false;
+    memcpy(replay->checkpoint, "SRCK", 4);
+    sempReplayPut32(&replay->checkpoint[4], SEMP_REPLAY_VERSION);
+    sempReplayPut64(&replay->checkpoint[8], replay->offset);
+    sempReplayPut64(&replay->checkpoint[16], replay->outputOffset);
+    sempReplayPut64(&replay->checkpoint[24], replay->inputSize);
+    sempReplayPut32(&replay->checkpoint[32], (uint32_t)snapshotLength);
+    length = SEMP_REPLAY_HEADER_BYTES + snapshotLength;
+    sempReplayPut32(&replay->checkpoint[length], sempReplayCrc(replay->checkpoint, length));
+    length += 4;
+
+    // Replace the previous checkpoint in a single step
+    file = fopen(replay->temporaryName, "wb");
+    if (!file)
+    {
+        sempPrintf(replay->printError, "SEMP: Failed to create %s", replay->temporaryName);
+        return false;
+    }
+    written = (fwrite(replay->checkpoint, 1, length, file) == length)
+              && (!fflush(file)) && (!fsync(fileno(file)));
+    fclose(file);
+    if ((!written) || rename(replay->temporaryName, replay->checkpointName))
+    {
+        sempPrintf(replay->printError, "SEMP: Failed to write the checkpoint %s",
+                   replay->checkpointName);
+        return false;
+    }
+    return true;
+}
+
+// Resume from the checkpoint file, returns false if the checkpoint is unusable
+static bool sempReplayResume(SEMP_REPLAY *replay, FILE *file, const char *outputName)
+{
+    uint32_t snapshotLength;
+    size_t length;
+
+    // Verify the checkpoint
+    length = fread(replay->checkpoint, 1, replay->checkpointLength, file);
+    snapshotLength = (length >= SEMP_REPLAY_HEADER_BYTES)
+                   ? sempReplayGet32(&replay->checkpoint[32]) : 0;
+    if ((length < (SEMP_REPLAY_HEADER_BYTES + 4))
+        || memcmp(replay->checkpoint, "SRCK", 4)
+        || (sempReplayGet32(&replay->checkpoint[4]) != SEMP_REPLAY_VERSION)
+        || (length != (SEMP_REPLAY_HEADER_BYTES + snapshotLength + 4))
+        || (sempReplayGet32(&replay->checkpoint[length - 4])
+            != sempReplayCrc(replay->checkpoint, length - 4)))
+    {
+        sempPrintf(replay->printError, "SEMP: Checkpoint %s is damaged", replay->checkpointName);
+        return false;
+    }
+    replay->offset = sempReplayGet64(&replay->checkpoint[8]);
+    replay->outputOffset = sempReplayGet64(&replay->checkpoint[16]);
+    if ((sempReplayGet64(&replay->checkpoint[24]) != replay->inputSize)
+        || (replay->offset > replay->inputSize))
+    {
+        sempPrintf(replay->printError, "SEMP: Checkpoint %s belongs to a different input file",
+                   replay->checkpointName);
+        return false;
+    }
+
+    // Restore the parser and position the files
+    if (!sempSnapshotRestore(replay->parse,
+                             &replay->checkpoint[SEMP_REPLAY_HEADER_BYTES],
+                             snapshotLength))
+        return false;
+    if (fseeko(replay->input, (off_t)replay->offset, SEEK_SET))
+    {
+        sempPrintf(replay->printError, "SEMP: Failed to seek the input file");
+        return false;
+    }
+    if (outputName)
+    {
+        // Drop the output written after the checkpoint
+        replay->output = fopen(outputName, "r+b");
+        if ((!replay->output)
+            || ftruncate(fileno(replay->output), (off_t)replay->outputOffset)
+            || fseeko(replay->output, (off_t)replay->outputOffset, SEEK_SET))
+        {
+            sempPrintf(replay->printError, "SEMP: Failed to position the output file %s at %llu",
+                       outputName, (unsigned long long)replay->outputOffset);
+            return false;
+        }
+    }
+    replay->resumeOffset = replay->offset;
+    return true;
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// 打开回放
+SEMP_REPLAY * sempReplayBegin(SEMP_PARSE_STATE *parse,
+                              const char *inputName,
+                              const char *outputName,
+                              const char *checkpointName,
+                              uint32_t checkpointMegabytes,
+                              SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_REPLAY *replay;
+    size_t checkpointLength;
+    size_t nameLength;
+    FILE *file;
+    bool resumed;
+
+    if ((!parse) || (!inputName))
+    {
+        sempPrintln(printError, "SEMP: Replay needs a parser and an input file");
+        return nullptr;
+    }
+    if (checkpointName && (!checkpointMegabytes))
+        checkpointMegabytes = 1;
+
+    // Allocate the replay, names, checkpoint and read buffers together
+    nameLength = checkpointName ? strlen(checkpointName) + 1 : 0;
+    checkpointLength = SEMP_REPLAY_HEADER_BYTES + SEMP_SNAPSHOT_HEADER_BYTES
+                     + sizeof(SEMP_SCRATCH_PAD) + parse->buffer_length
+                     + SEMP_SNAPSHOT_CRC_BYTES + 4;
+    replay = (SEMP_REPLAY *)semp_util_malloc(SEMP_ALIGN(sizeof(SEMP_REPLAY))
+                                             + SEMP_REPLAY_READ_BYTES + checkpointLength
+                                             + (2 * nameLength) + 4);
+    if (!replay)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the replay");
+        return nullptr;
+    }
+    memset(replay, 0, sizeof(*replay));
+    replay->data = (uint8_t *)replay + SEMP_ALIGN(sizeof(SEMP_REPLAY));
+    replay->checkpoint = replay->data + SEMP_REPLAY_READ_BYTES;
+    replay->checkpointLength = checkpointLength;
+    if (checkpointName)
+    {
+        replay->checkpointName = (char *)replay->checkpoint + checkpointLength;
+        replay->temporaryName = replay->checkpointName + nameLength;
+        strcpy(replay->checkpointName, checkpointName);
+        strcpy(replay->temporaryName, checkpointName);
+        strcat(replay->temporaryName, ".tmp");
+    }
+    replay->parse = parse;
+    replay->printError = printError;
+    replay->checkpointBytes = (uint64_t)checkpointMegabytes * 1024 * 1024;
+
+    do
+    {
+        // Open the input file and get its length
+        replay->input = fopen(inputName, "rb");
+        if ((!replay->input) || fseeko(replay->input, 0, SEEK_END))
+        {
+            sempPrintf(printError, "SEMP: Failed to open the input file %s", inputName);
+            break;
+        }
+        replay->inputSize = (uint64_t)ftello(replay->input);
+        rewind(replay->input);
+
+        // Resume from the last checkpoint
+        file = checkpointName ? fopen(checkpointName, "rb") : nullptr;
+        if (file)
+        {
+            resumed = sempReplayResume(replay, file, outputName);
+            fclose(file);
+            if (!resumed)
+                break;
+        }
+        else if (outputName)
+        {
+            replay->output = fopen(outputName, "wb");
+            if (!replay->output)
+            {
+                sempPrintf(printError, "SEMP: Failed to create the output file %s", outputName);
+                break;
+            }
+        }
+
+        // Next checkpoint on an interval boundary
+        if (replay->checkpointBytes)
+            replay->nextCheckpoint = ((replay->offset / replay->checkpointBytes) + 1)
+                                   * replay->checkpointBytes;
+        return replay;
+    } while (0);
+
+    sempReplayStop(&replay);
+    return nullptr;
+}
+
+// 写输出文件
+bool sempReplayWrite(SEMP_REPLAY *replay, const void *data, size_t length)
+{
+    if ((!replay) || (!replay->output))
+        return false;
+    if (fwrite(data, 1, length, replay->output) != length)
+    {
+        replay->writeFailed = true;
+        return false;
+    }
+    replay->outputOffset += length;
+    return true;
+}
+
+// 回放
+bool sempReplayRun(SEMP_REPLAY *replay)
+{
+    size_t bytes;
+    size_t length;
+
+    if (!replay)
+        return false;
+    while (!replay->stopRequested)
+    {
+        // Stop reading at the checkpoint boundary
+        length = SEMP_REPLAY_READ_BYTES;
+        if (replay->checkpointName && ((replay->nextCheckpoint - replay->offset) < length))
+            length = (size_t)(replay->nextCheckpoint - replay->offset);
+        bytes = fread(replay->data, 1, length, replay->input);
+        sempParseBuffer(replay->parse, replay->data, bytes);
+        replay->offset += bytes;
+        if (replay->writeFailed)
+        {
+            sempPrintf(replay->printError, "SEMP: Failed to write the replay output");
+            return false;
+        }
+
+        // End of the input file
+        if (bytes < length)
+        {
+            if (ferror(replay->input))
+            {
+                sempPrintf(replay->printError, "SEMP: Failed to read the input file");
+                return false;
+            }
+            if (replay->output && fflush(replay->output))
+                return false;
+            if (replay->checkpointName)
+                remove(replay->checkpointName);
+            return true;
+        }
+
+        if (replay->checkpointName && (replay->offset == replay->nextCheckpoint))
+        {
+            if (!sempReplayCheckpoint(replay))
+                return false;
+            replay->nextCheckpoint += replay->checkpointBytes;
+        }
+    }
+
+    // Preempted, save the position for the restart
+    sempReplayCheckpoint(replay);
+    return false;
+}
+
+// 请求停止回放
+void sempReplayRequestStop(SEMP_REPLAY *replay)
+{
+    if (replay)
+        replay->stopRequested = 1;
+}
+
+// 获取输入偏移
+uint64_t sempReplayGetOffset(SEMP_REPLAY *replay)
+{
+    return replay ? replay->offset : 0;
+}
+
+// 获取恢复的输入偏移
+uint64_t sempReplayGetResumeOffset(SEMP_REPLAY *replay)
+{
+    return replay ? replay->resumeOffset : 0;
+}
+
+// 释放回放对象
+void sempReplayStop(SEMP_REPLAY **replay)
+{
+    if (replay && *replay)
+    {
+        if ((*replay)->input)
+            fclose((*replay)->input);
+        if ((*replay)->output)
+            fclose((*replay)->output);
+        semp_util_free(*replay);
+        *replay = nullptr;
+    }
+}
@@ -0,0 +1,102 @@
+/**
+ * @file Message_Replay.h
+ * @brief 可断点续传的数据文件回放 - 头文件
+ * @details 按字节回放数据文件, 每处理N MB输入记录一个检查点: 输入文件偏移、
+ *          解析器快照和输出文件位置. 任务崩溃或被抢占后重新启动时, 从最后
+ *          一个检查点继续, 输出文件截断到检查点位置, 最终输出与一次完成的
+ *          回放完全相同. 输出文件只能通过sempReplayWrite写入.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_REPLAY_H
+#define MESSAGE_REPLAY_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_REPLAY_VERSION         1
+#define SEMP_REPLAY_READ_BYTES      (64 * 1024)     // Input read size
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_REPLAY SEMP_REPLAY;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 打开回放, 存在有效检查点时从检查点恢复
+ * @param parse 解析器, 恢复时载入检查点中的解析器快照
+ * @param inputName 输入数据文件
+ * @param outputName 输出文件, 可为nullptr
+ * @param checkpointName 检查点文件, nullptr时不记录检查点
+ * @param checkpointMegabytes 检查点间隔, 输入MB数
+ * @param printError 错误输出
+ * @return 回放对象, 失败时返回nullptr
+ */
+SEMP_REPLAY * sempReplayBegin(SEMP_PARSE_STATE *parse,
+                              const char *inputName,
+                              const char *outputName,
+                              const char *checkpointName,
+                              uint32_t checkpointMegabytes,
+                              SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 写输出文件, 在eomCallback中调用
+ * @param replay 回放对象
+ * @param data 数据
+ * @param length 数据长度
+ * @return 写入成功返回true
+ */
+bool sempReplayWrite(SEMP_REPLAY *replay, const void *data, size_t length);
+
+/**
+ * @brief 回放到文件结束或收到停止请求
+ * @details 文件结束时删除检查点文件; 收到停止请求时先记录检查点再返回.
+ * @param replay 回放对象
+ * @return 回放完成返回true, 停止或出错返回false
+ */
+bool sempReplayRun(SEMP_REPLAY *replay);
+
+/**
+ * @brief 请求停止回放, 可在信号处理函数或其他线程中调用
+ * @param replay 回放对象
+ */
+void sempReplayRequestStop(SEMP_REPLAY *replay);
+
+/**
+ * @brief 获取已处理的输入字节数, 包含检查点之前的部分
+ * @param replay 回放对象
+ * @return 输入文件偏移
+ */
+uint64_t sempReplayGetOffset(SEMP_REPLAY *replay);
+
+/**
+ * @brief 获取回放开始时的输入偏移, 从头开始时为0
+ * @param replay 回放对象
+ * @return 恢复的输入文件偏移
+ */
+uint64_t sempReplayGetResumeOffset(SEMP_REPLAY *replay);
+
+/**
+ * @brief 关闭文件并释放回放对象
+ * @param replay 回放对象指针的地址, 释放后置为nullptr
+ */
+void sempReplayStop(SEMP_REPLAY **replay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_REPLAY_H
@@ -0,0 +1,530 @@
+/**
+ * @file Message_Router.c
+ * @brief 帧发布/订阅路由 - 功能实现
+ * @details 路由位图: 每个协议一个订阅全部消息号的位图, 其余订阅按消息号
+ *          高字节分页, 只为有订阅的页分配256个位图. 队列为有界MPMC环,
+ *          每个单元带序号 (Vyukov), 空闲缓冲区也以同样的队列管理.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_Router.h"
+#include <sched.h>
+#include <stdatomic.h>
+
+//----------------------------------------
+// 内部常量与类型
+//----------------------------------------
+
+#define SEMP_ROUTER_PAGE_IDS    256     // Message numbers per routing page
+#define SEMP_ROUTER_PAGES       (65536 / SEMP_ROUTER_PAGE_IDS)
+
+// Bounded multiple producer, multiple consumer queue of buffer numbers
+typedef struct _SEMP_ROUTER_CELL
+{
+    atomic_size_t sequence;         // Position the cell is ready for
+    uint32_t value;
+} SEMP_ROUTER_CELL;
+
+typedef struct _SEMP_ROUTER_QUEUE
+{
+    _Alignas(SEMP_CACHE_LINE_BYTES) atomic_size_t enqueuePosition;
+    _Alignas(SEMP_CACHE_LINE_BYTES) atomic_size_t dequeuePosition;
+    _Alignas(SEMP_CACHE_LINE_BYTES) size_t mask;
+    SEMP_ROUTER_CELL *cells;
+} SEMP_ROUTER_QUEUE;
+
+// Reference counted frame buffer, the frame bytes follow the header
+typedef struct _SEMP_ROUTER_BUFFER
+{
+    SEMP_ROUTER_FRAME frame;        // Returned to the subscribers
+    atomic_uint references;         // Subscribers holding the frame
+    uint32_t index;                 // Buffer number
+} SEMP_ROUTER_BUFFER;
+
+typedef struct _SEMP_ROUTER_SUBSCRIBER
+{
+    SEMP_ROUTER_QUEUE queue;
+
+    // Counted by the routing threads, off the read only queue line
+    _Alignas(SEMP_CACHE_LINE_BYTES) atomic_uint_fast64_t frames;
+    atomic_uint_fast64_t dropped;
+} SEMP_ROUTER_SUBSCRIBER;
+
+struct _SEMP_ROUTER
+{
+    uint64_t *allIds;               // Subscribers of every message, per protocol
+    uint64_t **pages;               // Subscribers per message, per protocol and page
+    uint64_t *streamMasks;          // Subscribers per stream
+    uint8_t *buffers;
+    size_t bufferStride;
+    uint32_t bufferCount;
+    uint16_t bufferBytes;
+    uint16_t streamCount;
+    uint8_t protocolCount;
+    int subscriberCount;
+    SEMP_ROUTER_QUEUE freeBuffers;
+    SEMP_ROUTER_SUBSCRIBER *subscribers[SEMP_ROUTER_MAX_SUBSCRIBERS];
+    _Alignas(SEMP_CACHE_LINE_BYTES) atomic_uint_fast64_t frames;
+    atomic_uint_fast64_t unrouted;
+    atomic_uint_fast64_t noBuffer;
+    SEMP_PRINTF_CALLBACK printError;
+};
+
+//----------------------------------------
+// 位运算
+//----------------------------------------
+
+static int sempRouterLowestBit(uint64_t mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(mask);
+#else
+    int bit = 0;
+
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+static unsigned int sempRouterBitCount(uint64_t mask)
+{
+#if defined(__GNUC__)
+    return (unsigned int)__builtin_popcountll(mask);
+#else
+    unsigned int count = 0;
+
+    for (; mask; mask &= mask - 1)
+        count++;
+    return count;
+#endif
+}
+
+//----------------------------------------
+// 队列
+//----------------------------------------
+
+static bool sempRouterQueueBegin(SEMP_ROUTER_QUEUE *queue, uint32_t frames)
+{
+    size_t slots;
+    size_t index;
+
+    for (slots = 1; slots < frames; slots <<= 1)
+        ;
+    queue->cells = (SEMP_ROUTER_CELL *)semp_util_malloc(slots * sizeof(SEMP_ROUTER_CELL));
+    if (!queue->cells)
+        return false;
+    for (index = 0; index < slots; index++)
+        atomic_init(&queue->cells[index].sequence, index);
+    queue->mask = slots - 1;
+    atomic_init(&queue->enqueuePosition, 0);
+    atomic_init(&queue->dequeuePosition, 0);
+    return true;
+}
+
+// Append a value, returns false when the queue is full or a dequeue of the
+// cell has claimed it but not yet returned it
+static bool sempRouterEnqueue(SEMP_ROUTER_QUEUE *queue, uint32_t value)
+{
+    SEMP_ROUTER_CELL *cell;
+    size_t position;
+    intptr_t difference;
+
+    position = atomic_load_explicit(&queue->enqueuePosition, memory_order_relaxed);
+    for (;;)
+    {
+        cell = &queue->cells[position & queue->mask];
+        difference = (intptr_t)atomic_load_explicit(&cell->sequence, memory_order_acquire)
+                   - (intptr_t)position;
+        if (!difference)
+        {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueuePosition, &position,
+                                                      position + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+            return false;
+        else
+            position = atomic_load_explicit(&queue->enqueuePosition, memory_order_relaxed);
+    }
+    cell->value = value;
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+// Remove the oldest value, returns false when the queue is empty
+static bool sempRouterDequeue(SEMP_ROUTER_QUEUE *queue, uint32_t *value)
+{
+    SEMP_ROUTER_CELL *cell;
+    size_t position;
+    intptr_t difference;
+
+    position = atomic_load_explicit(&queue->dequeuePosition, memory_order_relaxed);
+    for (;;)
+    {
+        cell = &queue->cells[position & queue->mask];
+        difference = (intptr_t)atomic_load_explicit(&cell->sequence, memory_order_acquire)
+                   - (intptr_t)(position + 1);
+        if (!difference)
+        {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeuePosition, &position,
+                                                      position + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+            return false;
+        else
+            position = atomic_load_explicit(&queue->dequeuePosition, memory_order_relaxed);
+    }
+    *value = cell->value;
+    atomic_store_explicit(&cell->sequence, position + queue->mask + 1, memory_order_release);
+    return true;
+}
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+static SEMP_ROUTER_BUFFER * sempRouterBuffer(SEMP_ROUTER *router, uint32_t index)
+{
+    return (SEMP_ROUTER_BUFFER *)&router->buffers[index * router->bufferStride];
+}
+
+static bool sempRouterValidSubscriber(SEMP_ROUTER *router, int subscriber)
+{
+    if (router && (subscriber >= 0) && (subscriber < router->subscriberCount))
+        return true;
+    if (router)
+        sempPrintf(router->printError, "SEMP: Invalid router subscriber %d", subscriber);
+    return false;
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Allocate the router
+SEMP_ROUTER * sempRouterBegin(uint8_t protocolCount,
+                              uint16_t streamCount,
+                              uint32_t bufferCount,
+                              uint16_t bufferBytes,
+                              SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_ROUTER_BUFFER *buffer;
+    SEMP_ROUTER *router;
+    uint32_t index;
+
+    if ((!protocolCount) || (!streamCount) || (!bufferCount) || (!bufferBytes))
+    {
+        sempPrintln(printError, "SEMP: Please specify the router protocols, streams and buffers");
+        return nullptr;
+    }
+    // Cache line aligned for the _Alignas members
+    router = (SEMP_ROUTER *)semp_util_aligned_malloc(sizeof(SEMP_ROUTER));
+    if (!router)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the router structure");
+        return nullptr;
+    }
+    memset(router, 0, sizeof(SEMP_ROUTER));
+    router->protocolCount = protocolCount;
+    router->streamCount = streamCount;
+    router->bufferCount = bufferCount;
+    router->bufferBytes = bufferBytes;
+    router->bufferStride = SEMP_ALIGN(sizeof(SEMP_ROUTER_BUFFER)) + SEMP_ALIGN(bufferBytes);
+    router->printError = printError;
+
+    // Allocate the routing tables and the frame buffers
+    router->allIds = (uint64_t *)semp_util_malloc(protocolCount * sizeof(uint64_t));
+    router->pages = (uint64_t **)semp_util_malloc(protocolCount * SEMP_ROUTER_PAGES * sizeof(uint64_t *));
+    router->streamMasks = (uint64_t *)semp_util_malloc(streamCount * sizeof(uint64_t));
+    router->buffers = (uint8_t *)semp_util_malloc(bufferCount * router->bufferStride);
+    if ((!router->allIds) || (!router->pages) || (!router->streamMasks) || (!router->buffers)
+        || (!sempRouterQueueBegin(&router->freeBuffers, bufferCount)))
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the router tables");
+        sempRouterStop(&router);
+        return nullptr;
+    }
+    memset(router->allIds, 0, protocolCount * sizeof(uint64_t));
+    memset(router->pages, 0, protocolCount * SEMP_ROUTER_PAGES * sizeof(uint64_t *));
+    memset(router->streamMasks, 0, streamCount * sizeof(uint64_t));
+    for (index = 0; index < bufferCount; index++)
+    {
+        buffer = sempRouterBuffer(router, index);
+        buffer->index = index;
+        atomic_init(&buffer->references, 0);
+        sempRouterEnqueue(&router->freeBuffers, index);
+    }
+    atomic_init(&router->frames, 0);
+    atomic_init(&router->unrouted, 0);
+    atomic_init(&router->noBuffer, 0);
+    return router;
+}
+
+// Add a subscriber receiving all of the streams
+int sempRouterAddSubscriber(SEMP_ROUTER *router, uint32_t queueFrames)
+{
+    SEMP_ROUTER_SUBSCRIBER *subscriber;
+    uint16_t stream;
+    int index;
+
+    if (!router)
+        return -1;
+    if (router->subscriberCount >= SEMP_ROUTER_MAX_SUBSCRIBERS)
+    {
+        sempPrintf(router->printError, "SEMP: Router supports at most %d subscribers",
+                   SEMP_ROUTER_MAX_SUBSCRIBERS);
+        return -1;
+    }
+    if (queueFrames < SEMP_ROUTER_MINIMUM_QUEUE)
+        queueFrames = SEMP_ROUTER_MINIMUM_QUEUE;
+    subscriber = (SEMP_ROUTER_SUBSCRIBER *)semp_util_aligned_malloc(sizeof(SEMP_ROUTER_SUBSCRIBER));
+    if ((!subscriber) || (!sempRouterQueueBegin(&subscriber->queue, queueFrames)))
+    {
+        sempPrintln(router->printError, "SEMP: Failed to allocate the subscriber queue");
+        if (subscriber)
+            semp_util_aligned_free(subscriber);
+        return -1;
+    }
+    atomic_init(&subscriber->frames, 0);
+    atomic_init(&subscriber->dropped, 0);
+
+    index = router->subscriberCount++;
+    router->subscribers[index] = subscriber;
+    for (stream = 0; stream < router->streamCount; stream++)
+        router->streamMasks[stream] |= 1ull << index;
+    return index;
+}
+
+// Subscribe to a range of message numbers
+bool sempRouterSubscribe(SEMP_ROUTER *router,
+                         int subscriber,
+                         uint8_t protocol,
+                         uint16_t firstId,
+                         uint16_t lastId)
+{
+    uint64_t **page;
+    uint32_t id;
+
+    if (!sempRouterValidSubscriber(router, subscriber))
+        return false;
+    if ((protocol >= router->protocolCount) || (firstId > lastId))
+    {
+        sempPrintf(router->printError, "SEMP: Invalid router subscription, protocol %d, IDs %d - %d",
+                   protocol, firstId, lastId);
+        return false;
+    }
+
+    // Every message of the protocol
+    if ((!firstId) && (lastId == SEMP_ROUTER_ALL_IDS))
+    {
+        router->allIds[protocol] |= 1ull << subscriber;
+        return true;
+    }
+
+    // Expand the range into the pages
+    for (id = firstId; id <= lastId; id++)
+    {
+        page = &router->pages[protocol * SEMP_ROUTER_PAGES + (id / SEMP_ROUTER_PAGE_IDS)];
+        if (!*page)
+        {
+            *page = (uint64_t *)semp_util_malloc(SEMP_ROUTER_PAGE_IDS * sizeof(uint64_t));
+            if (!*page)
+            {
+                sempPrintln(router->printError, "SEMP: Failed to allocate the routing page");
+                return false;
+            }
+            memset(*page, 0, SEMP_ROUTER_PAGE_IDS * sizeof(uint64_t));
+        }
+        (*page)[id % SEMP_ROUTER_PAGE_IDS] |= 1ull << subscriber;
+    }
+    return true;
+}
+
+// Select the streams of a subscriber
+bool sempRouterSelectStreams(SEMP_ROUTER *router,
+                             int subscriber,
+                             const uint16_t *streams,
+                             uint16_t count)
+{
+    uint64_t bit;
+    uint16_t index;
+
+    if (!sempRouterValidSubscriber(router, subscriber))
+        return false;
+    for (index = 0; streams && (index < count); index++)
+    {
+        if (streams[index] >= router->streamCount)
+        {
+            sempPrintf(router->printError, "SEMP: Invalid router stream %d", streams[index]);
+            return false;
+        }
+    }
+
+    bit = 1ull << subscriber;
+    for (index = 0; index < router->streamCount; index++)
+    {
+        if (streams)
+            router->streamMasks[index] &= ~bit;
+        else
+            router->streamMasks[index] |= bit;
+    }
+    for (index = 0; streams && (index < count); index++)
+        router->streamMasks[streams[index]] |= bit;
+    return true;
+}
+
+// Route the frame to the matching subscribers
+int sempRouterPublish(SEMP_ROUTER *router,
+                      uint16_t stream,
+                      const SEMP_FRAME *frame,
+                      uint16_t messageId)
+{
+    SEMP_ROUTER_SUBSCRIBER *subscriber;
+    SEMP_ROUTER_BUFFER *buffer;
+    const uint64_t *page;
+    uint64_t mask;
+    uint32_t index;
+    int delivered = 0;
+
+    if ((!router) || (!frame) || (stream >= router->streamCount)
+        || (frame->type >= router->protocolCount))
+        return 0;
+
+    // Look up the subscribers
+    mask = router->allIds[frame->type];
+    page = router->pages[frame->type * SEMP_ROUTER_PAGES + (messageId / SEMP_ROUTER_PAGE_IDS)];
+    if (page)
+        mask |= page[messageId % SEMP_ROUTER_PAGE_IDS];
+    mask &= router->streamMasks[stream];
+    if (!mask)
+    {
+        atomic_fetch_add_explicit(&router->unrouted, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    // Copy the frame once
+    if ((frame->length > router->bufferBytes)
+        || (!sempRouterDequeue(&router->freeBuffers, &index)))
+    {
+        atomic_fetch_add_explicit(&router->noBuffer, 1, memory_order_relaxed);
+        return 0;
+    }
+    buffer = sempRouterBuffer(router, index);
+    memcpy((uint8_t *)buffer + SEMP_ALIGN(sizeof(SEMP_ROUTER_BUFFER)), frame->buffer, frame->length);
+    buffer->frame.frame = *frame;
+    buffer->frame.frame.buffer = (uint8_t *)buffer + SEMP_ALIGN(sizeof(SEMP_ROUTER_BUFFER));
+    buffer->frame.stream = stream;
+    buffer->frame.messageId = messageId;
+    atomic_store_explicit(&buffer->references, sempRouterBitCount(mask), memory_order_relaxed);
+    atomic_fetch_add_explicit(&router->frames, 1, memory_order_relaxed);
+
+    // Queue a reference for each subscriber
+    for (; mask; mask &= mask - 1)
+    {
+        subscriber = router->subscribers[sempRouterLowestBit(mask)];
+        if (sempRouterEnqueue(&subscriber->queue, index))
+        {
+            atomic_fetch_add_explicit(&subscriber->frames, 1, memory_order_relaxed);
+            delivered++;
+        }
+        else
+        {
+            atomic_fetch_add_explicit(&subscriber->dropped, 1, memory_order_relaxed);
+            sempRouterRelease(router, &buffer->frame);
+        }
+    }
+    return delivered;
+}
+
+// Take the next frame of the subscriber
+const SEMP_ROUTER_FRAME * sempRouterReceive(SEMP_ROUTER *router, int subscriber)
+{
+    uint32_t index;
+
+    if ((!router) || (subscriber < 0) || (subscriber >= router->subscriberCount)
+        || (!sempRouterDequeue(&router->subscribers[subscriber]->queue, &index)))
+        return nullptr;
+    return &sempRouterBuffer(router, index)->frame;
+}
+
+// Return the buffer after the last subscriber is done
+void sempRouterRelease(SEMP_ROUTER *router, const SEMP_ROUTER_FRAME *frame)
+{
+    SEMP_ROUTER_BUFFER *buffer;
+
+    if ((!router) || (!frame))
+        return;
+    buffer = (SEMP_ROUTER_BUFFER *)frame;
+    if (atomic_fetch_sub_explicit(&buffer->references, 1, memory_order_acq_rel) == 1)
+    {
+        // The free queue holds every buffer and is never full, the enqueue
+        // fails only while a dequeue of the same cell is still finishing
+        while (!sempRouterEnqueue(&router->freeBuffers, buffer->index))
+            sched_yield();
+    }
+}
+
+// Read the router statistics
+void sempRouterGetStats(SEMP_ROUTER *router, SEMP_ROUTER_STATS *stats)
+{
+    if ((!router) || (!stats))
+        return;
+    stats->frames = atomic_load_explicit(&router->frames, memory_order_relaxed);
+    stats->unrouted = atomic_load_explicit(&router->unrouted, memory_order_relaxed);
+    stats->noBuffer = atomic_load_explicit(&router->noBuffer, memory_order_relaxed);
+    stats->freeBuffers = (uint32_t)(atomic_load(&router->freeBuffers.enqueuePosition)
+                                    - atomic_load(&router->freeBuffers.dequeuePosition));
+}
+
+// Read the statistics of a subscriber
+void sempRouterGetSubscriberStats(SEMP_ROUTER *router,
+                                  int subscriber,
+                                  SEMP_ROUTER_SUBSCRIBER_STATS *stats)
+{
+    if ((!stats) || (!sempRouterValidSubscriber(router, subscriber)))
+        return;
+    stats->frames = atomic_load_explicit(&router->subscribers[subscriber]->frames,
+                                         memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&router->subscribers[subscriber]->dropped,
+                                          memory_order_relaxed);
+}
+
+// Free the router
+void sempRouterStop(SEMP_ROUTER **router)
+{
+    SEMP_ROUTER *state;
+    int index;
+
+    if ((!router) || (!*router))
+        return;
+    state = *router;
+    for (index = 0; index < state->subscriberCount; index++)
+    {
+        semp_util_free(state->subscribers[index]->queue.cells);
+        semp_util_aligned_free(state->subscribers[index]);
+    }
+    if (state->pages)
+        for (index = 0; index < (state->protocolCount * SEMP_ROUTER_PAGES); index++)
+            if (state->pages[index])
+                semp_util_free(state->pages[index]);
+    if (state->freeBuffers.cells)
+        semp_util_free(state->freeBuffers.cells);
+    if (state->buffers)
+        semp_util_free(state->buffers);
+    if (state->streamMasks)
+        semp_util_free(state->streamMasks);
+    if (state->pages)
+        semp_util_free(state->pages);
+    if (state->allIds)
+        semp_util_free(state->allIds);
+    semp_util_aligned_free(state);
+    *router = nullptr;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file Message_Router.h
+ * @brief 帧发布/订阅路由 - 头文件
+ * @details 替代eomCallback中按协议和消息号分支、为每个消费者复制帧的写法.
+ *          订阅者按 (协议即解析器表索引, 消息号范围, 数据流集合) 订阅,
+ *          路由表预先展开为订阅者位图: 协议和消息号查一次位图, 再与数据流
+ *          位图相与, 查找为O(1). 帧复制一次到带引用计数的缓冲区, 以引用的
+ *          形式加入每个匹配订阅者的有界无锁多生产者多消费者队列, 最后一个
+ *          订阅者释放后缓冲区回到空闲队列.
+ *          - 多个解析线程可同时发布, 每个订阅者可由多个线程同时接收
+ *          - 发布者从不等待: 订阅者队列满时只对该订阅者丢弃并计数
+ *          - 订阅关系须在开始发布前设置
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_ROUTER_H
+#define MESSAGE_ROUTER_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_ROUTER_MAX_SUBSCRIBERS 64      // Bits in the routing masks
+#define SEMP_ROUTER_MINIMUM_QUEUE   64      // Minimum frames per queue
+#define SEMP_ROUTER_ALL_IDS         0xffff  // lastId covering every message number
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_ROUTER SEMP_ROUTER;
+
+// Frame reference received by a subscriber, valid until sempRouterRelease
+typedef struct _SEMP_ROUTER_FRAME
+{
+    SEMP_FRAME frame;           // Frame bytes in the shared buffer, type is the protocol
+    uint16_t stream;            // Stream number set by the publisher
+    uint16_t messageId;         // Message number set by the publisher
+} SEMP_ROUTER_FRAME;
+
+// Router statistics
+typedef struct _SEMP_ROUTER_STATS
+{
+    uint64_t frames;            // Frames routed to at least one subscriber
+    uint64_t unrouted;          // Frames without a subscriber, not copied
+    uint64_t noBuffer;          // Frames dropped, all buffers in use or frame too long
+    uint32_t freeBuffers;       // Buffers not referenced by any subscriber
+} SEMP_ROUTER_STATS;
+
+// Per subscriber statistics
+typedef struct _SEMP_ROUTER_SUBSCRIBER_STATS
+{
+    uint64_t frames;            // Frames queued for the subscriber
+    uint64_t dropped;           // Frames dropped, subscriber queue full
+} SEMP_ROUTER_SUBSCRIBER_STATS;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 分配路由器
+ * @param protocolCount 解析器表中的协议数量
+ * @param streamCount 数据流数量, 数据流编号为 0 至 streamCount - 1
+ * @param bufferCount 帧缓冲区数量, 决定所有订阅者在途帧的总数
+ * @param bufferBytes 每个帧缓冲区的大小, 最大帧长度
+ * @param printError 错误输出回调
+ * @return 路由器指针, 失败返回nullptr
+ */
+SEMP_ROUTER * sempRouterBegin(uint8_t protocolCount,
+                              uint16_t streamCount,
+                              uint32_t bufferCount,
+                              uint16_t bufferBytes,
+                              SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 添加订阅者, 初始接收所有数据流, 不订阅任何消息
+ * @param router 路由器
+ * @param queueFrames 订阅者队列深度 (帧数), 向上取为2的幂
+ * @return 订阅者编号, 失败返回-1
+ */
+int sempRouterAddSubscriber(SEMP_ROUTER *router, uint32_t queueFrames);
+
+/**
+ * @brief 订阅一个协议的消息号范围, 可多次调用
+ * @param router 路由器
+ * @param subscriber 订阅者编号
+ * @param protocol 协议, 解析器表索引
+ * @param firstId 第一个消息号
+ * @param lastId 最后一个消息号, 0 至 SEMP_ROUTER_ALL_IDS 为该协议的全部消息
+ * @return 成功返回true
+ */
+bool sempRouterSubscribe(SEMP_ROUTER *router,
+                         int subscriber,
+                         uint8_t protocol,
+                         uint16_t firstId,
+                         uint16_t lastId);
+
+/**
+ * @brief 设置订阅者接收的数据流集合
+ * @param router 路由器
+ * @param subscriber 订阅者编号
+ * @param streams 数据流编号列表, nullptr表示所有数据流
+ * @param count 列表长度
+ * @return 成功返回true
+ */
+bool sempRouterSelectStreams(SEMP_ROUTER *router,
+                             int subscriber,
+                             const uint16_t *streams,
+                             uint16_t count);
+
+/**
+ * @brief 把帧路由到匹配的订阅者
+ * @details 可由多个解析线程同时调用, 通常在eomCallback中调用. 没有订阅者
+ *          的帧不复制.
+ * @param router 路由器
+ * @param stream 数据流编号
+ * @param frame 帧引用, 由sempGetFrame得到, type为协议
+ * @param messageId 消息编号 (RTCM消息号, UBX Class/ID等)
+ * @return 收到该帧的订阅者数量
+ */
+int sempRouterPublish(SEMP_ROUTER *router,
+                      uint16_t stream,
+                      const SEMP_FRAME *frame,
+                      uint16_t messageId);
+
+/**
+ * @brief 从订阅者队列取出一帧, 不等待
+ * @details 同一订阅者可由多个线程同时调用
+ * @param router 路由器
+ * @param subscriber 订阅者编号
+ * @return 帧引用, 队列为空返回nullptr; 使用完后调用sempRouterRelease
+ */
+const SEMP_ROUTER_FRAME * sempRouterReceive(SEMP_ROUTER *router, int subscriber);
+
+// Drop the subscriber's reference to the frame buffer
+void sempRouterRelease(SEMP_ROUTER *router, const SEMP_ROUTER_FRAME *frame);
+
+// Read the router statistics
+void sempRouterGetStats(SEMP_ROUTER *router, SEMP_ROUTER_STATS *stats);
+
+// Read the statistics of a subscriber
+void sempRouterGetSubscriberStats(SEMP_ROUTER *router,
+                                  int subscriber,
+                                  SEMP_ROUTER_SUBSCRIBER_STATS *stats);
+
+// Free the router and set the pointer to nullptr, the frames must be released
+void sempRouterStop(SEMP_ROUTER **router);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_ROUTER_H
@@ -0,0 +1,388 @@
+/**
+ * @file Message_RtcmEncoder.c
+ * @brief RTCM3 MSM4/MSM7与1005电文编码器 - 功能实现
+ * @details 位写入器在64位寄存器中累积字段, 每满32位整字写出一次, 字段按
+ *          电文顺序只写一遍. CRC-24Q在电文结束后对整帧计算.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_RtcmEncoder.h"
+
+//----------------------------------------
+// 内部类型
+//----------------------------------------
+
+typedef struct _SEMP_RTCM_BIT_WRITER
+{
+    uint8_t *next;          // Next byte to write
+    uint8_t *end;           // End of the message area
+    uint64_t bits;          // Pending bits in the low order positions
+    uint8_t count;          // Number of pending bits, less than 32
+    bool overflow;          // Message does not fit in the buffer
+} SEMP_RTCM_BIT_WRITER;
+
+// Scale factors for the MSM fine values, milliseconds of range
+#define SEMP_RTCM_P2_10     (1.0 / (1 << 10))
+#define SEMP_RTCM_P2_24     (1.0 / (1 << 24))
+#define SEMP_RTCM_P2_29     (1.0 / (1 << 29))
+#define SEMP_RTCM_P2_31     (1.0 / (1u << 31))
+
+//----------------------------------------
+// 位写入器
+//----------------------------------------
+
+// Append a field of 1 - 32 bits, most significant bit first
+static inline void sempRtcmPutBits(SEMP_RTCM_BIT_WRITER *writer, uint64_t value, uint8_t bits)
+{
+    uint32_t word;
+
+    writer->bits = (writer->bits << bits) | (value & ((1ull << bits) - 1));
+    writer->count += bits;
+    if (writer->count < 32)
+        return;
+
+    // Write the oldest 32 bits as one word
+    writer->count -= 32;
+    if ((writer->next + 4) > writer->end)
+    {
+        writer->overflow = true;
+        return;
+    }
+    word = (uint32_t)(writer->bits >> writer->count);
+    writer->next[0] = (uint8_t)(word >> 24);
+    writer->next[1] = (uint8_t)(word >> 16);
+    writer->next[2] = (uint8_t)(word >> 8);
+    writer->next[3] = (uint8_t)word;
+    writer->next += 4;
+}
+
+// Pad the message to a byte boundary and write the pending bytes
+static void sempRtcmFlushBits(SEMP_RTCM_BIT_WRITER *writer)
+{
+    if (writer->count & 7)
+        sempRtcmPutBits(writer, 0, 8 - (writer->count & 7));
+    if ((writer->next + (writer->count >> 3)) > writer->end)
+    {
+        writer->overflow = true;
+        return;
+    }
+    while (writer->count)
+    {
+        writer->count -= 8;
+        *writer->next++ = (uint8_t)(writer->bits >> writer->count);
+    }
+}
+
+// Start a message after the preamble and length bytes
+static void sempRtcmBeginFrame(SEMP_RTCM_BIT_WRITER *writer, uint8_t *buffer, size_t length)
+{
+    if (length > SEMP_RTCM_MAX_FRAME_BYTES)
+        length = SEMP_RTCM_MAX_FRAME_BYTES;
+    writer->next = buffer + 3;
+    writer->end = buffer + ((length > 6) ? (length - 3) : 3);
+    writer->bits = 0;
+    writer->count = 0;
+    writer->overflow = (length <= 6);
+}
+
+// Complete the frame header and append the CRC, returns the frame length
+static uint16_t sempRtcmEndFrame(SEMP_RTCM_BIT_WRITER *writer, uint8_t *buffer)
+{
+    uint16_t messageLength;
+    uint32_t crc;
+
+    sempRtcmFlushBits(writer);
+    if (writer->overflow)
+        return 0;
+
+    // Preamble, 6 reserved bits and the 10-bit message length
+    messageLength = (uint16_t)(writer->next - (buffer + 3));
+    buffer[0] = 0xd3;
+    buffer[1] = (uint8_t)(messageLength >> 8);
+    buffer[2] = (uint8_t)messageLength;
+
+    // CRC-24Q over the header and message
+    crc = sempRtcmCrc24q(buffer, messageLength + 3);
+    writer->next[0] = (uint8_t)(crc >> 16);
+    writer->next[1] = (uint8_t)(crc >> 8);
+    writer->next[2] = (uint8_t)crc;
+    return messageLength + 6;
+}
+
+//----------------------------------------
+// 字段换算
+//----------------------------------------
+
+static inline int64_t sempRtcmRound(double value)
+{
+    return (int64_t)((value < 0) ? (value - 0.5) : (value + 0.5));
+}
+
+// Signed field value, the most negative value marks an invalid or out of range field
+static inline int64_t sempRtcmSigned(double value, double scale, uint8_t bits)
+{
+    int64_t limit = (1ll << (bits - 1)) - 1;
+    int64_t field = sempRtcmRound(value / scale);
+
+    if ((field > limit) || (field < -limit))
+        return -limit - 1;
+    return field;
+}
+
+// Bit index of the highest set bit
+static inline uint8_t sempRtcmLog2(uint32_t value)
+{
+    uint8_t index = 0;
+
+    while (value >>= 1)
+        index++;
+    return index;
+}
+
+// DF402, 4-bit lock time indicator
+static uint8_t sempRtcmLockTime(uint32_t milliseconds)
+{
+    uint8_t indicator;
+
+    if (milliseconds < 32)
+        return 0;
+    indicator = sempRtcmLog2(milliseconds) - 4;
+    return (indicator > 15) ? 15 : indicator;
+}
+
+// DF407, 10-bit extended lock time indicator
+static uint16_t sempRtcmLockTimeExtended(uint32_t milliseconds)
+{
+    uint8_t shift;
+
+    if (milliseconds < 64)
+        return (uint16_t)milliseconds;
+    if (milliseconds >= 67108864)
+        return 704;
+
+    // Resolution halves with each doubling of the lock time
+    shift = sempRtcmLog2(milliseconds) - 5;
+    return (uint16_t)((32 * shift) + (milliseconds >> shift));
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// 编码MSM4/MSM7
+uint16_t sempRtcmEncodeMsm(uint8_t *buffer, size_t length, const SEMP_RTCM_MSM *msm)
+{
+    const SEMP_RTCM_MSM_OBS *cells[SEMP_RTCM_MSM_MAX_CELLS];
+    const SEMP_RTCM_MSM_OBS *first[SEMP_RTCM_MSM_MAX_SATELLITES];
+    uint32_t roughRange[SEMP_RTCM_MSM_MAX_SATELLITES]; // 2^-10 ms units
+    uint8_t satelliteIndex[SEMP_RTCM_MSM_MAX_SATELLITES + 1];
+    uint8_t signalIndex[SEMP_RTCM_MSM_MAX_SIGNALS + 1];
+    const SEMP_RTCM_MSM_OBS *obs;
+    SEMP_RTCM_BIT_WRITER writer;
+    uint64_t satelliteMask = 0;
+    uint64_t cellMask = 0;
+    uint32_t signalMask = 0;
+    uint8_t satellites = 0;
+    uint8_t signals = 0;
+    uint8_t cellCount;
+    uint8_t cell;
+    uint8_t sat;
+    uint16_t index;
+    bool msm7;
+    double range;
+
+    if ((!buffer) || (!msm) || (msm->obsCount && (!msm->obs))
+        || (msm->message < 1071) || (msm->message > 1137))
+        return 0;
+    if ((msm->message % 10) == 7)
+        msm7 = true;
+    else if ((msm->message % 10) == 4)
+        msm7 = false;
+    else
+        return 0;
+
+    // Build the satellite and signal masks, bit 63 is satellite 1
+    for (index = 0; index < msm->obsCount; index++)
+    {
+        obs = &msm->obs[index];
+        if ((obs->satellite < 1) || (obs->satellite > SEMP_RTCM_MSM_MAX_SATELLITES)
+            || (obs->signal < 1) || (obs->signal > SEMP_RTCM_MSM_MAX_SIGNALS))
+            return 0;
+        satelliteMask |= 1ull << (SEMP_RTCM_MSM_MAX_SATELLITES - obs->satellite);
+        signalMask |= 1u << (SEMP_RTCM_MSM_MAX_SIGNALS - obs->signal);
+    }
+
+    // Number the satellites and signals in mask order
+    for (index = 1; index <= SEMP_RTCM_MSM_MAX_SATELLITES; index++)
+        if (satelliteMask & (1ull << (SEMP_RTCM_MSM_MAX_SATELLITES - index)))
+            satelliteIndex[index] = satellites++;
+    for (index = 1; index <= SEMP_RTCM_MSM_MAX_SIGNALS; index++)
+        if (signalMask & (1u << (SEMP_RTCM_MSM_MAX_SIGNALS - index)))
+            signalIndex[index] = signals++;
+    if ((satellites * signals) > SEMP_RTCM_MSM_MAX_CELLS)
+        return 0;
+    cellCount = satellites * signals;
+
+    // Place the observations in their cells
+    memset(cells, 0, cellCount * sizeof(cells[0]));
+    memset(first, 0, satellites * sizeof(first[0]));
+    for (index = 0; index < msm->obsCount; index++)
+    {
+        obs = &msm->obs[index];
+        sat = satelliteIndex[obs->satellite];
+        cell = (sat * signals) + signalIndex[obs->signal];
+        cells[cell] = obs;
+        cellMask |= 1ull << (cellCount - 1 - cell);
+    }
+
+    // The rough range comes from the first signal with a pseudorange
+    for (cell = 0; cell < cellCount; cell++)
+    {
+        sat = cell / signals;
+        if (cells[cell] && (!first[sat]) && (cells[cell]->pseudorange != 0))
+            first[sat] = cells[cell];
+    }
+    for (sat = 0; sat < satellites; sat++)
+    {
+        roughRange[sat] = 0xffffffff;
+        if (first[sat])
+        {
+            range = sempRtcmRound(first[sat]->pseudorange / SEMP_RTCM_RANGE_MS / SEMP_RTCM_P2_10);
+            if ((range > 0) && (range < (255 << 10)))
+                roughRange[sat] = (uint32_t)range;
+        }
+    }
+
+    // Message header
+    sempRtcmBeginFrame(&writer, buffer, length);
+    sempRtcmPutBits(&writer, msm->message, 12);
+    sempRtcmPutBits(&writer, msm->station, 12);
+    sempRtcmPutBits(&writer, msm->epochTime, 30);
+    sempRtcmPutBits(&writer, msm->multipleMessage, 1);
+    sempRtcmPutBits(&writer, msm->iods, 3);
+    sempRtcmPutBits(&writer, 0, 7);
+    sempRtcmPutBits(&writer, msm->clockSteering, 2);
+    sempRtcmPutBits(&writer, msm->externalClock, 2);
+    sempRtcmPutBits(&writer, msm->smoothing, 1);
+    sempRtcmPutBits(&writer, msm->smoothingInterval, 3);
+    sempRtcmPutBits(&writer, satelliteMask >> 32, 32);
+    sempRtcmPutBits(&writer, satelliteMask, 32);
+    sempRtcmPutBits(&writer, signalMask, 32);
+    if (cellCount > 32)
+        sempRtcmPutBits(&writer, cellMask >> 32, cellCount - 32);
+    if (cellCount)
+        sempRtcmPutBits(&writer, cellMask, (cellCount > 32) ? 32 : cellCount);
+
+    // Satellite data: DF397, [DF419], DF398, [DF399]
+    for (sat = 0; sat < satellites; sat++)
+        sempRtcmPutBits(&writer, (roughRange[sat] == 0xffffffff) ? 0xff : roughRange[sat] >> 10, 8);
+    if (msm7)
+        for (sat = 0; sat < satellites; sat++)
+            sempRtcmPutBits(&writer, first[sat] ? first[sat]->extendedInfo : 0, 4);
+    for (sat = 0; sat < satellites; sat++)
+        sempRtcmPutBits(&writer, (roughRange[sat] == 0xffffffff) ? 0 : roughRange[sat], 10);
+    if (msm7)
+        for (sat = 0; sat < satellites; sat++)
+            sempRtcmPutBits(&writer,
+                            first[sat] ? sempRtcmSigned(first[sat]->phaserangeRate, 1, 14)
+                                       : -8192,
+                            14);
+
+    // Signal data, one pass per field in cell order
+    for (cell = 0; cell < cellCount; cell++)
+    {
+        if (!cells[cell])
+            continue;
+        sat = cell / signals;
+        range = (cells[cell]->pseudorange / SEMP_RTCM_RANGE_MS)
+              - (roughRange[sat] * SEMP_RTCM_P2_10);
+        if ((cells[cell]->pseudorange == 0) || (roughRange[sat] == 0xffffffff))
+            range = 1e9;
+        if (msm7)
+            sempRtcmPutBits(&writer, sempRtcmSigned(range, SEMP_RTCM_P2_29, 20), 20);
+        else
+            sempRtcmPutBits(&writer, sempRtcmSigned(range, SEMP_RTCM_P2_24, 15), 15);
+    }
+    for (cell = 0; cell < cellCount; cell++)
+    {
+        if (!cells[cell])
+            continue;
+        sat = cell / signals;
+        range = (cells[cell]->phaserange / SEMP_RTCM_RANGE_MS)
+              - (roughRange[sat] * SEMP_RTCM_P2_10);
+        if ((cells[cell]->phaserange == 0) || (roughRange[sat] == 0xffffffff))
+            range = 1e9;
+        if (msm7)
+            sempRtcmPutBits(&writer, sempRtcmSigned(range, SEMP_RTCM_P2_31, 24), 24);
+        else
+            sempRtcmPutBits(&writer, sempRtcmSigned(range, SEMP_RTCM_P2_29, 22), 22);
+    }
+    for (cell = 0; cell < cellCount; cell++)
+        if (cells[cell])
+        {
+            if (msm7)
+                sempRtcmPutBits(&writer, sempRtcmLockTimeExtended(cells[cell]->lockTime), 10);
+            else
+                sempRtcmPutBits(&writer, sempRtcmLockTime(cells[cell]->lockTime), 4);
+        }
+    for (cell = 0; cell < cellCount; cell++)
+        if (cells[cell])
+            sempRtcmPutBits(&writer, cells[cell]->halfCycle, 1);
+    for (cell = 0; cell < cellCount; cell++)
+        if (cells[cell])
+        {
+            range = cells[cell]->cnr * (msm7 ? 16 : 1);
+            range = (range < 0) ? 0 : sempRtcmRound(range);
+            if (msm7)
+                sempRtcmPutBits(&writer, (range > 1023) ? 1023 : (uint32_t)range, 10);
+            else
+                sempRtcmPutBits(&writer, (range > 63) ? 63 : (uint32_t)range, 6);
+        }
+    if (msm7)
+        for (cell = 0; cell < cellCount; cell++)
+            if (cells[cell])
+            {
+                sat = cell / signals;
+                range = 1e9;
+                if (first[sat] && (sempRtcmSigned(first[sat]->phaserangeRate, 1, 14) != -8192))
+                    range = cells[cell]->phaserangeRate
+                          - sempRtcmSigned(first[sat]->phaserangeRate, 1, 14);
+                sempRtcmPutBits(&writer, sempRtcmSigned(range, 0.0001, 15), 15);
+            }
+    return sempRtcmEndFrame(&writer, buffer);
+}
+
+// 编码1005
+uint16_t sempRtcmEncode1005(uint8_t *buffer, size_t length, const SEMP_RTCM_1005 *station)
+{
+    SEMP_RTCM_BIT_WRITER writer;
+    int64_t coordinate;
+
+    if ((!buffer) || (!station))
+        return 0;
+
+    sempRtcmBeginFrame(&writer, buffer, length);
+    sempRtcmPutBits(&writer, 1005, 12);
+    sempRtcmPutBits(&writer, station->station, 12);
+    sempRtcmPutBits(&writer, station->itrfYear, 6);
+    sempRtcmPutBits(&writer, station->gps, 1);
+    sempRtcmPutBits(&writer, station->glonass, 1);
+    sempRtcmPutBits(&writer, station->galileo, 1);
+    sempRtcmPutBits(&writer, station->referenceStation, 1);
+
+    // 38-bit coordinates in units of 0.0001 meters
+    coordinate = sempRtcmRound(station->x * 10000);
+    sempRtcmPutBits(&writer, (uint64_t)coordinate >> 32, 6);
+    sempRtcmPutBits(&writer, (uint64_t)coordinate, 32);
+    sempRtcmPutBits(&writer, station->singleOscillator, 1);
+    sempRtcmPutBits(&writer, 0, 1);
+    coordinate = sempRtcmRound(station->y * 10000);
+    sempRtcmPutBits(&writer, (uint64_t)coordinate >> 32, 6);
+    sempRtcmPutBits(&writer, (uint64_t)coordinate, 32);
+    sempRtcmPutBits(&writer, station->quarterCycle, 2);
+    coordinate = sempRtcmRound(station->z * 10000);
+    sempRtcmPutBits(&writer, (uint64_t)coordinate >> 32, 6);
+    sempRtcmPutBits(&writer, (uint64_t)coordinate, 32);
+    return sempRtcmEndFrame(&writer, buffer);
+}
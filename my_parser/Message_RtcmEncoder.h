@@ -0,0 +1,108 @@
+/**
+ * @file Message_RtcmEncoder.h
+ * @brief RTCM3 MSM4/MSM7与1005电文编码器 - 头文件
+ * @details 用于虚拟参考站数据流的生成与转播. 字段通过64位位写入器顺序写入
+ *          调用者提供的缓冲区, 编码过程不分配内存; 帧尾以整段计算的CRC-24Q
+ *          结束, 输出可直接由sempRtcmPreamble解析器分帧.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_RTCM_ENCODER_H
+#define MESSAGE_RTCM_ENCODER_H
+
+#include "Message_Parser.h"
+#include "Parse_RTCM.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_RTCM_MSM_MAX_SATELLITES    64  // Satellite mask bits
+#define SEMP_RTCM_MSM_MAX_SIGNALS       32  // Signal mask bits
+#define SEMP_RTCM_MSM_MAX_CELLS         64  // Satellites * signals limit
+
+// Speed of light, meters per millisecond of range
+#define SEMP_RTCM_RANGE_MS              299792.458
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+// One signal of one satellite, zero pseudorange or phaserange marks it invalid
+typedef struct _SEMP_RTCM_MSM_OBS
+{
+    uint8_t satellite;      // Satellite ID, 1 - 64
+    uint8_t signal;         // Signal ID, 1 - 32
+    uint8_t extendedInfo;   // MSM7 extended satellite information, 4 bits
+    bool halfCycle;         // Half-cycle ambiguity indicator
+    uint32_t lockTime;      // Phaserange lock time, milliseconds
+    double pseudorange;     // Meters
+    double phaserange;      // Meters
+    double phaserangeRate;  // Meters per second, MSM7 only
+    double cnr;             // Carrier to noise ratio, dB-Hz
+} SEMP_RTCM_MSM_OBS;
+
+// MSM message header and observations
+typedef struct _SEMP_RTCM_MSM
+{
+    uint16_t message;       // 1074, 1077, 1084, ... 1127, MSM4 or MSM7
+    uint16_t station;       // Reference station ID
+    uint32_t epochTime;     // 30-bit system epoch time (GPS TOW ms, GLONASS day and TOD ms)
+    bool multipleMessage;   // More MSM messages follow for this epoch
+    uint8_t iods;           // Issue of data station, 3 bits
+    uint8_t clockSteering;  // 2 bits
+    uint8_t externalClock;  // 2 bits
+    bool smoothing;         // Divergence-free smoothing indicator
+    uint8_t smoothingInterval;  // 3 bits
+    uint16_t obsCount;      // Number of observations
+    const SEMP_RTCM_MSM_OBS *obs;   // Observations in any order
+} SEMP_RTCM_MSM;
+
+// Message 1005, stationary antenna reference point
+typedef struct _SEMP_RTCM_1005
+{
+    uint16_t station;       // Reference station ID
+    uint8_t itrfYear;       // 6 bits
+    bool gps;               // GPS service supported
+    bool glonass;           // GLONASS service supported
+    bool galileo;           // Galileo service supported
+    bool referenceStation;  // Physical (false) or non-physical reference station
+    bool singleOscillator;  // Single receiver oscillator indicator
+    uint8_t quarterCycle;   // Quarter cycle indicator, 2 bits
+    double x;               // ECEF X, meters
+    double y;               // ECEF Y, meters
+    double z;               // ECEF Z, meters
+} SEMP_RTCM_1005;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 编码一帧MSM4或MSM7电文
+ * @param buffer 输出缓冲区, SEMP_RTCM_MAX_FRAME_BYTES字节总是足够
+ * @param length 输出缓冲区长度
+ * @param msm 电文头和观测值
+ * @return 帧长度(前导符到CRC), 消息号错误、单元数超过64或缓冲区不足时返回0
+ */
+uint16_t sempRtcmEncodeMsm(uint8_t *buffer, size_t length, const SEMP_RTCM_MSM *msm);
+
+/**
+ * @brief 编码一帧1005电文
+ * @param buffer 输出缓冲区, 至少25字节
+ * @param length 输出缓冲区长度
+ * @param station 基准站参数
+ * @return 帧长度, 缓冲区不足时返回0
+ */
+uint16_t sempRtcmEncode1005(uint8_t *buffer, size_t length, const SEMP_RTCM_1005 *station);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_RTCM_ENCODER_H
@@ -0,0 +1,307 @@
+/**
+ * @file Message_RtcmEpoch.c
+ * @brief RTCM MSM历元组装器 - 功能实现
+ * @details 块池中的一块总是借给解析器作为缓冲区.  保留一帧MSM时, 当前块
+ *          记入该基准站的未完成历元, 解析器改用空闲链表中的下一块.
+ *          历元输出后其所有块归还空闲链表.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_RtcmEpoch.h"
+
+#define SEMP_RTCM_DAY_MSEC      (24ul * 60 * 60 * 1000)
+#define SEMP_RTCM_WEEK_MSEC     (7ul * SEMP_RTCM_DAY_MSEC)
+#define SEMP_RTCM_BDS_MSEC      14000   // GPS time - BeiDou time
+
+//----------------------------------------
+// 内部类型
+//----------------------------------------
+
+// Epoch still collecting frames
+typedef struct _SEMP_RTCM_OPEN_EPOCH
+{
+    SEMP_RTCM_EPOCH epoch;                       // Frames collected so far
+    uint16_t blocks[SEMP_RTCM_EPOCH_MAX_FRAMES]; // Pool blocks holding the frames
+    uint32_t gpsTime;       // GPS time of week of the GPS-like MSM frames
+    uint32_t glonassTime;   // GLONASS day and time of day
+    bool haveGps;           // gpsTime is set
+    bool haveGlonass;       // glonassTime is set
+    bool truncated;         // Earlier frames of this epoch were already output
+    bool open;              // Slot in use
+    uint32_t lastUsed;      // Sequence number of the last frame added
+} SEMP_RTCM_OPEN_EPOCH;
+
+struct _SEMP_RTCM_ASSEMBLER
+{
+    SEMP_PARSE_STATE *parse;          // Parser using the pool
+    uint8_t *savedBuffer;             // Parser buffer before the assembler
+    uint16_t savedLength;             // Parser buffer length before the assembler
+    SEMP_RTCM_EPOCH_CALLBACK callback;
+    void *context;
+    uint8_t *pool;                    // blockCount blocks of blockBytes
+    uint16_t blockBytes;
+    uint16_t blockCount;
+    uint16_t currentBlock;            // Block lent to the parser
+    uint16_t freeCount;               // Number of blocks in freeBlocks
+    uint16_t *freeBlocks;             // Stack of free block numbers
+    uint32_t sequence;                // Frames added, for the oldest epoch
+    SEMP_RTCM_OPEN_EPOCH stations[SEMP_RTCM_EPOCH_MAX_STATIONS];
+};
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+// Output the frames collected so far and return their blocks to the pool
+static void sempRtcmEpochOutput(SEMP_RTCM_ASSEMBLER *assembler,
+                                SEMP_RTCM_OPEN_EPOCH *open,
+                                bool final)
+{
+    uint16_t index;
+
+    if (open->epoch.frameCount)
+    {
+        open->epoch.complete = final && (!open->truncated);
+        assembler->callback(assembler->context, &open->epoch);
+        for (index = 0; index < open->epoch.frameCount; index++)
+            assembler->freeBlocks[assembler->freeCount++] = open->blocks[index];
+        open->epoch.frameCount = 0;
+    }
+
+    // Later frames of the same epoch are reported as incomplete
+    open->truncated = !final;
+}
+
+// Find the open epoch that has waited longest, optionally only with frames
+static SEMP_RTCM_OPEN_EPOCH * sempRtcmEpochOldest(SEMP_RTCM_ASSEMBLER *assembler,
+                                                  bool withFrames)
+{
+    SEMP_RTCM_OPEN_EPOCH *oldest = nullptr;
+    SEMP_RTCM_OPEN_EPOCH *open;
+    int index;
+
+    for (index = 0; index < SEMP_RTCM_EPOCH_MAX_STATIONS; index++)
+    {
+        open = &assembler->stations[index];
+        if (open->open && ((!withFrames) || open->epoch.frameCount)
+            && ((!oldest) || ((int32_t)(open->lastUsed - oldest->lastUsed) < 0)))
+            oldest = open;
+    }
+    return oldest;
+}
+
+// Determine if the frame time matches the open epoch, record the time
+static bool sempRtcmEpochSameTime(SEMP_RTCM_OPEN_EPOCH *open, const SEMP_EPOCH *epoch)
+{
+    uint32_t time = epoch->milliseconds;
+
+    if (epoch->timeBase == SEMP_EPOCH_GLONASS_TOD)
+    {
+        if (open->haveGlonass && (open->glonassTime != time))
+            return false;
+        open->glonassTime = time;
+        open->haveGlonass = true;
+        return true;
+    }
+
+    // GPS, Galileo, QZSS, SBAS and NavIC share GPS time, BeiDou is 14 seconds behind
+    if (epoch->timeBase == SEMP_EPOCH_BDS_TOW)
+        time = (time + SEMP_RTCM_BDS_MSEC) % SEMP_RTCM_WEEK_MSEC;
+    if (open->haveGps && (open->gpsTime != time))
+        return false;
+    open->gpsTime = time;
+    open->haveGps = true;
+    return true;
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Allocate the assembler and lend the parser a pool block
+SEMP_RTCM_ASSEMBLER * sempRtcmEpochBegin(SEMP_PARSE_STATE *parse,
+                                         uint16_t blockCount,
+                                         uint16_t blockBytes,
+                                         SEMP_RTCM_EPOCH_CALLBACK callback,
+                                         void *context)
+{
+    SEMP_RTCM_ASSEMBLER *assembler;
+    int headerBytes;
+    uint16_t index;
+
+    if ((!parse) || (!callback))
+        return nullptr;
+    if (blockCount < 2)
+    {
+        sempPrintln(parse->printError, "SEMP: RTCM epoch assembler needs at least 2 blocks");
+        return nullptr;
+    }
+    if (blockBytes < SEMP_RTCM_MAX_FRAME_BYTES)
+        blockBytes = SEMP_RTCM_MAX_FRAME_BYTES;
+    blockBytes = SEMP_ALIGN(blockBytes);
+
+    // Allocate the assembler, the free stack and the pool together
+    headerBytes = SEMP_ALIGN(sizeof(SEMP_RTCM_ASSEMBLER))
+                + SEMP_ALIGN(blockCount * sizeof(uint16_t));
+    assembler = (SEMP_RTCM_ASSEMBLER *)semp_util_malloc(headerBytes
+                                                        + (blockCount * blockBytes));
+    if (!assembler)
+    {
+        sempPrintln(parse->printError, "SEMP: Failed to allocate the RTCM epoch assembler");
+        return nullptr;
+    }
+    memset(assembler, 0, sizeof(*assembler));
+    assembler->freeBlocks = (uint16_t *)((uint8_t *)assembler
+                                         + SEMP_ALIGN(sizeof(SEMP_RTCM_ASSEMBLER)));
+    assembler->pool = (uint8_t *)assembler + headerBytes;
+    assembler->blockBytes = blockBytes;
+    assembler->blockCount = blockCount;
+    assembler->callback = callback;
+    assembler->context = context;
+
+    // Block 0 goes to the parser, the rest are free
+    for (index = blockCount - 1; index > 0; index--)
+        assembler->freeBlocks[assembler->freeCount++] = index;
+    assembler->currentBlock = 0;
+
+    // Switch the parser to the pool, between frames
+    assembler->parse = parse;
+    assembler->savedBuffer = parse->buffer;
+    assembler->savedLength = parse->buffer_length;
+    parse->buffer = assembler->pool;
+    parse->buffer_length = blockBytes;
+    parse->state = sempFirstByte;
+    parse->msg_length = 0;
+    return assembler;
+}
+
+// Add the frame in the parser buffer to its epoch
+bool sempRtcmEpochFrame(SEMP_RTCM_ASSEMBLER *assembler,
+                        SEMP_PARSE_STATE *parse,
+                        uint16_t type)
+{
+    uint8_t *block;
+    SEMP_EPOCH epoch;
+    uint16_t frameIndex;
+    uint16_t message;
+    bool moreMessages;
+    SEMP_RTCM_OPEN_EPOCH *open;
+    uint16_t station;
+    int index;
+
+    if ((!assembler) || (parse != assembler->parse))
+        return false;
+    block = &assembler->pool[assembler->currentBlock * assembler->blockBytes];
+    if ((parse->buffer != block) || (parse->msg_length < (3 + 10 + 3))
+        || (block[0] != 0xd3))
+        return false;
+
+    // Only MSM1 - MSM7 frames belong to an epoch
+    message = sempRtcmGetBits(block, 24, 12);
+    if ((message < 1071) || (message > 1137)
+        || ((message % 10) < 1) || ((message % 10) > 7))
+        return false;
+
+    // Never hold a damaged frame
+    if (!sempValidateFrame(parse))
+        return false;
+    epoch = sempGetFrameEpoch(parse, type);
+    station = sempRtcmGetBits(block, 24 + 12, 12);
+    moreMessages = sempRtcmGetBits(block, 24 + 12 + 12 + 30, 1);
+
+    // Make sure a block is available to replace the one holding this frame,
+    // the oldest epoch stays open to collect its remaining frames
+    if (!assembler->freeCount)
+        sempRtcmEpochOutput(assembler, sempRtcmEpochOldest(assembler, true), false);
+
+    // Locate the station's open epoch
+    open = nullptr;
+    for (index = 0; index < SEMP_RTCM_EPOCH_MAX_STATIONS; index++)
+        if (assembler->stations[index].open
+            && (assembler->stations[index].epoch.station == station))
+        {
+            open = &assembler->stations[index];
+            break;
+        }
+
+    // A new epoch time ends the previous epoch without its final frame
+    if (open && (!sempRtcmEpochSameTime(open, &epoch)))
+    {
+        sempRtcmEpochOutput(assembler, open, false);
+        open->open = false;
+        open = nullptr;
+    }
+
+    // Output the frames of a full epoch, it continues as incomplete
+    if (open && (open->epoch.frameCount >= SEMP_RTCM_EPOCH_MAX_FRAMES))
+        sempRtcmEpochOutput(assembler, open, false);
+
+    // Start a new epoch, replace the oldest one when all slots are in use
+    if (!open)
+    {
+        for (index = 0; index < SEMP_RTCM_EPOCH_MAX_STATIONS; index++)
+            if (!assembler->stations[index].open)
+                break;
+        if (index < SEMP_RTCM_EPOCH_MAX_STATIONS)
+            open = &assembler->stations[index];
+        else
+        {
+            open = sempRtcmEpochOldest(assembler, false);
+            sempRtcmEpochOutput(assembler, open, false);
+        }
+        memset(open, 0, sizeof(*open));
+        open->open = true;
+        open->epoch.station = station;
+        open->epoch.epoch = epoch;
+        sempRtcmEpochSameTime(open, &epoch);
+    }
+
+    // Keep the frame in its block and lend the parser a free block
+    frameIndex = open->epoch.frameCount++;
+    open->epoch.frames[frameIndex] = block;
+    open->epoch.lengths[frameIndex] = parse->msg_length;
+    open->epoch.messages[frameIndex] = message;
+    open->blocks[frameIndex] = assembler->currentBlock;
+    open->lastUsed = assembler->sequence++;
+    assembler->currentBlock = assembler->freeBlocks[--assembler->freeCount];
+    parse->buffer = &assembler->pool[assembler->currentBlock * assembler->blockBytes];
+
+    // The last message of the epoch has the multiple message bit clear
+    if (!moreMessages)
+    {
+        sempRtcmEpochOutput(assembler, open, true);
+        open->open = false;
+    }
+    return true;
+}
+
+// Output all open epochs as incomplete
+void sempRtcmEpochFlush(SEMP_RTCM_ASSEMBLER *assembler)
+{
+    SEMP_RTCM_OPEN_EPOCH *open;
+
+    if (assembler)
+        while ((open = sempRtcmEpochOldest(assembler, false)))
+        {
+            sempRtcmEpochOutput(assembler, open, false);
+            open->open = false;
+        }
+}
+
+// Restore the parser buffer and free the assembler
+void sempRtcmEpochStop(SEMP_RTCM_ASSEMBLER **assembler)
+{
+    SEMP_PARSE_STATE *parse;
+
+    if (assembler && *assembler)
+    {
+        parse = (*assembler)->parse;
+        parse->buffer = (*assembler)->savedBuffer;
+        parse->buffer_length = (*assembler)->savedLength;
+        parse->state = sempFirstByte;
+        parse->msg_length = 0;
+        semp_util_free(*assembler);
+        *assembler = nullptr;
+    }
+}
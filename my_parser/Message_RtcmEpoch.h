@@ -0,0 +1,94 @@
+/**
+ * @file Message_RtcmEpoch.h
+ * @brief RTCM MSM历元组装器 - 头文件
+ * @details 一个观测历元由多条MSM消息组成(GPS/GLONASS/Galileo/BeiDou等),
+ *          多消息标志位(MM bit)为1表示同一基准站同一时刻还有后续消息.
+ *          组装器按基准站和历元时间归组, 收到MM位为0的消息时输出完整历元.
+ *          帧直接保存在池化的缓冲块中: 解析器的缓冲区由组装器从块池中提供,
+ *          保留一帧时只需为解析器换一个新块, 帧数据不做复制.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_RTCM_EPOCH_H
+#define MESSAGE_RTCM_EPOCH_H
+
+#include "Message_Parser.h"
+#include "Parse_RTCM.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_RTCM_EPOCH_MAX_FRAMES      32  // MSM frames per epoch
+#define SEMP_RTCM_EPOCH_MAX_STATIONS    16  // Stations with an open epoch
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_RTCM_ASSEMBLER SEMP_RTCM_ASSEMBLER;
+
+// One observation epoch of a reference station
+typedef struct _SEMP_RTCM_EPOCH
+{
+    uint16_t station;       // Reference station ID
+    SEMP_EPOCH epoch;       // Time tag of the first frame
+    uint16_t frameCount;    // Number of MSM frames
+    bool complete;          // Final frame (MM bit = 0) was received
+    const uint8_t *frames[SEMP_RTCM_EPOCH_MAX_FRAMES];  // Frames in the pool
+    uint16_t lengths[SEMP_RTCM_EPOCH_MAX_FRAMES];       // Frame lengths
+    uint16_t messages[SEMP_RTCM_EPOCH_MAX_FRAMES];      // Message numbers
+} SEMP_RTCM_EPOCH;
+
+// Epoch callback.  The frames remain valid until the callback returns,
+// then their blocks go back to the pool.  complete is false when the
+// epoch was cut short: a new epoch time, a full epoch or a full pool.
+typedef void (*SEMP_RTCM_EPOCH_CALLBACK)(void *context, const SEMP_RTCM_EPOCH *epoch);
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 分配组装器并接管解析器的缓冲区
+ * @param parse 解析器, 缓冲区替换为池中的块, sempRtcmEpochStop时恢复
+ * @param blockCount 池中的块数, 至少为2
+ * @param blockBytes 每块字节数, 即解析器的缓冲区长度, 至少一帧RTCM最大长度
+ * @param callback 历元回调
+ * @param context 历元回调的上下文
+ * @return 组装器指针, 失败返回nullptr
+ */
+SEMP_RTCM_ASSEMBLER * sempRtcmEpochBegin(SEMP_PARSE_STATE *parse,
+                                         uint16_t blockCount,
+                                         uint16_t blockBytes,
+                                         SEMP_RTCM_EPOCH_CALLBACK callback,
+                                         void *context);
+
+/**
+ * @brief 提交解析器缓冲区中的帧, 在eomCallback中调用
+ * @details MSM帧经校验后保留在当前块中, 解析器换用新块
+ * @param assembler 组装器
+ * @param parse 解析器
+ * @param type 解析器表索引
+ * @return 帧被保留返回true, 非MSM帧或校验失败返回false
+ */
+bool sempRtcmEpochFrame(SEMP_RTCM_ASSEMBLER *assembler,
+                        SEMP_PARSE_STATE *parse,
+                        uint16_t type);
+
+// Output all open epochs as incomplete, for example at the end of a stream
+void sempRtcmEpochFlush(SEMP_RTCM_ASSEMBLER *assembler);
+
+// Restore the parser buffer, free the assembler and set the pointer to nullptr
+void sempRtcmEpochStop(SEMP_RTCM_ASSEMBLER **assembler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_RTCM_EPOCH_H
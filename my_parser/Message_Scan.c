@@ -0,0 +1,625 @@
+/**
+ * @file Message_Scan.c
+ * @brief 归档数据完整性扫描 - 功能实现
+ * @details 每个线程从块起点开始扫描, 越过块终点直到完成跨越终点的帧, 并记录
+ *          块开头若干个开始搜索帧的位置 (对齐点) 及此前的结果. 分帧只依赖
+ *          开始搜索的位置, 两次扫描在同一位置开始搜索后结果相同. 合并时从
+ *          上一块停止的位置串行扫描到本块的某个对齐点, 本块在该点之后的结果
+ *          直接采用. 数据正常时通常在第一帧内对齐.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include "Message_Scan.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//----------------------------------------
+// 内部常量与类型
+//----------------------------------------
+
+#define SEMP_SCAN_NMEA_OVERHEAD     (1 + 2 + 2 + 1) // Same reserve as the NMEA parser
+#define SEMP_SCAN_NMEA_NAME_BYTES   (SEMP_NMEA_SENTENCE_NAME_BYTES - 1)
+#define SEMP_SCAN_FIRST_REGIONS     256
+
+// Results accumulated by a scan
+typedef struct _SEMP_SCAN_TOTALS
+{
+    uint64_t garbageBytes;
+    SEMP_SCAN_PROTOCOL protocols[SEMP_SCAN_MAX_PROTOCOLS];
+} SEMP_SCAN_TOTALS;
+
+// Preamble byte where the chunk scan started a frame search
+typedef struct _SEMP_SCAN_SYNC
+{
+    uint64_t position;
+    uint64_t regionCount;           // Regions before the position
+    SEMP_SCAN_TOTALS totals;        // Results before the position
+} SEMP_SCAN_SYNC;
+
+typedef struct _SEMP_SCAN SEMP_SCAN;
+
+typedef struct _SEMP_SCAN_WORKER
+{
+    const SEMP_SCAN *scan;
+    uint64_t start;                 // First byte of the chunk
+    uint64_t end;                   // Byte following the chunk
+    uint64_t position;              // Where the scan stopped, end or later
+    SEMP_SCAN_TOTALS totals;
+    SEMP_SCAN_REGION *regions;
+    uint64_t regionCount;
+    uint64_t regionSlots;
+    bool failed;                    // Failed to allocate the regions
+    uint16_t syncCount;
+    SEMP_SCAN_SYNC syncs[SEMP_SCAN_SYNC_POINTS];
+} SEMP_SCAN_WORKER;
+
+struct _SEMP_SCAN
+{
+    const SEMP_FRAMING_DESCRIPTOR * const *protocols;
+    const uint8_t *data;
+    uint64_t length;
+    uint16_t maxFrameBytes;
+    uint8_t firstByte[256];         // Index + 1 of the first protocol using the preamble
+};
+
+//----------------------------------------
+// 损坏区域
+//----------------------------------------
+
+// Add bytes to the damaged regions, adjacent bytes extend the last region
+static void sempScanDamage(SEMP_SCAN_WORKER *worker, uint64_t offset, uint64_t length)
+{
+    SEMP_SCAN_REGION *regions;
+    SEMP_SCAN_REGION *last;
+
+    if (worker->regionCount)
+    {
+        last = &worker->regions[worker->regionCount - 1];
+        if ((last->offset + last->length) == offset)
+        {
+            last->length += length;
+            return;
+        }
+    }
+
+    // Double the region list
+    if (worker->regionCount == worker->regionSlots)
+    {
+        regions = (SEMP_SCAN_REGION *)semp_util_malloc((worker->regionSlots
+                                                        ? (worker->regionSlots * 2)
+                                                        : SEMP_SCAN_FIRST_REGIONS)
+                                                       * sizeof(SEMP_SCAN_REGION));
+        if (!regions)
+        {
+            worker->failed = true;
+            return;
+        }
+        if (worker->regions)
+        {
+            memcpy(regions, worker->regions, worker->regionCount * sizeof(SEMP_SCAN_REGION));
+            semp_util_free(worker->regions);
+        }
+        worker->regions = regions;
+        worker->regionSlots = worker->regionSlots ? (worker->regionSlots * 2)
+                                                  : SEMP_SCAN_FIRST_REGIONS;
+    }
+    worker->regions[worker->regionCount].offset = offset;
+    worker->regions[worker->regionCount].length = length;
+    worker->regionCount++;
+}
+
+// Bytes outside of the frames
+static uint64_t sempScanGarbage(SEMP_SCAN_WORKER *worker, uint64_t offset, uint64_t length)
+{
+    worker->totals.garbageBytes += length;
+    sempScanDamage(worker, offset, length);
+    return offset + length;
+}
+
+//----------------------------------------
+// 分帧
+//----------------------------------------
+
+// Check the frame at the position, returns where the next search starts
+static uint64_t sempScanFrame(const SEMP_SCAN *scan,
+                              SEMP_SCAN_WORKER *worker,
+                              uint64_t position,
+                              uint8_t protocol)
+{
+    const SEMP_FRAMING_DESCRIPTOR *descriptor = scan->protocols[protocol];
+    SEMP_SCAN_PROTOCOL *results = &worker->totals.protocols[protocol];
+    const uint8_t *frame = &scan->data[position];
+    uint64_t available = scan->length - position;
+    const uint8_t *field;
+    uint32_t frameLength;
+    uint16_t length;
+    uint8_t index;
+
+    // Invalid sync byte, start searching at that byte
+    for (index = 1; index < descriptor->syncBytes; index++)
+    {
+        if (index >= available)
+            return sempScanGarbage(worker, position, available);
+        if (frame[index] != descriptor->sync[index])
+            return sempScanGarbage(worker, position, index);
+    }
+
+    // Same length checks as sempFramingHeader
+    if (available < descriptor->headerBytes)
+        return sempScanGarbage(worker, position, available);
+    field = &frame[descriptor->lengthOffset];
+    length = field[0];
+    if (descriptor->lengthBytes == 2)
+        length = descriptor->lengthBigEndian ? ((field[0] << 8) | field[1])
+                                             : (field[0] | (field[1] << 8));
+    frameLength = descriptor->lengthIsFrame
+                ? length
+                : (uint32_t)(descriptor->headerBytes + length + descriptor->trailerBytes);
+    if ((length & (~descriptor->lengthMask)) || (length < descriptor->minimumLength)
+        || (frameLength < descriptor->headerBytes)
+        || (descriptor->frameMultiple && (frameLength % descriptor->frameMultiple))
+        || (frameLength > scan->maxFrameBytes))
+        // Invalid length, search again after the preamble byte
+        return sempScanGarbage(worker, position, 1);
+
+    // Jump to the end of the frame, a truncated frame is never delivered
+    if (available < frameLength)
+        return sempScanGarbage(worker, position, available);
+    if ((!descriptor->validateFrame) || descriptor->validateFrame(frame, frameLength))
+    {
+        results->frames++;
+        results->bytes += frameLength;
+    }
+    else
+    {
+        results->badFrames++;
+        results->badBytes += frameLength;
+        sempScanDamage(worker, position, frameLength);
+    }
+    return position + frameLength;
+}
+
+// Check the NMEA sentence at the position, same rules as the NMEA parser
+static uint64_t sempScanNmea(const SEMP_SCAN *scan,
+                             SEMP_SCAN_WORKER *worker,
+                             uint64_t position,
+                             uint8_t protocol)
+{
+    SEMP_SCAN_PROTOCOL *results = &worker->totals.protocols[protocol];
+    const uint8_t *data = scan->data;
+    uint64_t offset = position + 1;
+    uint8_t nameLength = 0;
+    uint8_t checksum;
+    uint8_t upper;
+    uint8_t crc = 0;
+
+    // Sentence name: letters and digits followed by a comma
+    for (;; offset++)
+    {
+        if (offset >= scan->length)
+            return sempScanGarbage(worker, position, offset - position);
+        crc ^= data[offset];
+        if ((data[offset] == ',') && nameLength)
+            break;
+        upper = data[offset] & ~0x20;
+        if ((((upper < 'A') || (upper > 'Z')) && ((data[offset] < '0') || (data[offset] > '9')))
+            || (nameLength == SEMP_SCAN_NMEA_NAME_BYTES))
+            return sempScanGarbage(worker, position, offset - position);
+        nameLength++;
+    }
+
+    // Fields up to the asterisk
+    for (offset++;; offset++)
+    {
+        if (offset >= scan->length)
+            return sempScanGarbage(worker, position, offset - position);
+        if (data[offset] == '*')
+            break;
+        crc ^= data[offset];
+        if ((offset - position + 1 + SEMP_SCAN_NMEA_OVERHEAD) > scan->maxFrameBytes)
+            return sempScanGarbage(worker, position, offset - position);
+    }
+
+    // Two hexadecimal checksum characters
+    for (upper = 0; upper < 2; upper++)
+    {
+        if (++offset >= scan->length)
+            return sempScanGarbage(worker, position, offset - position);
+        if (semp_util_asciiToNibble(data[offset]) < 0)
+            return sempScanGarbage(worker, position, offset - position);
+    }
+    checksum = (uint8_t)((semp_util_asciiToNibble(data[offset - 1]) << 4)
+                         | semp_util_asciiToNibble(data[offset]));
+
+    // The parser ends the sentence on the following byte: CR LF, LF CR,
+    // a single CR or LF, or any other byte which starts the next search
+    if (++offset >= scan->length)
+        return sempScanGarbage(worker, position, offset - position);
+    if ((data[offset] == '\r') || (data[offset] == '\n'))
+    {
+        if (++offset >= scan->length)
+            return sempScanGarbage(worker, position, offset - position);
+        if (data[offset] == ((data[offset - 1] == '\r') ? '\n' : '\r'))
+            offset++;
+    }
+    if (checksum == crc)
+    {
+        results->frames++;
+        results->bytes += offset - position;
+    }
+    else
+    {
+        results->badFrames++;
+        results->badBytes += offset - position;
+        sempScanDamage(worker, position, offset - position);
+    }
+    return offset;
+}
+
+// Search for a frame at the position, returns where the next search starts
+static uint64_t sempScanStep(const SEMP_SCAN *scan, SEMP_SCAN_WORKER *worker, uint64_t position)
+{
+    uint8_t protocol;
+
+    protocol = scan->firstByte[scan->data[position]];
+    if (!protocol)
+        return sempScanGarbage(worker, position, 1);
+    protocol -= 1;
+    if (!scan->protocols[protocol])
+        return sempScanNmea(scan, worker, position, protocol);
+    return sempScanFrame(scan, worker, position, protocol);
+}
+
+//----------------------------------------
+// 分块扫描与合并
+//----------------------------------------
+
+// Scan the chunk, finishing the frame crossing its end
+static void * sempScanWorker(void *context)
+{
+    SEMP_SCAN_WORKER *worker = (SEMP_SCAN_WORKER *)context;
+    const SEMP_SCAN *scan = worker->scan;
+    SEMP_SCAN_SYNC *sync;
+    uint64_t position;
+    uint64_t skip;
+
+    position = worker->start;
+    while ((position < worker->end) && (!worker->failed))
+    {
+        // Skip the bytes which do not start a frame
+        if (!scan->firstByte[scan->data[position]])
+        {
+            for (skip = position + 1; skip < worker->end; skip++)
+                if (scan->firstByte[scan->data[skip]])
+                    break;
+            position = sempScanGarbage(worker, position, skip - position);
+            continue;
+        }
+
+        // Record the alignment points at the start of the chunk
+        if (worker->syncCount < SEMP_SCAN_SYNC_POINTS)
+        {
+            sync = &worker->syncs[worker->syncCount++];
+            sync->position = position;
+            sync->regionCount = worker->regionCount;
+            sync->totals = worker->totals;
+        }
+        position = sempScanStep(scan, worker, position);
+    }
+    worker->position = position;
+    return nullptr;
+}
+
+// Add the results of the chunk following the alignment point
+static void sempScanAppend(SEMP_SCAN_WORKER *result,
+                           const SEMP_SCAN_WORKER *worker,
+                           const SEMP_SCAN_SYNC *sync)
+{
+    const SEMP_SCAN_PROTOCOL *before;
+    const SEMP_SCAN_REGION *last;
+    uint64_t region = 0;
+    int index;
+
+    result->totals.garbageBytes += worker->totals.garbageBytes;
+    for (index = 0; index < SEMP_SCAN_MAX_PROTOCOLS; index++)
+    {
+        result->totals.protocols[index].frames += worker->totals.protocols[index].frames;
+        result->totals.protocols[index].bytes += worker->totals.protocols[index].bytes;
+        result->totals.protocols[index].badFrames += worker->totals.protocols[index].badFrames;
+        result->totals.protocols[index].badBytes += worker->totals.protocols[index].badBytes;
+    }
+    if (sync)
+    {
+        result->totals.garbageBytes -= sync->totals.garbageBytes;
+        for (index = 0; index < SEMP_SCAN_MAX_PROTOCOLS; index++)
+        {
+            before = &sync->totals.protocols[index];
+            result->totals.protocols[index].frames -= before->frames;
+            result->totals.protocols[index].bytes -= before->bytes;
+            result->totals.protocols[index].badFrames -= before->badFrames;
+            result->totals.protocols[index].badBytes -= before->badBytes;
+        }
+
+        // The region before the point may have grown past it
+        region = sync->regionCount;
+        if (region)
+        {
+            last = &worker->regions[region - 1];
+            if ((last->offset + last->length) > sync->position)
+                sempScanDamage(result, sync->position,
+                               last->offset + last->length - sync->position);
+        }
+    }
+    for (; region < worker->regionCount; region++)
+        sempScanDamage(result, worker->regions[region].offset, worker->regions[region].length);
+}
+
+// Join the chunks in input order
+static bool sempScanMerge(const SEMP_SCAN *scan,
+                          SEMP_SCAN_WORKER *workers,
+                          uint16_t count,
+                          SEMP_SCAN_WORKER *result,
+                          uint64_t *alignBytes)
+{
+    const SEMP_SCAN_SYNC *sync;
+    SEMP_SCAN_WORKER *worker;
+    uint64_t position;
+    uint64_t start;
+    uint16_t chunk;
+    uint16_t index;
+
+    sempScanAppend(result, &workers[0], nullptr);
+    position = workers[0].position;
+    for (chunk = 1; chunk < count; chunk++)
+    {
+        // Scan from where the previous chunk stopped to an alignment point,
+        // when there is none the whole chunk is scanned here
+        worker = &workers[chunk];
+        sync = nullptr;
+        index = 0;
+        while ((position < worker->position) && (!result->failed))
+        {
+            while ((index < worker->syncCount) && (worker->syncs[index].position < position))
+                index++;
+            if ((index < worker->syncCount) && (worker->syncs[index].position == position))
+            {
+                sync = &worker->syncs[index];
+                break;
+            }
+            start = position;
+            position = sempScanStep(scan, result, position);
+            *alignBytes += position - start;
+        }
+        if (sync)
+        {
+            sempScanAppend(result, worker, sync);
+            position = worker->position;
+        }
+    }
+    for (chunk = 0; chunk < count; chunk++)
+        if (workers[chunk].failed)
+            result->failed = true;
+    return !result->failed;
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Scan the data in memory
+SEMP_SCAN_REPORT * sempScanBuffer(const SEMP_FRAMING_DESCRIPTOR * const *protocols,
+                                  uint8_t protocolCount,
+                                  const uint8_t *data,
+                                  size_t length,
+                                  uint16_t threads,
+                                  uint16_t maxFrameBytes,
+                                  SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_SCAN_REPORT *report = nullptr;
+    SEMP_SCAN_WORKER *workers;
+    SEMP_SCAN_WORKER result;
+    uint64_t alignBytes = 0;
+    pthread_t *handles;
+    bool *started;
+    SEMP_SCAN scan;
+    uint16_t index;
+    uint8_t protocol;
+    long processors;
+
+    if ((!protocols) || (!protocolCount) || (protocolCount > SEMP_SCAN_MAX_PROTOCOLS)
+        || (length && (!data)))
+    {
+        sempPrintf(printError, "SEMP: Please specify 1 - %d scan protocols and the data",
+                   SEMP_SCAN_MAX_PROTOCOLS);
+        return nullptr;
+    }
+
+    // Preamble lookup, the first protocol in the table wins as in sempFirstByte
+    memset(&scan, 0, sizeof(scan));
+    for (protocol = protocolCount; protocol > 0; protocol--)
+    {
+        if (protocols[protocol - 1])
+            scan.firstByte[protocols[protocol - 1]->sync[0]] = protocol;
+        else
+        {
+            scan.firstByte['$'] = protocol;
+            scan.firstByte['!'] = protocol;
+        }
+    }
+    scan.protocols = protocols;
+    scan.data = data;
+    scan.length = length;
+    scan.maxFrameBytes = (maxFrameBytes < SEMP_MINIMUM_BUFFER_LENGTH)
+                       ? SEMP_MINIMUM_BUFFER_LENGTH : maxFrameBytes;
+
+    // One chunk per thread
+    if (!threads)
+    {
+        processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (processors > 0) ? (uint16_t)processors : 1;
+    }
+    if ((length / SEMP_SCAN_MINIMUM_CHUNK) < threads)
+        threads = (uint16_t)(length / SEMP_SCAN_MINIMUM_CHUNK);
+    if (!threads)
+        threads = 1;
+
+    workers = (SEMP_SCAN_WORKER *)semp_util_malloc(threads * (sizeof(SEMP_SCAN_WORKER)
+                                                              + sizeof(pthread_t)
+                                                              + sizeof(bool)));
+    if (!workers)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the scan workers");
+        return nullptr;
+    }
+    handles = (pthread_t *)&workers[threads];
+    started = (bool *)&handles[threads];
+    memset(workers, 0, threads * sizeof(SEMP_SCAN_WORKER));
+    for (index = 0; index < threads; index++)
+    {
+        workers[index].scan = &scan;
+        workers[index].start = (length * index) / threads;
+        workers[index].end = (length * (index + 1)) / threads;
+    }
+
+    // The calling thread scans the first chunk
+    for (index = 1; index < threads; index++)
+        started[index] = !pthread_create(&handles[index], nullptr, sempScanWorker,
+                                         &workers[index]);
+    sempScanWorker(&workers[0]);
+    for (index = 1; index < threads; index++)
+    {
+        if (started[index])
+            pthread_join(handles[index], nullptr);
+        else
+            sempScanWorker(&workers[index]);
+    }
+
+    // Join the chunks and build the report
+    memset(&result, 0, offsetof(SEMP_SCAN_WORKER, syncs));
+    if (sempScanMerge(&scan, workers, threads, &result, &alignBytes))
+        report = (SEMP_SCAN_REPORT *)semp_util_malloc(sizeof(SEMP_SCAN_REPORT));
+    if (report)
+    {
+        memset(report, 0, sizeof(SEMP_SCAN_REPORT));
+        report->bytes = length;
+        report->garbageBytes = result.totals.garbageBytes;
+        report->regionCount = result.regionCount;
+        report->regions = result.regions;
+        report->alignBytes = alignBytes;
+        report->threads = threads;
+        report->protocolCount = protocolCount;
+        memcpy(report->protocols, result.totals.protocols, sizeof(report->protocols));
+        result.regions = nullptr;
+    }
+    else
+        sempPrintln(printError, "SEMP: Failed to allocate the scan report");
+
+    if (result.regions)
+        semp_util_free(result.regions);
+    for (index = 0; index < threads; index++)
+        if (workers[index].regions)
+            semp_util_free(workers[index].regions);
+    semp_util_free(workers);
+    return report;
+}
+
+// Map the file and scan it
+SEMP_SCAN_REPORT * sempScanFile(const SEMP_FRAMING_DESCRIPTOR * const *protocols,
+                                uint8_t protocolCount,
+                                const char *fileName,
+                                uint16_t threads,
+                                uint16_t maxFrameBytes,
+                                SEMP_PRINTF_CALLBACK printError)
+{
+    static const uint8_t empty[1] = {0};
+    SEMP_SCAN_REPORT *report;
+    struct stat status;
+    void *map;
+    int fd;
+
+    if (!fileName)
+        return nullptr;
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        sempPrintf(printError, "SEMP: Failed to open %s, errno %d", fileName, errno);
+        return nullptr;
+    }
+    if (fstat(fd, &status))
+    {
+        sempPrintf(printError, "SEMP: Failed to read the size of %s, errno %d", fileName, errno);
+        close(fd);
+        return nullptr;
+    }
+    if (!status.st_size)
+    {
+        close(fd);
+        return sempScanBuffer(protocols, protocolCount, empty, 0, threads, maxFrameBytes,
+                              printError);
+    }
+
+    // The threads read the mapped pages in place
+    map = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        sempPrintf(printError, "SEMP: Failed to map %s, errno %d", fileName, errno);
+        return nullptr;
+    }
+    madvise(map, status.st_size, MADV_WILLNEED);
+    report = sempScanBuffer(protocols, protocolCount, (const uint8_t *)map, status.st_size,
+                            threads, maxFrameBytes, printError);
+    munmap(map, status.st_size);
+    return report;
+}
+
+// Display the scan report
+void sempScanPrintReport(const SEMP_SCAN_REPORT *report,
+                         const SEMP_FRAMING_DESCRIPTOR * const *protocols,
+                         uint32_t maxRegions,
+                         SEMP_PRINTF_CALLBACK print)
+{
+    const SEMP_SCAN_PROTOCOL *results;
+    uint64_t index;
+
+    if ((!report) || (!print))
+        return;
+    sempPrintf(print, "Scanned %llu bytes, %d threads, %llu bytes rescanned at chunk boundaries",
+               (unsigned long long)report->bytes, report->threads,
+               (unsigned long long)report->alignBytes);
+    for (index = 0; index < report->protocolCount; index++)
+    {
+        results = &report->protocols[index];
+        sempPrintf(print, "%-10s %10llu frames %12llu bytes, bad CRC %llu frames %llu bytes",
+                   (protocols && protocols[index]) ? protocols[index]->name : "NMEA",
+                   (unsigned long long)results->frames, (unsigned long long)results->bytes,
+                   (unsigned long long)results->badFrames, (unsigned long long)results->badBytes);
+    }
+    sempPrintf(print, "Garbage %llu bytes, %llu damaged regions",
+               (unsigned long long)report->garbageBytes, (unsigned long long)report->regionCount);
+    for (index = 0; (index < report->regionCount) && (index < maxRegions); index++)
+        sempPrintf(print, "    0x%010llx %llu bytes",
+                   (unsigned long long)report->regions[index].offset,
+                   (unsigned long long)report->regions[index].length);
+    if (report->regionCount > maxRegions)
+        sempPrintf(print, "    %llu more regions",
+                   (unsigned long long)(report->regionCount - maxRegions));
+}
+
+// Free the report
+void sempScanFreeReport(SEMP_SCAN_REPORT **report)
+{
+    if (report && *report)
+    {
+        if ((*report)->regions)
+            semp_util_free((*report)->regions);
+        semp_util_free(*report);
+        *report = nullptr;
+    }
+}
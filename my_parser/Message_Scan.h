@@ -0,0 +1,127 @@
+/**
+ * @file Message_Scan.h
+ * @brief 归档数据完整性扫描 - 头文件
+ * @details 只校验不解码的扫描模式, 用于归档数据审计. 不调用eomCallback,
+ *          不复制帧, 直接在输入数据上按描述表分帧: 检查同步字节, 读取长度
+ *          字段后跳到帧尾, 对整帧做一次span校验. 输入分块由多个线程同时
+ *          扫描, 块边界处由串行合并步骤重新对齐, 结果与单线程扫描完全相同.
+ *          输出每个协议的有效帧数、CRC错误帧数及字节数, 帧以外的无效字节数,
+ *          以及损坏区域 (连续的CRC错误帧和无效字节) 的偏移和长度.
+ *
+ *          分帧规则与解析器一致: 同步字节不符时从该字节重新搜索, 长度字段
+ *          无效时从前导字节的下一字节重新搜索, CRC错误的帧整帧跳过.
+ *          协议表中的nullptr项为NMEA语句, 规则与sempNmeaPreamble相同.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_SCAN_H
+#define MESSAGE_SCAN_H
+
+#include "Message_Framing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_SCAN_MAX_PROTOCOLS     8                   // Entries in the protocol table
+#define SEMP_SCAN_MINIMUM_CHUNK     (1024 * 1024)       // Smallest chunk per thread
+#define SEMP_SCAN_SYNC_POINTS       256                 // Recorded alignment points per chunk
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+// Damaged region: bad CRC frames and bytes outside of frames
+typedef struct _SEMP_SCAN_REGION
+{
+    uint64_t offset;            // Offset in the input
+    uint64_t length;            // Bytes in the region
+} SEMP_SCAN_REGION;
+
+// Per protocol results
+typedef struct _SEMP_SCAN_PROTOCOL
+{
+    uint64_t frames;            // Valid frames
+    uint64_t bytes;             // Bytes in the valid frames
+    uint64_t badFrames;         // Frames failing the CRC
+    uint64_t badBytes;          // Bytes in the bad frames
+} SEMP_SCAN_PROTOCOL;
+
+// Scan results
+typedef struct _SEMP_SCAN_REPORT
+{
+    uint64_t bytes;             // Input bytes
+    uint64_t garbageBytes;      // Bytes outside of frames, truncated frames included
+    uint64_t regionCount;       // Entries in regions
+    SEMP_SCAN_REGION *regions;  // Damaged regions in input order
+    uint64_t alignBytes;        // Bytes scanned again to join the chunks
+    uint16_t threads;           // Threads used for the scan
+    uint8_t protocolCount;      // Entries in protocols
+    SEMP_SCAN_PROTOCOL protocols[SEMP_SCAN_MAX_PROTOCOLS]; // Protocol table order
+} SEMP_SCAN_REPORT;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 扫描内存中的数据
+ * @param protocols 协议描述表列表, 先匹配前导字节的协议优先, nullptr项为NMEA
+ * @param protocolCount 协议数量, 最多SEMP_SCAN_MAX_PROTOCOLS
+ * @param data 输入数据
+ * @param length 数据长度
+ * @param threads 线程数量, 0为在线处理器数量
+ * @param maxFrameBytes 最大帧长度, 与解析器的bufferLength相同
+ * @param printError 错误输出回调
+ * @return 扫描报告, 失败返回nullptr, 使用sempScanFreeReport释放
+ */
+SEMP_SCAN_REPORT * sempScanBuffer(const SEMP_FRAMING_DESCRIPTOR * const *protocols,
+                                  uint8_t protocolCount,
+                                  const uint8_t *data,
+                                  size_t length,
+                                  uint16_t threads,
+                                  uint16_t maxFrameBytes,
+                                  SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 以mmap映射文件并扫描
+ * @param protocols 协议描述表列表, nullptr项为NMEA
+ * @param protocolCount 协议数量
+ * @param fileName 输入文件名
+ * @param threads 线程数量, 0为在线处理器数量
+ * @param maxFrameBytes 最大帧长度
+ * @param printError 错误输出回调
+ * @return 扫描报告, 失败返回nullptr
+ */
+SEMP_SCAN_REPORT * sempScanFile(const SEMP_FRAMING_DESCRIPTOR * const *protocols,
+                                uint8_t protocolCount,
+                                const char *fileName,
+                                uint16_t threads,
+                                uint16_t maxFrameBytes,
+                                SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 输出扫描报告
+ * @param report 扫描报告
+ * @param protocols 扫描使用的协议描述表列表, 用于协议名称
+ * @param maxRegions 最多输出的损坏区域数量
+ * @param print 输出回调
+ */
+void sempScanPrintReport(const SEMP_SCAN_REPORT *report,
+                         const SEMP_FRAMING_DESCRIPTOR * const *protocols,
+                         uint32_t maxRegions,
+                         SEMP_PRINTF_CALLBACK print);
+
+// Free the report and set the pointer to nullptr
+void sempScanFreeReport(SEMP_SCAN_REPORT **report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_SCAN_H
@@ -0,0 +1,310 @@
+/**
+ * @file Message_Snapshot.c
+ * @brief 解析器状态快照与恢复 - 功能实现
+ * @details 快照格式 (多字节字段为小端):
+ *            0  'S' 'P'        标识
+ *            2  version
+ *            3  flags          bit 0 computeCrc, bit 1 validateFrame, bit 2 lazyCrc
+ *            4  stateId        SEMP_STATE_ID
+ *            6  parser_type
+ *            7  parsers_count
+ *            8  verdict
+ *            9  epoch.timeBase
+ *           10  epoch.week
+ *           12  epoch.milliseconds
+ *           16  crc
+ *           20  msg_length
+ *           22  bufferedBytes  保存的帧字节数, 搜索前导符时为0
+ *           24  scratchPadBytes
+ *           26  streamOffset   已分段输出的大帧字节数
+ *           30  暂存区, 部分帧, CRC-32
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stddef.h>
+#include "Message_Snapshot.h"
+#include "Parse_NMEA.h"
+#include "Parse_RTCM.h"
+#include "Parse_UBLOX.h"
+#include "Parse_Unicore_Binary.h"
+#include "Parse_Unicore_Hash.h"
+#include "Message_Framing.h"
+
+#define SEMP_SNAPSHOT_COMPUTE_CRC       0x01
+#define SEMP_SNAPSHOT_VALIDATE_FRAME    0x02
+#define SEMP_SNAPSHOT_LAZY_CRC          0x04
+
+#define SEMP_STATE_ID_UNKNOWN           0xffff
+
+// State tables of the protocols
+static const SEMP_PROTOCOL_STATES * const sempProtocols[] =
+{
+    &sempNmeaProtocolStates,
+    &sempRtcmProtocolStates,
+    &sempUbloxProtocolStates,
+    &sempUnicoreBinaryProtocolStates,
+    &sempUnicoreHashProtocolStates,
+    &sempCustomProtocolStates,
+    &sempFramingProtocolStates,
+};
+static const uint8_t sempProtocolCount = sizeof(sempProtocols) / sizeof(sempProtocols[0]);
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+static void sempPut16(uint8_t *blob, uint16_t value)
+{
+    blob[0] = (uint8_t)value;
+    blob[1] = (uint8_t)(value >> 8);
+}
+
+static void sempPut32(uint8_t *blob, uint32_t value)
+{
+    sempPut16(blob, (uint16_t)value);
+    sempPut16(&blob[2], (uint16_t)(value >> 16));
+}
+
+static uint16_t sempGet16(const uint8_t *blob)
+{
+    return blob[0] | (blob[1] << 8);
+}
+
+static uint32_t sempGet32(const uint8_t *blob)
+{
+    return sempGet16(blob) | ((uint32_t)sempGet16(&blob[2]) << 16);
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// 由协议ID查找状态表
+const SEMP_PROTOCOL_STATES * sempGetProtocolStates(uint8_t protocol)
+{
+    uint8_t index;
+
+    for (index = 0; index < sempProtocolCount; index++)
+        if (sempProtocols[index]->protocol == protocol)
+            return sempProtocols[index];
+    return nullptr;
+}
+
+// 获取稳定状态ID
+uint16_t sempGetStateId(const SEMP_PARSE_STATE *parse)
+{
+    const SEMP_PROTOCOL_STATES *protocol;
+    uint8_t index;
+    uint8_t state;
+
+    if ((!parse) || (parse->state == sempFirstByte))
+        return SEMP_STATE_ID(SEMP_PROTOCOL_NONE, 0);
+    for (index = 0; index < sempProtocolCount; index++)
+    {
+        protocol = sempProtocols[index];
+        for (state = 0; state < protocol->stateCount; state++)
+            if (parse->state == protocol->states[state])
+                return SEMP_STATE_ID(protocol->protocol, state);
+    }
+    return SEMP_STATE_ID_UNKNOWN;
+}
+
+// Translates state value into an ASCII state name
+const char * sempGetStateName(const SEMP_PARSE_STATE *parse)
+{
+    const SEMP_PROTOCOL_STATES *protocol;
+    uint16_t stateId;
+
+    stateId = sempGetStateId(parse);
+    if (stateId == SEMP_STATE_ID(SEMP_PROTOCOL_NONE, 0))
+        return "sempFirstByte";
+    protocol = sempGetProtocolStates(stateId >> 8);
+    if ((stateId == SEMP_STATE_ID_UNKNOWN) || (!protocol))
+        return "Unknown state";
+    return protocol->stateNames[stateId & 0xff];
+}
+
+// 计算快照长度
+size_t sempSnapshotSize(const SEMP_PARSE_STATE *parse)
+{
+    size_t length;
+
+    length = SEMP_SNAPSHOT_HEADER_BYTES + sizeof(SEMP_SCRATCH_PAD) + SEMP_SNAPSHOT_CRC_BYTES;
+    if (parse && (parse->state != sempFirstByte))
+        length += parse->msg_length;
+    return length;
+}
+
+// 保存解析器状态
+size_t sempSnapshotSave(const SEMP_PARSE_STATE *parse, uint8_t *blob, size_t length)
+{
+    uint16_t bufferedBytes;
+    uint16_t stateId;
+    size_t snapshotLength;
+    uint8_t flags;
+
+    if ((!parse) || (!blob))
+        return 0;
+    snapshotLength = sempSnapshotSize(parse);
+    if (length < snapshotLength)
+    {
+        sempPrintf(parse->printError, "SEMP %s: Snapshot needs %d bytes",
+                   parse->config->parserName, (int)snapshotLength);
+        return 0;
+    }
+    stateId = sempGetStateId(parse);
+    if (stateId == SEMP_STATE_ID_UNKNOWN)
+    {
+        sempPrintf(parse->printError, "SEMP %s: Parser state is not in a state table",
+                   parse->config->parserName);
+        return 0;
+    }
+
+    // The frame bytes are only needed while a frame is being parsed
+    bufferedBytes = (parse->state == sempFirstByte) ? 0 : parse->msg_length;
+
+    flags = 0;
+    if (parse->computeCrc)
+        flags |= SEMP_SNAPSHOT_COMPUTE_CRC;
+    if (parse->validateFrame)
+        flags |= SEMP_SNAPSHOT_VALIDATE_FRAME;
+    if (parse->lazyCrc)
+        flags |= SEMP_SNAPSHOT_LAZY_CRC;
+
+    blob[0] = 'S';
+    blob[1] = 'P';
+    blob[2] = SEMP_SNAPSHOT_VERSION;
+    blob[3] = flags;
+    sempPut16(&blob[4], stateId);
+    blob[6] = parse->parser_type;
+    blob[7] = parse->config->parsers_count;
+    blob[8] = parse->verdict;
+    blob[9] = parse->epoch.timeBase;
+    sempPut16(&blob[10], parse->epoch.week);
+    sempPut32(&blob[12], parse->epoch.milliseconds);
+    sempPut32(&blob[16], parse->crc);
+    sempPut16(&blob[20], parse->msg_length);
+    sempPut16(&blob[22], bufferedBytes);
+    sempPut16(&blob[24], sizeof(SEMP_SCRATCH_PAD));
+    sempPut32(&blob[26], parse->streamOffset);
+    memcpy(&blob[SEMP_SNAPSHOT_HEADER_BYTES], parse->scratchPad, sizeof(SEMP_SCRATCH_PAD));
+    memcpy(&blob[SEMP_SNAPSHOT_HEADER_BYTES + sizeof(SEMP_SCRATCH_PAD)],
+           parse->buffer, bufferedBytes);
+
+    // The descriptor address is only valid in this process, the restore
+    // finds the descriptor again in its parsers table
+    if ((stateId >> 8) == SEMP_PROTOCOL_FRAMING)
+        memset(&blob[SEMP_SNAPSHOT_HEADER_BYTES + offsetof(SEMP_SCRATCH_PAD, framing.descriptor)],
+               0, sizeof(((SEMP_SCRATCH_PAD *)nullptr)->framing.descriptor));
+
+    // Protect the snapshot while it travels to the other worker
+    sempPut32(&blob[snapshotLength - SEMP_SNAPSHOT_CRC_BYTES],
+              ~semp_util_crc32(0xffffffff, blob, snapshotLength - SEMP_SNAPSHOT_CRC_BYTES));
+    return snapshotLength;
+}
+
+// 由快照恢复解析器状态
+bool sempSnapshotRestore(SEMP_PARSE_STATE *parse, const uint8_t *blob, size_t length)
+{
+    const SEMP_FRAMING_DESCRIPTOR *descriptor;
+    const SEMP_PROTOCOL_STATES *protocol;
+    SEMP_SCRATCH_PAD scratchPad;
+    uint16_t bufferedBytes;
+    uint16_t msgLength;
+    uint32_t streamOffset;
+    uint16_t stateId;
+    uint8_t parserType;
+    uint8_t flags;
+
+    if ((!parse) || (!blob))
+        return false;
+
+    // Verify the format and the integrity of the snapshot
+    if ((length < (SEMP_SNAPSHOT_HEADER_BYTES + SEMP_SNAPSHOT_CRC_BYTES))
+        || (blob[0] != 'S') || (blob[1] != 'P'))
+    {
+        sempPrintf(parse->printError, "SEMP %s: Not a parser snapshot", parse->config->parserName);
+        return false;
+    }
+    if (blob[2] != SEMP_SNAPSHOT_VERSION)
+    {
+        sempPrintf(parse->printError, "SEMP %s: Snapshot version %d not supported",
+                   parse->config->parserName, blob[2]);
+        return false;
+    }
+    bufferedBytes = sempGet16(&blob[22]);
+    if ((sempGet16(&blob[24]) != sizeof(SEMP_SCRATCH_PAD))
+        || (length != (SEMP_SNAPSHOT_HEADER_BYTES + sizeof(SEMP_SCRATCH_PAD)
+                       + bufferedBytes + SEMP_SNAPSHOT_CRC_BYTES))
+        || (sempGet32(&blob[length - SEMP_SNAPSHOT_CRC_BYTES])
+            != ~semp_util_crc32(0xffffffff, blob, length - SEMP_SNAPSHOT_CRC_BYTES)))
+    {
+        sempPrintf(parse->printError, "SEMP %s: Snapshot is damaged", parse->config->parserName);
+        return false;
+    }
+
+    // The parsers table must match the one used by the source parser
+    flags = blob[3];
+    stateId = sempGet16(&blob[4]);
+    parserType = blob[6];
+    msgLength = sempGet16(&blob[20]);
+    streamOffset = sempGet32(&blob[26]);
+    protocol = nullptr;
+    if (stateId != SEMP_STATE_ID(SEMP_PROTOCOL_NONE, 0))
+    {
+        protocol = sempGetProtocolStates(stateId >> 8);
+        if ((!protocol) || ((stateId & 0xff) >= protocol->stateCount)
+            || (parserType >= parse->config->parsers_count)
+            || (protocol->preamble && (parse->config->parsers_table[parserType] != protocol->preamble)))
+        {
+            sempPrintf(parse->printError, "SEMP %s: Snapshot state 0x%04x does not match the parsers table",
+                       parse->config->parserName, stateId);
+            return false;
+        }
+    }
+    if ((blob[7] != parse->config->parsers_count) || (msgLength > parse->buffer_length)
+        || (bufferedBytes > msgLength) || (streamOffset && (!parse->chunkCallback)))
+    {
+        sempPrintf(parse->printError, "SEMP %s: Snapshot does not fit this parser",
+                   parse->config->parserName);
+        return false;
+    }
+
+    // A described protocol gets its descriptor from this parsers table
+    memcpy(&scratchPad, &blob[SEMP_SNAPSHOT_HEADER_BYTES], sizeof(SEMP_SCRATCH_PAD));
+    descriptor = nullptr;
+    if (protocol && (protocol->protocol == SEMP_PROTOCOL_FRAMING))
+    {
+        descriptor = sempFramingReplay(parse, parserType,
+                                       &blob[SEMP_SNAPSHOT_HEADER_BYTES + sizeof(SEMP_SCRATCH_PAD)],
+                                       bufferedBytes, &scratchPad);
+        if (!descriptor)
+        {
+            sempPrintf(parse->printError, "SEMP %s: Snapshot state 0x%04x does not match the parsers table",
+                       parse->config->parserName, stateId);
+            return false;
+        }
+    }
+
+    // Resume the frame
+    parse->state = protocol ? protocol->states[stateId & 0xff] : sempFirstByte;
+    parse->computeCrc = (protocol && (flags & SEMP_SNAPSHOT_COMPUTE_CRC))
+                      ? protocol->computeCrc : nullptr;
+    parse->validateFrame = (protocol && (flags & SEMP_SNAPSHOT_VALIDATE_FRAME))
+                         ? (descriptor ? descriptor->validateFrame : protocol->validateFrame)
+                         : nullptr;
+    parse->lazyCrc = (flags & SEMP_SNAPSHOT_LAZY_CRC) != 0;
+    parse->parser_type = parserType;
+    parse->verdict = blob[8];
+    parse->epoch.timeBase = blob[9];
+    parse->epoch.week = sempGet16(&blob[10]);
+    parse->epoch.milliseconds = sempGet32(&blob[12]);
+    parse->crc = sempGet32(&blob[16]);
+    parse->msg_length = msgLength;
+    parse->streamOffset = streamOffset;
+    memcpy(parse->scratchPad, &scratchPad, sizeof(SEMP_SCRATCH_PAD));
+    memcpy(parse->buffer, &blob[SEMP_SNAPSHOT_HEADER_BYTES + sizeof(SEMP_SCRATCH_PAD)],
+           bufferedBytes);
+    return true;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file Message_Snapshot.h
+ * @brief 解析器状态快照与恢复 - 头文件
+ * @details 将解析中的数据流从一个解析器迁移到另一个线程或进程的解析器,
+ *          帧可在任意字节处切断. 快照为带版本号的紧凑数据块: 当前状态以
+ *          稳定的状态ID保存而非函数指针, 另含暂存区、CRC、msg_length
+ *          和已缓存的部分帧. 恢复后继续输入剩余字节, 结果与未迁移时相同.
+ *          暂存区按本机字节序保存, 快照只在相同架构的程序之间交换.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_SNAPSHOT_H
+#define MESSAGE_SNAPSHOT_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_SNAPSHOT_VERSION           2
+#define SEMP_SNAPSHOT_HEADER_BYTES      30  // Fixed fields before the scratch pad
+#define SEMP_SNAPSHOT_CRC_BYTES         4   // Trailing CRC-32 of the snapshot
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 获取解析器当前状态的稳定状态ID
+ * @param parse 解析器
+ * @return SEMP_STATE_ID(protocol, index), 状态不在任何状态表中时返回0xffff
+ */
+uint16_t sempGetStateId(const SEMP_PARSE_STATE *parse);
+
+/**
+ * @brief 由协议ID查找协议的状态表
+ * @param protocol SEMP_PROTOCOL_ID
+ * @return 状态表, 未知协议返回nullptr
+ */
+const SEMP_PROTOCOL_STATES * sempGetProtocolStates(uint8_t protocol);
+
+/**
+ * @brief 计算快照所需的字节数
+ * @param parse 解析器
+ * @return 快照长度
+ */
+size_t sempSnapshotSize(const SEMP_PARSE_STATE *parse);
+
+/**
+ * @brief 保存解析器状态
+ * @param parse 解析器, 在两次sempParseNextByte之间调用
+ * @param blob 快照输出缓冲区
+ * @param length 缓冲区长度, 至少sempSnapshotSize字节
+ * @return 快照长度, 失败时返回0
+ */
+size_t sempSnapshotSave(const SEMP_PARSE_STATE *parse, uint8_t *blob, size_t length);
+
+/**
+ * @brief 由快照恢复解析器状态
+ * @param parse 目标解析器, 使用与源解析器相同的解析器表创建
+ * @param blob 快照
+ * @param length 快照长度
+ * @return 恢复成功返回true, 版本、CRC、解析器表或缓冲区大小不匹配时返回false
+ */
+bool sempSnapshotRestore(SEMP_PARSE_STATE *parse, const uint8_t *blob, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_SNAPSHOT_H
@@ -0,0 +1,482 @@
+/**
+ * @file Message_Split.c
+ * @brief 按协议拆分原始数据文件 - 功能实现
+ * @details sempParseBuffer在帧结束时帧字节一定是本次输入中最后的msg_length个
+ *          字节, 二进制帧由sempGetFrameInput直接引用输入. 文本语句由解析器
+ *          统一以CR LF结尾, 输入中的语句以CR LF结尾时同样引用输入. 其余的帧
+ *          复制到输出的复制区, 与引用输入的帧按原顺序一起写出.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#define _GNU_SOURCE     // O_DIRECT
+#include "Message_Split.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+//----------------------------------------
+// 内部类型
+//----------------------------------------
+
+typedef struct _SEMP_SPLIT_OUTPUT
+{
+    int fd;                     // Output file descriptor, -1 discards the frames
+    bool owned;                 // Opened by sempSplitOpenOutput
+    bool direct;                // O_DIRECT, frames go to the aligned staging
+    bool failed;                // Write error, no more output
+    uint16_t count;             // Entries in the batch
+    struct iovec iov[SEMP_SPLIT_MAX_BATCH]; // Frame references
+    uint8_t *copy;              // Copied frames or the aligned O_DIRECT staging
+    uint32_t copyLength;        // Bytes used in the copy area
+    uint8_t *staging;           // O_DIRECT staging allocation
+    SEMP_SPLIT_STATS stats;
+} SEMP_SPLIT_OUTPUT;
+
+struct _SEMP_SPLIT
+{
+    SEMP_PARSE_STATE *parse;
+    uint32_t copyBytes;             // Size of each copy area
+    uint16_t outputCount;           // One output per protocol
+    SEMP_PRINTF_CALLBACK printError;
+    SEMP_SPLIT_OUTPUT *outputs;
+};
+
+//----------------------------------------
+// 内部函数
+//----------------------------------------
+
+// Handle a write error
+static void sempSplitWriteFailed(SEMP_SPLIT *split, SEMP_SPLIT_OUTPUT *output)
+{
+    sempPrintf(split->printError, "SEMP: Split output fd %d write failed, errno %d",
+               output->fd, errno);
+    output->failed = true;
+}
+
+// Write the bytes, retrying partial writes
+static void sempSplitWrite(SEMP_SPLIT *split,
+                           SEMP_SPLIT_OUTPUT *output,
+                           const uint8_t *data,
+                           size_t length)
+{
+    ssize_t bytes;
+
+    while (length && (!output->failed))
+    {
+        bytes = write(output->fd, data, length);
+        if (bytes < 0)
+        {
+            if (errno != EINTR)
+                sempSplitWriteFailed(split, output);
+            continue;
+        }
+        output->stats.writes++;
+        data += bytes;
+        length -= bytes;
+    }
+}
+
+// Write the batch with writev, the frame bytes are not copied
+static void sempSplitFlush(SEMP_SPLIT *split, SEMP_SPLIT_OUTPUT *output)
+{
+    struct iovec *iov = output->iov;
+    int count = output->count;
+    ssize_t bytes;
+
+    while (count && (!output->failed))
+    {
+        bytes = writev(output->fd, iov, count);
+        if (bytes < 0)
+        {
+            if (errno != EINTR)
+                sempSplitWriteFailed(split, output);
+            continue;
+        }
+        output->stats.writes++;
+
+        // Skip the written entries, continue within a partly written one
+        while (count && ((size_t)bytes >= iov->iov_len))
+        {
+            bytes -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + bytes;
+            iov->iov_len -= bytes;
+        }
+    }
+    output->count = 0;
+    output->copyLength = 0;
+}
+
+// Write the complete blocks of the O_DIRECT staging
+static void sempSplitFlushDirect(SEMP_SPLIT *split, SEMP_SPLIT_OUTPUT *output)
+{
+    uint32_t blocks;
+
+    blocks = output->copyLength & ~(SEMP_SPLIT_DIRECT_BLOCK - 1);
+    if (!blocks)
+        return;
+    sempSplitWrite(split, output, output->copy, blocks);
+
+    // Keep the partial block for the next write
+    output->copyLength -= blocks;
+    memmove(output->copy, &output->copy[blocks], output->copyLength);
+}
+
+// Get the frame bytes in the input, nullptr when the frame must be copied
+static const uint8_t * sempSplitFrameInput(SEMP_PARSE_STATE *parse)
+{
+    const uint8_t *frame;
+
+    frame = sempGetFrameInput(parse);
+    if (frame || (!parse->inputByte))
+        return frame;
+
+    // Text sentences end with the line feed when the input holds CR LF
+    frame = parse->inputByte + 1 - parse->msg_length;
+    if ((frame < parse->inputStart) || memcmp(frame, parse->buffer, parse->msg_length))
+        return nullptr;
+    return frame;
+}
+
+// Add the validated frame to the output of its protocol
+static void sempSplitEomCallback(SEMP_PARSE_STATE *parse, uint16_t type)
+{
+    SEMP_SPLIT *split = (SEMP_SPLIT *)parse->userContext;
+    SEMP_SPLIT_OUTPUT *output = &split->outputs[type];
+    const uint8_t *data;
+    SEMP_FRAME frame;
+    struct iovec *previous;
+
+    // The CRC is checked once here with the span routine
+    sempGetFrame(parse, type, &frame);
+    if (!sempFrameValidate(&frame))
+    {
+        output->stats.badFrames++;
+        return;
+    }
+    output->stats.frames++;
+    output->stats.bytes += frame.length;
+    if ((output->fd < 0) || output->failed)
+        return;
+
+    // O_DIRECT needs aligned buffers and lengths, copy into the staging
+    if (output->direct)
+    {
+        if ((output->copyLength + frame.length) > SEMP_SPLIT_DIRECT_BYTES)
+            sempSplitFlushDirect(split, output);
+        memcpy(&output->copy[output->copyLength], frame.buffer, frame.length);
+        output->copyLength += frame.length;
+        output->stats.copiedFrames++;
+        return;
+    }
+
+    // Reference the frame in the input, copy the others once.  A flush
+    // empties the copy area, flush a full batch before copying.
+    if (output->count >= SEMP_SPLIT_MAX_BATCH)
+        sempSplitFlush(split, output);
+    data = sempSplitFrameInput(parse);
+    if (!data)
+    {
+        if ((output->copyLength + frame.length) > split->copyBytes)
+            sempSplitFlush(split, output);
+        data = &output->copy[output->copyLength];
+        memcpy(&output->copy[output->copyLength], frame.buffer, frame.length);
+        output->copyLength += frame.length;
+        output->stats.copiedFrames++;
+    }
+
+    // Extend the previous entry when the frames are adjacent
+    if (output->count)
+    {
+        previous = &output->iov[output->count - 1];
+        if (((uint8_t *)previous->iov_base + previous->iov_len) == data)
+        {
+            previous->iov_len += frame.length;
+            return;
+        }
+    }
+    output->iov[output->count].iov_base = (void *)data;
+    output->iov[output->count].iov_len = frame.length;
+    output->count++;
+}
+
+// Write the data left in the O_DIRECT staging
+static void sempSplitFinishDirect(SEMP_SPLIT *split, SEMP_SPLIT_OUTPUT *output)
+{
+    if ((!output->direct) || output->failed)
+        return;
+    sempSplitFlushDirect(split, output);
+
+    // The last partial block is written without O_DIRECT
+#ifdef O_DIRECT
+    if (output->copyLength)
+        fcntl(output->fd, F_SETFL, fcntl(output->fd, F_GETFL) & ~O_DIRECT);
+#endif  // O_DIRECT
+    sempSplitWrite(split, output, output->copy, output->copyLength);
+    output->copyLength = 0;
+}
+
+// Close the file opened by sempSplitOpenOutput
+static void sempSplitCloseOutput(SEMP_SPLIT_OUTPUT *output)
+{
+    if (output->owned && (output->fd >= 0))
+        close(output->fd);
+    if (output->staging)
+        semp_util_free(output->staging);
+    output->fd = -1;
+    output->owned = false;
+    output->direct = false;
+    output->failed = false;
+    output->staging = nullptr;
+    output->copyLength = 0;
+}
+
+//----------------------------------------
+// API函数实现
+//----------------------------------------
+
+// Allocate the splitter
+SEMP_SPLIT * sempSplitBegin(const SEMP_PARSE_ROUTINE *parseTable,
+                            uint16_t parserCount,
+                            const char * const *parserNames,
+                            uint16_t parserNameCount,
+                            size_t bufferLength,
+                            SEMP_PRINTF_CALLBACK printError)
+{
+    SEMP_SPLIT *split;
+    uint32_t copyBytes;
+    size_t bytes;
+    uint16_t index;
+
+    if ((!parseTable) || (!parserCount))
+    {
+        sempPrintln(printError, "SEMP: Please specify the split parsers table");
+        return nullptr;
+    }
+    copyBytes = SEMP_SPLIT_COPY_BYTES;
+    if (copyBytes < bufferLength)
+        copyBytes = (uint32_t)bufferLength;
+
+    // Allocate the splitter, the outputs and their copy areas together
+    bytes = SEMP_ALIGN(sizeof(SEMP_SPLIT))
+          + (parserCount * (SEMP_ALIGN(sizeof(SEMP_SPLIT_OUTPUT)) + SEMP_ALIGN(copyBytes)));
+    split = (SEMP_SPLIT *)semp_util_malloc(bytes);
+    if (!split)
+    {
+        sempPrintln(printError, "SEMP: Failed to allocate the splitter");
+        return nullptr;
+    }
+    memset(split, 0, sizeof(*split));
+    split->outputs = (SEMP_SPLIT_OUTPUT *)((uint8_t *)split + SEMP_ALIGN(sizeof(SEMP_SPLIT)));
+    for (index = 0; index < parserCount; index++)
+    {
+        memset(&split->outputs[index], 0, sizeof(SEMP_SPLIT_OUTPUT));
+        split->outputs[index].fd = -1;
+        split->outputs[index].copy = (uint8_t *)&split->outputs[parserCount]
+                                   + (index * SEMP_ALIGN(copyBytes));
+    }
+    split->outputCount = parserCount;
+    split->copyBytes = copyBytes;
+    split->printError = printError;
+
+    // Frame by length, validate once with the span routine
+    split->parse = sempBeginParser("Split", parseTable, parserCount,
+                                   parserNames, parserNameCount, 0,
+                                   bufferLength, sempSplitEomCallback,
+                                   printError, nullptr, nullptr);
+    if (!split->parse)
+    {
+        semp_util_free(split);
+        return nullptr;
+    }
+    split->parse->userContext = split;
+    sempEnableLazyValidation(split->parse, true);
+    return split;
+}
+
+// Write the frames of the protocol to the file descriptor
+bool sempSplitSetOutput(SEMP_SPLIT *split, uint16_t protocol, int fd)
+{
+    SEMP_SPLIT_OUTPUT *output;
+
+    if ((!split) || (protocol >= split->outputCount))
+        return false;
+    output = &split->outputs[protocol];
+    if (output->direct)
+        sempSplitFinishDirect(split, output);
+    else
+        sempSplitFlush(split, output);
+    sempSplitCloseOutput(output);
+    output->copy = (uint8_t *)&split->outputs[split->outputCount]
+                 + (protocol * SEMP_ALIGN(split->copyBytes));
+    output->fd = fd;
+    return true;
+}
+
+// Create the output file of the protocol
+bool sempSplitOpenOutput(SEMP_SPLIT *split,
+                         uint16_t protocol,
+                         const char *fileName,
+                         bool direct)
+{
+    SEMP_SPLIT_OUTPUT *output;
+    uintptr_t address;
+    int flags;
+    int fd;
+
+    if ((!split) || (!fileName) || (protocol >= split->outputCount))
+        return false;
+
+    flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if (direct)
+        flags |= O_DIRECT;
+#else
+    if (direct)
+    {
+        sempPrintln(split->printError, "SEMP: O_DIRECT is not supported");
+        return false;
+    }
+#endif  // O_DIRECT
+    fd = open(fileName, flags, 0644);
+    if (fd < 0)
+    {
+        sempPrintf(split->printError, "SEMP: Failed to create %s, errno %d", fileName, errno);
+        return false;
+    }
+    sempSplitSetOutput(split, protocol, fd);
+    output = &split->outputs[protocol];
+    output->owned = true;
+    if (!direct)
+        return true;
+
+    // Allocate the block aligned staging
+    output->staging = (uint8_t *)semp_util_malloc(SEMP_SPLIT_DIRECT_BYTES
+                                                  + SEMP_SPLIT_DIRECT_BLOCK);
+    if (!output->staging)
+    {
+        sempPrintln(split->printError, "SEMP: Failed to allocate the O_DIRECT staging");
+        sempSplitCloseOutput(output);
+        return false;
+    }
+    address = ((uintptr_t)output->staging + SEMP_SPLIT_DIRECT_BLOCK - 1)
+            & ~(uintptr_t)(SEMP_SPLIT_DIRECT_BLOCK - 1);
+    output->copy = (uint8_t *)address;
+    output->direct = true;
+    return true;
+}
+
+// Split the input data
+bool sempSplitInput(SEMP_SPLIT *split, const uint8_t *data, size_t length)
+{
+    bool success = true;
+    uint16_t index;
+
+    if ((!split) || (!data))
+        return false;
+
+    sempParseBuffer(split->parse, data, length);
+
+    // The data is reused after return, write the references now
+    for (index = 0; index < split->outputCount; index++)
+    {
+        if (!split->outputs[index].direct)
+            sempSplitFlush(split, &split->outputs[index]);
+        if (split->outputs[index].failed)
+            success = false;
+    }
+    return success;
+}
+
+// Map the input file and split it
+bool sempSplitFile(SEMP_SPLIT *split, const char *fileName)
+{
+    struct stat status;
+    bool success;
+    void *map;
+    int fd;
+
+    if ((!split) || (!fileName))
+        return false;
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        sempPrintf(split->printError, "SEMP: Failed to open %s, errno %d", fileName, errno);
+        return false;
+    }
+    if (fstat(fd, &status))
+    {
+        sempPrintf(split->printError, "SEMP: Failed to read the size of %s, errno %d",
+                   fileName, errno);
+        close(fd);
+        return false;
+    }
+    if (!status.st_size)
+    {
+        close(fd);
+        return true;
+    }
+
+    // The frames are written straight from the mapped pages
+    map = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        sempPrintf(split->printError, "SEMP: Failed to map %s, errno %d", fileName, errno);
+        return false;
+    }
+    madvise(map, status.st_size, MADV_SEQUENTIAL);
+    success = sempSplitInput(split, (const uint8_t *)map, status.st_size);
+    munmap(map, status.st_size);
+    return success;
+}
+
+// Write the data left in the O_DIRECT staging
+bool sempSplitFinish(SEMP_SPLIT *split)
+{
+    SEMP_SPLIT_OUTPUT *output;
+    bool success = true;
+    uint16_t index;
+
+    if (!split)
+        return false;
+    for (index = 0; index < split->outputCount; index++)
+    {
+        output = &split->outputs[index];
+        sempSplitFinishDirect(split, output);
+        if (output->failed)
+            success = false;
+    }
+    return success;
+}
+
+// Read the statistics of a protocol
+void sempSplitGetStats(SEMP_SPLIT *split, uint16_t protocol, SEMP_SPLIT_STATS *stats)
+{
+    if (split && stats && (protocol < split->outputCount))
+        *stats = split->outputs[protocol].stats;
+}
+
+// Free the splitter
+void sempSplitStop(SEMP_SPLIT **split)
+{
+    uint16_t index;
+
+    if (split && *split)
+    {
+        sempSplitFinish(*split);
+        for (index = 0; index < (*split)->outputCount; index++)
+            sempSplitCloseOutput(&(*split)->outputs[index]);
+        sempStopParser(&(*split)->parse);
+        semp_util_free(*split);
+        *split = nullptr;
+    }
+}
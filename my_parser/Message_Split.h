@@ -0,0 +1,130 @@
+/**
+ * @file Message_Split.h
+ * @brief 按协议拆分原始数据文件 - 头文件
+ * @details 把接收机混合记录文件拆分为每个协议一个文件 (RTCM、UBX、NMEA等).
+ *          解析器表中的每个协议对应一个输出, 校验通过的帧以引用的形式加入
+ *          该输出的iovec批次, 再以writev批量写出. 数据流中相邻的同协议帧
+ *          合并为一个iovec.
+ *          - 输入文件以mmap映射, 帧字节直接从映射写出, 用户空间不复制
+ *          - 跨越两次sempSplitInput调用的帧从解析器缓冲区复制一次
+ *          - 可选O_DIRECT输出: 帧复制到按块对齐的暂存区, 整块写出,
+ *            文件末尾不足一块的部分在结束时以普通方式写出
+ *          - 校验失败的帧和没有输出的协议只计数, 不写出
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#ifndef MESSAGE_SPLIT_H
+#define MESSAGE_SPLIT_H
+
+#include "Message_Parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------
+// 配置常量
+//----------------------------------------
+
+#define SEMP_SPLIT_MAX_BATCH        1024                // iovecs per writev, IOV_MAX
+#define SEMP_SPLIT_COPY_BYTES       (64 * 1024)         // Copied frames per output
+#define SEMP_SPLIT_DIRECT_BLOCK     4096                // O_DIRECT alignment
+#define SEMP_SPLIT_DIRECT_BYTES     (1024 * 1024)       // O_DIRECT staging per output
+
+//----------------------------------------
+// 类型定义
+//----------------------------------------
+
+typedef struct _SEMP_SPLIT SEMP_SPLIT;
+
+// Per protocol statistics
+typedef struct _SEMP_SPLIT_STATS
+{
+    uint64_t frames;            // Frames written or discarded without an output
+    uint64_t bytes;             // Bytes of those frames
+    uint64_t badFrames;         // Frames failing the CRC, not written
+    uint64_t copiedFrames;      // Frames copied: split across inputs or O_DIRECT
+    uint64_t writes;            // writev and write calls
+} SEMP_SPLIT_STATS;
+
+//----------------------------------------
+// API函数声明
+//----------------------------------------
+
+/**
+ * @brief 分配拆分器
+ * @param parseTable 解析器表, 表索引即协议编号
+ * @param parserCount 解析器数量
+ * @param parserNames 解析器名称
+ * @param parserNameCount 名称数量
+ * @param bufferLength 解析器缓冲区大小, 最大帧长度
+ * @param printError 错误输出回调
+ * @return 拆分器指针, 失败返回nullptr
+ */
+SEMP_SPLIT * sempSplitBegin(const SEMP_PARSE_ROUTINE *parseTable,
+                            uint16_t parserCount,
+                            const char * const *parserNames,
+                            uint16_t parserNameCount,
+                            size_t bufferLength,
+                            SEMP_PRINTF_CALLBACK printError);
+
+/**
+ * @brief 把协议的帧写入已打开的文件描述符, 拆分器不关闭该描述符
+ * @param split 拆分器
+ * @param protocol 协议, 解析器表索引
+ * @param fd 输出文件描述符, -1表示丢弃该协议的帧
+ * @return 成功返回true
+ */
+bool sempSplitSetOutput(SEMP_SPLIT *split, uint16_t protocol, int fd);
+
+/**
+ * @brief 创建协议的输出文件, 由sempSplitStop关闭
+ * @param split 拆分器
+ * @param protocol 协议, 解析器表索引
+ * @param fileName 输出文件名, 已存在时截断
+ * @param direct true时以O_DIRECT写入, 不支持时返回失败
+ * @return 成功返回true
+ */
+bool sempSplitOpenOutput(SEMP_SPLIT *split,
+                         uint16_t protocol,
+                         const char *fileName,
+                         bool direct);
+
+/**
+ * @brief 拆分一段输入数据
+ * @details 返回前引用该数据的批次均已写出, 调用者随后可复用数据缓冲区
+ * @param split 拆分器
+ * @param data 输入数据
+ * @param length 数据长度
+ * @return 所有输出均正常返回true
+ */
+bool sempSplitInput(SEMP_SPLIT *split, const uint8_t *data, size_t length);
+
+/**
+ * @brief 以mmap映射输入文件并拆分
+ * @param split 拆分器
+ * @param fileName 输入文件名
+ * @return 所有输出均正常返回true
+ */
+bool sempSplitFile(SEMP_SPLIT *split, const char *fileName);
+
+/**
+ * @brief 写出O_DIRECT暂存区中剩余的数据, 输入结束后调用
+ * @param split 拆分器
+ * @return 所有输出均正常返回true
+ */
+bool sempSplitFinish(SEMP_SPLIT *split);
+
+// Read the statistics of a protocol
+void sempSplitGetStats(SEMP_SPLIT *split, uint16_t protocol, SEMP_SPLIT_STATS *stats);
+
+// Finish, close the files opened by sempSplitOpenOutput, free the splitter
+// and set the pointer to nullptr
+void sempSplitStop(SEMP_SPLIT **split);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGE_SPLIT_H
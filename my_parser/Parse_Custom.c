@@ -19,6 +19,19 @@ static uint32_t sempCustomComputeCrc(SEMP_PARSE_STATE *parse, uint8_t data)
     return crc;
 }
 
+// 校验整帧CRC (同步字节到消息数据末尾)
+bool sempCustomValidate(const uint8_t *buffer, uint16_t length)
+{
+    uint32_t crc;
+    uint32_t crcRx;
+
+    if (length < (sizeof(SEMP_CUSTOM_HEADER) + 4))
+        return false;
+    crc = semp_util_crc32(0xFFFFFFFF, buffer, length - 4) ^ 0xFFFFFFFF;
+    memcpy(&crcRx, &buffer[length - 4], sizeof(crcRx));
+    return (crc == crcRx);
+}
+
 static bool sempCustomReadCrc(SEMP_PARSE_STATE *parse, uint8_t data)
 {
     SEMP_SCRATCH_PAD *scratchPad = (SEMP_SCRATCH_PAD *)parse->scratchPad;
@@ -32,14 +45,20 @@ static bool sempCustomReadCrc(SEMP_PARSE_STATE *parse, uint8_t data)
     
     // uint32_t crcComputed = scratchPad->bluetooth.crc;
     // Call the end-of-message routine with this message
-    if ((!parse->crc) || (parse->badCrc && (!parse->badCrc(parse))))
-        parse->eomCallback(parse, parse->parser_type); // Pass parser array index
+    if (parse->lazyCrc)
+    {
+        // Framed by length only, the CRC is checked by sempValidateFrame
+        parse->verdict = SEMP_FRAME_UNVALIDATED;
+        sempEndOfFrame(parse);
+    }
+    else if ((!parse->crc) || (parse->config->badCrc && (!parse->config->badCrc(parse))))
+        sempEndOfFrame(parse); // Pass parser array index
     else
     {
         sempPrintf(parse->printDebug,
                    "SEMP: %s Unicore, bad CRC, "
                    "received %02x %02x %02x %02x, computed: %02x %02x %02x %02x",
-                   parse->parserName,
+                   parse->config->parserName,
                    parse->buffer[parse->msg_length - 4],
                    parse->buffer[parse->msg_length - 3],
                    parse->buffer[parse->msg_length - 2],
@@ -76,6 +95,17 @@ static bool sempCustomReadHeader(SEMP_PARSE_STATE *parse, uint8_t data)
     {
         SEMP_CUSTOM_HEADER *header = (SEMP_CUSTOM_HEADER *)parse->buffer;
         scratchPad->custom.bytesRemaining = header->messageLength;
+
+        // Verify that the message fits in the buffer, larger messages are
+        // streamed when the chunk callback is set
+        if (((uint32_t)(sizeof(SEMP_CUSTOM_HEADER) + header->messageLength + 4) > parse->buffer_length)
+            && (!parse->chunkCallback))
+        {
+            sempPrintf(parse->printDebug, "SEMP %s: Custom invalid length %d",
+                       parse->config->parserName, header->messageLength);
+            sempResync(parse);
+            return false;
+        }
         parse->state = sempCustomReadData;
     }
     return true;
@@ -109,7 +139,38 @@ bool sempCustomPreamble(SEMP_PARSE_STATE *parse, uint8_t data)
     // Look for the second sync byte
     parse->crc = 0xFFFFFFFF;
     parse->computeCrc = sempCustomComputeCrc;
+    parse->validateFrame = sempCustomValidate;
     parse->crc = parse->computeCrc(parse, data);
     parse->state = sempCustomSync2;
     return true;
-} 
\ No newline at end of file
+}
+
+// 状态表, 快照中以表索引保存状态, 新状态只能追加在表尾
+static const SEMP_PARSE_ROUTINE sempCustomStates[] =
+{
+    sempCustomSync2,
+    sempCustomSync3,
+    sempCustomReadHeader,
+    sempCustomReadData,
+    sempCustomReadCrc,
+};
+
+static const char * const sempCustomStateNames[] =
+{
+    "sempCustomSync2",
+    "sempCustomSync3",
+    "sempCustomReadHeader",
+    "sempCustomReadData",
+    "sempCustomReadCrc",
+};
+
+const SEMP_PROTOCOL_STATES sempCustomProtocolStates =
+{
+    SEMP_PROTOCOL_CUSTOM,
+    sempCustomPreamble,
+    sempCustomComputeCrc,
+    sempCustomValidate,
+    sempCustomStates,
+    sempCustomStateNames,
+    sizeof(sempCustomStates) / sizeof(sempCustomStates[0]),
+};
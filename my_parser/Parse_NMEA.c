@@ -24,6 +24,41 @@ static bool sempNmeaChecksumByte1(SEMP_PARSE_STATE *parse, uint8_t data);
 static bool sempNmeaFindAsterisk(SEMP_PARSE_STATE *parse, uint8_t data);
 static bool sempNmeaFindFirstComma(SEMP_PARSE_STATE *parse, uint8_t data);
 
+// 提取字段1中的UTC时间 hhmmss[.ss]
+static void sempNmeaEpoch(SEMP_PARSE_STATE *parse)
+{
+    SEMP_SCRATCH_PAD *scratchPad = (SEMP_SCRATCH_PAD *)parse->scratchPad;
+    const uint8_t *field;
+    uint32_t milliseconds;
+    uint8_t digits[6];
+    int index;
+
+    // Field 1 follows the preamble, the sentence name and the comma
+    field = &parse->buffer[1 + scratchPad->nmea.sentenceNameLength + 1];
+    if ((field + 7) > &parse->buffer[parse->msg_length])
+        return;
+    for (index = 0; index < 6; index++)
+    {
+        digits[index] = field[index] - '0';
+        if (digits[index] > 9)
+            return;
+    }
+    milliseconds = ((((digits[0] * 10 + digits[1]) * 60
+                   + (digits[2] * 10 + digits[3])) * 60
+                   + (digits[4] * 10 + digits[5])) * 1000);
+
+    // Hundredths of a second
+    if ((field[6] == '.') && ((uint8_t)(field[7] - '0') <= 9))
+    {
+        milliseconds += (field[7] - '0') * 100;
+        if ((uint8_t)(field[8] - '0') <= 9)
+            milliseconds += (field[8] - '0') * 10;
+    }
+    parse->epoch.milliseconds = milliseconds;
+    parse->epoch.week = SEMP_EPOCH_NO_WEEK;
+    parse->epoch.timeBase = SEMP_EPOCH_UTC_TOD;
+}
+
 // 验证校验和
 static void sempNmeaValidateChecksum(SEMP_PARSE_STATE *parse)
 {
@@ -35,7 +70,7 @@ static void sempNmeaValidateChecksum(SEMP_PARSE_STATE *parse)
     checksum |= semp_util_asciiToNibble(parse->buffer[parse->msg_length - 1]);
 
     // 验证校验和
-    if ((checksum == parse->crc) || (parse->badCrc && (!parse->badCrc(parse))))
+    if ((checksum == parse->crc) || (parse->config->badCrc && (!parse->config->badCrc(parse))))
     {
         // 添加回车和换行符
         parse->buffer[parse->msg_length++] = '\r';
@@ -44,15 +79,18 @@ static void sempNmeaValidateChecksum(SEMP_PARSE_STATE *parse)
         // 添加字符串结束符
         parse->buffer[parse->msg_length] = 0;
 
+        // 提取时间标签
+        sempNmeaEpoch(parse);
+
         // 调用EOM回调
-        parse->eomCallback(parse, parse->parser_type);
+        sempEndOfFrame(parse);
     }
     else
     {
         // 打印校验和错误信息
         sempPrintf(parse->printDebug,
                    "SEMP: %s NMEA %s, 0x%04x (%d) bytes, bad checksum, received 0x%c%c, computed: 0x%02x",
-                   parse->parserName,
+                   parse->config->parserName,
                    scratchPad->nmea.sentenceName,
                    parse->msg_length, parse->msg_length,
                    parse->buffer[parse->msg_length - 2],
@@ -122,7 +160,7 @@ static bool sempNmeaChecksumByte2(SEMP_PARSE_STATE *parse, uint8_t data)
         return true;
     }
 
-    sempPrintf(parse->printDebug, "SEMP %s: NMEA invalid second checksum character", parse->parserName);
+    sempPrintf(parse->printDebug, "SEMP %s: NMEA invalid second checksum character", parse->config->parserName);
     return sempFirstByte(parse, data);
 }
 
@@ -135,7 +173,7 @@ static bool sempNmeaChecksumByte1(SEMP_PARSE_STATE *parse, uint8_t data)
         return true;
     }
     
-    sempPrintf(parse->printDebug, "SEMP %s: NMEA invalid first checksum character", parse->parserName);
+    sempPrintf(parse->printDebug, "SEMP %s: NMEA invalid first checksum character", parse->config->parserName);
     return sempFirstByte(parse, data);
 }
 
@@ -151,7 +189,7 @@ static bool sempNmeaFindAsterisk(SEMP_PARSE_STATE *parse, uint8_t data)
         parse->crc ^= data; // 包含在校验和计算中
         if ((uint32_t)(parse->msg_length + NMEA_BUFFER_OVERHEAD) > parse->buffer_length)
         {
-            sempPrintf(parse->printDebug, "SEMP %s: NMEA sentence too long, increase buffer size > %d", parse->parserName, parse->buffer_length);
+            sempPrintf(parse->printDebug, "SEMP %s: NMEA sentence too long, increase buffer size > %d", parse->config->parserName, parse->buffer_length);
             return sempFirstByte(parse, data);
         }
     }
@@ -169,13 +207,13 @@ static bool sempNmeaFindFirstComma(SEMP_PARSE_STATE *parse, uint8_t data)
         uint8_t upper = data & ~0x20;
         if (((upper < 'A') || (upper > 'Z')) && ((data < '0') || (data > '9')))
         {
-            sempPrintf(parse->printDebug, "SEMP %s: NMEA invalid sentence name character 0x%02x", parse->parserName, data);
+            sempPrintf(parse->printDebug, "SEMP %s: NMEA invalid sentence name character 0x%02x", parse->config->parserName, data);
             return sempFirstByte(parse, data);
         }
 
         if (scratchPad->nmea.sentenceNameLength == (sizeof(scratchPad->nmea.sentenceName) - 1))
         {
-            sempPrintf(parse->printDebug, "SEMP %s: NMEA sentence name > %ld characters", parse->parserName, sizeof(scratchPad->nmea.sentenceName) - 1);
+            sempPrintf(parse->printDebug, "SEMP %s: NMEA sentence name > %ld characters", parse->config->parserName, sizeof(scratchPad->nmea.sentenceName) - 1);
             return sempFirstByte(parse, data);
         }
         
@@ -205,4 +243,38 @@ bool sempNmeaPreamble(SEMP_PARSE_STATE *parse, uint8_t data)
 
     parse->state = sempNmeaFindFirstComma;
     return true;
-} 
\ No newline at end of file
+}
+
+// 状态表, 快照中以表索引保存状态, 新状态只能追加在表尾
+static const SEMP_PARSE_ROUTINE sempNmeaStates[] =
+{
+    sempNmeaFindFirstComma,
+    sempNmeaFindAsterisk,
+    sempNmeaChecksumByte1,
+    sempNmeaChecksumByte2,
+    sempNmeaLineTermination,
+    sempNmeaCarriageReturn,
+    sempNmeaLineFeed,
+};
+
+static const char * const sempNmeaStateNames[] =
+{
+    "sempNmeaFindFirstComma",
+    "sempNmeaFindAsterisk",
+    "sempNmeaChecksumByte1",
+    "sempNmeaChecksumByte2",
+    "sempNmeaLineTermination",
+    "sempNmeaCarriageReturn",
+    "sempNmeaLineFeed",
+};
+
+const SEMP_PROTOCOL_STATES sempNmeaProtocolStates =
+{
+    SEMP_PROTOCOL_NMEA,
+    sempNmeaPreamble,
+    nullptr,
+    nullptr,
+    sempNmeaStates,
+    sempNmeaStateNames,
+    sizeof(sempNmeaStates) / sizeof(sempNmeaStates[0]),
+};
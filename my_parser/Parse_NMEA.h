@@ -27,6 +27,9 @@ extern "C" {
  */
 bool sempNmeaPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
 
+// 状态表, 用于解析器快照和状态名称
+extern const SEMP_PROTOCOL_STATES sempNmeaProtocolStates;
+
 #ifdef __cplusplus
 }
 #endif
@@ -18,6 +18,79 @@ static uint32_t sempRtcmComputeCrc24q(SEMP_PARSE_STATE *parse, uint8_t data)
     return crc & 0x00ffffff;
 }
 
+// 计算一段数据的CRC-24Q
+uint32_t sempRtcmCrc24q(const uint8_t *buffer, uint16_t length)
+{
+    const uint8_t *end = buffer + length;
+    uint32_t crc = 0;
+
+    while (buffer < end)
+        crc = (crc << 8) ^ semp_crc24qTable[*buffer++ ^ ((crc >> 16) & 0xff)];
+    return crc & 0x00ffffff;
+}
+
+// 校验整帧CRC (前导符到CRC字节)
+bool sempRtcmValidate(const uint8_t *buffer, uint16_t length)
+{
+    // The CRC over the message including the CRC bytes is zero
+    return (sempRtcmCrc24q(buffer, length) == 0);
+}
+
+// 按位读取字段 (高位在前)
+uint32_t sempRtcmGetBits(const uint8_t *buffer, uint32_t bitOffset, uint8_t bits)
+{
+    uint32_t lastBit = bitOffset + bits - 1;
+    uint32_t index;
+    uint64_t value = 0;
+
+    // Gather the bytes holding the field, at most five
+    for (index = bitOffset >> 3; index <= (lastBit >> 3); index++)
+        value = (value << 8) | buffer[index];
+
+    // Drop the bits following the field and those preceding it
+    value >>= 7 - (lastBit & 7);
+    return (uint32_t)(value & ((1ull << bits) - 1));
+}
+
+// 提取观测电文的历元时间, 消息号已在帧头解析时得到
+static void sempRtcmEpoch(SEMP_PARSE_STATE *parse, uint16_t message)
+{
+    // Message number 12 bits, reference station 12 bits, then the epoch
+    const uint32_t epochBit = 24 + 12 + 12;
+
+    // The header of a streamed message is no longer in the buffer
+    if (parse->streamOffset || (parse->msg_length < ((epochBit + 30 + 7) / 8)))
+        return;
+
+    // GLONASS observations and MSM, day of week (MSM) and time of day
+    if (((message >= 1009) && (message <= 1012))
+        || ((message >= 1081) && (message <= 1087)))
+    {
+        parse->epoch.milliseconds = sempRtcmGetBits(parse->buffer,
+                                                    epochBit + ((message >= 1081) ? 3 : 0),
+                                                    27);
+        parse->epoch.timeBase = SEMP_EPOCH_GLONASS_TOD;
+    }
+
+    // BeiDou MSM, BeiDou time of week
+    else if ((message >= 1121) && (message <= 1127))
+    {
+        parse->epoch.milliseconds = sempRtcmGetBits(parse->buffer, epochBit, 30);
+        parse->epoch.timeBase = SEMP_EPOCH_BDS_TOW;
+    }
+
+    // GPS observations and GPS, Galileo, SBAS, QZSS and NavIC MSM
+    else if (((message >= 1001) && (message <= 1004))
+             || ((message >= 1071) && (message <= 1077))
+             || ((message >= 1091) && (message <= 1117))
+             || ((message >= 1131) && (message <= 1137)))
+    {
+        parse->epoch.milliseconds = sempRtcmGetBits(parse->buffer, epochBit, 30);
+        parse->epoch.timeBase = SEMP_EPOCH_GPS_TOW;
+    }
+    parse->epoch.week = SEMP_EPOCH_NO_WEEK;
+}
+
 //----------------------------------------
 // RTCM 解析状态机函数
 //----------------------------------------
@@ -38,15 +111,21 @@ static bool sempRtcmReadCrc(SEMP_PARSE_STATE *parse, uint8_t data)
     if (scratchPad->rtcm.bytesRemaining > 0)
         return true;
 
-    if ((parse->crc == 0) || (parse->badCrc && (!parse->badCrc(parse))))
+    if (parse->lazyCrc)
     {
-        parse->eomCallback(parse, parse->parser_type);
+        // Framed by length only, the CRC is checked by sempValidateFrame
+        parse->verdict = SEMP_FRAME_UNVALIDATED;
+        sempEndOfFrame(parse);
+    }
+    else if ((parse->crc == 0) || (parse->config->badCrc && (!parse->config->badCrc(parse))))
+    {
+        sempEndOfFrame(parse);
     }
     else
     {
         sempPrintf(parse->printDebug,
                    "SEMP: %s RTCM %d, 0x%04x (%d) bytes, bad CRC, computed: %06x",
-                   parse->parserName,
+                   parse->config->parserName,
                    scratchPad->rtcm.message,
                    parse->msg_length, parse->msg_length,
                    scratchPad->rtcm.crc);
@@ -64,6 +143,7 @@ static bool sempRtcmReadData(SEMP_PARSE_STATE *parse, uint8_t data)
 
     if (scratchPad->rtcm.bytesRemaining <= 0)
     {
+        sempRtcmEpoch(parse, scratchPad->rtcm.message);
         scratchPad->rtcm.crc = parse->crc;
         scratchPad->rtcm.bytesRemaining = 3;
         parse->state = sempRtcmReadCrc;
@@ -96,6 +176,18 @@ static bool sempRtcmReadLength2(SEMP_PARSE_STATE *parse, uint8_t data)
 {
     SEMP_SCRATCH_PAD *scratchPad = (SEMP_SCRATCH_PAD *)parse->scratchPad;
     scratchPad->rtcm.bytesRemaining |= data;
+
+    // Verify the message number fits and the message fits in the buffer,
+    // larger messages are streamed when the chunk callback is set
+    if ((scratchPad->rtcm.bytesRemaining < 2)
+        || (((uint32_t)(scratchPad->rtcm.bytesRemaining + 6) > parse->buffer_length)
+            && (!parse->chunkCallback)))
+    {
+        sempPrintf(parse->printDebug, "SEMP %s: RTCM invalid length %d",
+                   parse->config->parserName, scratchPad->rtcm.bytesRemaining);
+        sempResync(parse);
+        return false;
+    }
     parse->state = sempRtcmReadMessage1;
     return true;
 }
@@ -119,9 +211,42 @@ bool sempRtcmPreamble(SEMP_PARSE_STATE *parse, uint8_t data)
     if (data == 0xd3)
     {
         parse->computeCrc = sempRtcmComputeCrc24q;
+        parse->validateFrame = sempRtcmValidate;
         parse->crc = parse->computeCrc(parse, data);
         parse->state = sempRtcmReadLength1;
         return true;
     }
     return false;
-} 
\ No newline at end of file
+}
+
+// 状态表, 快照中以表索引保存状态, 新状态只能追加在表尾
+static const SEMP_PARSE_ROUTINE sempRtcmStates[] =
+{
+    sempRtcmReadLength1,
+    sempRtcmReadLength2,
+    sempRtcmReadMessage1,
+    sempRtcmReadMessage2,
+    sempRtcmReadData,
+    sempRtcmReadCrc,
+};
+
+static const char * const sempRtcmStateNames[] =
+{
+    "sempRtcmReadLength1",
+    "sempRtcmReadLength2",
+    "sempRtcmReadMessage1",
+    "sempRtcmReadMessage2",
+    "sempRtcmReadData",
+    "sempRtcmReadCrc",
+};
+
+const SEMP_PROTOCOL_STATES sempRtcmProtocolStates =
+{
+    SEMP_PROTOCOL_RTCM,
+    sempRtcmPreamble,
+    sempRtcmComputeCrc24q,
+    sempRtcmValidate,
+    sempRtcmStates,
+    sempRtcmStateNames,
+    sizeof(sempRtcmStates) / sizeof(sempRtcmStates[0]),
+};
@@ -14,6 +14,9 @@
 extern "C" {
 #endif
 
+// Preamble, length, 1023 byte maximum message and CRC-24Q
+#define SEMP_RTCM_MAX_FRAME_BYTES       (3 + 1023 + 3)
+
 //----------------------------------------
 // RTCM解析器前导函数
 //----------------------------------------
@@ -27,6 +30,40 @@ extern "C" {
  */
 bool sempRtcmPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
 
+// CRC-24Q lookup table, defined in Parse_RTCM.c
+extern const unsigned int semp_crc24qTable[256];
+
+/**
+ * @brief 计算一段数据的CRC-24Q
+ *
+ * @param buffer 数据起始地址
+ * @param length 数据长度
+ * @return 24位CRC值
+ */
+uint32_t sempRtcmCrc24q(const uint8_t *buffer, uint16_t length);
+
+/**
+ * @brief 校验完整RTCM帧的CRC-24Q
+ *
+ * @param buffer 帧起始地址 (前导符0xD3)
+ * @param length 帧长度, 包含3字节CRC
+ * @return CRC正确返回true
+ */
+bool sempRtcmValidate(const uint8_t *buffer, uint16_t length);
+
+/**
+ * @brief 从RTCM帧中按位读取无符号字段 (高位在前)
+ *
+ * @param buffer 帧起始地址
+ * @param bitOffset 起始位偏移, 从帧首字节开始计数
+ * @param bits 字段位数 (1 - 32)
+ * @return 字段值
+ */
+uint32_t sempRtcmGetBits(const uint8_t *buffer, uint32_t bitOffset, uint8_t bits);
+
+// 状态表, 用于解析器快照和状态名称
+extern const SEMP_PROTOCOL_STATES sempRtcmProtocolStates;
+
 #ifdef __cplusplus
 }
 #endif
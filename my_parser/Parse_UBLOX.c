@@ -7,6 +7,69 @@
 
 #include "Parse_UBLOX.h"
 
+// 校验整帧的Fletcher校验和 (Class到负载末尾)
+bool sempUbloxValidate(const uint8_t *buffer, uint16_t length)
+{
+    const uint8_t *data;
+    const uint8_t *end;
+    uint8_t ck_a = 0;
+    uint8_t ck_b = 0;
+
+    if (length < 8)
+        return false;
+    end = buffer + length - 2;
+    for (data = buffer + 2; data < end; data++)
+    {
+        ck_a += *data;
+        ck_b += ck_a;
+    }
+    return (end[0] == ck_a) && (end[1] == ck_b);
+}
+
+// NAV messages starting with version and reserved bytes, iTOW at offset 4:
+// NAV-ODO, NAV-HPPOSECEF, NAV-HPPOSLLH, NAV-SVIN, NAV-RELPOSNED
+static const uint8_t sempUbloxNavItowAt4[] = {0x09, 0x13, 0x14, 0x3b, 0x3c};
+
+// NAV消息中iTOW在负载中的偏移
+static uint8_t sempUbloxItowOffset(uint8_t id)
+{
+    uint8_t index;
+
+    for (index = 0; index < sizeof(sempUbloxNavItowAt4); index++)
+        if (id == sempUbloxNavItowAt4[index])
+            return 4;
+    return 0;
+}
+
+// 提取历元时间: NAV类消息的iTOW, RXM-RAWX的rcvTow和week
+static void sempUbloxEpoch(SEMP_PARSE_STATE *parse, uint16_t message)
+{
+    const uint8_t *payload = &parse->buffer[6];
+    uint16_t payloadLength = parse->buffer[4] | (parse->buffer[5] << 8);
+    uint8_t offset;
+    uint32_t iTOW;
+    double rcvTow;
+
+    // The header of a streamed message is no longer in the buffer
+    if (parse->streamOffset)
+        return;
+    offset = sempUbloxItowOffset((uint8_t)message);
+    if (((message >> 8) == 0x01) && (payloadLength >= (offset + 4)))
+    {
+        memcpy(&iTOW, &payload[offset], sizeof(iTOW));
+        parse->epoch.milliseconds = iTOW;
+        parse->epoch.week = SEMP_EPOCH_NO_WEEK;
+        parse->epoch.timeBase = SEMP_EPOCH_GPS_TOW;
+    }
+    else if ((message == 0x0215) && (payloadLength >= 16))
+    {
+        memcpy(&rcvTow, payload, sizeof(rcvTow));
+        parse->epoch.milliseconds = (uint32_t)((rcvTow * 1000.) + 0.5);
+        parse->epoch.week = payload[8] | (payload[9] << 8);
+        parse->epoch.timeBase = SEMP_EPOCH_GPS_TOW;
+    }
+}
+
 //----------------------------------------
 // u-blox 解析状态机函数 (前向声明)
 //----------------------------------------
@@ -28,15 +91,21 @@ static bool sempUbloxCkB(SEMP_PARSE_STATE *parse, uint8_t data)
 
     bool badChecksum = (parse->buffer[parse->msg_length - 2] != scratchPad->ublox.ck_a) || (parse->buffer[parse->msg_length - 1] != scratchPad->ublox.ck_b);
 
-    if (!badChecksum || (parse->badCrc && !parse->badCrc(parse)))
+    if (parse->lazyCrc)
     {
-        parse->eomCallback(parse, parse->parser_type);
+        // Framed by length only, the checksum is checked by sempValidateFrame
+        parse->verdict = SEMP_FRAME_UNVALIDATED;
+        sempEndOfFrame(parse);
+    }
+    else if (!badChecksum || (parse->config->badCrc && !parse->config->badCrc(parse)))
+    {
+        sempEndOfFrame(parse);
     }
     else
     {
         sempPrintf(parse->printDebug,
                    "SEMP %s: UBLOX bad checksum received 0x%02x%02x computed 0x%02x%02x",
-                   parse->parserName,
+                   parse->config->parserName,
                    parse->buffer[parse->msg_length - 2], parse->buffer[parse->msg_length - 1],
                    scratchPad->ublox.ck_a, scratchPad->ublox.ck_b);
     }
@@ -49,6 +118,9 @@ static bool sempUbloxCkB(SEMP_PARSE_STATE *parse, uint8_t data)
 // 读取CK_A字节
 static bool sempUbloxCkA(SEMP_PARSE_STATE *parse, uint8_t data)
 {
+    SEMP_SCRATCH_PAD *scratchPad = (SEMP_SCRATCH_PAD *)parse->scratchPad;
+
+    sempUbloxEpoch(parse, scratchPad->ublox.message);
     parse->state = sempUbloxCkB;
     return true;
 }
@@ -60,8 +132,11 @@ static bool sempUbloxPayload(SEMP_PARSE_STATE *parse, uint8_t data)
 
     if (scratchPad->ublox.bytesRemaining--)
     {
-        scratchPad->ublox.ck_a += data;
-        scratchPad->ublox.ck_b += scratchPad->ublox.ck_a;
+        if (!parse->lazyCrc)
+        {
+            scratchPad->ublox.ck_a += data;
+            scratchPad->ublox.ck_b += scratchPad->ublox.ck_a;
+        }
         return true;
     }
     return sempUbloxCkA(parse, data);
@@ -76,6 +151,17 @@ static bool sempUbloxLength2(SEMP_PARSE_STATE *parse, uint8_t data)
     scratchPad->ublox.ck_b += scratchPad->ublox.ck_a;
 
     scratchPad->ublox.bytesRemaining |= ((uint16_t)data) << 8;
+
+    // Verify that the message fits in the buffer, larger messages are
+    // streamed when the chunk callback is set
+    if (((uint32_t)(scratchPad->ublox.bytesRemaining + 8) > parse->buffer_length)
+        && (!parse->chunkCallback))
+    {
+        sempPrintf(parse->printDebug, "SEMP %s: UBLOX invalid length %d",
+                   parse->config->parserName, scratchPad->ublox.bytesRemaining);
+        sempResync(parse);
+        return false;
+    }
     parse->state = sempUbloxPayload;
     return true;
 }
@@ -124,7 +210,7 @@ static bool sempUbloxSync2(SEMP_PARSE_STATE *parse, uint8_t data)
 {
     if (data != 0x62)
     {
-        sempPrintf(parse->printDebug, "SEMP %s: UBLOX invalid second sync byte", parse->parserName);
+        sempPrintf(parse->printDebug, "SEMP %s: UBLOX invalid second sync byte", parse->config->parserName);
         return sempFirstByte(parse, data);
     }
     parse->state = sempUbloxClass;
@@ -138,6 +224,43 @@ bool sempUbloxPreamble(SEMP_PARSE_STATE *parse, uint8_t data)
     {
         return false;
     }
+    parse->validateFrame = sempUbloxValidate;
     parse->state = sempUbloxSync2;
     return true;
-} 
\ No newline at end of file
+}
+
+// 状态表, 快照中以表索引保存状态, 新状态只能追加在表尾
+static const SEMP_PARSE_ROUTINE sempUbloxStates[] =
+{
+    sempUbloxSync2,
+    sempUbloxClass,
+    sempUbloxId,
+    sempUbloxLength1,
+    sempUbloxLength2,
+    sempUbloxPayload,
+    sempUbloxCkA,
+    sempUbloxCkB,
+};
+
+static const char * const sempUbloxStateNames[] =
+{
+    "sempUbloxSync2",
+    "sempUbloxClass",
+    "sempUbloxId",
+    "sempUbloxLength1",
+    "sempUbloxLength2",
+    "sempUbloxPayload",
+    "sempUbloxCkA",
+    "sempUbloxCkB",
+};
+
+const SEMP_PROTOCOL_STATES sempUbloxProtocolStates =
+{
+    SEMP_PROTOCOL_UBLOX,
+    sempUbloxPreamble,
+    nullptr,
+    sempUbloxValidate,
+    sempUbloxStates,
+    sempUbloxStateNames,
+    sizeof(sempUbloxStates) / sizeof(sempUbloxStates[0]),
+};
@@ -27,6 +27,18 @@ extern "C" {
  */
 bool sempUbloxPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
 
+/**
+ * @brief 校验完整UBX帧的Fletcher校验和
+ *
+ * @param buffer 帧起始地址 (同步字符0xB5)
+ * @param length 帧长度, 包含2字节校验和
+ * @return 校验和正确返回true
+ */
+bool sempUbloxValidate(const uint8_t *buffer, uint16_t length);
+
+// 状态表, 用于解析器快照和状态名称
+extern const SEMP_PROTOCOL_STATES sempUbloxProtocolStates;
+
 #ifdef __cplusplus
 }
 #endif
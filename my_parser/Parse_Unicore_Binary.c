@@ -13,8 +13,25 @@
 //----------------------------------------
 static uint32_t sempUnicoreBinaryComputeCrc(SEMP_PARSE_STATE *parse, uint8_t data)
 {
-    // 复用主解析器中的CRC32计算
-    // return semp_computeCrc32(parse, data);
+    uint32_t crc;
+
+    // 复用主解析器中的CRC32查找表
+    crc = parse->crc;
+    crc = semp_crc32Table[(crc ^ data) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+// 校验整帧CRC (前导符到消息数据末尾)
+bool sempUnicoreBinaryValidate(const uint8_t *buffer, uint16_t length)
+{
+    uint32_t crc;
+    uint32_t crcRx;
+
+    if (length < (sizeof(SEMP_UNICORE_HEADER) + 4))
+        return false;
+    crc = semp_util_crc32(0, buffer, length - 4);
+    memcpy(&crcRx, &buffer[length - 4], sizeof(crcRx));
+    return (crc == crcRx);
 }
 
 //----------------------------------------
@@ -34,13 +51,19 @@ static bool sempUnicoreBinaryReadCrc(SEMP_PARSE_STATE *parse, uint8_t data)
     if (--scratchPad->unicoreBinary.bytesRemaining)
         return true;
 
-    if ((!parse->crc) || (parse->badCrc && (!parse->badCrc(parse))))
+    if (parse->lazyCrc)
+    {
+        // Framed by length only, the CRC is checked by sempValidateFrame
+        parse->verdict = SEMP_FRAME_UNVALIDATED;
+        sempEndOfFrame(parse);
+    }
+    else if ((!parse->crc) || (parse->config->badCrc && (!parse->config->badCrc(parse))))
     {
-        parse->eomCallback(parse, parse->parser_type);
+        sempEndOfFrame(parse);
     }
     else
     {
-        sempPrintf(parse->printDebug, "SEMP: %s Unicore, bad CRC", parse->parserName);
+        sempPrintf(parse->printDebug, "SEMP: %s Unicore, bad CRC", parse->config->parserName);
     }
     
     parse->state = sempFirstByte;
@@ -70,6 +93,23 @@ static bool sempUnicoreBinaryReadHeader(SEMP_PARSE_STATE *parse, uint8_t data)
     {
         SEMP_UNICORE_HEADER *header = (SEMP_UNICORE_HEADER *)parse->buffer;
         scratchPad->unicoreBinary.bytesRemaining = header->messageLength;
+
+        // Capture the time tag, referenceTime 0: GPST, 1: BDST
+        parse->epoch.milliseconds = header->secondsOfWeek;
+        parse->epoch.week = header->weekNumber;
+        parse->epoch.timeBase = header->referenceTime ? SEMP_EPOCH_BDS_TOW
+                                                      : SEMP_EPOCH_GPS_TOW;
+
+        // Verify that the message fits in the buffer, larger messages are
+        // streamed when the chunk callback is set
+        if (((uint32_t)(sizeof(SEMP_UNICORE_HEADER) + header->messageLength + 4) > parse->buffer_length)
+            && (!parse->chunkCallback))
+        {
+            sempPrintf(parse->printDebug, "SEMP %s: Unicore invalid length %d",
+                       parse->config->parserName, header->messageLength);
+            sempResync(parse);
+            return false;
+        }
         parse->state = sempUnicoreBinaryReadData;
     }
     return true;
@@ -103,7 +143,38 @@ bool sempUnicoreBinaryPreamble(SEMP_PARSE_STATE *parse, uint8_t data)
 
     parse->crc = 0;
     parse->computeCrc = sempUnicoreBinaryComputeCrc;
+    parse->validateFrame = sempUnicoreBinaryValidate;
     parse->crc = parse->computeCrc(parse, data);
     parse->state = sempUnicoreBinarySync2;
     return true;
-} 
\ No newline at end of file
+}
+
+// 状态表, 快照中以表索引保存状态, 新状态只能追加在表尾
+static const SEMP_PARSE_ROUTINE sempUnicoreBinaryStates[] =
+{
+    sempUnicoreBinarySync2,
+    sempUnicoreBinarySync3,
+    sempUnicoreBinaryReadHeader,
+    sempUnicoreBinaryReadData,
+    sempUnicoreBinaryReadCrc,
+};
+
+static const char * const sempUnicoreBinaryStateNames[] =
+{
+    "sempUnicoreBinarySync2",
+    "sempUnicoreBinarySync3",
+    "sempUnicoreBinaryReadHeader",
+    "sempUnicoreBinaryReadData",
+    "sempUnicoreBinaryReadCrc",
+};
+
+const SEMP_PROTOCOL_STATES sempUnicoreBinaryProtocolStates =
+{
+    SEMP_PROTOCOL_UNICORE_BINARY,
+    sempUnicoreBinaryPreamble,
+    sempUnicoreBinaryComputeCrc,
+    sempUnicoreBinaryValidate,
+    sempUnicoreBinaryStates,
+    sempUnicoreBinaryStateNames,
+    sizeof(sempUnicoreBinaryStates) / sizeof(sempUnicoreBinaryStates[0]),
+};
@@ -27,6 +27,18 @@ extern "C" {
  */
 bool sempUnicoreBinaryPreamble(SEMP_PARSE_STATE *parse, uint8_t data);
 
+/**
+ * @brief 校验完整和芯星通二进制帧的CRC32
+ *
+ * @param buffer 帧起始地址 (同步字符0xAA)
+ * @param length 帧长度, 包含4字节CRC
+ * @return CRC正确返回true
+ */
+bool sempUnicoreBinaryValidate(const uint8_t *buffer, uint16_t length);
+
+// 状态表, 用于解析器快照和状态名称
+extern const SEMP_PROTOCOL_STATES sempUnicoreBinaryProtocolStates;
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,12 +40,12 @@ static void sempUnicoreHashValidateCrc(SEMP_PARSE_STATE *parse)
     }
 
     if (crc != crcRx) {
-        sempPrintf(parse->printDebug, "SEMP: %s Unicore hash (#) %s, bad CRC", parse->parserName, scratchPad->unicoreHash.sentenceName);
+        sempPrintf(parse->printDebug, "SEMP: %s Unicore hash (#) %s, bad CRC", parse->config->parserName, scratchPad->unicoreHash.sentenceName);
         return;
     }
 
     if ((uint32_t)(parse->msg_length + UNICORE_HASH_BUFFER_OVERHEAD) > parse->buffer_length) {
-        sempPrintf(parse->printDebug, "SEMP %s: Unicore hash (#) sentence too long", parse->parserName);
+        sempPrintf(parse->printDebug, "SEMP %s: Unicore hash (#) sentence too long", parse->config->parserName);
         parse->state = sempFirstByte;
         return;
     }
@@ -54,7 +54,7 @@ static void sempUnicoreHashValidateCrc(SEMP_PARSE_STATE *parse)
     parse->buffer[parse->msg_length++] = '\n';
     parse->buffer[parse->msg_length] = 0;
 
-    parse->eomCallback(parse, parse->parser_type);
+    sempEndOfFrame(parse);
 }
 
 static void sempUnicoreHashValidateChecksum(SEMP_PARSE_STATE *parse)
@@ -68,13 +68,13 @@ static void sempUnicoreHashValidateChecksum(SEMP_PARSE_STATE *parse)
 
     uint32_t checksum = (semp_util_asciiToNibble(parse->buffer[parse->msg_length - 2]) << 4) | semp_util_asciiToNibble(parse->buffer[parse->msg_length - 1]);
 
-    if ((checksum == parse->crc) || (parse->badCrc && (!parse->badCrc(parse)))) {
+    if ((checksum == parse->crc) || (parse->config->badCrc && (!parse->config->badCrc(parse)))) {
         parse->buffer[parse->msg_length++] = '\r';
         parse->buffer[parse->msg_length++] = '\n';
         parse->buffer[parse->msg_length] = 0;
-        parse->eomCallback(parse, parse->parser_type);
+        sempEndOfFrame(parse);
     } else {
-        sempPrintf(parse->printDebug, "SEMP: %s Unicore hash (#) %s, bad checksum", parse->parserName, scratchPad->unicoreHash.sentenceName);
+        sempPrintf(parse->printDebug, "SEMP: %s Unicore hash (#) %s, bad checksum", parse->config->parserName, scratchPad->unicoreHash.sentenceName);
     }
 }
 
@@ -122,7 +122,7 @@ static bool sempUnicoreHashChecksumByte(SEMP_PARSE_STATE *parse, uint8_t data)
     scratchPad->unicoreHash.bytesRemaining--;
 
     if (semp_util_asciiToNibble(parse->buffer[parse->msg_length - 1]) < 0) {
-        sempPrintf(parse->printDebug, "SEMP %s: Unicore hash (#) invalid checksum character", parse->parserName);
+        sempPrintf(parse->printDebug, "SEMP %s: Unicore hash (#) invalid checksum character", parse->config->parserName);
         return sempFirstByte(parse, data);
     }
 
@@ -140,7 +140,7 @@ static bool sempUnicoreHashFindAsterisk(SEMP_PARSE_STATE *parse, uint8_t data)
     } else {
         parse->crc ^= data;
         if ((uint32_t)(parse->msg_length + UNICORE_HASH_BUFFER_OVERHEAD) > parse->buffer_length) {
-            sempPrintf(parse->printDebug, "SEMP %s: Unicore hash (#) sentence too long", parse->parserName);
+            sempPrintf(parse->printDebug, "SEMP %s: Unicore hash (#) sentence too long", parse->config->parserName);
             return sempFirstByte(parse, data);
         }
     }
@@ -155,12 +155,12 @@ static bool sempUnicoreHashFindFirstComma(SEMP_PARSE_STATE *parse, uint8_t data)
     if ((data != ',') || (scratchPad->unicoreHash.sentenceNameLength == 0)) {
         uint8_t upper = data & ~0x20;
         if (((upper < 'A') || (upper > 'Z')) && ((data < '0') || (data > '9'))) {
-            sempPrintf(parse->printDebug, "SEMP %s: Unicore hash (#) invalid sentence name character", parse->parserName);
+            sempPrintf(parse->printDebug, "SEMP %s: Unicore hash (#) invalid sentence name character", parse->config->parserName);
             return sempFirstByte(parse, data);
         }
 
         if (scratchPad->unicoreHash.sentenceNameLength == (sizeof(scratchPad->unicoreHash.sentenceName) - 1)) {
-            sempPrintf(parse->printDebug, "SEMP %s: Unicore hash (#) sentence name too long", parse->parserName);
+            sempPrintf(parse->printDebug, "SEMP %s: Unicore hash (#) sentence name too long", parse->config->parserName);
             return sempFirstByte(parse, data);
         }
 
@@ -184,4 +184,36 @@ bool sempUnicoreHashPreamble(SEMP_PARSE_STATE *parse, uint8_t data)
     scratchPad->unicoreHash.sentenceNameLength = 0;
     parse->state = sempUnicoreHashFindFirstComma;
     return true;
-} 
\ No newline at end of file
+}
+
+// 状态表, 快照中以表索引保存状态, 新状态只能追加在表尾
+static const SEMP_PARSE_ROUTINE sempUnicoreHashStates[] =
+{
+    sempUnicoreHashFindFirstComma,
+    sempUnicoreHashFindAsterisk,
+    sempUnicoreHashChecksumByte,
+    sempUnicoreHashLineTermination,
+    sempUnicoreHashCarriageReturn,
+    sempUnicoreHashLineFeed,
+};
+
+static const char * const sempUnicoreHashStateNames[] =
+{
+    "sempUnicoreHashFindFirstComma",
+    "sempUnicoreHashFindAsterisk",
+    "sempUnicoreHashChecksumByte",
+    "sempUnicoreHashLineTermination",
+    "sempUnicoreHashCarriageReturn",
+    "sempUnicoreHashLineFeed",
+};
+
+const SEMP_PROTOCOL_STATES sempUnicoreHashProtocolStates =
+{
+    SEMP_PROTOCOL_UNICORE_HASH,
+    sempUnicoreHashPreamble,
+    nullptr,
+    nullptr,
+    sempUnicoreHashStates,
+    sempUnicoreHashStateNames,
+    sizeof(sempUnicoreHashStates) / sizeof(sempUnicoreHashStates[0]),
+};
@@ -0,0 +1,317 @@
+/**
+ * @file adaptive_bench.c
+ * @brief 自适应协议锁定一致性与性能测试程序
+ * @details 对单一协议数据流 (RTCM、UBX、NMEA) 和含错误字节的混合数据流,
+ *          分别在关闭和开启自适应锁定时解析, 比较输出的全部帧, 统计锁定、
+ *          命中和回退次数以及解析速度. 字节预算为0时输出必须完全一致,
+ *          预算大于0时混合数据流中被跳过的字节可能丢失帧.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../Message_Parser.h"
+#include "../Message_NmeaWriter.h"
+#include "../Message_RtcmEncoder.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+#include "../Parse_Unicore_Hash.h"
+
+#define STREAM_BYTES    (256 * 1024)
+#define LOCK_FRAMES     8
+#define BENCH_ROUNDS    40
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+
+// Running hash of the frames a parser outputs
+typedef struct {
+    uint64_t hash;
+    long frames;
+} OutputLog;
+
+static uint8_t g_stream[STREAM_BYTES];
+static size_t g_streamLength;
+
+static void logBytes(OutputLog *log, const void *data, size_t length) {
+    log->hash = semp_util_hash64((const uint8_t *)data, (uint16_t)length, log->hash);
+}
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendRtcm(uint16_t message, uint16_t length) {
+    static uint8_t frame[6 + 1023];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message);
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (frame[4] & 0x0f));
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    appendBytes(frame, 6 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    static uint8_t frame[24 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+static void appendUnicoreHash(const char *body) {
+    char sentence[256];
+    uint32_t crc = semp_util_crc32(0, (const uint8_t *)body, strlen(body));
+    int length = snprintf(sentence, sizeof(sentence), "#%s*%08x\r\n", body, crc);
+    appendBytes(sentence, length);
+}
+
+static void initFix(SEMP_NMEA_FIX *fix) {
+    memset(fix, 0, sizeof(*fix));
+    sempNmeaSetPosition(fix, 40.0583, -105.2153, 1620.5);
+    fix->quality = 4;
+    fix->satellites = 21;
+    fix->hdop = 70;
+}
+
+// RTCM参考站: MSM7观测值与短的站坐标帧
+static void buildRtcmStream(void) {
+    SEMP_RTCM_MSM_OBS obs[12];
+    SEMP_RTCM_MSM msm;
+    uint8_t frame[SEMP_RTCM_MAX_FRAME_BYTES];
+
+    for (int i = 0; i < 12; i++) {
+        memset(&obs[i], 0, sizeof(obs[i]));
+        obs[i].satellite = 3 + i * 2;
+        obs[i].signal = 2;
+        obs[i].pseudorange = 21000000.0 + i * 850123.25;
+        obs[i].phaserange = obs[i].pseudorange + 0.37;
+        obs[i].cnr = 44;
+    }
+    memset(&msm, 0, sizeof(msm));
+    msm.message = 1077;
+    msm.station = 7;
+    msm.obsCount = 12;
+    msm.obs = obs;
+
+    g_streamLength = 0;
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 4096); epoch++) {
+        msm.epochTime = 45296000 + epoch * 1000;
+        appendBytes(frame, sempRtcmEncodeMsm(frame, sizeof(frame), &msm));
+        appendRtcm(1005, 19);
+        appendRtcm(1033, 8);
+    }
+}
+
+// u-blox接收机: 导航解与短的状态帧
+static void buildUbloxStream(void) {
+    g_streamLength = 0;
+    while (g_streamLength < (STREAM_BYTES - 4096)) {
+        appendUblox(0x01, 0x07, 92);
+        appendUblox(0x01, 0x03, 16);
+        appendUblox(0x01, 0x20, 16);
+    }
+}
+
+static void buildNmeaStream(void) {
+    SEMP_NMEA_FIX fix;
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+
+    initFix(&fix);
+    g_streamLength = 0;
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 4096); epoch++) {
+        fix.timeMs = 45296000 + epoch * 1000;
+        appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        appendBytes(sentence, sempNmeaWriteRmc(sentence, sizeof(sentence), "GN", &fix));
+    }
+}
+
+// 以RTCM为主的混合数据流, 含错误字节
+static void buildMixedStream(void) {
+    SEMP_NMEA_FIX fix;
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+    uint32_t seed = 12345;
+
+    initFix(&fix);
+    g_streamLength = 0;
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 8192); epoch++) {
+        fix.timeMs = 45296000 + epoch * 1000;
+        for (int i = 0; i < 12; i++)
+            appendRtcm(1074 + (i % 4) * 10, 40 + i * 9);
+        appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        if ((epoch % 4) == 0) {
+            appendUblox(0x01, 0x07, 92);
+            appendUnicoreBinary(1000 + epoch, 96);
+            appendUnicoreHash("BESTNAVA,COM1,0,72.5,FINESTEERING,2300,1000.000,SOLVED,SINGLE,"
+                              "40.05830000000,-105.21530000000,1620.5000,-17.0000");
+            appendBytes("\x01\x02garbage", 9);
+        }
+    }
+
+    // Corrupt a few bytes for bad CRCs, bad lengths and resynchronization
+    for (int i = 0; i < 100; i++) {
+        seed = seed * 1103515245 + 12345;
+        g_stream[(seed >> 8) % g_streamLength] ^= (uint8_t)(1 << (seed & 7));
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void adaptiveEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    OutputLog *log = (OutputLog *)parse->userContext;
+
+    log->frames++;
+    logBytes(log, &type, sizeof(type));
+    logBytes(log, &parse->msg_length, sizeof(parse->msg_length));
+    logBytes(log, parse->buffer, parse->msg_length);
+}
+
+//----------------------------------------
+// 测试流程
+//----------------------------------------
+static const SEMP_PARSE_ROUTINE g_parsersTable[] = {
+    sempNmeaPreamble,
+    sempRtcmPreamble,
+    sempUbloxPreamble,
+    sempUnicoreBinaryPreamble,
+    sempUnicoreHashPreamble,
+};
+static const char * const g_parserNames[] = {
+    "NMEA", "RTCM3", "u-blox", "Unicore-BIN", "Unicore-HASH"
+};
+#define PARSER_COUNT    (sizeof(g_parsersTable) / sizeof(g_parsersTable[0]))
+
+static double elapsedSeconds(const struct timespec *start) {
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Parse the stream, returns the parse time in ns per byte
+static double runParser(uint16_t lockFrames, uint32_t byteBudget, OutputLog *log,
+                        SEMP_ADAPTIVE_STATS *stats) {
+    SEMP_PARSE_STATE *parse;
+    struct timespec start;
+    OutputLog benchLog;
+    double seconds;
+
+    parse = sempBeginParser("Adaptive", g_parsersTable, PARSER_COUNT, g_parserNames, PARSER_COUNT,
+                            0, 3000, adaptiveEomCallback, NULL, NULL, NULL);
+    if (!parse)
+        return -1;
+    memset(log, 0, sizeof(OutputLog));
+    parse->userContext = log;
+    sempEnableAdaptiveLock(parse, lockFrames, byteBudget);
+    sempParseBuffer(parse, g_stream, g_streamLength);
+    sempGetAdaptiveStats(parse, stats);
+
+    // Time the parser, the stream repeats so the lock state carries over
+    parse->userContext = &benchLog;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+        sempParseBuffer(parse, g_stream, g_streamLength);
+    seconds = elapsedSeconds(&start);
+    sempStopParser(&parse);
+    return seconds * 1e9 / (BENCH_ROUNDS * g_streamLength);
+}
+
+static int compareStream(const char *name, uint32_t byteBudget, bool expectIdentical) {
+    SEMP_ADAPTIVE_STATS stats;
+    OutputLog expected;
+    OutputLog actual;
+    double scanTime;
+    double lockTime;
+    bool identical;
+
+    scanTime = runParser(0, 0, &expected, &stats);
+    lockTime = runParser(LOCK_FRAMES, byteBudget, &actual, &stats);
+    identical = (expected.hash == actual.hash) && (expected.frames == actual.frames);
+    printf("%-6s 预算 %-3u 帧 %6ld / %6ld  锁定 %4u  命中 %6u  回退 %4u  跳过 %6u  "
+           "%.2f -> %.2f ns/字节  %s\n",
+           name, byteBudget, actual.frames, expected.frames,
+           stats.locks, stats.hits, stats.fallbacks, stats.skippedBytes,
+           scanTime, lockTime, identical ? "一致" : "不一致");
+    return (expectIdentical && (!identical)) ? 1 : 0;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  自适应协议锁定测试 v1.0\n");
+    printf("=================================\n");
+    printf("锁定帧数: %d, 速度: 关闭 -> 开启\n", LOCK_FRAMES);
+
+    buildRtcmStream();
+    failures += compareStream("RTCM", 0, true);
+    buildUbloxStream();
+    failures += compareStream("UBX", 0, true);
+    buildNmeaStream();
+    failures += compareStream("NMEA", 0, true);
+    buildMixedStream();
+    failures += compareStream("混合", 0, true);
+    failures += compareStream("混合", 64, false);
+
+    printf("\n--- 自适应协议锁定测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
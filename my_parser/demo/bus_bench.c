@@ -0,0 +1,342 @@
+/**
+ * @file bus_bench.c
+ * @brief 多进程共享内存帧总线测试程序
+ * @details 父进程创建总线并解析RTCM、NMEA、u-blox和Unicore混合数据流,
+ *          把校验通过的帧发布到总线. 两个子进程分别按名称和按文件描述符
+ *          打开总线读取: 快速消费者读取全部帧, 慢速消费者每读若干帧休眠,
+ *          应被写入者覆盖而不是阻塞写入者. 两者读到的每帧都与解析结果比较.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../Message_Parser.h"
+#include "../Message_Bus.h"
+#include "../Message_NmeaWriter.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+
+#define STREAM_BYTES    (8 * 1024 * 1024)
+#define MAX_FRAMES      100000
+#define BUS_FRAMES      2048
+#define BUS_BYTES       (512 * 1024)
+#define SLOW_FRAMES     64          // Frames between the slow reader's naps
+#define SLOW_MICROSECONDS 2000
+
+// Parser table order, the frame types
+#define TYPE_RTCM       0
+#define TYPE_NMEA       1
+#define TYPE_UBLOX      2
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+static uint8_t *g_stream;
+static size_t g_streamLength;
+static uint64_t g_frameHashes[MAX_FRAMES];   // Expected frames, in bus order
+static uint64_t g_frameCount;
+static SEMP_BUS *g_bus;
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendRtcm(uint16_t message, uint16_t length) {
+    static uint8_t frame[6 + 1023];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message);
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (frame[4] & 0x0f));
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    appendBytes(frame, 6 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    static uint8_t frame[24 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+// 混合数据流, 含错误字节
+static void buildStream(void) {
+    SEMP_NMEA_FIX fix;
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+    uint32_t seed = 4242;
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.quality = 4;
+    fix.satellites = 21;
+
+    g_streamLength = 0;
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 16384); epoch++) {
+        seed = seed * 1103515245 + 12345;
+        fix.timeMs = 45296000 + epoch * 100;
+        appendRtcm(1077, 200 + ((seed >> 16) % 400));
+        appendUnicoreBinary(1000 + (epoch & 0xff), 96 + ((seed >> 12) % 200));
+        appendUblox(0x01, 0x07, 92);
+        appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        appendRtcm(1087, 100 + ((seed >> 20) % 300));
+    }
+    for (int i = 0; i < 200; i++) {
+        seed = seed * 1103515245 + 12345;
+        g_stream[(seed >> 4) % g_streamLength] ^= (uint8_t)(1 << (seed & 7));
+    }
+}
+
+//----------------------------------------
+// 帧描述
+//----------------------------------------
+static uint16_t frameMessageId(const SEMP_FRAME *frame) {
+    if (frame->type == TYPE_RTCM)
+        return (uint16_t)sempRtcmGetBits(frame->buffer, 24, 12);
+    if (frame->type == TYPE_UBLOX)
+        return (uint16_t)((frame->buffer[2] << 8) | frame->buffer[3]);
+    if (frame->type == TYPE_NMEA)
+        return 0;
+    return (uint16_t)(frame->buffer[4] | (frame->buffer[5] << 8));
+}
+
+static uint64_t hashFrame(uint16_t stream, uint8_t protocol, uint16_t messageId,
+                          const uint8_t *data, uint16_t length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    hash = (hash ^ stream) * 0x100000001b3ULL;
+    hash = (hash ^ protocol) * 0x100000001b3ULL;
+    hash = (hash ^ messageId) * 0x100000001b3ULL;
+    for (uint16_t i = 0; i < length; i++)
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+
+// Record the expected frames
+void referenceEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    SEMP_FRAME frame;
+
+    sempGetFrame(parse, type, &frame);
+    if ((g_frameCount < MAX_FRAMES) && sempFrameValidate(&frame))
+        g_frameHashes[g_frameCount++] = hashFrame(1, (uint8_t)type, frameMessageId(&frame),
+                                                  frame.buffer, frame.length);
+}
+
+// Publish each frame once
+void publishEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    static uint32_t published;
+    struct timespec now;
+    SEMP_FRAME frame;
+
+    sempGetFrame(parse, type, &frame);
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (sempBusPublish(g_bus, 1, &frame, frameMessageId(&frame),
+                       (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec)
+        && ((++published % 128) == 0))
+        sched_yield();      // Let the readers run on a single core
+}
+
+//----------------------------------------
+// 消费者进程
+//----------------------------------------
+static int readBus(const char *name, int fd, bool slow, int ready) {
+    SEMP_BUS_FRAME frame;
+    SEMP_BUS_STATS stats;
+    SEMP_BUS *bus;
+    uint64_t stale = 0;
+    int mismatches = 0;
+    bool match;
+
+    alarm(60);
+    bus = sempBusOpen(name, fd, false, NULL);
+    if (!bus)
+        return 1;
+    if (write(ready, "r", 1) != 1)
+        return 1;
+    close(ready);
+
+    for (;;) {
+        if (!sempBusRead(bus, &frame)) {
+            sempBusGetStats(bus, &stats);
+            if ((stats.frames + stats.lostFrames) >= g_frameCount)
+                break;
+            sched_yield();
+            continue;
+        }
+
+        // Use the frame in place, then check that it was not overwritten
+        match = (frame.sequence < g_frameCount)
+             && (hashFrame(frame.stream, frame.protocol, frame.messageId, frame.data, frame.length)
+                 == g_frameHashes[frame.sequence]);
+        if (!sempBusFrameValid(bus, &frame))
+            stale++;
+        else if (!match)
+            mismatches++;
+        if (slow && ((frame.sequence % SLOW_FRAMES) == 0))
+            usleep(SLOW_MICROSECONDS);
+    }
+    sempBusGetStats(bus, &stats);
+    sempBusClose(&bus);
+
+    printf("%s消费者 (%s): 读取 %llu 帧, 丢失 %llu, 读取中被覆盖 %llu, 不一致 %d\n",
+           slow ? "慢速" : "快速", name ? "名称" : "文件描述符",
+           (unsigned long long)stats.frames, (unsigned long long)stats.lostFrames,
+           (unsigned long long)stale, mismatches);
+    fflush(stdout);
+    if (mismatches || ((stats.frames + stats.lostFrames) != g_frameCount))
+        return 1;
+    return (slow && (!stats.lostFrames)) ? 1 : 0;
+}
+
+//----------------------------------------
+// 测试流程
+//----------------------------------------
+static const SEMP_PARSE_ROUTINE parsersTable[] = {
+    sempRtcmPreamble, sempNmeaPreamble, sempUbloxPreamble, sempUnicoreBinaryPreamble,
+};
+static const char * const parserNames[] = {"RTCM3", "NMEA", "u-blox", "Unicore-BIN"};
+#define PARSER_COUNT    (sizeof(parsersTable) / sizeof(parsersTable[0]))
+
+static bool parseStream(SEMP_EOM_CALLBACK callback) {
+    SEMP_PARSE_STATE *parse;
+
+    parse = sempBeginParser("Bus", parsersTable, PARSER_COUNT, parserNames, PARSER_COUNT,
+                            0, 3000, callback, NULL, NULL, NULL);
+    if (!parse)
+        return false;
+    sempEnableLazyValidation(parse, true);
+    sempParseBuffer(parse, g_stream, g_streamLength);
+    sempStopParser(&parse);
+    return true;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    char name[64];
+    pid_t readers[2];
+    struct timespec start;
+    struct timespec end;
+    SEMP_BUS_STATS stats;
+    int ready[2];
+    int status;
+    int failures = 0;
+    char byte;
+
+    printf("=================================\n");
+    printf("  共享内存帧总线测试 v1.0\n");
+    printf("=================================\n");
+
+    g_stream = (uint8_t *)malloc(STREAM_BYTES);
+    if (!g_stream)
+        return -1;
+    buildStream();
+    parseStream(referenceEomCallback);
+    printf("数据流 %zu 字节, 有效帧 %llu, 总线 %d 帧 / %d 字节\n", g_streamLength,
+           (unsigned long long)g_frameCount, BUS_FRAMES, BUS_BYTES);
+    fflush(stdout);
+
+    snprintf(name, sizeof(name), "/semp_bus_bench_%d", (int)getpid());
+    g_bus = sempBusCreate(name, BUS_FRAMES, BUS_BYTES, NULL);
+    if ((!g_bus) || pipe(ready))
+        return -1;
+
+    // One reader opens the bus by name, the other by the inherited descriptor
+    for (int i = 0; i < 2; i++) {
+        readers[i] = fork();
+        if (readers[i] == 0) {
+            close(ready[0]);
+            _exit(readBus(i ? NULL : name, sempBusGetFd(g_bus), i == 1, ready[1]));
+        }
+    }
+    close(ready[1]);
+    for (int i = 0; i < 2; i++)
+        if (read(ready[0], &byte, 1) != 1)
+            failures++;
+    close(ready[0]);
+
+    // The writer never waits for the readers
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    parseStream(publishEomCallback);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sempBusGetStats(g_bus, &stats);
+    printf("写入者: 发布 %llu 帧, 拒绝 %llu, %.1f ms\n",
+           (unsigned long long)stats.frames, (unsigned long long)stats.rejectedFrames,
+           (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+    fflush(stdout);
+    if (stats.frames != g_frameCount)
+        failures++;
+
+    for (int i = 0; i < 2; i++) {
+        if ((waitpid(readers[i], &status, 0) != readers[i])
+            || (!WIFEXITED(status)) || WEXITSTATUS(status))
+            failures++;
+    }
+    sempBusClose(&g_bus);
+
+    free(g_stream);
+    printf("\n--- 共享内存帧总线测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * @file crc_bench.c
+ * @brief 多帧批量CRC校验一致性与性能测试程序
+ * @details 以延迟校验模式解析短帧为主的RTCM、Custom和Unicore混合数据流,
+ *          其中部分帧含错误字节. 收集全部帧后分别逐帧调用sempFrameValidate
+ *          和调用sempFrameValidateBatch校验, 比较每帧的结果和校验速度.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../Message_Parser.h"
+#include "../Message_Batch.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+
+#define STREAM_BYTES    (1024 * 1024)
+#define MAX_FRAMES      20000
+#define BENCH_ROUNDS    40
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+static uint8_t g_stream[STREAM_BYTES];
+static size_t g_streamLength;
+static uint8_t g_frameBytes[STREAM_BYTES];
+static size_t g_frameBytesLength;
+static SEMP_FRAME g_frames[MAX_FRAMES];
+static size_t g_frameCount;
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendRtcm(uint16_t message, uint16_t length) {
+    static uint8_t frame[6 + 1023];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message);
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (frame[4] & 0x0f));
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    appendBytes(frame, 6 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    static uint8_t frame[24 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+static void appendCustom(uint16_t id, uint16_t length) {
+    static uint8_t frame[20 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 20);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0x18;
+    frame[3] = 20;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[12] = (uint8_t)length;
+    frame[13] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[20 + i] = (uint8_t)(i * 3 + id);
+    crc = semp_util_crc32(0xffffffff, frame, 20 + length) ^ 0xffffffff;
+    memcpy(&frame[20 + length], &crc, 4);
+    appendBytes(frame, 24 + length);
+}
+
+// 短帧为主的混合数据流, 含错误字节
+static void buildStream(bool custom) {
+    uint32_t seed = 777;
+    int pick;
+
+    g_streamLength = 0;
+    while (g_streamLength < (STREAM_BYTES - 8192)) {
+        seed = seed * 1103515245 + 12345;
+        pick = (seed >> 8) % 100;
+        if (pick < 70)
+            appendRtcm(1074 + ((seed >> 16) % 4) * 10, 10 + ((seed >> 20) % 150));
+        else if (pick < 95) {
+            if (custom)
+                appendCustom((uint16_t)pick, 8 + ((seed >> 20) % 120));
+            else
+                appendUnicoreBinary((uint16_t)pick, 8 + ((seed >> 20) % 120));
+        }
+        else
+            appendUblox(0x01, 0x07, 92);
+    }
+
+    // Corrupt a few bytes for bad CRCs
+    for (int i = 0; i < 300; i++) {
+        seed = seed * 1103515245 + 12345;
+        g_stream[(seed >> 8) % g_streamLength] ^= (uint8_t)(1 << (seed & 7));
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+
+// Keep a copy of each frame, the parser reuses its buffer
+void crcEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    SEMP_FRAME *frame;
+
+    if ((g_frameCount >= MAX_FRAMES)
+        || ((g_frameBytesLength + parse->msg_length) > sizeof(g_frameBytes)))
+        return;
+    frame = &g_frames[g_frameCount++];
+    sempGetFrame(parse, type, frame);
+    memcpy(&g_frameBytes[g_frameBytesLength], parse->buffer, parse->msg_length);
+    frame->buffer = &g_frameBytes[g_frameBytesLength];
+    g_frameBytesLength += parse->msg_length;
+}
+
+//----------------------------------------
+// 测试流程
+//----------------------------------------
+static double elapsedSeconds(const struct timespec *start) {
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void resetVerdicts(void) {
+    for (size_t i = 0; i < g_frameCount; i++)
+        g_frames[i].verdict = SEMP_FRAME_UNVALIDATED;
+}
+
+static int runStream(bool custom) {
+    static const SEMP_PARSE_ROUTINE unicoreTable[] = {
+        sempRtcmPreamble, sempUbloxPreamble, sempUnicoreBinaryPreamble,
+    };
+    static const SEMP_PARSE_ROUTINE customTable[] = {
+        sempRtcmPreamble, sempUbloxPreamble, sempCustomPreamble,
+    };
+    static const char * const unicoreNames[] = {"RTCM3", "u-blox", "Unicore-BIN"};
+    static const char * const customNames[] = {"RTCM3", "u-blox", "Custom"};
+    static uint8_t verdicts[MAX_FRAMES];
+    SEMP_PARSE_STATE *parse;
+    struct timespec start;
+    double singleSeconds;
+    double batchSeconds;
+    size_t singleValid = 0;
+    size_t batchValid = 0;
+    int mismatches = 0;
+
+    buildStream(custom);
+    g_frameCount = 0;
+    g_frameBytesLength = 0;
+    parse = sempBeginParser("Crc", custom ? customTable : unicoreTable, 3,
+                            custom ? customNames : unicoreNames, 3,
+                            0, 3000, crcEomCallback, NULL, NULL, NULL);
+    if (!parse)
+        return 1;
+    sempEnableLazyValidation(parse, true);
+    sempParseBuffer(parse, g_stream, g_streamLength);
+    sempStopParser(&parse);
+
+    // Validate one frame at a time
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        resetVerdicts();
+        singleValid = 0;
+        for (size_t i = 0; i < g_frameCount; i++)
+            if (sempFrameValidate(&g_frames[i]))
+                singleValid++;
+    }
+    singleSeconds = elapsedSeconds(&start);
+    for (size_t i = 0; i < g_frameCount; i++)
+        verdicts[i] = g_frames[i].verdict;
+
+    // Validate the frames as a batch
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        resetVerdicts();
+        batchValid = sempFrameValidateBatch(g_frames, g_frameCount);
+    }
+    batchSeconds = elapsedSeconds(&start);
+    for (size_t i = 0; i < g_frameCount; i++)
+        if (verdicts[i] != g_frames[i].verdict)
+            mismatches++;
+
+    printf("%-7s 帧 %zu, 有效 %zu / %zu, 结果不一致 %d, 逐帧 %.2f ns/字节, 批量 %.2f ns/字节\n",
+           custom ? "Custom" : "Unicore", g_frameCount, batchValid, singleValid, mismatches,
+           singleSeconds * 1e9 / (BENCH_ROUNDS * g_frameBytesLength),
+           batchSeconds * 1e9 / (BENCH_ROUNDS * g_frameBytesLength));
+    return (mismatches || (batchValid != singleValid)) ? 1 : 0;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  多帧批量CRC校验测试 v1.0\n");
+    printf("=================================\n");
+    printf("交错计算 %d 帧, 每类排队 %d 帧\n", SEMP_BATCH_CRC_LANES, SEMP_BATCH_CRC_QUEUE);
+
+    failures += runStream(false);
+    failures += runStream(true);
+
+    printf("\n--- 多帧批量CRC校验测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
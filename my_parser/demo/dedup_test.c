@@ -0,0 +1,320 @@
+/**
+ * @file dedup_test.c
+ * @brief 冗余链路消息去重测试程序
+ * @details 三条链路各由一个解析线程解析同一个u-blox数据流的不同副本
+ *          (丢帧、CRC错误), 检查每一帧恰好交付一次及每条链路的统计.
+ *          另外检查滑动窗口过期后同一帧再次交付, 以及哈希桶溢出时仍在
+ *          窗口内的键被替换、该帧再次交付并计入evicted.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../Message_Parser.h"
+#include "../Message_Dedup.h"
+#include "../Parse_UBLOX.h"
+
+#define FRAME_COUNT     2000
+#define PAYLOAD_BYTES   24
+#define FRAME_BYTES     (8 + PAYLOAD_BYTES)
+#define LINKS           3
+#define WINDOW_FRAMES   (4 * FRAME_COUNT)
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+typedef struct {
+    uint8_t *stream;
+    size_t length;
+    uint32_t frames;            // Frames in the stream
+    uint32_t corrupted;         // Frames with a bad checksum
+} LinkStream;
+
+static LinkStream g_links[LINKS];
+static SEMP_DEDUP *g_dedup;
+static atomic_uint g_delivered[FRAME_COUNT];
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+
+// UBX frame, the first two payload bytes hold the frame number
+static void buildUblox(uint8_t *frame, uint32_t number, uint32_t salt) {
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = 0x01;
+    frame[3] = 0x07;
+    frame[4] = PAYLOAD_BYTES;
+    frame[5] = 0;
+    frame[6] = (uint8_t)number;
+    frame[7] = (uint8_t)(number >> 8);
+    for (int i = 2; i < PAYLOAD_BYTES; i++)
+        frame[6 + i] = (uint8_t)(number * 31 + i * 7 + salt);
+    for (int i = 2; i < 6 + PAYLOAD_BYTES; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + PAYLOAD_BYTES] = ckA;
+    frame[7 + PAYLOAD_BYTES] = ckB;
+}
+
+// Link 0 drops every third frame, link 1 corrupts every seventh frame,
+// link 2 carries every frame
+static void buildLinks(void) {
+    LinkStream *link;
+
+    for (int l = 0; l < LINKS; l++) {
+        link = &g_links[l];
+        link->stream = (uint8_t *)malloc(FRAME_COUNT * FRAME_BYTES);
+        link->length = 0;
+        link->frames = 0;
+        link->corrupted = 0;
+        for (uint32_t n = 0; n < FRAME_COUNT; n++) {
+            if ((l == 0) && ((n % 3) == 0))
+                continue;
+            buildUblox(&link->stream[link->length], n, 0);
+            if ((l == 1) && ((n % 7) == 0)) {
+                link->stream[link->length + 10] ^= 0x40;
+                link->corrupted++;
+            }
+            link->length += FRAME_BYTES;
+            link->frames++;
+        }
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void dedupEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    SEMP_FRAME frame;
+    uint8_t link = (uint8_t)(uintptr_t)parse->userContext;
+
+    sempGetFrame(parse, type, &frame);
+    if (sempDedupFrame(g_dedup, link, &frame, (frame.buffer[2] << 8) | frame.buffer[3]))
+        atomic_fetch_add(&g_delivered[frame.buffer[6] | (frame.buffer[7] << 8)], 1);
+}
+
+void printStats(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static const SEMP_PARSE_ROUTINE parsersTable[] = {sempUbloxPreamble};
+static const char * const parserNames[] = {"u-blox"};
+
+static void *linkThread(void *arg) {
+    uint8_t link = (uint8_t)(uintptr_t)arg;
+    SEMP_PARSE_STATE *parse;
+
+    parse = sempBeginParser("Link", parsersTable, 1, parserNames, 1, 0, 256,
+                            dedupEomCallback, NULL, NULL, NULL);
+    if (parse) {
+        sempEnableLazyValidation(parse, true);
+        parse->userContext = (void *)(uintptr_t)link;
+        sempParseBuffer(parse, g_links[link].stream, g_links[link].length);
+        sempStopParser(&parse);
+    }
+    return NULL;
+}
+
+//----------------------------------------
+// 测试用例
+//----------------------------------------
+
+// Every frame delivered exactly once, the statistics add up
+static int testLinks(void) {
+    SEMP_DEDUP_LINK_STATS stats;
+    pthread_t threads[LINKS];
+    uint32_t wins = 0;
+    int failures = 0;
+
+    printf("\n三条链路并发去重:\n");
+    g_dedup = sempDedupBegin(WINDOW_FRAMES, LINKS, printStats);
+    if (!g_dedup)
+        return 1;
+    for (int i = 0; i < FRAME_COUNT; i++)
+        atomic_init(&g_delivered[i], 0);
+    for (int l = 0; l < LINKS; l++)
+        pthread_create(&threads[l], NULL, linkThread, (void *)(uintptr_t)l);
+    for (int l = 0; l < LINKS; l++)
+        pthread_join(threads[l], NULL);
+    sempDedupPrintStats(g_dedup, printStats);
+
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        if (atomic_load(&g_delivered[i]) != 1) {
+            printf("  帧 %d 交付 %u 次\n", i, atomic_load(&g_delivered[i]));
+            failures++;
+            break;
+        }
+    }
+    for (uint8_t l = 0; l < LINKS; l++) {
+        sempDedupGetStats(g_dedup, l, &stats);
+        wins += stats.wins;
+        if ((stats.frames != g_links[l].frames) || (stats.badCrc != g_links[l].corrupted)
+            || ((stats.wins + stats.duplicates + stats.badCrc) != stats.frames)
+            || stats.evicted) {
+            printf("  链路 %d 统计错误\n", l);
+            failures++;
+        }
+    }
+    if (wins != FRAME_COUNT) {
+        printf("  交付 %u 帧, 应为 %d\n", wins, FRAME_COUNT);
+        failures++;
+    }
+    sempDedupStop(&g_dedup);
+    if (g_dedup)
+        failures++;
+    return failures;
+}
+
+// Offer a hand built frame on link 0
+static bool offerFrame(SEMP_DEDUP *dedup, const uint8_t *buffer) {
+    SEMP_FRAME frame;
+
+    frame.buffer = buffer;
+    frame.length = FRAME_BYTES;
+    frame.type = 0;
+    frame.validate = sempUbloxValidate;
+    frame.verdict = SEMP_FRAME_UNVALIDATED;
+    return sempDedupFrame(dedup, 0, &frame, 0x0107);
+}
+
+// A key expires after the window of distinct frames
+static int testWindow(void) {
+    uint8_t first[FRAME_BYTES];
+    uint8_t other[FRAME_BYTES];
+    SEMP_DEDUP_LINK_STATS stats;
+    SEMP_DEDUP *dedup;
+    uint32_t n;
+    int failures = 0;
+
+    printf("\n滑动窗口过期:\n");
+    dedup = sempDedupBegin(SEMP_DEDUP_MINIMUM_WINDOW, 1, printStats);
+    if (!dedup)
+        return 1;
+    buildUblox(first, 0, 1);
+    if (!offerFrame(dedup, first))
+        failures++;
+
+    // The first frame and the next window - 2 frames are remembered
+    for (n = 1; n < (SEMP_DEDUP_MINIMUM_WINDOW - 1); n++) {
+        buildUblox(other, n, 1);
+        offerFrame(dedup, other);
+    }
+    if (offerFrame(dedup, first)) {
+        printf("  窗口内的重复帧被再次交付\n");
+        failures++;
+    }
+
+    // One more distinct frame expires the first one
+    buildUblox(other, n, 1);
+    offerFrame(dedup, other);
+    if (!offerFrame(dedup, first)) {
+        printf("  过期的帧没有再次交付\n");
+        failures++;
+    }
+    sempDedupGetStats(dedup, 0, &stats);
+    printf("  %u 帧, 交付 %u, 重复 %u, 替换 %u\n", stats.frames, stats.wins,
+           stats.duplicates, stats.evicted);
+    if ((stats.wins != (SEMP_DEDUP_MINIMUM_WINDOW + 1)) || (stats.duplicates != 1)
+        || stats.evicted)
+        failures++;
+    sempDedupStop(&dedup);
+    return failures;
+}
+
+// Bucket of a frame: same key and bucket selection as Message_Dedup.c
+static uint32_t frameBucket(const uint8_t *buffer, uint32_t bucketMask) {
+    uint64_t key = semp_util_hash64(buffer, FRAME_BYTES, 0x0107);
+
+    return (uint32_t)((key ? key : 1) >> 32) & bucketMask;
+}
+
+// A full bucket replaces its oldest key even when it is still live
+static int testOverflow(void) {
+    static uint8_t colliding[SEMP_DEDUP_BUCKET_SLOTS][FRAME_BYTES];
+    uint8_t first[FRAME_BYTES];
+    SEMP_DEDUP_LINK_STATS stats;
+    SEMP_DEDUP *dedup;
+    uint32_t bucketMask;
+    uint32_t bucket;
+    uint32_t found = 0;
+    int failures = 0;
+
+    printf("\n哈希桶溢出:\n");
+
+    // The minimum window fills the table half way
+    bucketMask = (2 * SEMP_DEDUP_MINIMUM_WINDOW / SEMP_DEDUP_BUCKET_SLOTS) - 1;
+    buildUblox(first, 0, 2);
+    bucket = frameBucket(first, bucketMask);
+    for (uint32_t n = 1; (n < 65536) && (found < SEMP_DEDUP_BUCKET_SLOTS); n++) {
+        buildUblox(colliding[found], n, 2);
+        if (frameBucket(colliding[found], bucketMask) == bucket)
+            found++;
+    }
+    if (found < SEMP_DEDUP_BUCKET_SLOTS)
+        return 1;
+
+    dedup = sempDedupBegin(SEMP_DEDUP_MINIMUM_WINDOW, 1, printStats);
+    if (!dedup)
+        return 1;
+    offerFrame(dedup, first);
+    for (uint32_t i = 0; i < (SEMP_DEDUP_BUCKET_SLOTS - 1); i++)
+        offerFrame(dedup, colliding[i]);
+    if (offerFrame(dedup, first)) {
+        printf("  桶未满时重复帧被交付\n");
+        failures++;
+    }
+
+    // The ninth key displaces the first frame within the window
+    offerFrame(dedup, colliding[SEMP_DEDUP_BUCKET_SLOTS - 1]);
+    sempDedupGetStats(dedup, 0, &stats);
+    if (stats.evicted != 1) {
+        printf("  替换计数 %u, 应为 1\n", stats.evicted);
+        failures++;
+    }
+    if (!offerFrame(dedup, first)) {
+        printf("  被替换的帧没有再次交付\n");
+        failures++;
+    }
+    sempDedupGetStats(dedup, 0, &stats);
+    printf("  %u 帧, 交付 %u, 重复 %u, 替换 %u\n", stats.frames, stats.wins,
+           stats.duplicates, stats.evicted);
+    if ((stats.wins != (SEMP_DEDUP_BUCKET_SLOTS + 2)) || (stats.duplicates != 1))
+        failures++;
+    sempDedupStop(&dedup);
+    return failures;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  冗余链路消息去重测试 v1.0\n");
+    printf("=================================\n");
+
+    buildLinks();
+    failures += testLinks();
+    failures += testWindow();
+    failures += testOverflow();
+    for (int l = 0; l < LINKS; l++)
+        free(g_links[l].stream);
+
+    printf("\n--- 冗余链路消息去重测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,405 @@
+/**
+ * @file engine_test.c
+ * @brief 整块解析引擎一致性与性能测试程序
+ * @details 生成含错误字节和超长帧的混合协议数据流, 分别逐字节调用
+ *          sempParseNextByte和以随机长度的数据块调用sempParseBuffer, 比较
+ *          两者的全部输出: 帧、分段、调试与错误信息. 覆盖逐字节校验、延迟
+ *          校验、大帧分段和缓冲区过小四种配置. 最后比较两者的解析速度.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include "../Message_Parser.h"
+#include "../Message_NmeaWriter.h"
+#include "../Message_RtcmEncoder.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+#include "../Parse_Unicore_Hash.h"
+
+#define STREAM_BYTES    (256 * 1024)
+#define SPLIT_SEEDS     8
+#define BENCH_ROUNDS    40
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+
+// Running hash of everything a parser outputs
+typedef struct {
+    uint64_t hash;
+    long frames;
+    long chunks;
+    long messages;
+} OutputLog;
+
+static uint8_t g_stream[STREAM_BYTES];
+static size_t g_streamLength;
+static OutputLog *g_log;
+
+static void logBytes(OutputLog *log, const void *data, size_t length) {
+    log->hash = semp_util_hash64((const uint8_t *)data, (uint16_t)length, log->hash);
+}
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendRtcm(uint16_t message, uint16_t length) {
+    static uint8_t frame[6 + 1023];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message);
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (frame[4] & 0x0f));
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    appendBytes(frame, 6 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    static uint8_t frame[24 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+static void appendCustom(uint16_t id, uint16_t length) {
+    static uint8_t frame[20 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 20);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0x18;
+    frame[3] = 20;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[12] = (uint8_t)length;
+    frame[13] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[20 + i] = (uint8_t)(i * 3 + id);
+    crc = semp_util_crc32(0xffffffff, frame, 20 + length) ^ 0xffffffff;
+    memcpy(&frame[20 + length], &crc, 4);
+    appendBytes(frame, 24 + length);
+}
+
+static void appendUnicoreHash(const char *body) {
+    char sentence[256];
+    uint32_t crc = semp_util_crc32(0, (const uint8_t *)body, strlen(body));
+    int length = snprintf(sentence, sizeof(sentence), "#%s*%08x\r\n", body, crc);
+    appendBytes(sentence, length);
+}
+
+static void buildStream(void) {
+    SEMP_NMEA_FIX fix;
+    SEMP_RTCM_MSM_OBS obs[12];
+    SEMP_RTCM_MSM msm;
+    uint8_t frame[SEMP_RTCM_MAX_FRAME_BYTES];
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+    uint32_t seed = 12345;
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.quality = 4;
+    fix.satellites = 21;
+    fix.hdop = 70;
+    for (int i = 0; i < 12; i++) {
+        memset(&obs[i], 0, sizeof(obs[i]));
+        obs[i].satellite = 3 + i * 2;
+        obs[i].signal = 2;
+        obs[i].pseudorange = 21000000.0 + i * 850123.25;
+        obs[i].phaserange = obs[i].pseudorange + 0.37;
+        obs[i].cnr = 44;
+    }
+    memset(&msm, 0, sizeof(msm));
+    msm.message = 1077;
+    msm.station = 7;
+    msm.obsCount = 12;
+    msm.obs = obs;
+
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 16384); epoch++) {
+        msm.epochTime = 45296000 + epoch * 1000;
+        fix.timeMs = msm.epochTime;
+        appendBytes(frame, sempRtcmEncodeMsm(frame, sizeof(frame), &msm));
+        appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        appendUblox(0x01, 0x07, 92);
+        appendUnicoreBinary(1000 + epoch, 96);
+        appendCustom(200 + epoch, 120);
+        appendBytes(sentence, sempNmeaWriteRmc(sentence, sizeof(sentence), "GN", &fix));
+        appendUnicoreHash("BESTNAVA,COM1,0,72.5,FINESTEERING,2300,1000.000,SOLVED,SINGLE,"
+                          "40.05830000000,-105.21530000000,1620.5000,-17.0000");
+        if ((epoch % 8) == 0) {
+            // Frames larger than the small buffers
+            appendRtcm(1230, 700 + epoch % 300);
+            appendUblox(0x02, 0x15, 1500);
+            appendUnicoreBinary(43, 2000);
+            appendCustom(7, 900);
+            appendBytes("\x01\x02garbage", 9);
+        }
+    }
+
+    // Corrupt a few bytes for bad CRCs, bad lengths and resynchronization
+    for (int i = 0; i < 200; i++) {
+        seed = seed * 1103515245 + 12345;
+        g_stream[(seed >> 8) % g_streamLength] ^= (uint8_t)(1 << (seed & 7));
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void engineEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    OutputLog *log = (OutputLog *)parse->userContext;
+    SEMP_EPOCH epoch = sempGetFrameEpoch(parse, type);
+
+    log->frames++;
+    logBytes(log, &type, sizeof(type));
+    logBytes(log, &parse->msg_length, sizeof(parse->msg_length));
+    logBytes(log, &parse->verdict, sizeof(parse->verdict));
+    logBytes(log, &epoch.milliseconds, sizeof(epoch.milliseconds));
+    logBytes(log, &epoch.week, sizeof(epoch.week));
+    logBytes(log, &epoch.timeBase, sizeof(epoch.timeBase));
+    logBytes(log, parse->buffer, parse->msg_length);
+}
+
+void engineChunkCallback(SEMP_PARSE_STATE *parse, const SEMP_CHUNK *chunk) {
+    OutputLog *log = (OutputLog *)parse->userContext;
+
+    log->chunks++;
+    logBytes(log, &chunk->offset, sizeof(chunk->offset));
+    logBytes(log, &chunk->length, sizeof(chunk->length));
+    logBytes(log, &chunk->final, sizeof(chunk->final));
+    logBytes(log, &chunk->verdict, sizeof(chunk->verdict));
+    logBytes(log, chunk->data, chunk->length);
+}
+
+// Debug and error messages are part of the output
+void enginePrint(const char *format, ...) {
+    char message[256];
+    va_list args;
+    int length;
+
+    va_start(args, format);
+    length = vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if (g_log && (length > 0)) {
+        g_log->messages++;
+        logBytes(g_log, message, ((size_t)length < sizeof(message)) ? (size_t)length : sizeof(message) - 1);
+    }
+}
+
+//----------------------------------------
+// 测试配置
+//----------------------------------------
+typedef struct {
+    const char *name;
+    uint16_t bufferLength;
+    bool lazy;
+    bool streaming;
+} EngineConfig;
+
+static const EngineConfig g_configs[] = {
+    {"逐字节校验", 3000, false, false},
+    {"延迟校验",   3000, true,  false},
+    {"大帧分段",   256,  false, true},
+    {"缓冲区过小", 256,  false, false},
+};
+
+static SEMP_PARSE_STATE * beginParser(const SEMP_PARSE_ROUTINE *parsersTable,
+                                      const char * const *parserNamesTable,
+                                      uint8_t parserCount,
+                                      const EngineConfig *config,
+                                      OutputLog *log) {
+    SEMP_PARSE_STATE *parse;
+
+    parse = sempBeginParser("Engine", parsersTable, parserCount, parserNamesTable, parserCount,
+                            0, config->bufferLength, engineEomCallback,
+                            enginePrint, NULL, NULL);
+    if (parse) {
+        memset(log, 0, sizeof(OutputLog));
+        parse->userContext = log;
+        parse->printDebug = enginePrint;
+        sempEnableLazyValidation(parse, config->lazy);
+        if (config->streaming)
+            sempEnableStreaming(parse, engineChunkCallback);
+    }
+    return parse;
+}
+
+// Parse the stream with sempParseBuffer in random length blocks
+static void parseBlocks(SEMP_PARSE_STATE *parse, uint32_t seed) {
+    size_t offset = 0;
+    size_t length;
+
+    while (offset < g_streamLength) {
+        seed = seed * 1103515245 + 12345;
+        length = 1 + ((seed >> 8) % ((seed & 0x100) ? 16 : 1500));
+        if (length > (g_streamLength - offset))
+            length = g_streamLength - offset;
+        sempParseBuffer(parse, &g_stream[offset], length);
+        offset += length;
+    }
+}
+
+static double elapsedSeconds(const struct timespec *start) {
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    static const SEMP_PARSE_ROUTINE unicoreTable[] = {
+        sempNmeaPreamble,
+        sempRtcmPreamble,
+        sempUbloxPreamble,
+        sempUnicoreBinaryPreamble,
+        sempUnicoreHashPreamble,
+    };
+    static const SEMP_PARSE_ROUTINE customTable[] = {
+        sempNmeaPreamble,
+        sempRtcmPreamble,
+        sempUbloxPreamble,
+        sempCustomPreamble,
+        sempUnicoreHashPreamble,
+    };
+    static const char * const unicoreNames[] = {
+        "NMEA", "RTCM3", "u-blox", "Unicore-BIN", "Unicore-HASH"
+    };
+    static const char * const customNames[] = {
+        "NMEA", "RTCM3", "u-blox", "Custom", "Unicore-HASH"
+    };
+    const uint8_t parserCount = sizeof(unicoreTable) / sizeof(unicoreTable[0]);
+    SEMP_PARSE_STATE *parse;
+    OutputLog expected;
+    OutputLog actual;
+    struct timespec start;
+    double byteSeconds;
+    double bufferSeconds;
+    int failures = 0;
+    int runs = 0;
+
+    printf("=================================\n");
+    printf("  整块解析引擎测试 v1.0\n");
+    printf("=================================\n");
+
+    buildStream();
+    printf("数据流: %zu 字节\n", g_streamLength);
+
+    // 1. 输出一致性
+    for (int table = 0; table < 2; table++) {
+        const SEMP_PARSE_ROUTINE *parsersTable = table ? customTable : unicoreTable;
+        const char * const *parserNamesTable = table ? customNames : unicoreNames;
+
+        for (size_t c = 0; c < sizeof(g_configs) / sizeof(g_configs[0]); c++) {
+            const EngineConfig *config = &g_configs[c];
+
+            parse = beginParser(parsersTable, parserNamesTable, parserCount, config, &expected);
+            if (!parse) {
+                printf("解析器初始化失败!\n");
+                return -1;
+            }
+            g_log = &expected;
+            for (size_t i = 0; i < g_streamLength; i++)
+                sempParseNextByte(parse, g_stream[i]);
+            sempStopParser(&parse);
+
+            for (uint32_t seed = 0; seed < SPLIT_SEEDS; seed++) {
+                parse = beginParser(parsersTable, parserNamesTable, parserCount, config, &actual);
+                g_log = &actual;
+                parseBlocks(parse, seed);
+                sempStopParser(&parse);
+                runs++;
+                if (memcmp(&actual, &expected, sizeof(OutputLog))) {
+                    printf("  %s %s, 分块 %u: 输出不一致 (帧 %ld / %ld, 分段 %ld / %ld, 信息 %ld / %ld)\n",
+                           table ? "Custom" : "Unicore", config->name, seed,
+                           actual.frames, expected.frames, actual.chunks, expected.chunks,
+                           actual.messages, expected.messages);
+                    failures++;
+                }
+            }
+            g_log = NULL;
+            printf("%-8s %s: 帧 %ld, 分段 %ld, 信息 %ld\n", table ? "Custom" : "Unicore",
+                   config->name, expected.frames, expected.chunks, expected.messages);
+        }
+    }
+
+    // 2. 解析速度
+    parse = beginParser(unicoreTable, unicoreNames, parserCount, &g_configs[0], &actual);
+    parse->printDebug = NULL;
+    parse->printError = NULL;
+    sempParseBuffer(parse, g_stream, g_streamLength);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+        for (size_t i = 0; i < g_streamLength; i++)
+            sempParseNextByte(parse, g_stream[i]);
+    byteSeconds = elapsedSeconds(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+        sempParseBuffer(parse, g_stream, g_streamLength);
+    bufferSeconds = elapsedSeconds(&start);
+    sempStopParser(&parse);
+
+    printf("\n--- 整块解析引擎测试总结 ---\n");
+    printf("sempParseNextByte: %.2f ns/字节\n", byteSeconds * 1e9 / (BENCH_ROUNDS * g_streamLength));
+    printf("sempParseBuffer:   %.2f ns/字节\n", bufferSeconds * 1e9 / (BENCH_ROUNDS * g_streamLength));
+    printf("比较 %d 次, 失败: %d\n", runs, failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,374 @@
+/**
+ * @file epoch_test.c
+ * @brief RTCM MSM历元组装器测试程序
+ * @details 编码多个基准站交错发送的GPS/GLONASS/Galileo/北斗MSM7历元,
+ *          检查完整历元与不完整历元 (最后一帧丢失、数据流结束) 的标志,
+ *          块池耗尽时等待最久的历元被提前输出, 以及历元中的帧指针指向池中的块
+ *          且内容与编码的帧相同, 每一帧恰好输出一次. 另检查u-blox NAV消息的
+ *          历元时间取自各消息iTOW所在的偏移.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../Message_Parser.h"
+#include "../Message_RtcmEpoch.h"
+#include "../Message_RtcmEncoder.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+
+#define STATIONS        3
+#define EPOCHS          50
+#define STREAM_BYTES    (STATIONS * EPOCHS * 4 * 512)
+#define MAX_FRAMES      (STATIONS * EPOCHS * 5)
+#define MAX_BLOCKS      64
+
+static const uint16_t g_messages[] = {1077, 1087, 1097, 1127};
+#define MESSAGES        (sizeof(g_messages) / sizeof(g_messages[0]))
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+typedef struct {
+    size_t offset;              // Frame offset in the stream
+    uint16_t length;
+    uint16_t station;
+    uint16_t message;
+    int delivered;              // Times the frame was output
+} FrameRecord;
+
+typedef struct {
+    int epochs;
+    int complete;
+    int incomplete;
+    int firstIncompleteStation; // Station of the first incomplete epoch, -1 if none
+    int badFrames;              // Frames not matching an encoded frame
+    const uint8_t *blocks[MAX_BLOCKS]; // Distinct frame addresses seen
+    int blockCount;
+} EpochLog;
+
+static uint8_t g_stream[STREAM_BYTES];
+static size_t g_streamLength;
+static FrameRecord g_frames[MAX_FRAMES];
+static int g_frameCount;
+static int g_arpCount;          // 1005 frames in the stream
+static EpochLog g_log;
+static SEMP_RTCM_ASSEMBLER *g_assembler;
+static SEMP_PARSE_STATE *g_parse;
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendMsm(uint16_t station, uint16_t message, uint32_t epoch, bool more) {
+    SEMP_RTCM_MSM_OBS obs[5];
+    SEMP_RTCM_MSM msm;
+    FrameRecord *record = &g_frames[g_frameCount++];
+    uint32_t tow = 345600000 + epoch * 1000;
+
+    for (int i = 0; i < 5; i++) {
+        memset(&obs[i], 0, sizeof(obs[i]));
+        obs[i].satellite = 1 + i * 5 + station;
+        obs[i].signal = 2 + (i & 1) * 7;
+        obs[i].pseudorange = 20000000.0 + station * 1000.0 + epoch * 11.0 + i * 912345.5;
+        obs[i].phaserange = obs[i].pseudorange + 0.17;
+        obs[i].phaserangeRate = -312.25 + i;
+        obs[i].cnr = 40 + i;
+    }
+    memset(&msm, 0, sizeof(msm));
+    msm.message = message;
+    msm.station = station;
+    if (message == 1087)
+        msm.epochTime = (4u << 27) | ((tow + 3 * 3600000 - 18000) % 86400000);
+    else if (message == 1127)
+        msm.epochTime = tow - 14000;
+    else
+        msm.epochTime = tow;
+    msm.multipleMessage = more;
+    msm.obsCount = 5;
+    msm.obs = obs;
+
+    record->offset = g_streamLength;
+    record->length = sempRtcmEncodeMsm(&g_stream[g_streamLength], STREAM_BYTES - g_streamLength,
+                                       &msm);
+    record->station = station;
+    record->message = message;
+    record->delivered = 0;
+    g_streamLength += record->length;
+}
+
+// Stations interleave their messages, dropLast loses the final message of
+// every fifth epoch of station 2, stopEarly ends the stream mid epoch
+static void buildStream(bool dropLast, bool stopEarly) {
+    uint8_t frame[32];
+    SEMP_RTCM_1005 arp;
+    uint16_t length;
+
+    g_streamLength = 0;
+    g_frameCount = 0;
+    g_arpCount = 0;
+    memset(&arp, 0, sizeof(arp));
+    arp.station = 1;
+    arp.gps = true;
+    arp.x = -1288398.5;
+    arp.y = -4721697.1;
+    arp.z = 4078625.3;
+    for (uint32_t epoch = 0; epoch < EPOCHS; epoch++) {
+        for (size_t m = 0; m < MESSAGES; m++) {
+            for (uint16_t station = 1; station <= STATIONS; station++) {
+                if (dropLast && (station == 2) && ((epoch % 5) == 0) && (m == (MESSAGES - 1)))
+                    continue;
+                if (stopEarly && (epoch == (EPOCHS - 1)) && (m == 2))
+                    return;
+                appendMsm(station, g_messages[m], epoch, m < (MESSAGES - 1));
+            }
+        }
+
+        // Not an MSM message, not held by the assembler
+        length = sempRtcmEncode1005(frame, sizeof(frame), &arp);
+        memcpy(&g_stream[g_streamLength], frame, length);
+        g_streamLength += length;
+        g_arpCount++;
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+
+// Match the frame with an encoded frame not yet output
+static bool matchFrame(const uint8_t *frame, uint16_t length, uint16_t station, uint16_t message) {
+    for (int i = 0; i < g_frameCount; i++) {
+        if ((!g_frames[i].delivered) && (g_frames[i].length == length)
+            && (g_frames[i].station == station) && (g_frames[i].message == message)
+            && (!memcmp(&g_stream[g_frames[i].offset], frame, length))) {
+            g_frames[i].delivered++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void epochCallback(void *context, const SEMP_RTCM_EPOCH *epoch) {
+    EpochLog *log = (EpochLog *)context;
+    int block;
+
+    log->epochs++;
+    if (epoch->complete) {
+        log->complete++;
+        if ((epoch->frameCount != MESSAGES) || (epoch->messages[MESSAGES - 1] != 1127))
+            log->badFrames++;
+    } else {
+        if (!log->incomplete)
+            log->firstIncompleteStation = epoch->station;
+        log->incomplete++;
+    }
+
+    for (int i = 0; i < epoch->frameCount; i++) {
+        // The frame stays in its pool block, the parser has another one
+        if ((epoch->frames[i] >= g_stream) && (epoch->frames[i] < &g_stream[STREAM_BYTES]))
+            log->badFrames++;
+        if (epoch->frames[i] == g_parse->buffer)
+            log->badFrames++;
+        for (int j = 0; j < i; j++)
+            if (epoch->frames[j] == epoch->frames[i])
+                log->badFrames++;
+        if (!matchFrame(epoch->frames[i], epoch->lengths[i], epoch->station, epoch->messages[i]))
+            log->badFrames++;
+
+        for (block = 0; block < log->blockCount; block++)
+            if (log->blocks[block] == epoch->frames[i])
+                break;
+        if ((block == log->blockCount) && (log->blockCount < MAX_BLOCKS))
+            log->blocks[log->blockCount++] = epoch->frames[i];
+    }
+}
+
+int g_nonMsm;
+
+void epochEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    if (!sempRtcmEpochFrame(g_assembler, parse, type))
+        g_nonMsm++;
+}
+
+void printError(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static const SEMP_PARSE_ROUTINE parsersTable[] = {sempRtcmPreamble};
+static const char * const parserNames[] = {"RTCM3"};
+
+SEMP_EPOCH g_ubloxEpoch;
+
+void ubloxEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    g_ubloxEpoch = sempGetFrameEpoch(parse, type);
+}
+
+static const SEMP_PARSE_ROUTINE ubloxTable[] = {sempUbloxPreamble};
+static const char * const ubloxNames[] = {"u-blox"};
+
+//----------------------------------------
+// 测试用例
+//----------------------------------------
+static int runAssembler(const char *name, uint16_t blocks, bool dropLast, bool stopEarly,
+                        int expectedComplete, int expectedIncomplete, int oldestStation) {
+    int failures = 0;
+    int delivered = 0;
+
+    buildStream(dropLast, stopEarly);
+    memset(&g_log, 0, sizeof(g_log));
+    g_log.firstIncompleteStation = -1;
+    g_nonMsm = 0;
+    g_parse = sempBeginParser("Epoch", parsersTable, 1, parserNames, 1, 0, 256,
+                              epochEomCallback, printError, NULL, NULL);
+    if (!g_parse)
+        return 1;
+    g_assembler = sempRtcmEpochBegin(g_parse, blocks, 0, epochCallback, &g_log);
+    if (!g_assembler)
+        return 1;
+
+    // Odd sized pieces, frames cross the calls
+    for (size_t offset = 0; offset < g_streamLength; offset += 333)
+        sempParseBuffer(g_parse, &g_stream[offset],
+                        ((g_streamLength - offset) < 333) ? (g_streamLength - offset) : 333);
+    sempRtcmEpochFlush(g_assembler);
+    sempRtcmEpochStop(&g_assembler);
+    sempStopParser(&g_parse);
+
+    for (int i = 0; i < g_frameCount; i++) {
+        delivered += g_frames[i].delivered;
+        if (g_frames[i].delivered != 1)
+            failures++;
+    }
+    printf("%s: %d 块, %d 历元 (完整 %d, 不完整 %d), %d / %d 帧, %d 个不同的块, 非MSM %d\n",
+           name, blocks, g_log.epochs, g_log.complete, g_log.incomplete, delivered,
+           g_frameCount, g_log.blockCount, g_nonMsm);
+    if (failures)
+        printf("  %d 帧没有恰好输出一次\n", failures);
+    if (g_log.badFrames) {
+        printf("  %d 帧指针或内容错误\n", g_log.badFrames);
+        failures++;
+    }
+    if ((g_log.complete != expectedComplete) || (g_log.incomplete != expectedIncomplete)) {
+        printf("  应为完整 %d, 不完整 %d\n", expectedComplete, expectedIncomplete);
+        failures++;
+    }
+    if ((oldestStation >= 0) && (g_log.firstIncompleteStation != oldestStation)) {
+        printf("  最先输出的不完整历元来自基准站 %d, 应为 %d\n", g_log.firstIncompleteStation,
+               oldestStation);
+        failures++;
+    }
+    if ((g_log.blockCount > blocks) || (g_nonMsm != g_arpCount)) {
+        printf("  帧不在 %d 个池块中或非MSM帧计数错误\n", blocks);
+        failures++;
+    }
+    return failures;
+}
+
+// u-blox NAV message with iTOW at the given payload offset, the bytes
+// before it are version, reserved and station bytes
+static uint32_t parseUbloxNav(uint8_t id, uint16_t payload, uint8_t offset, uint32_t iTOW) {
+    uint8_t frame[8 + 100];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = 0x01;
+    frame[3] = id;
+    frame[4] = (uint8_t)payload;
+    frame[5] = (uint8_t)(payload >> 8);
+    for (uint16_t i = 0; i < payload; i++)
+        frame[6 + i] = (uint8_t)(0xa5 ^ (i * 29));
+    for (int i = 0; (i < 4) && ((offset + i) < payload); i++)
+        frame[6 + offset + i] = (uint8_t)(iTOW >> (8 * i));
+    for (int i = 2; i < 6 + payload; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + payload] = ckA;
+    frame[7 + payload] = ckB;
+
+    memset(&g_ubloxEpoch, 0, sizeof(g_ubloxEpoch));
+    sempParseBuffer(g_parse, frame, payload + 8);
+    return (g_ubloxEpoch.timeBase == SEMP_EPOCH_GPS_TOW) ? g_ubloxEpoch.milliseconds : 0;
+}
+
+static int testUbloxEpochs(void) {
+    static const struct {
+        const char *name;
+        uint8_t id;
+        uint16_t payload;
+        uint8_t offset;
+        uint32_t expected;      // 0 when the message has no time tag
+    } cases[] = {
+        {"NAV-PVT",       0x07, 92, 0, 345600000},
+        {"NAV-HPPOSLLH",  0x14, 36, 4, 345601000},
+        {"NAV-RELPOSNED", 0x3c, 64, 4, 345602000},
+        {"NAV-HPPOSECEF", 0x13, 28, 4, 345603000},
+        {"NAV-ODO",       0x09, 20, 4, 345604000},
+        {"NAV-SVIN",      0x3b, 40, 4, 345605000},
+        {"NAV-HPPOSLLH 负载过短", 0x14, 6, 4, 0},
+    };
+    uint32_t milliseconds;
+    int failures = 0;
+
+    g_parse = sempBeginParser("Epoch", ubloxTable, 1, ubloxNames, 1, 0, 256,
+                              ubloxEomCallback, printError, NULL, NULL);
+    if (!g_parse)
+        return 1;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        milliseconds = parseUbloxNav(cases[i].id, cases[i].payload, cases[i].offset,
+                                     cases[i].expected ? cases[i].expected : 345609000);
+        if (milliseconds != cases[i].expected) {
+            printf("  %s: 历元 %u ms, 应为 %u ms\n", cases[i].name, milliseconds,
+                   cases[i].expected);
+            failures++;
+        }
+    }
+    sempStopParser(&g_parse);
+    printf("u-blox NAV历元: %zu 条消息, 失败 %d\n", sizeof(cases) / sizeof(cases[0]), failures);
+    return failures;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  RTCM MSM历元组装器测试 v1.0\n");
+    printf("=================================\n");
+
+    // Every epoch ends with its final message
+    failures += runAssembler("完整历元", MAX_BLOCKS, false, false,
+                             STATIONS * EPOCHS, 0, -1);
+
+    // The next epoch time closes the epochs missing their final message
+    failures += runAssembler("最后一帧丢失", MAX_BLOCKS, true, false,
+                             STATIONS * EPOCHS - EPOCHS / 5, EPOCHS / 5, 2);
+
+    // The flush at the end outputs the open epochs
+    failures += runAssembler("数据流中断", MAX_BLOCKS, false, true,
+                             STATIONS * (EPOCHS - 1), STATIONS, 1);
+
+    // Eight blocks hold seven frames.  At the third message of station 2
+    // the pool is empty, station 2 has waited longest since its last frame
+    // and is output early, then station 1.  Both finish as incomplete
+    // epochs, only station 3 completes each epoch.
+    failures += runAssembler("块池耗尽", 8, false, false,
+                             EPOCHS, 4 * EPOCHS, 2);
+
+    // iTOW follows the version and reserved bytes of the RTK messages
+    failures += testUbloxEpochs();
+
+    printf("\n--- RTCM MSM历元组装器测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
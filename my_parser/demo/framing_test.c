@@ -0,0 +1,308 @@
+/**
+ * @file framing_test.c
+ * @brief 通用分帧引擎一致性与性能测试程序
+ * @details 用描述表驱动的通用分帧引擎解析RTCM、UBX、Unicore二进制和自定义
+ *          协议, 检查输出的帧序列与手写状态机完全相同 (含错误字节的数据流、
+ *          逐字节校验和延迟校验), 检查SBF帧的分帧与CRC, 并比较两者的速度.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../Message_Parser.h"
+#include "../Message_Framing.h"
+#include "../Message_RtcmEncoder.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+
+#define STREAM_BYTES    (256 * 1024)
+#define BENCH_ROUNDS    40
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+
+// Running hash of the frames a parser outputs
+typedef struct {
+    uint64_t hash;
+    long frames;
+    long badFrames;
+} FrameLog;
+
+static uint8_t g_stream[STREAM_BYTES];
+static size_t g_streamLength;
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    static uint8_t frame[24 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+static void appendCustom(uint16_t id, uint16_t length) {
+    static uint8_t frame[20 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 20);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0x18;
+    frame[3] = 20;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[12] = (uint8_t)length;
+    frame[13] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[20 + i] = (uint8_t)(i * 3 + id);
+    crc = semp_util_crc32(0xffffffff, frame, 20 + length) ^ 0xffffffff;
+    memcpy(&frame[20 + length], &crc, 4);
+    appendBytes(frame, 24 + length);
+}
+
+// SBF block, the length is a multiple of 4 and includes the header
+static void appendSbf(uint16_t id, uint16_t payloadLength) {
+    static uint8_t frame[8 + 4096];
+    uint16_t length = (uint16_t)((8 + payloadLength + 3) & ~3);
+    uint16_t crc = 0;
+
+    frame[0] = '$';
+    frame[1] = '@';
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 8; i < length; i++)
+        frame[i] = (uint8_t)(i * 5 + id);
+    for (uint16_t i = 4; i < length; i++) {
+        crc ^= (uint16_t)(frame[i] << 8);
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    frame[2] = (uint8_t)crc;
+    frame[3] = (uint8_t)(crc >> 8);
+    appendBytes(frame, length);
+}
+
+static void corruptStream(uint32_t seed, int count) {
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        g_stream[(seed >> 8) % g_streamLength] ^= (uint8_t)(1 << (seed & 7));
+    }
+}
+
+static void buildStream(void) {
+    SEMP_RTCM_MSM_OBS obs[12];
+    SEMP_RTCM_MSM msm;
+    uint8_t frame[SEMP_RTCM_MAX_FRAME_BYTES];
+
+    for (int i = 0; i < 12; i++) {
+        memset(&obs[i], 0, sizeof(obs[i]));
+        obs[i].satellite = 3 + i * 2;
+        obs[i].signal = 2;
+        obs[i].pseudorange = 21000000.0 + i * 850123.25;
+        obs[i].phaserange = obs[i].pseudorange + 0.37;
+        obs[i].cnr = 44;
+    }
+    memset(&msm, 0, sizeof(msm));
+    msm.message = 1077;
+    msm.station = 7;
+    msm.obsCount = 12;
+    msm.obs = obs;
+
+    g_streamLength = 0;
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 8192); epoch++) {
+        msm.epochTime = 45296000 + epoch * 1000;
+        appendBytes(frame, sempRtcmEncodeMsm(frame, sizeof(frame), &msm));
+        appendUblox(0x01, 0x07, 92);
+        appendUnicoreBinary(1000 + epoch, 96);
+        appendCustom(200 + epoch, 120);
+        if ((epoch % 8) == 0) {
+            appendUblox(0x02, 0x15, 1500);
+            appendUnicoreBinary(43, 2000);
+            appendBytes("\x01\x02garbage", 9);
+        }
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void framingEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    FrameLog *log = (FrameLog *)parse->userContext;
+
+    log->frames++;
+    if (!sempValidateFrame(parse))
+        log->badFrames++;
+    log->hash = semp_util_hash64((const uint8_t *)&type, sizeof(type), log->hash);
+    log->hash = semp_util_hash64(&parse->verdict, sizeof(parse->verdict), log->hash);
+    log->hash = semp_util_hash64(parse->buffer, parse->msg_length, log->hash);
+}
+
+//----------------------------------------
+// 测试循环
+//----------------------------------------
+
+// Parse the stream, return the seconds spent
+static double parseStream(const SEMP_PARSE_ROUTINE *parsersTable,
+                          uint8_t parserCount,
+                          bool lazy,
+                          bool buffer,
+                          int rounds,
+                          FrameLog *log) {
+    static const char * const parserNamesTable[] = {"A", "B", "C", "D"};
+    SEMP_PARSE_STATE *parse;
+    struct timespec start;
+    struct timespec end;
+
+    parse = sempBeginParser("Framing", parsersTable, parserCount, parserNamesTable, parserCount,
+                            0, 3000, framingEomCallback, NULL, NULL, NULL);
+    if (!parse)
+        return 0;
+    memset(log, 0, sizeof(FrameLog));
+    parse->userContext = log;
+    sempEnableLazyValidation(parse, lazy);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < rounds; round++) {
+        if (buffer)
+            sempParseBuffer(parse, g_stream, g_streamLength);
+        else
+            for (size_t i = 0; i < g_streamLength; i++)
+                sempParseNextByte(parse, g_stream[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sempStopParser(&parse);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    static const SEMP_PARSE_ROUTINE handTables[2][3] = {
+        {sempRtcmPreamble, sempUbloxPreamble, sempUnicoreBinaryPreamble},
+        {sempRtcmPreamble, sempUbloxPreamble, sempCustomPreamble},
+    };
+    static const SEMP_PARSE_ROUTINE framingTables[2][3] = {
+        {sempFramingRtcmPreamble, sempFramingUbloxPreamble, sempFramingUnicoreBinaryPreamble},
+        {sempFramingRtcmPreamble, sempFramingUbloxPreamble, sempFramingCustomPreamble},
+    };
+    static const SEMP_PARSE_ROUTINE sbfTable[] = {sempFramingSbfPreamble};
+    FrameLog expected;
+    FrameLog actual;
+    double seconds[4];
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  通用分帧引擎测试 v1.0\n");
+    printf("=================================\n");
+
+    // 1. 与手写状态机的帧序列比较
+    for (int corrupt = 0; corrupt < 2; corrupt++) {
+        buildStream();
+        if (corrupt)
+            corruptStream(12345, 300);
+        for (int table = 0; table < 2; table++) {
+            for (int lazy = 0; lazy < 2; lazy++) {
+                parseStream(handTables[table], 3, lazy, false, 1, &expected);
+                for (int buffer = 0; buffer < 2; buffer++) {
+                    parseStream(framingTables[table], 3, lazy, buffer, 1, &actual);
+                    if (memcmp(&actual, &expected, sizeof(FrameLog))) {
+                        printf("  %s %s %s %s: 帧序列不一致 (帧 %ld / %ld)\n",
+                               corrupt ? "错误字节" : "正常数据", table ? "Custom" : "Unicore",
+                               lazy ? "延迟校验" : "逐字节校验",
+                               buffer ? "sempParseBuffer" : "sempParseNextByte",
+                               actual.frames, expected.frames);
+                        failures++;
+                    }
+                }
+                printf("%s %-7s %s: 帧 %ld, CRC错误 %ld\n", corrupt ? "错误字节" : "正常数据",
+                       table ? "Custom" : "Unicore", lazy ? "延迟校验" : "逐字节校验",
+                       expected.frames, expected.badFrames);
+            }
+        }
+    }
+
+    // 2. SBF
+    g_streamLength = 0;
+    for (int i = 0; g_streamLength < (STREAM_BYTES - 8192); i++) {
+        appendSbf(4007, 80 + (i % 200));
+        if ((i % 16) == 0)
+            appendBytes("$GPGGA,garbage", 14);
+    }
+    parseStream(sbfTable, 1, false, true, 1, &actual);
+    printf("SBF: 帧 %ld, CRC错误 %ld\n", actual.frames, actual.badFrames);
+    if (actual.badFrames || (actual.frames < 1000))
+        failures++;
+    corruptStream(777, 100);
+    parseStream(sbfTable, 1, false, true, 1, &expected);
+    printf("SBF 错误字节: 帧 %ld\n", expected.frames);
+    if (expected.frames >= actual.frames)
+        failures++;
+
+    // 3. 解析速度
+    buildStream();
+    parseStream(handTables[0], 3, false, false, 1, &expected);
+    seconds[0] = parseStream(handTables[0], 3, false, false, BENCH_ROUNDS, &expected);
+    seconds[1] = parseStream(handTables[0], 3, false, true, BENCH_ROUNDS, &expected);
+    seconds[2] = parseStream(framingTables[0], 3, false, false, BENCH_ROUNDS, &actual);
+    seconds[3] = parseStream(framingTables[0], 3, false, true, BENCH_ROUNDS, &actual);
+
+    printf("\n--- 通用分帧引擎测试总结 ---\n");
+    printf("手写状态机 sempParseNextByte: %.2f ns/字节, sempParseBuffer: %.2f ns/字节\n",
+           seconds[0] * 1e9 / (BENCH_ROUNDS * g_streamLength),
+           seconds[1] * 1e9 / (BENCH_ROUNDS * g_streamLength));
+    printf("通用分帧   sempParseNextByte: %.2f ns/字节, sempParseBuffer: %.2f ns/字节\n",
+           seconds[2] * 1e9 / (BENCH_ROUNDS * g_streamLength),
+           seconds[3] * 1e9 / (BENCH_ROUNDS * g_streamLength));
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file hop_bench.c
+ * @brief 多数据流切换性能测试程序
+ * @details 一个工作线程轮流向大量解析器各送入几个字节, 解析器总内存远大于
+ *          缓存, 每次切换数据流时解析器状态都不在缓存中. 统计每次切换和每
+ *          字节的耗时, 衡量SEMP_PARSE_STATE的缓存行布局. 比较逐字节、整块
+ *          和批量 (sempParseBatch) 三种调用方式
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <time.h>
+#include "../Message_Parser.h"
+#include "../Message_Batch.h"
+#include "../Message_RtcmEncoder.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+
+#define STREAM_COUNT    20000
+#define HOP_BYTES       4       // Bytes passed to a parser per hop
+#define STREAM_BYTES    4096
+#define ROUNDS          64
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+static uint8_t g_stream[STREAM_BYTES];
+static size_t g_streamLength;
+static long g_frames;
+
+static void appendUblox(uint16_t length, uint8_t seed) {
+    uint8_t *frame = &g_stream[g_streamLength];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = 0x01;
+    frame[3] = 0x07;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 7 + seed);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    g_streamLength += 8 + length;
+}
+
+// 生成RTCM MSM与UBX混合数据
+static void buildStream(void) {
+    SEMP_RTCM_MSM_OBS obs[8];
+    SEMP_RTCM_MSM msm;
+
+    memset(&msm, 0, sizeof(msm));
+    msm.message = 1077;
+    msm.station = 1;
+    msm.obs = obs;
+    msm.obsCount = 8;
+    for (int i = 0; i < 8; i++) {
+        memset(&obs[i], 0, sizeof(obs[i]));
+        obs[i].satellite = 2 + i * 3;
+        obs[i].signal = 2;
+        obs[i].pseudorange = 20500000.0 + i * 713117.5;
+        obs[i].phaserange = obs[i].pseudorange + 0.25;
+        obs[i].cnr = 45;
+    }
+    while (g_streamLength < (STREAM_BYTES - 512)) {
+        msm.epochTime += 1000;
+        g_streamLength += sempRtcmEncodeMsm(&g_stream[g_streamLength],
+                                            STREAM_BYTES - g_streamLength, &msm);
+        appendUblox(92, (uint8_t)g_streamLength);
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void hopEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    g_frames++;
+}
+
+//----------------------------------------
+// 测试循环
+//----------------------------------------
+
+// 每轮向每个解析器送入HOP_BYTES字节, 返回每次切换的纳秒数.
+// mode 0: sempParseNextByte逐字节, 1: 每次切换调用sempParseBuffer,
+// 2: 每轮以sempParseBatch批量解析全部数据流
+static double runHops(SEMP_PARSE_STATE **parsers, int mode) {
+    static uint32_t offsets[STREAM_COUNT];
+    static uint32_t order[STREAM_COUNT];
+    static SEMP_BATCH_LANE lanes[STREAM_COUNT];
+    struct timespec start;
+    struct timespec end;
+    double seconds;
+    long hops = 0;
+
+    uint32_t seed = 1;
+
+    // The connections become readable in random order
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        offsets[i] = (uint32_t)((i * 131) % (g_streamLength - HOP_BYTES));
+        order[i] = i;
+    }
+    for (int i = STREAM_COUNT - 1; i > 0; i--) {
+        uint32_t j;
+        uint32_t swap;
+
+        seed = seed * 1103515245 + 12345;
+        j = (seed >> 8) % (i + 1);
+        swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int k = 0; k < STREAM_COUNT; k++) {
+            int i = order[k];
+            SEMP_PARSE_STATE *parse = parsers[i];
+            uint32_t offset = offsets[i];
+            if (mode == 0) {
+                for (int j = 0; j < HOP_BYTES; j++)
+                    sempParseNextByte(parse, g_stream[offset + j]);
+            } else if (mode == 1)
+                sempParseBuffer(parse, &g_stream[offset], HOP_BYTES);
+            else {
+                lanes[k].parse = parse;
+                lanes[k].data = &g_stream[offset];
+                lanes[k].length = HOP_BYTES;
+            }
+            offset += HOP_BYTES;
+            if ((offset + HOP_BYTES) > g_streamLength)
+                offset = 0;
+            offsets[i] = offset;
+            hops++;
+        }
+        if (mode == 2)
+            sempParseBatch(lanes, STREAM_COUNT);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return seconds * 1e9 / hops;
+}
+
+// Parsers whose per byte block spans two cache lines
+static int countSplitParsers(SEMP_PARSE_STATE **parsers) {
+    size_t hotBytes = offsetof(SEMP_PARSE_STATE, scratch) + sizeof(SEMP_SCRATCH_PAD);
+    int split = 0;
+
+    for (int i = 0; i < STREAM_COUNT; i++)
+        if ((((uintptr_t)parsers[i] % SEMP_CACHE_LINE_BYTES) + hotBytes) > SEMP_CACHE_LINE_BYTES)
+            split++;
+    return split;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    static const SEMP_PARSE_ROUTINE parsersTable[] = {
+        sempNmeaPreamble,
+        sempRtcmPreamble,
+        sempUbloxPreamble,
+    };
+    static const char * const parserNamesTable[] = {
+        "NMEA", "RTCM3", "u-blox"
+    };
+    const uint8_t parserCount = sizeof(parsersTable) / sizeof(parsersTable[0]);
+    static const SEMP_PARSER_CONFIG config = {
+        "Hop", parsersTable, parserNamesTable, hopEomCallback, NULL,
+        sizeof(parsersTable) / sizeof(parsersTable[0])
+    };
+    static SEMP_PARSE_STATE *parsers[STREAM_COUNT];
+    double nanoseconds;
+
+    printf("=================================\n");
+    printf("  多数据流切换性能测试 v1.0\n");
+    printf("=================================\n");
+
+    buildStream();
+    printf("数据流: %d, 每次切换 %d 字节\n", STREAM_COUNT, HOP_BYTES);
+    printf("解析器结构: %zu 字节, 逐字节访问的字段与暂存区: %zu 字节\n",
+           sizeof(SEMP_PARSE_STATE), offsetof(SEMP_PARSE_STATE, scratch) + sizeof(SEMP_SCRATCH_PAD));
+
+    static const char * const modeNames[] = {
+        "逐字节", "整块", "批量"
+    };
+    for (int shared = 0; shared < 2; shared++) {
+        for (int mode = 0; mode < 3; mode++) {
+            g_frames = 0;
+            for (int i = 0; i < STREAM_COUNT; i++) {
+                if (shared)
+                    parsers[i] = sempBeginSharedParser(&config, 0, 1200, NULL, NULL);
+                else
+                    parsers[i] = sempBeginParser("Hop", parsersTable, parserCount,
+                                                 parserNamesTable, parserCount, 0, 1200,
+                                                 hopEomCallback, NULL, NULL, NULL);
+                if (!parsers[i]) {
+                    printf("解析器初始化失败!\n");
+                    return -1;
+                }
+            }
+            nanoseconds = runHops(parsers, mode);
+            printf("%s %s: 帧 %ld, 每次切换 %.1f ns, 每字节 %.1f ns, 跨缓存行 %d\n",
+                   shared ? "共享配置" : "独立配置", modeNames[mode], g_frames,
+                   nanoseconds, nanoseconds / HOP_BYTES, countSplitParsers(parsers));
+            for (int i = 0; i < STREAM_COUNT; i++)
+                sempStopParser(&parsers[i]);
+        }
+    }
+    return 0;
+}
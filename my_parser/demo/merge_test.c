@@ -0,0 +1,241 @@
+/**
+ * @file merge_test.c
+ * @brief 多接收机数据流按历元合并测试程序
+ * @details 三个输入记录同一段200秒的数据: RTCM MSM7 (1077 GPS, 1087 GLONASS,
+ *          1097 Galileo, 1127 北斗)、UBX NAV-PVT和NMEA GGA (UTC). 每一帧的
+ *          合并键都应为该历元的GPS时间, 输出顺序单调. 测试覆盖周翻转、GPS和
+ *          UTC日翻转、GLONASS (莫斯科时间) 日翻转, 以及历元以GLONASS电文开始
+ *          的数据流.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../Message_Parser.h"
+#include "../Message_Merge.h"
+#include "../Message_RtcmEncoder.h"
+#include "../Message_NmeaWriter.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+
+#define EPOCHS          200
+#define INPUTS          3
+#define STREAM_BYTES    (EPOCHS * 4096)
+#define MAX_FRAMES      (EPOCHS * 8)
+#define LEAP_MSEC       18000ull
+#define DAY_MSEC        (24ull * 60 * 60 * 1000)
+#define WEEK_MSEC       (7 * DAY_MSEC)
+#define HOUR_MSEC       (60ull * 60 * 1000)
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+typedef struct {
+    uint8_t data[STREAM_BYTES];
+    size_t length;
+    size_t offset;              // Read position
+    uint64_t epochs[MAX_FRAMES]; // Expected key of each frame
+    int frames;
+} InputStream;
+
+typedef struct {
+    int frames[INPUTS];         // Frames output per input
+    uint64_t lastEpoch;
+    int failures;
+} MergeResult;
+
+static InputStream g_inputs[INPUTS];
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendFrame(InputStream *input, const void *data, size_t length, uint64_t epoch) {
+    memcpy(&input->data[input->length], data, length);
+    input->length += length;
+    input->epochs[input->frames++] = epoch;
+}
+
+static void appendMsm(uint16_t message, uint32_t epochTime, uint64_t epoch) {
+    uint8_t frame[SEMP_RTCM_MAX_FRAME_BYTES];
+    SEMP_RTCM_MSM_OBS obs[4];
+    SEMP_RTCM_MSM msm;
+
+    for (int i = 0; i < 4; i++) {
+        memset(&obs[i], 0, sizeof(obs[i]));
+        obs[i].satellite = 2 + i * 6;
+        obs[i].signal = 2;
+        obs[i].pseudorange = 20500000.0 + i * 731234.5;
+        obs[i].phaserange = obs[i].pseudorange + 0.21;
+        obs[i].cnr = 42;
+    }
+    memset(&msm, 0, sizeof(msm));
+    msm.message = message;
+    msm.station = 12;
+    msm.epochTime = epochTime;
+    msm.obsCount = 4;
+    msm.obs = obs;
+    appendFrame(&g_inputs[0], frame, sempRtcmEncodeMsm(frame, sizeof(frame), &msm), epoch);
+}
+
+static void appendNavPvt(uint32_t iTOW, uint64_t epoch) {
+    uint8_t frame[8 + 92];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    memset(frame, 0, sizeof(frame));
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = 0x01;
+    frame[3] = 0x07;
+    frame[4] = 92;
+    memcpy(&frame[6], &iTOW, sizeof(iTOW));
+    for (int i = 2; i < 6 + 92; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + 92] = ckA;
+    frame[7 + 92] = ckB;
+    appendFrame(&g_inputs[1], frame, sizeof(frame), epoch);
+}
+
+static void appendGga(uint32_t utcTod, uint64_t epoch) {
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+    SEMP_NMEA_FIX fix;
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.timeMs = utcTod;
+    fix.quality = 4;
+    fix.satellites = 18;
+    fix.hdop = 80;
+    appendFrame(&g_inputs[2], sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix),
+                epoch);
+}
+
+// All inputs record the same epochs, start is the GPS time of week of the first one
+static void buildInputs(uint64_t start, bool glonassFirst) {
+    uint64_t gps;
+    uint64_t moscow;
+    uint32_t tow;
+
+    memset(g_inputs, 0, sizeof(g_inputs));
+    for (int i = 0; i < EPOCHS; i++) {
+        gps = start + i * 1000ull;
+        tow = (uint32_t)(gps % WEEK_MSEC);
+
+        // GLONASS epoch time: day of week and Moscow time of day
+        moscow = gps + WEEK_MSEC - LEAP_MSEC + 3 * HOUR_MSEC;
+        if (glonassFirst)
+            appendMsm(1087, (uint32_t)((((moscow / DAY_MSEC) % 7) << 27) | (moscow % DAY_MSEC)), gps);
+        appendMsm(1077, tow, gps);
+        if (!glonassFirst)
+            appendMsm(1087, (uint32_t)((((moscow / DAY_MSEC) % 7) << 27) | (moscow % DAY_MSEC)), gps);
+        appendMsm(1097, tow, gps);
+        appendMsm(1127, (uint32_t)((gps + WEEK_MSEC - 14000) % WEEK_MSEC), gps);
+        appendNavPvt(tow, gps);
+        appendGga((uint32_t)((gps + WEEK_MSEC - LEAP_MSEC) % DAY_MSEC), gps);
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+size_t readInput(void *context, uint8_t *buffer, size_t length) {
+    InputStream *input = (InputStream *)context;
+
+    // Odd sized reads split the frames across calls
+    if (length > 777)
+        length = 777;
+    if (length > (input->length - input->offset))
+        length = input->length - input->offset;
+    memcpy(buffer, &input->data[input->offset], length);
+    input->offset += length;
+    return length;
+}
+
+void mergeOutput(void *context, uint8_t input, const SEMP_FRAME *frame, uint64_t epoch) {
+    MergeResult *result = (MergeResult *)context;
+    int index = result->frames[input]++;
+
+    if (index >= g_inputs[input].frames) {
+        result->failures++;
+        return;
+    }
+    if ((epoch != g_inputs[input].epochs[index]) || (epoch < result->lastEpoch)) {
+        if (result->failures++ < 4)
+            printf("  输入 %d 第 %d 帧: 键值 %llu, 应为 %llu, 上一键值 %llu\n", input, index,
+                   (unsigned long long)epoch, (unsigned long long)g_inputs[input].epochs[index],
+                   (unsigned long long)result->lastEpoch);
+    }
+    result->lastEpoch = epoch;
+}
+
+void printError(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static const SEMP_PARSE_ROUTINE parsersTable[] = {
+    sempRtcmPreamble, sempNmeaPreamble, sempUbloxPreamble,
+};
+static const char * const parserNames[] = {"RTCM3", "NMEA", "u-blox"};
+
+//----------------------------------------
+// 测试用例
+//----------------------------------------
+static int runMerge(const char *name, uint64_t start, bool glonassFirst) {
+    MergeResult result;
+    SEMP_MERGE *merge;
+
+    printf("%s, 起始GPS时间 %llu ms:\n", name, (unsigned long long)start);
+    buildInputs(start, glonassFirst);
+    memset(&result, 0, sizeof(result));
+    merge = sempMergeBegin(parsersTable, 3, parserNames, 1100, 16, mergeOutput, &result,
+                           printError);
+    if (!merge)
+        return 1;
+    for (int i = 0; i < INPUTS; i++)
+        sempMergeAddInput(merge, readInput, &g_inputs[i]);
+    if (!sempMergeRun(merge))
+        result.failures++;
+    sempMergeStop(&merge);
+
+    for (int i = 0; i < INPUTS; i++) {
+        if (result.frames[i] != g_inputs[i].frames) {
+            printf("  输入 %d 输出 %d 帧, 应为 %d\n", i, result.frames[i], g_inputs[i].frames);
+            result.failures++;
+        }
+    }
+    printf("  %d + %d + %d 帧, 最后键值 %llu, %s\n", result.frames[0], result.frames[1],
+           result.frames[2], (unsigned long long)result.lastEpoch,
+           result.failures ? "失败" : "通过");
+    return result.failures ? 1 : 0;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  多接收机数据流按历元合并测试 v1.0\n");
+    printf("=================================\n");
+
+    failures += runMerge("周三白天", 3 * DAY_MSEC + 11 * HOUR_MSEC, false);
+    failures += runMerge("GPS周及UTC日翻转", WEEK_MSEC - 100000, false);
+    failures += runMerge("GLONASS日翻转", 2 * DAY_MSEC + 21 * HOUR_MSEC + LEAP_MSEC - 100000,
+                         false);
+    failures += runMerge("历元以GLONASS电文开始", 5 * DAY_MSEC + 23 * HOUR_MSEC + 59 * 60000ull,
+                         true);
+
+    printf("\n--- 多接收机数据流按历元合并测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file nmea_writer_bench.c
+ * @brief NMEA语句生成器性能测试程序
+ * @details 为一组虚拟流动站生成GGA/RMC语句, 与snprintf实现比较输出内容和速度,
+ *          并用NMEA解析器校验生成语句的校验和
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../Message_Parser.h"
+#include "../Message_NmeaWriter.h"
+#include "../Parse_NMEA.h"
+
+#define ROVER_COUNT     500
+#define EPOCH_COUNT     2000
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+static SEMP_NMEA_FIX g_rovers[ROVER_COUNT];
+static long g_sentences;
+
+//----------------------------------------
+// snprintf基准实现
+//----------------------------------------
+static void snprintfAngle(char *buffer, size_t length, int32_t angle, int degreeDigits,
+                          char positive, char negative) {
+    uint32_t magnitude = (angle < 0) ? -(uint32_t)angle : (uint32_t)angle;
+    uint32_t minutes = (magnitude % 10000000) * 60;
+    snprintf(buffer, length, "%0*u%02u.%07u,%c", degreeDigits, magnitude / 10000000,
+             minutes / 10000000, minutes % 10000000, (angle < 0) ? negative : positive);
+}
+
+static int snprintfGga(char *buffer, size_t length, const SEMP_NMEA_FIX *fix) {
+    char latitude[20];
+    char longitude[20];
+    char body[SEMP_NMEA_MAX_SENTENCE];
+    uint32_t seconds = fix->timeMs / 1000;
+    uint8_t checksum;
+
+    snprintfAngle(latitude, sizeof(latitude), fix->latitude, 2, 'N', 'S');
+    snprintfAngle(longitude, sizeof(longitude), fix->longitude, 3, 'E', 'W');
+    snprintf(body, sizeof(body),
+             "GPGGA,%02u%02u%02u.%02u,%s,%s,%u,%02u,%u.%02u,%s%d.%03d,M,%s%d.%03d,M,%u.%u,%04u",
+             seconds / 3600, (seconds / 60) % 60, seconds % 60, (fix->timeMs % 1000) / 10,
+             latitude, longitude, fix->quality, fix->satellites, fix->hdop / 100, fix->hdop % 100,
+             (fix->altitude < 0) ? "-" : "", abs(fix->altitude) / 1000, abs(fix->altitude) % 1000,
+             (fix->geoidSeparation < 0) ? "-" : "", abs(fix->geoidSeparation) / 1000,
+             abs(fix->geoidSeparation) % 1000,
+             fix->differentialAge / 10, fix->differentialAge % 10, fix->station);
+    checksum = semp_util_calculateChecksum((const uint8_t *)body, strlen(body));
+    return snprintf(buffer, length, "$%s*%02X\r\n", body, checksum);
+}
+
+static int snprintfRmc(char *buffer, size_t length, const SEMP_NMEA_FIX *fix) {
+    char latitude[20];
+    char longitude[20];
+    char body[SEMP_NMEA_MAX_SENTENCE];
+    uint32_t seconds = fix->timeMs / 1000;
+    uint32_t knots = (uint32_t)((((uint64_t)fix->speed * 3600) + 926) / 1852);
+    uint8_t checksum;
+
+    snprintfAngle(latitude, sizeof(latitude), fix->latitude, 2, 'N', 'S');
+    snprintfAngle(longitude, sizeof(longitude), fix->longitude, 3, 'E', 'W');
+    snprintf(body, sizeof(body),
+             "GPRMC,%02u%02u%02u.%02u,A,%s,%s,%u.%03u,%u.%02u,%02u%02u%02u,,,%c",
+             seconds / 3600, (seconds / 60) % 60, seconds % 60, (fix->timeMs % 1000) / 10,
+             latitude, longitude, knots / 1000, knots % 1000, fix->course / 100, fix->course % 100,
+             fix->day, fix->month, fix->year % 100, (fix->quality == 4) ? 'R' : 'F');
+    checksum = semp_util_calculateChecksum((const uint8_t *)body, strlen(body));
+    return snprintf(buffer, length, "$%s*%02X\r\n", body, checksum);
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void benchEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    g_sentences++;
+}
+
+void benchPrintError(const char *format, ...) {
+}
+
+static double elapsedSeconds(const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    char expected[SEMP_NMEA_MAX_SENTENCE];
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+    struct timespec start;
+    double writerSeconds;
+    double snprintfSeconds;
+    long mismatches = 0;
+    long bytes = 0;
+    uint16_t length;
+
+    printf("=================================\n");
+    printf("  NMEA语句生成器性能测试 v1.0\n");
+    printf("=================================\n");
+
+    // 1. 生成虚拟流动站
+    srand(1);
+    for (int i = 0; i < ROVER_COUNT; i++) {
+        SEMP_NMEA_FIX *fix = &g_rovers[i];
+        memset(fix, 0, sizeof(*fix));
+        sempNmeaSetPosition(fix, -60 + (rand() % 120000) / 1000.0, -170 + (rand() % 340000) / 1000.0,
+                            -50 + (rand() % 3000000) / 1000.0);
+        fix->geoidSeparation = -30000 + rand() % 60000;
+        fix->quality = (i & 1) ? 4 : 5;
+        fix->satellites = 8 + (i % 30);
+        fix->hdop = 50 + (i % 200);
+        fix->differentialAge = 1 + (i % 50);
+        fix->station = i % 4096;
+        fix->speed = rand() % 40000;
+        fix->course = rand() % 36000;
+        fix->day = 17;
+        fix->month = 10;
+        fix->year = 2024;
+    }
+
+    // 2. 比较输出内容并用解析器校验
+    const SEMP_PARSE_ROUTINE parsersTable[] = { sempNmeaPreamble };
+    const char *parserNamesTable[] = { "NMEA" };
+    SEMP_PARSE_STATE *parser = sempBeginParser("NmeaWriterBench", parsersTable, 1,
+                                               parserNamesTable, 1, 0, 256,
+                                               benchEomCallback, benchPrintError, NULL, NULL);
+    if (!parser) {
+        printf("解析器初始化失败!\n");
+        return -1;
+    }
+    for (int i = 0; i < ROVER_COUNT; i++) {
+        g_rovers[i].timeMs = 45296780 + i * 10;
+        length = sempNmeaWriteGga(sentence, sizeof(sentence), "GP", &g_rovers[i]);
+        snprintfGga(expected, sizeof(expected), &g_rovers[i]);
+        mismatches += (strcmp(sentence, expected) != 0);
+        for (uint16_t j = 0; j < length; j++)
+            sempParseNextByte(parser, (uint8_t)sentence[j]);
+        length = sempNmeaWriteRmc(sentence, sizeof(sentence), "GP", &g_rovers[i]);
+        snprintfRmc(expected, sizeof(expected), &g_rovers[i]);
+        mismatches += (strcmp(sentence, expected) != 0);
+        for (uint16_t j = 0; j < length; j++)
+            sempParseNextByte(parser, (uint8_t)sentence[j]);
+    }
+    sempStopParser(&parser);
+    printf("GGA/RMC: %d 条, 内容不一致 %ld 条, 解析器校验通过 %ld 条\n",
+           ROVER_COUNT * 2, mismatches, g_sentences);
+    printf("示例: %s", sentence);
+
+    // 3. 性能比较
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int epoch = 0; epoch < EPOCH_COUNT; epoch++) {
+        for (int i = 0; i < ROVER_COUNT; i++) {
+            g_rovers[i].timeMs = epoch * 1000;
+            bytes += sempNmeaWriteGga(sentence, sizeof(sentence), "GP", &g_rovers[i]);
+            bytes += sempNmeaWriteRmc(sentence, sizeof(sentence), "GP", &g_rovers[i]);
+        }
+    }
+    writerSeconds = elapsedSeconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int epoch = 0; epoch < EPOCH_COUNT; epoch++) {
+        for (int i = 0; i < ROVER_COUNT; i++) {
+            g_rovers[i].timeMs = epoch * 1000;
+            bytes += snprintfGga(sentence, sizeof(sentence), &g_rovers[i]);
+            bytes += snprintfRmc(sentence, sizeof(sentence), &g_rovers[i]);
+        }
+    }
+    snprintfSeconds = elapsedSeconds(&start);
+
+    printf("\n--- 性能测试总结 (%d 个流动站 x %d 历元) ---\n", ROVER_COUNT, EPOCH_COUNT);
+    printf("  - 生成器 : %8.1f 万条/秒\n", 2.0 * ROVER_COUNT * EPOCH_COUNT / writerSeconds / 1e4);
+    printf("  - snprintf: %8.1f 万条/秒\n", 2.0 * ROVER_COUNT * EPOCH_COUNT / snprintfSeconds / 1e4);
+    printf("  - 加速比 : %.1fx (%ld 字节)\n", snprintfSeconds / writerSeconds, bytes);
+    printf("=======================\n");
+    return (mismatches == 0) ? 0 : -1;
+}
@@ -0,0 +1,297 @@
+/**
+ * @file order_bench.c
+ * @brief 按帧频率排序前导探测顺序的一致性与性能测试程序
+ * @details 生成偏斜的协议混合数据流 (90% RTCM, 9% NMEA, 1% UBX), 以及
+ *          中途由NMEA为主变为RTCM为主的数据流, 分别按parsers table顺序和
+ *          按帧频率排序的顺序解析. 比较两者输出的全部帧, 统计每帧调用
+ *          前导函数的次数和解析速度. parsers table与stress_test相同,
+ *          NMEA在前, 另测试RTCM在表尾的最坏顺序.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../Message_Parser.h"
+#include "../Message_NmeaWriter.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+#include "../Parse_Unicore_Hash.h"
+
+#define STREAM_BYTES    (512 * 1024)
+#define SORT_INTERVAL   64
+#define BENCH_ROUNDS    40
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+
+// Running hash of the frames a parser outputs
+typedef struct {
+    uint64_t hash;
+    long frames;
+} OutputLog;
+
+static uint8_t g_stream[STREAM_BYTES];
+static size_t g_streamLength;
+static long g_probes;
+
+static void logBytes(OutputLog *log, const void *data, size_t length) {
+    log->hash = semp_util_hash64((const uint8_t *)data, (uint16_t)length, log->hash);
+}
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendRtcm(uint16_t message, uint16_t length) {
+    static uint8_t frame[6 + 1023];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message);
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (frame[4] & 0x0f));
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    appendBytes(frame, 6 + length);
+}
+
+// Append frames picked at random, rtcmPercent and nmeaPercent of the
+// frames are RTCM and NMEA, the rest u-blox
+static void appendMix(size_t endLength, int rtcmPercent, int nmeaPercent, uint32_t *seed) {
+    SEMP_NMEA_FIX fix;
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+    int pick;
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.quality = 4;
+    fix.satellites = 21;
+    fix.hdop = 70;
+    while (g_streamLength < endLength) {
+        *seed = *seed * 1103515245 + 12345;
+        pick = (*seed >> 8) % 100;
+        if (pick < rtcmPercent)
+            appendRtcm(1074 + ((*seed >> 16) % 4) * 10, 20 + ((*seed >> 20) % 100));
+        else if (pick < (rtcmPercent + nmeaPercent)) {
+            fix.timeMs += 100;
+            appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        }
+        else
+            appendUblox(0x01, 0x07, 92);
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void orderEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    OutputLog *log = (OutputLog *)parse->userContext;
+
+    log->frames++;
+    logBytes(log, &type, sizeof(type));
+    logBytes(log, &parse->msg_length, sizeof(parse->msg_length));
+    logBytes(log, parse->buffer, parse->msg_length);
+}
+
+// Count the preamble routine calls
+static bool countNmea(SEMP_PARSE_STATE *parse, uint8_t data) {
+    g_probes++;
+    return sempNmeaPreamble(parse, data);
+}
+
+static bool countRtcm(SEMP_PARSE_STATE *parse, uint8_t data) {
+    g_probes++;
+    return sempRtcmPreamble(parse, data);
+}
+
+static bool countUblox(SEMP_PARSE_STATE *parse, uint8_t data) {
+    g_probes++;
+    return sempUbloxPreamble(parse, data);
+}
+
+static bool countUnicoreBinary(SEMP_PARSE_STATE *parse, uint8_t data) {
+    g_probes++;
+    return sempUnicoreBinaryPreamble(parse, data);
+}
+
+static bool countUnicoreHash(SEMP_PARSE_STATE *parse, uint8_t data) {
+    g_probes++;
+    return sempUnicoreHashPreamble(parse, data);
+}
+
+//----------------------------------------
+// 测试流程
+//----------------------------------------
+typedef struct {
+    const char *name;
+    const SEMP_PARSE_ROUTINE *parsersTable;
+    const SEMP_PARSE_ROUTINE *countTable;
+    const char * const *parserNames;
+} TableOrder;
+
+static const SEMP_PARSE_ROUTINE g_stressTable[] = {
+    sempNmeaPreamble, sempRtcmPreamble, sempUbloxPreamble,
+    sempUnicoreBinaryPreamble, sempUnicoreHashPreamble,
+};
+static const SEMP_PARSE_ROUTINE g_stressCount[] = {
+    countNmea, countRtcm, countUblox, countUnicoreBinary, countUnicoreHash,
+};
+static const char * const g_stressNames[] = {
+    "NMEA", "RTCM3", "u-blox", "Unicore-BIN", "Unicore-HASH"
+};
+static const SEMP_PARSE_ROUTINE g_worstTable[] = {
+    sempNmeaPreamble, sempUbloxPreamble, sempUnicoreBinaryPreamble,
+    sempUnicoreHashPreamble, sempRtcmPreamble,
+};
+static const SEMP_PARSE_ROUTINE g_worstCount[] = {
+    countNmea, countUblox, countUnicoreBinary, countUnicoreHash, countRtcm,
+};
+static const char * const g_worstNames[] = {
+    "NMEA", "u-blox", "Unicore-BIN", "Unicore-HASH", "RTCM3"
+};
+static const TableOrder g_orders[] = {
+    {"NMEA在前", g_stressTable, g_stressCount, g_stressNames},
+    {"RTCM在后", g_worstTable, g_worstCount, g_worstNames},
+};
+#define PARSER_COUNT    (sizeof(g_stressTable) / sizeof(g_stressTable[0]))
+
+static double elapsedSeconds(const struct timespec *start) {
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static SEMP_PARSE_STATE * beginParser(const SEMP_PARSE_ROUTINE *parsersTable,
+                                      const char * const *parserNames,
+                                      uint16_t sortInterval,
+                                      OutputLog *log) {
+    SEMP_PARSE_STATE *parse;
+
+    parse = sempBeginParser("Order", parsersTable, PARSER_COUNT, parserNames, PARSER_COUNT,
+                            0, 3000, orderEomCallback, NULL, NULL, NULL);
+    if (parse) {
+        memset(log, 0, sizeof(OutputLog));
+        parse->userContext = log;
+        sempEnableAdaptiveOrder(parse, sortInterval);
+    }
+    return parse;
+}
+
+// Parse the stream, returns the parse time in ns per byte
+static double runParser(const TableOrder *order, uint16_t sortInterval,
+                        OutputLog *log, double *probesPerFrame) {
+    SEMP_PARSE_STATE *parse;
+    struct timespec start;
+    OutputLog benchLog;
+    double seconds;
+
+    // Output and preamble calls
+    parse = beginParser(order->countTable, order->parserNames, sortInterval, log);
+    if (!parse)
+        return -1;
+    g_probes = 0;
+    sempParseBuffer(parse, g_stream, g_streamLength);
+    sempStopParser(&parse);
+    *probesPerFrame = log->frames ? (double)g_probes / log->frames : 0;
+
+    // Parse time
+    parse = beginParser(order->parsersTable, order->parserNames, sortInterval, &benchLog);
+    sempParseBuffer(parse, g_stream, g_streamLength);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+        sempParseBuffer(parse, g_stream, g_streamLength);
+    seconds = elapsedSeconds(&start);
+    sempStopParser(&parse);
+    return seconds * 1e9 / (BENCH_ROUNDS * g_streamLength);
+}
+
+static int compareOrders(const char *name) {
+    OutputLog expected;
+    OutputLog actual;
+    double tableProbes;
+    double sortedProbes;
+    double tableTime;
+    double sortedTime;
+    int failures = 0;
+    bool identical;
+
+    for (size_t i = 0; i < sizeof(g_orders) / sizeof(g_orders[0]); i++) {
+        tableTime = runParser(&g_orders[i], 0, &expected, &tableProbes);
+        sortedTime = runParser(&g_orders[i], SORT_INTERVAL, &actual, &sortedProbes);
+        identical = (expected.hash == actual.hash) && (expected.frames == actual.frames);
+        printf("%s %s: 帧 %ld, 前导调用 %.2f -> %.2f 次/帧, %.2f -> %.2f ns/字节, %s\n",
+               name, g_orders[i].name, expected.frames, tableProbes, sortedProbes,
+               tableTime, sortedTime, identical ? "一致" : "不一致");
+        if (!identical)
+            failures++;
+    }
+    return failures;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    uint32_t seed = 2024;
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  前导探测顺序测试 v1.0\n");
+    printf("=================================\n");
+    printf("排序间隔: %d 帧, 表顺序 -> 频率顺序\n", SORT_INTERVAL);
+
+    g_streamLength = 0;
+    appendMix(STREAM_BYTES - 4096, 90, 9, &seed);
+    failures += compareOrders("偏斜混合");
+
+    // The mix changes halfway through the stream
+    g_streamLength = 0;
+    appendMix(STREAM_BYTES / 2, 5, 90, &seed);
+    appendMix(STREAM_BYTES - 4096, 90, 5, &seed);
+    failures += compareOrders("混合变化");
+
+    printf("\n--- 前导探测顺序测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,355 @@
+/**
+ * @file pipeline_bench.c
+ * @brief 单数据流流水线解析一致性与性能测试程序
+ * @details 生成RTCM、NMEA、u-blox和Unicore混合的高速数据流, 其中部分帧含
+ *          错误字节. 分别在单线程中逐帧分帧、校验、解码和输出, 以及用四级
+ *          流水线处理, 比较输出的帧序列 (按顺序计算的哈希) 和吞吐量.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../Message_Parser.h"
+#include "../Message_Pipeline.h"
+#include "../Message_NmeaWriter.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+
+#define STREAM_BYTES    (64 * 1024 * 1024)
+#define BLOCK_BYTES     (64 * 1024)
+#define BLOCK_COUNT     16
+#define QUEUE_FRAMES    4096
+#define BENCH_ROUNDS    3
+
+// Parser table order, the frame types
+#define TYPE_RTCM       0
+#define TYPE_NMEA       1
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+static uint8_t *g_stream;
+static size_t g_streamLength;
+
+// Output of a run
+typedef struct _BENCH_OUTPUT
+{
+    uint64_t hash;
+    uint64_t frames;
+    uint64_t lastSequence;
+    int outOfOrder;
+} BENCH_OUTPUT;
+
+// Input position of a run
+typedef struct _BENCH_INPUT
+{
+    size_t offset;
+} BENCH_INPUT;
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendRtcm(uint16_t message, uint16_t length) {
+    static uint8_t frame[6 + 1023];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message);
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (frame[4] & 0x0f));
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    appendBytes(frame, 6 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    static uint8_t frame[24 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+// 记录接收机的混合数据流, 含错误字节
+static void buildStream(void) {
+    SEMP_NMEA_FIX fix;
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+    uint32_t seed = 2024;
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.quality = 4;
+    fix.satellites = 21;
+    fix.hdop = 70;
+
+    g_streamLength = 0;
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 16384); epoch++) {
+        seed = seed * 1103515245 + 12345;
+        fix.timeMs = 45296000 + epoch * 100;
+        appendRtcm(1077, 200 + ((seed >> 16) % 400));
+        appendRtcm(1087, 100 + ((seed >> 20) % 300));
+        appendUnicoreBinary(1000 + (epoch & 0xff), 96 + ((seed >> 12) % 200));
+        appendUblox(0x01, 0x07, 92);
+        appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        if ((epoch % 10) == 0)
+            appendBytes(sentence, sempNmeaWriteRmc(sentence, sizeof(sentence), "GN", &fix));
+    }
+
+    // Corrupt a few bytes for bad CRCs
+    for (int i = 0; i < 2000; i++) {
+        seed = seed * 1103515245 + 12345;
+        g_stream[(seed >> 4) % g_streamLength] ^= (uint8_t)(1 << (seed & 7));
+    }
+}
+
+//----------------------------------------
+// 解码与输出
+//----------------------------------------
+
+// Stand in for the application decoders
+static uint64_t decodeFrame(const SEMP_FRAME *frame) {
+    char sentence[256];
+    char fields[32][24];
+    uint64_t value = 0;
+    uint32_t bits;
+    int count;
+
+    if (frame->type == TYPE_RTCM) {
+        // 12 bit fields of the message
+        bits = (frame->length - 6) * 8;
+        for (uint32_t offset = 24; (offset + 12) <= (24 + bits); offset += 12)
+            value += sempRtcmGetBits(frame->buffer, offset, 12);
+    }
+    else if (frame->type == TYPE_NMEA) {
+        if (frame->length < sizeof(sentence)) {
+            memcpy(sentence, frame->buffer, frame->length);
+            sentence[frame->length] = 0;
+            count = semp_util_parse_delimited_fields(sentence, fields, 32, 24, ',', '*');
+            for (int i = 0; i < count; i++)
+                value += strlen(fields[i]) * (i + 1);
+        }
+    }
+    else {
+        for (uint16_t i = 0; i < frame->length; i++)
+            value += frame->buffer[i];
+    }
+    return value;
+}
+
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t length) {
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    while (length--)
+        hash = (hash ^ *bytes++) * 0x100000001b3ULL;
+    return hash;
+}
+
+static void outputFrame(BENCH_OUTPUT *output, const SEMP_FRAME *frame, uint64_t decoded) {
+    output->hash = hashBytes(output->hash, &frame->type, sizeof(frame->type));
+    output->hash = hashBytes(output->hash, frame->buffer, frame->length);
+    output->hash = hashBytes(output->hash, &decoded, sizeof(decoded));
+    output->frames++;
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+
+// Single thread: validate, decode and output each frame
+void singleEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    BENCH_OUTPUT *output = (BENCH_OUTPUT *)parse->userContext;
+    SEMP_FRAME frame;
+
+    sempGetFrame(parse, type, &frame);
+    if (sempFrameValidate(&frame))
+        outputFrame(output, &frame, decodeFrame(&frame));
+}
+
+static size_t pipelineRead(void *context, uint8_t *buffer, size_t length) {
+    BENCH_INPUT *input = (BENCH_INPUT *)context;
+
+    if (length > (g_streamLength - input->offset))
+        length = g_streamLength - input->offset;
+    memcpy(buffer, &g_stream[input->offset], length);
+    input->offset += length;
+    return length;
+}
+
+static void pipelineDecode(void *context, SEMP_PIPELINE_FRAME *frame) {
+    frame->userData = decodeFrame(&frame->frame);
+}
+
+static void pipelineOutput(void *context, const SEMP_PIPELINE_FRAME *frame) {
+    BENCH_OUTPUT *output = (BENCH_OUTPUT *)context;
+
+    if (output->frames && (frame->sequence <= output->lastSequence))
+        output->outOfOrder++;
+    output->lastSequence = frame->sequence;
+    outputFrame(output, &frame->frame, frame->userData);
+}
+
+//----------------------------------------
+// 测试流程
+//----------------------------------------
+static double elapsedSeconds(const struct timespec *start) {
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static const SEMP_PARSE_ROUTINE parsersTable[] = {
+    sempRtcmPreamble, sempNmeaPreamble, sempUbloxPreamble, sempUnicoreBinaryPreamble,
+};
+static const char * const parserNames[] = {"RTCM3", "NMEA", "u-blox", "Unicore-BIN"};
+#define PARSER_COUNT    (sizeof(parsersTable) / sizeof(parsersTable[0]))
+
+// Read the stream in blocks like the pipeline and handle each frame in turn
+static double runSingle(BENCH_OUTPUT *output) {
+    SEMP_PARSE_STATE *parse;
+    struct timespec start;
+    size_t offset;
+    size_t length;
+
+    memset(output, 0, sizeof(*output));
+    output->hash = 0xcbf29ce484222325ULL;
+    parse = sempBeginParser("Single", parsersTable, PARSER_COUNT, parserNames, PARSER_COUNT,
+                            0, 3000, singleEomCallback, NULL, NULL, NULL);
+    if (!parse)
+        return 0;
+    sempEnableLazyValidation(parse, true);
+    parse->userContext = output;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (offset = 0; offset < g_streamLength; offset += length) {
+        length = g_streamLength - offset;
+        if (length > BLOCK_BYTES)
+            length = BLOCK_BYTES;
+        sempParseBuffer(parse, &g_stream[offset], length);
+    }
+    sempStopParser(&parse);
+    return elapsedSeconds(&start);
+}
+
+static double runPipeline(BENCH_OUTPUT *output, SEMP_PIPELINE_STATS *stats) {
+    SEMP_PIPELINE *pipeline;
+    BENCH_INPUT input;
+    struct timespec start;
+
+    memset(output, 0, sizeof(*output));
+    output->hash = 0xcbf29ce484222325ULL;
+    pipeline = sempPipelineBegin(parsersTable, PARSER_COUNT, parserNames, 3000,
+                                 BLOCK_BYTES, BLOCK_COUNT, QUEUE_FRAMES,
+                                 pipelineDecode, pipelineOutput, output, NULL);
+    if (!pipeline)
+        return 0;
+    input.offset = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sempPipelineRun(pipeline, pipelineRead, &input);
+    sempPipelineGetStats(pipeline, stats);
+    sempPipelineStop(&pipeline);
+    return elapsedSeconds(&start);
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    BENCH_OUTPUT single;
+    BENCH_OUTPUT piped;
+    SEMP_PIPELINE_STATS stats;
+    double singleSeconds = 0;
+    double pipelineSeconds = 0;
+    double seconds;
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  单数据流流水线解析测试 v1.0\n");
+    printf("=================================\n");
+
+    g_stream = (uint8_t *)malloc(STREAM_BYTES);
+    if (!g_stream)
+        return -1;
+    buildStream();
+    printf("数据流 %zu 字节, 输入块 %d x %d 字节, 队列 %d 帧\n",
+           g_streamLength, BLOCK_COUNT, BLOCK_BYTES, QUEUE_FRAMES);
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        seconds = runSingle(&single);
+        if ((!round) || (seconds < singleSeconds))
+            singleSeconds = seconds;
+        seconds = runPipeline(&piped, &stats);
+        if ((!round) || (seconds < pipelineSeconds))
+            pipelineSeconds = seconds;
+
+        if ((piped.hash != single.hash) || (piped.frames != single.frames) || piped.outOfOrder) {
+            printf("第 %d 轮输出不一致: 单线程 %llu 帧, 流水线 %llu 帧, 乱序 %d\n",
+                   round, (unsigned long long)single.frames,
+                   (unsigned long long)piped.frames, piped.outOfOrder);
+            failures++;
+        }
+    }
+
+    printf("帧 %llu, 坏帧 %llu, 复制 %llu, 丢弃 %llu\n",
+           (unsigned long long)stats.frames, (unsigned long long)stats.badFrames,
+           (unsigned long long)stats.copiedFrames, (unsigned long long)stats.droppedFrames);
+    printf("单线程 %.1f MB/s, 流水线 %.1f MB/s\n",
+           g_streamLength / singleSeconds / 1e6, g_streamLength / pipelineSeconds / 1e6);
+
+    free(g_stream);
+    printf("\n--- 单数据流流水线解析测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,386 @@
+/**
+ * @file pool_test.c
+ * @brief 按需借用缓冲区的多数据流解析测试程序
+ * @details 多个数据流交错发送u-blox、RTCM和NMEA帧, 每次调用的数据长度随机,
+ *          帧跨越多次调用. 检查在途的帧保留其借用的缓冲区且内容为已收到的
+ *          部分帧, 帧结束和重新同步后缓冲区归还, 大量空闲数据流不占用缓冲区,
+ *          以及每个数据流交付的帧与普通解析器逐个解析该数据流的结果相同.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../Message_Parser.h"
+#include "../Message_Pool.h"
+#include "../Message_RtcmEncoder.h"
+#include "../Message_NmeaWriter.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+
+#define STREAMS         400
+#define FRAMES          24              // Frames per stream
+#define STREAM_BYTES    (FRAMES * 1100)
+#define BUFFER_BYTES    2048
+#define IDLE_STREAMS    10000
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+
+// Frames delivered for one stream
+typedef struct {
+    uint64_t hash;              // Hash chain of the frames and their types
+    int frames;
+} FrameLog;
+
+typedef struct {
+    uint8_t data[STREAM_BYTES];
+    size_t length;
+    size_t offset;              // Bytes passed to the pool
+    size_t starts[FRAMES];      // Offset of each frame
+    SEMP_COMPACT_STATE state;
+    FrameLog pooled;            // Frames from the pool
+    FrameLog direct;            // Frames from a parser of its own
+} TestStream;
+
+static TestStream *g_streams;
+static uint32_t g_seed = 62;
+
+static uint32_t nextRandom(void) {
+    g_seed = g_seed * 1103515245 + 12345;
+    return g_seed >> 8;
+}
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static size_t appendUblox(uint8_t *frame, uint16_t payload, uint32_t seed) {
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = 0x01;
+    frame[3] = 0x07;
+    frame[4] = (uint8_t)payload;
+    frame[5] = (uint8_t)(payload >> 8);
+    for (uint16_t i = 0; i < payload; i++)
+        frame[6 + i] = (uint8_t)(seed + i * 17);
+    for (int i = 2; i < 6 + payload; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + payload] = ckA;
+    frame[7 + payload] = ckB;
+    return payload + 8;
+}
+
+static size_t appendMsm(uint8_t *frame, uint16_t station, uint8_t obsCount) {
+    SEMP_RTCM_MSM_OBS obs[32];
+    SEMP_RTCM_MSM msm;
+
+    for (int i = 0; i < obsCount; i++) {
+        memset(&obs[i], 0, sizeof(obs[i]));
+        obs[i].satellite = 1 + i;
+        obs[i].signal = 2;
+        obs[i].pseudorange = 20000000.0 + station * 10.0 + i * 123456.5;
+        obs[i].phaserange = obs[i].pseudorange + 0.3;
+        obs[i].cnr = 40;
+    }
+    memset(&msm, 0, sizeof(msm));
+    msm.message = 1077;
+    msm.station = station;
+    msm.epochTime = nextRandom() & 0x3fffffff;
+    msm.obsCount = obsCount;
+    msm.obs = obs;
+    return sempRtcmEncodeMsm(frame, SEMP_RTCM_MAX_FRAME_BYTES, &msm);
+}
+
+static size_t appendGga(uint8_t *frame, uint32_t timeMs) {
+    SEMP_NMEA_FIX fix;
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.timeMs = timeMs;
+    fix.quality = 4;
+    fix.satellites = 18;
+    fix.hdop = 80;
+    return sempNmeaWriteGga((char *)frame, SEMP_NMEA_MAX_SENTENCE, "GN", &fix);
+}
+
+static void buildStream(TestStream *stream, uint16_t number) {
+    memset(stream, 0, sizeof(*stream));
+    for (int f = 0; f < FRAMES; f++) {
+        uint8_t *frame = &stream->data[stream->length];
+
+        stream->starts[f] = stream->length;
+        switch (nextRandom() % 3) {
+        case 0:
+            stream->length += appendUblox(frame, 16 + nextRandom() % 1000, nextRandom());
+            break;
+        case 1:
+            stream->length += appendMsm(frame, number, 1 + nextRandom() % 32);
+            break;
+        default:
+            stream->length += appendGga(frame, nextRandom() % 86400000);
+            break;
+        }
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void poolEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    FrameLog *log = (FrameLog *)parse->userContext;
+
+    log->hash = semp_util_hash64(parse->buffer, parse->msg_length, log->hash + type);
+    log->frames++;
+}
+
+void printError(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static const SEMP_PARSE_ROUTINE parsersTable[] = {
+    sempUbloxPreamble, sempRtcmPreamble, sempNmeaPreamble,
+};
+static const char * const parserNames[] = {"u-blox", "RTCM3", "NMEA"};
+
+//----------------------------------------
+// 测试用例
+//----------------------------------------
+
+// Streams interleave, frames cross the calls
+static int testInterleaved(SEMP_BUFFER_POOL *pool) {
+    SEMP_POOL_STATS stats;
+    SEMP_PARSE_STATE *parse;
+    TestStream *stream;
+    uint32_t inFlight = 0;
+    uint32_t peakLent = 0;
+    int remaining = STREAMS;
+    int badBuffers = 0;
+    int frame;
+    int failures = 0;
+    size_t length;
+
+    printf("\n%d 个数据流交错:\n", STREAMS);
+    for (int s = 0; s < STREAMS; s++)
+        buildStream(&g_streams[s], s);
+
+    while (remaining) {
+        for (int s = 0; s < STREAMS; s++) {
+            stream = &g_streams[s];
+            if (stream->offset == stream->length)
+                continue;
+            length = 1 + nextRandom() % 300;
+            if (length > (stream->length - stream->offset))
+                length = stream->length - stream->offset;
+            if (stream->state.buffer)
+                inFlight--;
+            sempPoolParse(pool, &stream->state, &stream->data[stream->offset], length,
+                          &stream->pooled);
+            stream->offset += length;
+            if (stream->offset == stream->length)
+                remaining--;
+
+            // The buffer holds the start of the frame in flight.  The NMEA
+            // parser does not count the carriage return, so compare from
+            // the start of the frame rather than the end of the data.
+            if (stream->state.buffer) {
+                inFlight++;
+                for (frame = FRAMES - 1; stream->starts[frame] >= stream->offset; frame--)
+                    ;
+                if ((!stream->state.msg_length)
+                    || ((stream->starts[frame] + stream->state.msg_length) > stream->offset)
+                    || ((SEMP_POOL_SMALLEST_BUFFER << stream->state.sizeClass)
+                        < stream->state.msg_length)
+                    || memcmp(stream->state.buffer, &stream->data[stream->starts[frame]],
+                              stream->state.msg_length))
+                    badBuffers++;
+            } else if (stream->state.stateId || stream->state.msg_length) {
+                badBuffers++;
+            }
+
+            // Only the streams with a frame in flight hold a buffer
+            sempPoolGetStats(pool, &stats);
+            if (stats.lentBuffers != inFlight)
+                badBuffers++;
+            if (stats.lentBuffers > peakLent)
+                peakLent = stats.lentBuffers;
+        }
+    }
+
+    // The same streams through a parser of their own
+    parse = sempBeginParser("Direct", parsersTable, 3, parserNames, 3, 0, BUFFER_BYTES,
+                            poolEomCallback, printError, NULL, NULL);
+    if (!parse)
+        return 1;
+    for (int s = 0; s < STREAMS; s++) {
+        stream = &g_streams[s];
+        parse->userContext = &stream->direct;
+        sempParseBuffer(parse, stream->data, stream->length);
+        if ((stream->pooled.frames != FRAMES) || (stream->direct.frames != FRAMES)
+            || (stream->pooled.hash != stream->direct.hash)) {
+            if (failures++ < 4)
+                printf("  数据流 %d: 缓冲池 %d 帧, 普通解析器 %d 帧, 内容%s\n", s,
+                       stream->pooled.frames, stream->direct.frames,
+                       (stream->pooled.hash == stream->direct.hash) ? "相同" : "不同");
+        }
+    }
+    sempStopParser(&parse);
+
+    sempPoolGetStats(pool, &stats);
+    printf("  %d 帧, 最多借出 %u 个缓冲区, %u 个slab, %u 字节, 缓冲区错误 %d\n",
+           STREAMS * FRAMES, peakLent, stats.slabs, stats.reservedBytes, badBuffers);
+    if (badBuffers || stats.lentBuffers)
+        failures++;
+    return failures;
+}
+
+// One frame in flight across calls, then a resync
+static int testInFlight(SEMP_BUFFER_POOL *pool) {
+    static const uint8_t badLength[] = {0xb5, 0x62, 0x01, 0x07, 0xff, 0xff};
+    static const char badNmea[] = "$GPGGA?,1234";
+    uint8_t frame[1100];
+    SEMP_COMPACT_STATE state;
+    SEMP_POOL_STATS stats;
+    FrameLog log;
+    const uint8_t *buffer = NULL;
+    uint8_t sizeClass = 0;
+    size_t length;
+    int moves = 0;
+    int failures = 0;
+
+    printf("\n在途的帧:\n");
+    memset(&state, 0, sizeof(state));
+    memset(&log, 0, sizeof(log));
+    length = appendUblox(frame, 1000, 7);
+
+    // The buffer only moves when the frame outgrows its size class
+    for (size_t offset = 0; offset < (length - 1); offset += 7) {
+        sempPoolParse(pool, &state, &frame[offset],
+                      ((length - 1 - offset) < 7) ? (length - 1 - offset) : 7, &log);
+        sempPoolGetStats(pool, &stats);
+        if ((!state.buffer) || (stats.lentBuffers != 1) || log.frames) {
+            failures++;
+            break;
+        }
+        if (buffer && (state.buffer != buffer)) {
+            moves++;
+            if ((state.sizeClass <= sizeClass)
+                || (state.msg_length <= (SEMP_POOL_SMALLEST_BUFFER << sizeClass)))
+                failures++;
+        }
+        buffer = state.buffer;
+        sizeClass = state.sizeClass;
+    }
+    sempPoolParse(pool, &state, &frame[length - 1], 1, &log);
+    sempPoolGetStats(pool, &stats);
+    printf("  %zu 字节的帧, 缓冲区更换 %d 次, 交付 %d 帧, 之后借出 %u\n", length, moves,
+           log.frames, stats.lentBuffers);
+    if ((log.frames != 1) || state.buffer || stats.lentBuffers || (moves != 4))
+        failures++;
+
+    // A length beyond the worker buffer resyncs, the buffer comes back
+    sempPoolParse(pool, &state, badLength, 4, &log);
+    sempPoolGetStats(pool, &stats);
+    if ((!state.buffer) || (stats.lentBuffers != 1))
+        failures++;
+    sempPoolParse(pool, &state, &badLength[4], 2, &log);
+    sempPoolGetStats(pool, &stats);
+    if (state.buffer || stats.lentBuffers)
+        failures++;
+
+    // An invalid sentence name character ends the NMEA sentence early
+    sempPoolParse(pool, &state, (const uint8_t *)badNmea, 5, &log);
+    sempPoolGetStats(pool, &stats);
+    if ((!state.buffer) || (stats.lentBuffers != 1))
+        failures++;
+    sempPoolParse(pool, &state, (const uint8_t *)&badNmea[5], strlen(badNmea) - 5, &log);
+    sempPoolGetStats(pool, &stats);
+    if (state.buffer || stats.lentBuffers || (log.frames != 1))
+        failures++;
+
+    // A stream closed mid frame returns its buffer
+    sempPoolParse(pool, &state, frame, 100, &log);
+    sempPoolEndStream(pool, &state);
+    sempPoolGetStats(pool, &stats);
+    printf("  重新同步及关闭后借出 %u, 交付 %d 帧\n", stats.lentBuffers, log.frames);
+    if (state.buffer || stats.lentBuffers)
+        failures++;
+    return failures;
+}
+
+// Streams whose calls end on frame boundaries never borrow a buffer
+static int testIdle(SEMP_BUFFER_POOL *pool) {
+    SEMP_COMPACT_STATE *states;
+    SEMP_POOL_STATS before;
+    SEMP_POOL_STATS after;
+    FrameLog log;
+    uint8_t frame[SEMP_RTCM_MAX_FRAME_BYTES];
+    size_t length;
+    int failures = 0;
+
+    printf("\n%d 个空闲数据流:\n", IDLE_STREAMS);
+    states = (SEMP_COMPACT_STATE *)calloc(IDLE_STREAMS, sizeof(SEMP_COMPACT_STATE));
+    if (!states)
+        return 1;
+    memset(&log, 0, sizeof(log));
+    sempPoolGetStats(pool, &before);
+    for (int s = 0; s < IDLE_STREAMS; s++) {
+        length = (s & 1) ? appendMsm(frame, s & 0xfff, 8) : appendGga(frame, s * 1000);
+        sempPoolParse(pool, &states[s], frame, length, &log);
+    }
+    sempPoolGetStats(pool, &after);
+    for (int s = 0; s < IDLE_STREAMS; s++)
+        if (states[s].buffer || states[s].msg_length)
+            failures++;
+    printf("  %zu 字节/数据流, 交付 %d 帧, 借出 %u, slab %u -> %u\n",
+           sizeof(SEMP_COMPACT_STATE), log.frames, after.lentBuffers, before.slabs, after.slabs);
+    if ((log.frames != IDLE_STREAMS) || after.lentBuffers || (after.slabs != before.slabs))
+        failures++;
+    free(states);
+    return failures;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    SEMP_BUFFER_POOL *pool;
+    SEMP_PARSE_STATE *worker;
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  按需借用缓冲区的多数据流解析测试 v1.0\n");
+    printf("=================================\n");
+
+    g_streams = (TestStream *)malloc(STREAMS * sizeof(TestStream));
+    worker = sempBeginParser("Pool", parsersTable, 3, parserNames, 3, 0, BUFFER_BYTES,
+                             poolEomCallback, printError, NULL, NULL);
+    pool = sempPoolBegin(worker);
+    if ((!g_streams) || (!pool))
+        return -1;
+
+    failures += testInterleaved(pool);
+    failures += testInFlight(pool);
+    failures += testIdle(pool);
+
+    sempPoolStop(&pool);
+    sempStopParser(&worker);
+    free(g_streams);
+    if (pool)
+        failures++;
+
+    printf("\n--- 按需借用缓冲区的多数据流解析测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,330 @@
+/**
+ * @file relay_test.c
+ * @brief RTCM差分数据零拷贝转发测试程序
+ * @details 混合基准站和消息号的RTCM数据流 (含CRC错误帧和无效字节) 分成
+ *          奇数长度的小段交给转发器, 帧跨越两次sempRelayInput调用. 四个订阅者:
+ *          - 流订阅者, 不过滤: 收到所有有效帧, 字节完全相同
+ *          - 流订阅者, 按基准站和消息号过滤 (星历电文不含基准站ID)
+ *          - 数据报订阅者, 按消息号过滤: 每个数据报恰好一帧
+ *          - 流订阅者, 发送缓冲区很小且不及时读取: 缓存满后整帧丢弃,
+ *            收到的数据仍是完整帧的序列
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "../Message_Parser.h"
+#include "../Message_Relay.h"
+#include "../Parse_RTCM.h"
+
+#define FRAME_COUNT     600
+#define STREAM_BYTES    (FRAME_COUNT * 512)
+#define PIECE_BYTES     97
+#define BACKLOG_BYTES   4096
+#define SUBSCRIBERS     4
+
+// Subscriber numbers
+#define ALL_FRAMES      0
+#define FILTERED        1
+#define DATAGRAMS       2
+#define SLOW            3
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+typedef struct {
+    size_t offset;              // Frame offset in the stream
+    uint16_t length;
+    uint16_t message;
+    uint16_t station;
+    bool valid;                 // CRC is correct
+} FrameRecord;
+
+typedef struct {
+    int writeFd;                // Given to the relay
+    int readFd;                 // Read by the test
+    uint8_t *received;          // Bytes read
+    size_t receivedLength;
+    uint32_t datagrams;         // Datagrams read
+    uint32_t badDatagrams;      // Datagrams not holding a single expected frame
+} Subscriber;
+
+static uint8_t g_stream[STREAM_BYTES];
+static size_t g_streamLength;
+static FrameRecord g_frames[FRAME_COUNT];
+static Subscriber g_subscribers[SUBSCRIBERS];
+
+static const uint16_t g_stationFilter[] = {2};
+static const uint16_t g_messageFilter[] = {1077, 1019, 1060, 4073};
+static const uint16_t g_datagramFilter[] = {1005};
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendRtcm(FrameRecord *record, uint16_t message, uint16_t station,
+                       uint16_t length, bool corrupt) {
+    uint8_t *frame = &g_stream[g_streamLength];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message + station);
+
+    // Message number then the station ID.  Ephemerides carry a satellite ID
+    // there, SSR messages an epoch time and proprietary messages vendor bits
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (station >> 8));
+    frame[5] = (uint8_t)station;
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    if (corrupt)
+        frame[3 + length / 2] ^= 0x10;
+
+    record->offset = g_streamLength;
+    record->length = 6 + length;
+    record->message = message;
+    record->station = station;
+    record->valid = !corrupt;
+    g_streamLength += 6 + length;
+}
+
+static void buildStream(void) {
+    static const uint16_t messages[] = {1077, 1087, 1005, 1019, 1230, 1060, 4073};
+    uint32_t seed = 12345;
+
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        seed = seed * 1103515245 + 12345;
+        appendRtcm(&g_frames[i], messages[i % 7], 1 + ((seed >> 16) % 3),
+                   20 + ((seed >> 8) % 400), (i % 41) == 40);
+        if ((i % 17) == 0) {
+            memcpy(&g_stream[g_streamLength], "\x00\xd3\xffgarbage", 10);
+            g_streamLength += 10;
+        }
+    }
+}
+
+// Determine if the subscriber accepts the frame
+static bool accepts(int subscriber, const FrameRecord *record) {
+    if (!record->valid)
+        return false;
+    switch (subscriber) {
+    default:
+        return true;
+    case FILTERED:
+        // Messages without a station ID pass the station filter
+        return ((record->message == 1077) && (record->station == 2)) || (record->message == 1019)
+               || (record->message == 1060) || (record->message == 4073);
+    case DATAGRAMS:
+        return record->message == 1005;
+    }
+}
+
+//----------------------------------------
+// 套接字
+//----------------------------------------
+static bool openSubscriber(Subscriber *subscriber, int type, int sendBytes) {
+    int fds[2];
+
+    if (socketpair(AF_UNIX, type, 0, fds))
+        return false;
+    subscriber->writeFd = fds[0];
+    subscriber->readFd = fds[1];
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    if (sendBytes)
+        setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sendBytes, sizeof(sendBytes));
+    subscriber->received = (uint8_t *)malloc(STREAM_BYTES);
+    subscriber->receivedLength = 0;
+    subscriber->datagrams = 0;
+    subscriber->badDatagrams = 0;
+    return subscriber->received != NULL;
+}
+
+// Read everything waiting on the socket
+static void drain(Subscriber *subscriber, bool datagrams) {
+    uint8_t datagram[SEMP_RTCM_MAX_FRAME_BYTES + 1];
+    ssize_t bytes;
+    FrameRecord *record;
+
+    if (!datagrams) {
+        while ((bytes = read(subscriber->readFd, &subscriber->received[subscriber->receivedLength],
+                             STREAM_BYTES - subscriber->receivedLength)) > 0)
+            subscriber->receivedLength += bytes;
+        return;
+    }
+
+    // Each datagram holds the next accepted frame
+    while ((bytes = recv(subscriber->readFd, datagram, sizeof(datagram), 0)) > 0) {
+        record = NULL;
+        for (uint32_t i = 0, n = 0; i < FRAME_COUNT; i++)
+            if (accepts(DATAGRAMS, &g_frames[i]) && (n++ == subscriber->datagrams)) {
+                record = &g_frames[i];
+                break;
+            }
+        if ((!record) || (bytes != record->length)
+            || memcmp(datagram, &g_stream[record->offset], bytes))
+            subscriber->badDatagrams++;
+        subscriber->datagrams++;
+    }
+}
+
+//----------------------------------------
+// 检查
+//----------------------------------------
+
+// The received bytes are the accepted frames in order, skipping dropped
+// frames when allowed, returns the number of frames found
+static int matchFrames(const Subscriber *subscriber, int id, bool allowDrops, int *failures) {
+    size_t position = 0;
+    int frames = 0;
+
+    for (int i = 0; (i < FRAME_COUNT) && (position < subscriber->receivedLength); i++) {
+        if (!accepts(id, &g_frames[i]))
+            continue;
+        if (((position + g_frames[i].length) <= subscriber->receivedLength)
+            && (!memcmp(&subscriber->received[position], &g_stream[g_frames[i].offset],
+                        g_frames[i].length))) {
+            position += g_frames[i].length;
+            frames++;
+        } else if (!allowDrops)
+            break;
+    }
+    if (position != subscriber->receivedLength) {
+        printf("  订阅者 %d: 收到的数据在第 %zu 字节处与帧序列不符\n", id, position);
+        (*failures)++;
+    }
+    return frames;
+}
+
+static int expectedFrames(int subscriber) {
+    int frames = 0;
+
+    for (int i = 0; i < FRAME_COUNT; i++)
+        if (accepts(subscriber, &g_frames[i]))
+            frames++;
+    return frames;
+}
+
+void printError(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    static const char * const names[SUBSCRIBERS] = {"全部", "基准站2/1077,1019,SSR", "1005数据报", "慢速"};
+    SEMP_RELAY_STATS stats[SUBSCRIBERS];
+    SEMP_RELAY *relay;
+    int ids[SUBSCRIBERS];
+    uint32_t forwarded = 0;
+    uint32_t crossing = 0;
+    size_t piece;
+    int received;
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  RTCM差分数据零拷贝转发测试 v1.0\n");
+    printf("=================================\n");
+
+    buildStream();
+    for (int i = 0; i < FRAME_COUNT; i++)
+        if ((g_frames[i].offset / PIECE_BYTES)
+            != ((g_frames[i].offset + g_frames[i].length - 1) / PIECE_BYTES))
+            crossing++;
+
+    if ((!openSubscriber(&g_subscribers[ALL_FRAMES], SOCK_STREAM, 0))
+        || (!openSubscriber(&g_subscribers[FILTERED], SOCK_STREAM, 0))
+        || (!openSubscriber(&g_subscribers[DATAGRAMS], SOCK_DGRAM, 0))
+        || (!openSubscriber(&g_subscribers[SLOW], SOCK_STREAM, 4096)))
+        return -1;
+
+    relay = sempRelayBegin(SUBSCRIBERS, 8, BACKLOG_BYTES, printError);
+    if (!relay)
+        return -1;
+    ids[ALL_FRAMES] = sempRelayAddSubscriber(relay, g_subscribers[ALL_FRAMES].writeFd,
+                                             SEMP_RELAY_STREAM);
+    ids[FILTERED] = sempRelayAddSubscriber(relay, g_subscribers[FILTERED].writeFd,
+                                           SEMP_RELAY_STREAM);
+    ids[DATAGRAMS] = sempRelayAddSubscriber(relay, g_subscribers[DATAGRAMS].writeFd,
+                                            SEMP_RELAY_DATAGRAM);
+    ids[SLOW] = sempRelayAddSubscriber(relay, g_subscribers[SLOW].writeFd, SEMP_RELAY_STREAM);
+    sempRelaySetFilter(relay, ids[FILTERED], g_stationFilter, 1, g_messageFilter, 4);
+    sempRelaySetFilter(relay, ids[DATAGRAMS], NULL, 0, g_datagramFilter, 1);
+
+    // Small pieces, most frames cross the receive buffers.  The slow
+    // subscriber is only read at the end.
+    for (size_t offset = 0; offset < g_streamLength; offset += piece) {
+        piece = ((g_streamLength - offset) < PIECE_BYTES) ? (g_streamLength - offset) : PIECE_BYTES;
+        forwarded += sempRelayInput(relay, &g_stream[offset], piece);
+        drain(&g_subscribers[ALL_FRAMES], false);
+        drain(&g_subscribers[FILTERED], false);
+        drain(&g_subscribers[DATAGRAMS], true);
+    }
+
+    // Empty inputs flush the backlog while the slow subscriber catches up
+    for (int i = 0; i < 100; i++) {
+        drain(&g_subscribers[SLOW], false);
+        sempRelayInput(relay, g_stream, 0);
+        sempRelayGetStats(relay, ids[SLOW], &stats[SLOW]);
+        if (!stats[SLOW].backlogBytes)
+            break;
+    }
+    drain(&g_subscribers[SLOW], false);
+
+    printf("%d 帧, %u 帧跨越两次输入, 转发 %u 次\n", FRAME_COUNT, crossing, forwarded);
+    for (int s = 0; s < SUBSCRIBERS; s++) {
+        sempRelayGetStats(relay, ids[s], &stats[s]);
+        received = (s == DATAGRAMS) ? (int)g_subscribers[s].datagrams
+                                    : matchFrames(&g_subscribers[s], s, s == SLOW, &failures);
+        printf("  %-18s 收到 %d 帧 %zu 字节, 统计 %u 帧 %llu 字节, 丢弃 %u, 应收 %d 帧\n",
+               names[s], received, g_subscribers[s].receivedLength, stats[s].frames,
+               (unsigned long long)stats[s].bytes, stats[s].dropped, expectedFrames(s));
+
+        // Every accepted frame is either received whole or counted as dropped
+        if ((received != (int)stats[s].frames)
+            || ((stats[s].frames + stats[s].dropped) != (uint32_t)expectedFrames(s))
+            || stats[s].backlogBytes) {
+            printf("  %s: 帧数不一致\n", names[s]);
+            failures++;
+        }
+        if ((s != DATAGRAMS) && (stats[s].bytes != g_subscribers[s].receivedLength))
+            failures++;
+        if ((s != SLOW) && stats[s].dropped)
+            failures++;
+    }
+    if (g_subscribers[DATAGRAMS].badDatagrams) {
+        printf("  %u 个数据报内容错误\n", g_subscribers[DATAGRAMS].badDatagrams);
+        failures++;
+    }
+    if (!stats[SLOW].dropped) {
+        printf("  慢速订阅者没有丢帧, 缓存满的情况未覆盖\n");
+        failures++;
+    }
+    if (!crossing)
+        failures++;
+
+    sempRelayStop(&relay);
+    for (int s = 0; s < SUBSCRIBERS; s++) {
+        close(g_subscribers[s].writeFd);
+        close(g_subscribers[s].readFd);
+        free(g_subscribers[s].received);
+    }
+    printf("\n--- RTCM差分数据零拷贝转发测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
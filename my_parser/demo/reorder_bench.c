@@ -0,0 +1,397 @@
+/**
+ * @file reorder_bench.c
+ * @brief 并行解码重排序缓冲区一致性测试程序
+ * @details 分帧线程解析RTCM、NMEA、u-blox和Unicore混合数据流, 在eomCallback
+ *          中预留序号, 多个解码线程以任意顺序解码 (RTCM帧解码耗时较长),
+ *          经重排序缓冲区输出. 比较输出顺序和内容与单线程结果, 并测试队首
+ *          超时: 一个帧在超时后才提交, 应被跳过且提交失败.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "../Message_Parser.h"
+#include "../Message_Reorder.h"
+#include "../Message_NmeaWriter.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+
+#define STREAM_BYTES    (8 * 1024 * 1024)
+#define WINDOW_FRAMES   256
+#define WORKER_COUNT    4
+#define TIMEOUT_MS      20
+#define LATE_SEQUENCE   1000        // Frame completed after the timeout
+#define NO_SEQUENCE     UINT64_MAX
+
+// Parser table order, the frame types
+#define TYPE_RTCM       0
+#define TYPE_NMEA       1
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+static uint8_t *g_stream;
+static size_t g_streamLength;
+
+// Frame waiting for a decode thread, indexed by sequence & window
+typedef struct _BENCH_JOB
+{
+    uint8_t bytes[2048];
+    SEMP_FRAME frame;
+    uint64_t sequence;
+    uint64_t decoded;
+} BENCH_JOB;
+
+typedef struct _BENCH_RUN
+{
+    SEMP_REORDER *reorder;
+    BENCH_JOB jobs[WINDOW_FRAMES];
+    atomic_uint_fast64_t published;     // Sequences available to the workers
+    atomic_uint_fast64_t claimed;       // Next sequence to decode
+    atomic_bool finished;               // Framing done
+    uint64_t lateSequence;              // Sequence completed after the timeout
+    bool lateRefused;                   // The late completion failed
+    uint64_t hash;                      // Output in sequence order
+    uint64_t frames;
+    uint64_t lastSequence;
+    int outOfOrder;
+} BENCH_RUN;
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendRtcm(uint16_t message, uint16_t length) {
+    static uint8_t frame[6 + 1023];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message);
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (frame[4] & 0x0f));
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    appendBytes(frame, 6 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    static uint8_t frame[24 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+static void buildStream(void) {
+    SEMP_NMEA_FIX fix;
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+    uint32_t seed = 71;
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.quality = 4;
+    fix.satellites = 21;
+
+    g_streamLength = 0;
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 16384); epoch++) {
+        seed = seed * 1103515245 + 12345;
+        fix.timeMs = 45296000 + epoch * 100;
+        appendRtcm(1077, 200 + ((seed >> 16) % 400));
+        appendUnicoreBinary(1000 + (epoch & 0xff), 96 + ((seed >> 12) % 200));
+        appendUblox(0x01, 0x07, 92);
+        appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        appendRtcm(1087, 100 + ((seed >> 20) % 300));
+    }
+}
+
+//----------------------------------------
+// 解码与输出
+//----------------------------------------
+static uint64_t nowMilliseconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Stand in for the application decoders, the MSM frames are slow
+static uint64_t decodeFrame(const SEMP_FRAME *frame) {
+    char sentence[256];
+    char fields[32][24];
+    uint64_t value = 0;
+    uint32_t bits;
+    int count;
+
+    if (frame->type == TYPE_RTCM) {
+        bits = (frame->length - 6) * 8;
+        for (int pass = 0; pass < 8; pass++)
+            for (uint32_t offset = 24; (offset + 12) <= (24 + bits); offset += 12)
+                value += sempRtcmGetBits(frame->buffer, offset, 12) ^ pass;
+    }
+    else if (frame->type == TYPE_NMEA) {
+        if (frame->length < sizeof(sentence)) {
+            memcpy(sentence, frame->buffer, frame->length);
+            sentence[frame->length] = 0;
+            count = semp_util_parse_delimited_fields(sentence, fields, 32, 24, ',', '*');
+            for (int i = 0; i < count; i++)
+                value += strlen(fields[i]) * (i + 1);
+        }
+    }
+    else {
+        for (uint16_t i = 0; i < frame->length; i++)
+            value += frame->buffer[i];
+    }
+    return value;
+}
+
+static uint64_t hashFrame(uint64_t hash, const SEMP_FRAME *frame, uint64_t decoded) {
+    const uint8_t *bytes = frame->buffer;
+
+    hash = (hash ^ frame->type) * 0x100000001b3ULL;
+    for (uint16_t i = 0; i < frame->length; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    return (hash ^ decoded) * 0x100000001b3ULL;
+}
+
+// Called by the thread draining the reorder buffer
+static void reorderOutput(void *context, uint64_t sequence, void *item) {
+    BENCH_RUN *run = (BENCH_RUN *)context;
+    BENCH_JOB *job = (BENCH_JOB *)item;
+
+    if ((job->sequence != sequence) || (run->frames && (sequence <= run->lastSequence)))
+        run->outOfOrder++;
+    run->lastSequence = sequence;
+    run->hash = hashFrame(run->hash, &job->frame, job->decoded);
+    run->frames++;
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+
+// Reference: decode and output each frame in turn
+void singleEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    BENCH_RUN *run = (BENCH_RUN *)parse->userContext;
+    SEMP_FRAME frame;
+
+    sempGetFrame(parse, type, &frame);
+    if (run->frames != run->lateSequence)
+        run->hash = hashFrame(run->hash, &frame, decodeFrame(&frame));
+    else
+        run->outOfOrder++;          // Count the skipped frame
+    run->frames++;
+}
+
+// Framing thread: reserve the sequence and hand the frame to the workers
+void parallelEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    BENCH_RUN *run = (BENCH_RUN *)parse->userContext;
+    BENCH_JOB *job;
+    uint64_t sequence;
+
+    // The window bounds the frames in flight
+    while (!sempReorderReserve(run->reorder, &sequence)) {
+        sempReorderPoll(run->reorder, nowMilliseconds());
+        sched_yield();
+    }
+    job = &run->jobs[sequence % WINDOW_FRAMES];
+    sempGetFrame(parse, type, &job->frame);
+    memcpy(job->bytes, parse->buffer, parse->msg_length);
+    job->frame.buffer = job->bytes;
+    job->sequence = sequence;
+    atomic_store_explicit(&run->published, sequence + 1, memory_order_release);
+}
+
+static void * decodeThread(void *arg) {
+    BENCH_RUN *run = (BENCH_RUN *)arg;
+    BENCH_JOB *job;
+    uint64_t sequence;
+
+    for (;;) {
+        sequence = atomic_fetch_add(&run->claimed, 1);
+        while (sequence >= atomic_load_explicit(&run->published, memory_order_acquire)) {
+            if (atomic_load(&run->finished)
+                && (sequence >= atomic_load(&run->published)))
+                return nullptr;
+            sched_yield();
+        }
+        // Hold one frame past the head of line timeout.  The window slot is
+        // reused once the frame times out, so the late worker does not read it.
+        if (sequence == run->lateSequence) {
+            SEMP_REORDER_STATS stats;
+
+            do {
+                sched_yield();
+                sempReorderGetStats(run->reorder, &stats);
+            } while (!stats.timedOut);
+            run->lateRefused = !sempReorderComplete(run->reorder, sequence, NULL);
+            continue;
+        }
+        job = &run->jobs[sequence % WINDOW_FRAMES];
+        job->decoded = decodeFrame(&job->frame);
+        sempReorderComplete(run->reorder, sequence, job);
+    }
+}
+
+//----------------------------------------
+// 测试流程
+//----------------------------------------
+static const SEMP_PARSE_ROUTINE parsersTable[] = {
+    sempRtcmPreamble, sempNmeaPreamble, sempUbloxPreamble, sempUnicoreBinaryPreamble,
+};
+static const char * const parserNames[] = {"RTCM3", "NMEA", "u-blox", "Unicore-BIN"};
+#define PARSER_COUNT    (sizeof(parsersTable) / sizeof(parsersTable[0]))
+
+static bool parseStream(SEMP_EOM_CALLBACK callback, BENCH_RUN *run) {
+    SEMP_PARSE_STATE *parse;
+
+    parse = sempBeginParser("Reorder", parsersTable, PARSER_COUNT, parserNames, PARSER_COUNT,
+                            0, 3000, callback, NULL, NULL, NULL);
+    if (!parse)
+        return false;
+    parse->userContext = run;
+    sempParseBuffer(parse, g_stream, g_streamLength);
+    sempStopParser(&parse);
+    return true;
+}
+
+static int runTest(uint64_t lateSequence) {
+    static BENCH_RUN single;
+    static BENCH_RUN parallel;
+    pthread_t workers[WORKER_COUNT];
+    SEMP_REORDER_STATS stats;
+    struct timespec start;
+    struct timespec end;
+    int failures = 0;
+
+    // Single threaded reference output
+    memset(&single, 0, sizeof(single));
+    single.hash = 0xcbf29ce484222325ULL;
+    single.lateSequence = lateSequence;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!parseStream(singleEomCallback, &single))
+        return 1;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("单线程: %llu 帧, %.1f ms\n", (unsigned long long)single.frames,
+           (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+
+    // Parallel decode
+    memset(&parallel, 0, sizeof(parallel));
+    parallel.hash = 0xcbf29ce484222325ULL;
+    parallel.lateSequence = lateSequence;
+    atomic_init(&parallel.published, 0);
+    atomic_init(&parallel.claimed, 0);
+    atomic_init(&parallel.finished, false);
+    parallel.reorder = sempReorderBegin(WINDOW_FRAMES, (lateSequence == NO_SEQUENCE) ? 0 : TIMEOUT_MS,
+                                        reorderOutput, &parallel, NULL);
+    if (!parallel.reorder)
+        return 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < WORKER_COUNT; i++)
+        pthread_create(&workers[i], NULL, decodeThread, &parallel);
+    parseStream(parallelEomCallback, &parallel);
+    atomic_store(&parallel.finished, true);
+    for (int i = 0; i < WORKER_COUNT; i++)
+        pthread_join(workers[i], NULL);
+    sempReorderPoll(parallel.reorder, nowMilliseconds());
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sempReorderGetStats(parallel.reorder, &stats);
+    sempReorderStop(&parallel.reorder);
+
+    printf("%d 个解码线程: 输出 %llu 帧, 超时 %llu, 迟到 %llu, 窗口满 %llu, 乱序 %d, %.1f ms\n",
+           WORKER_COUNT, (unsigned long long)stats.released, (unsigned long long)stats.timedOut,
+           (unsigned long long)stats.lateFrames, (unsigned long long)stats.fullWindows,
+           parallel.outOfOrder,
+           (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+
+    if ((parallel.hash != single.hash) || parallel.outOfOrder
+        || ((parallel.frames + single.outOfOrder) != single.frames)) {
+        printf("输出与单线程不一致\n");
+        failures++;
+    }
+    if ((lateSequence != NO_SEQUENCE)
+        && ((stats.timedOut != 1) || (!parallel.lateRefused) || (stats.lateFrames != 1))) {
+        printf("队首超时处理错误\n");
+        failures++;
+    }
+    return failures;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  重排序缓冲区测试 v1.0\n");
+    printf("=================================\n");
+
+    g_stream = (uint8_t *)malloc(STREAM_BYTES);
+    if (!g_stream)
+        return -1;
+    buildStream();
+    printf("数据流 %zu 字节, 窗口 %d 帧\n", g_streamLength, WINDOW_FRAMES);
+
+    printf("\n--- 按顺序输出 ---\n");
+    failures += runTest(NO_SEQUENCE);
+    printf("\n--- 队首超时 (第 %d 帧迟到) ---\n", LATE_SEQUENCE);
+    failures += runTest(LATE_SEQUENCE);
+
+    free(g_stream);
+    printf("\n--- 重排序缓冲区测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,368 @@
+/**
+ * @file router_bench.c
+ * @brief 帧发布/订阅路由一致性与性能测试程序
+ * @details 三个解析线程各解析一个RTCM、NMEA、u-blox和Unicore混合数据流,
+ *          在eomCallback中把帧发布到路由器. 四个订阅者分别订阅MSM消息
+ *          (两个接收线程)、数据流1的NMEA、全部消息和数据流0、2的UBX NAV-PVT.
+ *          每个订阅者收到的帧数和内容 (与顺序无关的哈希和) 与单线程按相同
+ *          条件筛选的结果比较, 结束时所有缓冲区都应已归还.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "../Message_Parser.h"
+#include "../Message_Router.h"
+#include "../Message_NmeaWriter.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+
+#define STREAM_BYTES    (2 * 1024 * 1024)
+#define STREAM_COUNT    3
+#define SUBSCRIBERS     4
+#define QUEUE_FRAMES    32768
+#define BUFFER_COUNT    32768
+#define BUFFER_BYTES    1100
+
+// Parser table order, the frame types
+#define TYPE_RTCM       0
+#define TYPE_NMEA       1
+#define TYPE_UBLOX      2
+#define PROTOCOLS       4
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+static uint8_t *g_stream;
+static size_t g_streamLength;
+static uint8_t *g_streams[STREAM_COUNT];
+static size_t g_streamLengths[STREAM_COUNT];
+static SEMP_ROUTER *g_router;
+static atomic_bool g_published;             // All of the parsers are done
+
+// Frames received by a subscriber
+typedef struct _BENCH_SUBSCRIBER
+{
+    int id;
+    atomic_uint_fast64_t frames;
+    atomic_uint_fast64_t hashSum;
+    uint64_t expectedFrames;
+    uint64_t expectedHashSum;
+} BENCH_SUBSCRIBER;
+
+static BENCH_SUBSCRIBER g_subscribers[SUBSCRIBERS];
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendRtcm(uint16_t message, uint16_t length) {
+    static uint8_t frame[6 + 1023];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message);
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (frame[4] & 0x0f));
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    appendBytes(frame, 6 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    static uint8_t frame[24 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+// 混合数据流, 含错误字节, 各数据流的种子不同
+static void buildStream(uint32_t seed) {
+    SEMP_NMEA_FIX fix;
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.quality = 4;
+    fix.satellites = 21;
+
+    g_streamLength = 0;
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 16384); epoch++) {
+        seed = seed * 1103515245 + 12345;
+        fix.timeMs = 45296000 + epoch * 100;
+        appendRtcm(1077, 200 + ((seed >> 16) % 400));
+        appendUnicoreBinary(1000 + (epoch & 0xff), 96 + ((seed >> 12) % 200));
+        appendUblox(0x01, 0x07, 92);
+        appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        appendRtcm(1087, 100 + ((seed >> 20) % 300));
+    }
+    for (int i = 0; i < 200; i++) {
+        seed = seed * 1103515245 + 12345;
+        g_stream[(seed >> 4) % g_streamLength] ^= (uint8_t)(1 << (seed & 7));
+    }
+}
+
+//----------------------------------------
+// 帧描述与订阅条件
+//----------------------------------------
+static uint16_t frameMessageId(const SEMP_FRAME *frame) {
+    if (frame->type == TYPE_RTCM)
+        return (uint16_t)sempRtcmGetBits(frame->buffer, 24, 12);
+    if (frame->type == TYPE_UBLOX)
+        return (uint16_t)((frame->buffer[2] << 8) | frame->buffer[3]);
+    if (frame->type == TYPE_NMEA)
+        return 0;
+    return (uint16_t)(frame->buffer[4] | (frame->buffer[5] << 8));
+}
+
+static uint64_t hashFrame(uint16_t stream, uint16_t messageId, const SEMP_FRAME *frame) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    hash = (hash ^ stream) * 0x100000001b3ULL;
+    hash = (hash ^ frame->type) * 0x100000001b3ULL;
+    hash = (hash ^ messageId) * 0x100000001b3ULL;
+    for (uint16_t i = 0; i < frame->length; i++)
+        hash = (hash ^ frame->buffer[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+// The subscriptions, as the giant switch of an eomCallback would test them
+static bool subscriberWants(int subscriber, uint16_t stream, const SEMP_FRAME *frame,
+                            uint16_t messageId) {
+    switch (subscriber) {
+    case 0:     // RTCM MSM1 - MSM7 of all the constellations
+        return (frame->type == TYPE_RTCM) && (messageId >= 1071) && (messageId <= 1137);
+    case 1:     // NMEA of stream 1
+        return (frame->type == TYPE_NMEA) && (stream == 1);
+    case 2:     // Monitor
+        return true;
+    default:    // UBX NAV-PVT of streams 0 and 2
+        return (frame->type == TYPE_UBLOX) && (messageId == 0x0107) && (stream != 1);
+    }
+}
+
+static void subscribe(void) {
+    static const uint16_t nmeaStreams[] = {1};
+    static const uint16_t pvtStreams[] = {0, 2};
+
+    for (int i = 0; i < SUBSCRIBERS; i++)
+        g_subscribers[i].id = sempRouterAddSubscriber(g_router, QUEUE_FRAMES);
+    sempRouterSubscribe(g_router, g_subscribers[0].id, TYPE_RTCM, 1071, 1137);
+    sempRouterSubscribe(g_router, g_subscribers[1].id, TYPE_NMEA, 0, SEMP_ROUTER_ALL_IDS);
+    sempRouterSelectStreams(g_router, g_subscribers[1].id, nmeaStreams, 1);
+    for (uint8_t protocol = 0; protocol < PROTOCOLS; protocol++)
+        sempRouterSubscribe(g_router, g_subscribers[2].id, protocol, 0, SEMP_ROUTER_ALL_IDS);
+    sempRouterSubscribe(g_router, g_subscribers[3].id, TYPE_UBLOX, 0x0107, 0x0107);
+    sempRouterSelectStreams(g_router, g_subscribers[3].id, pvtStreams, 2);
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+
+// Reference: apply the subscriptions in a single thread
+void referenceEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    uint16_t stream = (uint16_t)(uintptr_t)parse->userContext;
+    uint16_t messageId;
+    SEMP_FRAME frame;
+
+    sempGetFrame(parse, type, &frame);
+    messageId = frameMessageId(&frame);
+    for (int i = 0; i < SUBSCRIBERS; i++) {
+        if (subscriberWants(i, stream, &frame, messageId)) {
+            g_subscribers[i].expectedFrames++;
+            g_subscribers[i].expectedHashSum += hashFrame(stream, messageId, &frame);
+        }
+    }
+}
+
+void routerEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    SEMP_FRAME frame;
+
+    sempGetFrame(parse, type, &frame);
+    sempRouterPublish(g_router, (uint16_t)(uintptr_t)parse->userContext, &frame,
+                      frameMessageId(&frame));
+}
+
+//----------------------------------------
+// 线程
+//----------------------------------------
+static const SEMP_PARSE_ROUTINE parsersTable[] = {
+    sempRtcmPreamble, sempNmeaPreamble, sempUbloxPreamble, sempUnicoreBinaryPreamble,
+};
+static const char * const parserNames[] = {"RTCM3", "NMEA", "u-blox", "Unicore-BIN"};
+
+static void parseStream(uint16_t stream, SEMP_EOM_CALLBACK callback) {
+    SEMP_PARSE_STATE *parse;
+
+    parse = sempBeginParser("Router", parsersTable, PROTOCOLS, parserNames, PROTOCOLS,
+                            0, 3000, callback, NULL, NULL, NULL);
+    if (!parse)
+        return;
+    parse->userContext = (void *)(uintptr_t)stream;
+    sempParseBuffer(parse, g_streams[stream], g_streamLengths[stream]);
+    sempStopParser(&parse);
+}
+
+static void * parserThread(void *arg) {
+    parseStream((uint16_t)(uintptr_t)arg, routerEomCallback);
+    return NULL;
+}
+
+static void * subscriberThread(void *arg) {
+    BENCH_SUBSCRIBER *subscriber = (BENCH_SUBSCRIBER *)arg;
+    const SEMP_ROUTER_FRAME *frame;
+    bool done;
+
+    for (;;) {
+        done = atomic_load(&g_published);
+        frame = sempRouterReceive(g_router, subscriber->id);
+        if (!frame) {
+            if (done)
+                return NULL;
+            sched_yield();
+            continue;
+        }
+        atomic_fetch_add(&subscriber->frames, 1);
+        atomic_fetch_add(&subscriber->hashSum,
+                         hashFrame(frame->stream, frame->messageId, &frame->frame));
+        sempRouterRelease(g_router, frame);
+    }
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    static const char * const names[SUBSCRIBERS] = {"MSM", "NMEA 流1", "全部", "NAV-PVT 流0,2"};
+    pthread_t parsers[STREAM_COUNT];
+    pthread_t receivers[SUBSCRIBERS + 1];
+    SEMP_ROUTER_SUBSCRIBER_STATS subscriberStats;
+    SEMP_ROUTER_STATS stats;
+    struct timespec start;
+    struct timespec end;
+    uint64_t totalFrames = 0;
+    double seconds;
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  帧发布/订阅路由测试 v1.0\n");
+    printf("=================================\n");
+
+    g_stream = (uint8_t *)malloc(STREAM_BYTES);
+    if (!g_stream)
+        return -1;
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        buildStream(4242 + i * 17);
+        g_streams[i] = (uint8_t *)malloc(g_streamLength);
+        if (!g_streams[i])
+            return -1;
+        memcpy(g_streams[i], g_stream, g_streamLength);
+        g_streamLengths[i] = g_streamLength;
+        parseStream((uint16_t)i, referenceEomCallback);
+    }
+
+    g_router = sempRouterBegin(PROTOCOLS, STREAM_COUNT, BUFFER_COUNT, BUFFER_BYTES, NULL);
+    if (!g_router)
+        return -1;
+    subscribe();
+
+    // Two receivers share the MSM queue
+    atomic_init(&g_published, false);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < SUBSCRIBERS; i++)
+        pthread_create(&receivers[i], NULL, subscriberThread, &g_subscribers[i]);
+    pthread_create(&receivers[SUBSCRIBERS], NULL, subscriberThread, &g_subscribers[0]);
+    for (int i = 0; i < STREAM_COUNT; i++)
+        pthread_create(&parsers[i], NULL, parserThread, (void *)(uintptr_t)i);
+    for (int i = 0; i < STREAM_COUNT; i++)
+        pthread_join(parsers[i], NULL);
+    atomic_store(&g_published, true);
+    for (int i = 0; i <= SUBSCRIBERS; i++)
+        pthread_join(receivers[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    for (int i = 0; i < SUBSCRIBERS; i++) {
+        sempRouterGetSubscriberStats(g_router, g_subscribers[i].id, &subscriberStats);
+        printf("%-16s 收到 %llu / %llu 帧, 丢弃 %llu%s\n", names[i],
+               (unsigned long long)atomic_load(&g_subscribers[i].frames),
+               (unsigned long long)g_subscribers[i].expectedFrames,
+               (unsigned long long)subscriberStats.dropped,
+               (atomic_load(&g_subscribers[i].hashSum) == g_subscribers[i].expectedHashSum)
+               ? "" : ", 内容不一致");
+        if ((atomic_load(&g_subscribers[i].frames) != g_subscribers[i].expectedFrames)
+            || (atomic_load(&g_subscribers[i].hashSum) != g_subscribers[i].expectedHashSum))
+            failures++;
+    }
+    sempRouterGetStats(g_router, &stats);
+    totalFrames = stats.frames + stats.unrouted + stats.noBuffer;
+    printf("路由 %llu 帧, 无订阅者 %llu, 无缓冲区 %llu, 空闲缓冲区 %u / %d, %.0f 帧/秒\n",
+           (unsigned long long)stats.frames, (unsigned long long)stats.unrouted,
+           (unsigned long long)stats.noBuffer, stats.freeBuffers, BUFFER_COUNT,
+           totalFrames / seconds);
+    if (stats.freeBuffers != BUFFER_COUNT)
+        failures++;
+    sempRouterStop(&g_router);
+
+    for (int i = 0; i < STREAM_COUNT; i++)
+        free(g_streams[i]);
+    free(g_stream);
+    printf("\n--- 帧发布/订阅路由测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
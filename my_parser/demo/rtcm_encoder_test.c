@@ -0,0 +1,459 @@
+/**
+ * @file rtcm_encoder_test.c
+ * @brief RTCM3 MSM4/MSM7与1005编码器往返测试程序
+ * @details 随机生成MSM4/MSM7 (GPS/GLONASS/Galileo/北斗) 和1005电文, 编码后
+ *          由现有的RTCM解析器分帧并校验CRC, 再在eomCallback中按RTCM 10403
+ *          的字段定义逐字段解码 (DF397-DF408, DF420, 1005的DF021-DF364),
+ *          与编码前的值比较, 允许误差为各字段的量化间隔的一半.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "../Message_Parser.h"
+#include "../Message_RtcmEncoder.h"
+#include "../Parse_RTCM.h"
+
+#define MSM_FRAMES      20000
+#define ARP_FRAMES      200
+#define MAX_OBS         64
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+
+// Encoded message, compared with the decoded fields
+typedef struct {
+    bool isMsm;
+    SEMP_RTCM_MSM msm;
+    SEMP_RTCM_MSM_OBS obs[MAX_OBS];
+    SEMP_RTCM_1005 arp;
+} Expected;
+
+static Expected g_expected;
+static int g_parsed;
+static int g_badCrc;
+static int g_mismatches;
+static uint32_t g_seed = 2024;
+
+//----------------------------------------
+// 随机数
+//----------------------------------------
+static uint32_t nextRandom(void) {
+    g_seed = g_seed * 1103515245 + 12345;
+    return g_seed >> 8;
+}
+
+static double uniform(double low, double high) {
+    return low + (high - low) * (nextRandom() & 0xffffff) / (double)0x1000000;
+}
+
+//----------------------------------------
+// 字段读取
+//----------------------------------------
+
+// Unsigned field of up to 64 bits, most significant bit first
+static uint64_t getBits(const uint8_t *buffer, uint32_t *bit, uint8_t bits) {
+    uint64_t value = 0;
+    uint8_t count;
+
+    while (bits) {
+        count = (bits > 32) ? 32 : bits;
+        value = (value << count) | sempRtcmGetBits(buffer, *bit, count);
+        *bit += count;
+        bits -= count;
+    }
+    return value;
+}
+
+// Two's complement field
+static int64_t getSigned(const uint8_t *buffer, uint32_t *bit, uint8_t bits) {
+    uint64_t value = getBits(buffer, bit, bits);
+
+    if (value & (1ull << (bits - 1)))
+        return (int64_t)value - (int64_t)(1ull << bits);
+    return (int64_t)value;
+}
+
+static void mismatch(const char *field, double decoded, double expected) {
+    if (g_mismatches++ < 10)
+        printf("  %s: 解码 %.6f, 应为 %.6f\n", field, decoded, expected);
+}
+
+static void checkValue(const char *field, double decoded, double expected, double tolerance) {
+    if (fabs(decoded - expected) > tolerance)
+        mismatch(field, decoded, expected);
+}
+
+//----------------------------------------
+// 解码比较
+//----------------------------------------
+
+// DF402: minimum lock time of the indicator
+static uint32_t lockTimeMinimum(uint8_t indicator) {
+    return indicator ? (1u << (indicator + 4)) : 0;
+}
+
+// DF407: minimum lock time and resolution of the indicator
+static uint32_t lockTimeExtendedMinimum(uint16_t indicator, uint32_t *resolution) {
+    uint32_t shift;
+
+    if (indicator < 64) {
+        *resolution = 1;
+        return indicator;
+    }
+    shift = (indicator / 32) - 1;
+    *resolution = 1u << shift;
+    return (indicator - 32 * shift) << shift;
+}
+
+static void checkLockTime(bool msm7, uint16_t indicator, uint32_t lockTime) {
+    uint32_t resolution;
+    uint32_t minimum;
+
+    if (msm7) {
+        minimum = lockTimeExtendedMinimum(indicator, &resolution);
+        if ((indicator == 704) ? (lockTime < minimum)
+                               : ((lockTime < minimum) || (lockTime >= (minimum + resolution))))
+            mismatch("DF407 锁定时间", indicator, lockTime);
+    } else {
+        minimum = lockTimeMinimum((uint8_t)indicator);
+        if ((lockTime < minimum)
+            || ((indicator < 15) && (lockTime >= lockTimeMinimum((uint8_t)(indicator + 1)))))
+            mismatch("DF402 锁定时间", indicator, lockTime);
+    }
+}
+
+// Cell order: satellites in mask order, then signals in mask order
+static const SEMP_RTCM_MSM_OBS *findObs(uint8_t satellite, uint8_t signal) {
+    for (int i = 0; i < g_expected.msm.obsCount; i++)
+        if ((g_expected.obs[i].satellite == satellite) && (g_expected.obs[i].signal == signal))
+            return &g_expected.obs[i];
+    return NULL;
+}
+
+static void decodeMsm(const uint8_t *frame) {
+    const SEMP_RTCM_MSM *msm = &g_expected.msm;
+    const SEMP_RTCM_MSM_OBS *cellObs[64];
+    uint8_t satelliteIds[64];
+    uint8_t signalIds[32];
+    uint8_t cellSatellite[64];
+    double roughRange[64];
+    int64_t roughRate[64];
+    uint8_t extended[64];
+    uint64_t satelliteMask;
+    uint32_t signalMask;
+    uint64_t cellMask;
+    bool msm7 = ((msm->message % 10) == 7);
+    uint32_t bit = 24;
+    int satellites = 0;
+    int signals = 0;
+    int cells = 0;
+    int64_t value;
+    double range;
+
+    // Header, DF002 - DF396
+    checkValue("DF002 消息号", getBits(frame, &bit, 12), msm->message, 0);
+    checkValue("DF003 基准站", getBits(frame, &bit, 12), msm->station, 0);
+    checkValue("历元时间", getBits(frame, &bit, 30), msm->epochTime, 0);
+    checkValue("DF393 MM", getBits(frame, &bit, 1), msm->multipleMessage, 0);
+    checkValue("DF409 IODS", getBits(frame, &bit, 3), msm->iods, 0);
+    bit += 7;
+    checkValue("DF411 时钟调整", getBits(frame, &bit, 2), msm->clockSteering, 0);
+    checkValue("DF412 外部时钟", getBits(frame, &bit, 2), msm->externalClock, 0);
+    checkValue("DF417 平滑", getBits(frame, &bit, 1), msm->smoothing, 0);
+    checkValue("DF418 平滑间隔", getBits(frame, &bit, 3), msm->smoothingInterval, 0);
+    satelliteMask = getBits(frame, &bit, 64);
+    signalMask = (uint32_t)getBits(frame, &bit, 32);
+    for (int i = 0; i < 64; i++)
+        if (satelliteMask & (1ull << (63 - i)))
+            satelliteIds[satellites++] = i + 1;
+    for (int i = 0; i < 32; i++)
+        if (signalMask & (1u << (31 - i)))
+            signalIds[signals++] = i + 1;
+    if ((satellites * signals) > 64) {
+        mismatch("卫星数 x 信号数", satellites * signals, 64);
+        return;
+    }
+    cellMask = getBits(frame, &bit, satellites * signals);
+    for (int s = 0; s < satellites; s++)
+        for (int g = 0; g < signals; g++) {
+            const SEMP_RTCM_MSM_OBS *obs = findObs(satelliteIds[s], signalIds[g]);
+            bool present = (cellMask >> (satellites * signals - 1 - (s * signals + g))) & 1;
+
+            if (present != (obs != NULL))
+                mismatch("DF396 单元掩码", present, obs != NULL);
+            if (present) {
+                cellObs[cells] = obs;
+                cellSatellite[cells++] = s;
+            }
+        }
+
+    // Satellite data: DF397, DF419, DF398, DF399
+    for (int s = 0; s < satellites; s++)
+        roughRange[s] = (double)getBits(frame, &bit, 8);
+    for (int s = 0; s < satellites; s++)
+        extended[s] = msm7 ? (uint8_t)getBits(frame, &bit, 4) : 0;
+    for (int s = 0; s < satellites; s++)
+        roughRange[s] += getBits(frame, &bit, 10) / 1024.0;
+    for (int s = 0; s < satellites; s++)
+        roughRate[s] = msm7 ? getSigned(frame, &bit, 14) : 0;
+
+    // Signal data: DF400/DF405, DF401/DF406, DF402/DF407, DF420, DF403/DF408, DF404
+    for (int c = 0; c < cells; c++) {
+        const SEMP_RTCM_MSM_OBS *obs = cellObs[c];
+
+        value = getSigned(frame, &bit, msm7 ? 20 : 15);
+        if (obs->pseudorange == 0) {
+            if (value != -(1ll << (msm7 ? 19 : 14)))
+                mismatch("DF400/DF405 无效标记", value, 0);
+            continue;
+        }
+        range = (roughRange[cellSatellite[c]] + value / (msm7 ? 536870912.0 : 16777216.0))
+              * SEMP_RTCM_RANGE_MS;
+        checkValue("DF400/DF405 伪距", range, obs->pseudorange,
+                   SEMP_RTCM_RANGE_MS / (msm7 ? 536870912.0 : 16777216.0) / 2 + 1e-6);
+    }
+    for (int c = 0; c < cells; c++) {
+        value = getSigned(frame, &bit, msm7 ? 24 : 22);
+        range = (roughRange[cellSatellite[c]] + value / (msm7 ? 2147483648.0 : 536870912.0))
+              * SEMP_RTCM_RANGE_MS;
+        checkValue("DF401/DF406 相位距离", range, cellObs[c]->phaserange,
+                   SEMP_RTCM_RANGE_MS / (msm7 ? 2147483648.0 : 536870912.0) / 2 + 1e-6);
+    }
+    for (int c = 0; c < cells; c++)
+        checkLockTime(msm7, (uint16_t)getBits(frame, &bit, msm7 ? 10 : 4), cellObs[c]->lockTime);
+    for (int c = 0; c < cells; c++)
+        checkValue("DF420 半周", getBits(frame, &bit, 1), cellObs[c]->halfCycle, 0);
+    for (int c = 0; c < cells; c++)
+        checkValue("DF403/DF408 载噪比", getBits(frame, &bit, msm7 ? 10 : 6) / (msm7 ? 16.0 : 1.0),
+                   cellObs[c]->cnr, msm7 ? (1 / 32.0 + 1e-9) : (0.5 + 1e-9));
+    if (msm7)
+        for (int c = 0; c < cells; c++) {
+            value = getSigned(frame, &bit, 15);
+            checkValue("DF399 + DF404 相位距离变化率",
+                       roughRate[cellSatellite[c]] + value * 0.0001,
+                       cellObs[c]->phaserangeRate, 0.00005 + 1e-9);
+        }
+
+    // The rough values come from the first signal of the satellite
+    for (int c = 0; c < cells; c++)
+        if ((!c) || (cellSatellite[c] != cellSatellite[c - 1])) {
+            checkValue("DF419 扩展信息", extended[cellSatellite[c]],
+                       msm7 ? cellObs[c]->extendedInfo : 0, 0);
+        }
+
+    // Padding to a byte boundary ends the message
+    if (((bit + 7) / 8) != (3u + ((frame[1] & 3) << 8) + frame[2]))
+        mismatch("电文长度", (bit + 7) / 8, 3 + ((frame[1] & 3) << 8) + frame[2]);
+}
+
+static void decode1005(const uint8_t *frame) {
+    const SEMP_RTCM_1005 *arp = &g_expected.arp;
+    uint32_t bit = 24;
+
+    checkValue("DF002 消息号", getBits(frame, &bit, 12), 1005, 0);
+    checkValue("DF003 基准站", getBits(frame, &bit, 12), arp->station, 0);
+    checkValue("DF021 ITRF年", getBits(frame, &bit, 6), arp->itrfYear, 0);
+    checkValue("DF022 GPS", getBits(frame, &bit, 1), arp->gps, 0);
+    checkValue("DF023 GLONASS", getBits(frame, &bit, 1), arp->glonass, 0);
+    checkValue("DF024 Galileo", getBits(frame, &bit, 1), arp->galileo, 0);
+    checkValue("DF141 参考站", getBits(frame, &bit, 1), arp->referenceStation, 0);
+    checkValue("DF025 X", getSigned(frame, &bit, 38) * 0.0001, arp->x, 0.00005 + 1e-9);
+    checkValue("DF142 单振荡器", getBits(frame, &bit, 1), arp->singleOscillator, 0);
+    bit += 1;
+    checkValue("DF026 Y", getSigned(frame, &bit, 38) * 0.0001, arp->y, 0.00005 + 1e-9);
+    checkValue("DF364 四分之一周", getBits(frame, &bit, 2), arp->quarterCycle, 0);
+    checkValue("DF027 Z", getSigned(frame, &bit, 38) * 0.0001, arp->z, 0.00005 + 1e-9);
+    if (bit != 19 * 8 + 24)
+        mismatch("1005 长度", bit, 19 * 8 + 24);
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void encoderEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    g_parsed++;
+    if (g_expected.isMsm)
+        decodeMsm(parse->buffer);
+    else
+        decode1005(parse->buffer);
+}
+
+bool encoderBadCrc(SEMP_PARSE_STATE *parse) {
+    g_badCrc++;
+    return true;
+}
+
+void printError(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static const SEMP_PARSE_ROUTINE parsersTable[] = {sempRtcmPreamble};
+static const char * const parserNames[] = {"RTCM3"};
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void randomMsm(void) {
+    static const uint16_t messages[] = {1074, 1077, 1084, 1087, 1094, 1097, 1124, 1127};
+    SEMP_RTCM_MSM *msm = &g_expected.msm;
+    uint8_t satelliteList[64];
+    uint8_t signalList[32];
+    int satellites;
+    int signals;
+    double range;
+    double rate;
+    bool msm7;
+
+    memset(msm, 0, sizeof(*msm));
+    msm->message = messages[nextRandom() % 8];
+    msm7 = ((msm->message % 10) == 7);
+    msm->station = nextRandom() % 4096;
+    msm->epochTime = nextRandom() & 0x3fffffff;
+    msm->multipleMessage = nextRandom() & 1;
+    msm->iods = nextRandom() & 7;
+    msm->clockSteering = nextRandom() & 3;
+    msm->externalClock = nextRandom() & 3;
+    msm->smoothing = nextRandom() & 1;
+    msm->smoothingInterval = nextRandom() & 7;
+
+    // Distinct satellites and signals, at most 64 cells
+    signals = 1 + nextRandom() % 4;
+    satellites = 1 + nextRandom() % (64 / signals > 16 ? 16 : 64 / signals);
+    for (int i = 0; i < 64; i++)
+        satelliteList[i] = i + 1;
+    for (int i = 0; i < 32; i++)
+        signalList[i] = i + 1;
+    for (int i = 0; i < satellites; i++) {
+        int j = i + nextRandom() % (64 - i);
+        uint8_t swap = satelliteList[i];
+        satelliteList[i] = satelliteList[j];
+        satelliteList[j] = swap;
+    }
+    for (int i = 0; i < signals; i++) {
+        int j = i + nextRandom() % (32 - i);
+        uint8_t swap = signalList[i];
+        signalList[i] = signalList[j];
+        signalList[j] = swap;
+    }
+
+    msm->obsCount = 0;
+    for (int s = 0; s < satellites; s++) {
+        range = uniform(19000000.0, 27000000.0);
+        rate = uniform(-800.0, 800.0);
+        for (int g = 0; g < signals; g++) {
+            SEMP_RTCM_MSM_OBS *obs = &g_expected.obs[msm->obsCount];
+
+            // Some cells are empty, the satellite keeps at least one.  The
+            // signal rates stay within the DF404 range of the rounded DF399
+            if ((g > 0) && ((nextRandom() % 4) == 0))
+                continue;
+            memset(obs, 0, sizeof(*obs));
+            obs->satellite = satelliteList[s];
+            obs->signal = signalList[g];
+            obs->pseudorange = range + uniform(-50.0, 50.0);
+            obs->phaserange = obs->pseudorange + uniform(-100.0, 100.0);
+            obs->phaserangeRate = msm7 ? (rate + uniform(-0.5, 0.5)) : 0;
+            obs->lockTime = (nextRandom() & 0xffffff) >> (nextRandom() % 24);
+            obs->halfCycle = nextRandom() & 1;
+            obs->cnr = msm7 ? uniform(20.0, 55.0) : (double)(20 + nextRandom() % 35);
+            obs->extendedInfo = msm7 ? (nextRandom() & 15) : 0;
+
+            // Signals without a pseudorange carry the invalid value
+            if ((g > 0) && ((nextRandom() % 16) == 0))
+                obs->pseudorange = 0;
+            msm->obsCount++;
+        }
+    }
+
+    // The extended information belongs to the satellite, not the signal
+    for (int i = 1; i < msm->obsCount; i++)
+        if (g_expected.obs[i].satellite == g_expected.obs[i - 1].satellite)
+            g_expected.obs[i].extendedInfo = g_expected.obs[i - 1].extendedInfo;
+    msm->obs = g_expected.obs;
+}
+
+static void random1005(void) {
+    SEMP_RTCM_1005 *arp = &g_expected.arp;
+
+    memset(arp, 0, sizeof(*arp));
+    arp->station = nextRandom() % 4096;
+    arp->itrfYear = nextRandom() & 63;
+    arp->gps = nextRandom() & 1;
+    arp->glonass = nextRandom() & 1;
+    arp->galileo = nextRandom() & 1;
+    arp->referenceStation = nextRandom() & 1;
+    arp->singleOscillator = nextRandom() & 1;
+    arp->quarterCycle = nextRandom() & 3;
+    arp->x = uniform(-6400000.0, 6400000.0);
+    arp->y = uniform(-6400000.0, 6400000.0);
+    arp->z = uniform(-6400000.0, 6400000.0);
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    uint8_t frame[SEMP_RTCM_MAX_FRAME_BYTES];
+    SEMP_PARSE_STATE *parse;
+    uint16_t length;
+    int encoded = 0;
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  RTCM3编码器往返测试 v1.0\n");
+    printf("=================================\n");
+
+    parse = sempBeginParser("Encoder", parsersTable, 1, parserNames, 1, 0,
+                            SEMP_RTCM_MAX_FRAME_BYTES, encoderEomCallback, printError, NULL,
+                            encoderBadCrc);
+    if (!parse)
+        return -1;
+
+    for (int i = 0; i < (MSM_FRAMES + ARP_FRAMES); i++) {
+        g_expected.isMsm = (i < MSM_FRAMES);
+        if (g_expected.isMsm) {
+            randomMsm();
+            length = sempRtcmEncodeMsm(frame, sizeof(frame), &g_expected.msm);
+        } else {
+            random1005();
+            length = sempRtcmEncode1005(frame, sizeof(frame), &g_expected.arp);
+        }
+        if (!length) {
+            printf("  第 %d 帧编码失败\n", i);
+            failures++;
+            continue;
+        }
+        encoded++;
+
+        // The framer checks the length field and the CRC-24Q
+        sempParseBuffer(parse, frame, length);
+    }
+
+    // A buffer one byte short of the frame is rejected
+    randomMsm();
+    length = sempRtcmEncodeMsm(frame, sizeof(frame), &g_expected.msm);
+    if (sempRtcmEncodeMsm(frame, length - 1, &g_expected.msm)
+        || (!sempRtcmEncodeMsm(frame, length, &g_expected.msm))) {
+        printf("  缓冲区长度检查错误\n");
+        failures++;
+    }
+    sempStopParser(&parse);
+
+    printf("编码 %d 帧 (MSM %d, 1005 %d), 分帧 %d, CRC错误 %d, 字段不一致 %d\n",
+           encoded, MSM_FRAMES, ARP_FRAMES, g_parsed, g_badCrc, g_mismatches);
+    if ((g_parsed != encoded) || g_badCrc || g_mismatches)
+        failures++;
+
+    printf("\n--- RTCM3编码器往返测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
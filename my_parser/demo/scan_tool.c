@@ -0,0 +1,317 @@
+/**
+ * @file scan_tool.c
+ * @brief 归档数据完整性扫描工具与一致性测试程序
+ * @details 带参数运行时扫描指定文件并输出损坏报告:
+ *              scan_tool <输入文件> [线程数]
+ *          不带参数时生成含错误字节的混合数据, 单线程扫描结果与逐字节解析
+ *          (同样的描述表分帧) 的帧数比较, 多线程扫描结果 (含损坏区域列表)
+ *          与单线程结果逐项比较, 并比较两者的速度.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../Message_Parser.h"
+#include "../Message_Framing.h"
+#include "../Message_Scan.h"
+#include "../Message_NmeaWriter.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+
+#define STREAM_BYTES    (64 * 1024 * 1024)
+#define RANDOM_BYTES    (5 * 1024 * 1024)
+#define BUFFER_LENGTH   3000
+#define PROTOCOLS       4
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+static uint8_t *g_stream;
+static size_t g_streamLength;
+
+// Byte by byte parse results
+static SEMP_SCAN_PROTOCOL g_expected[PROTOCOLS];
+
+// Same framing in the scan and in the parser
+static const SEMP_FRAMING_DESCRIPTOR * const scanProtocols[PROTOCOLS] = {
+    &sempFramingRtcm, nullptr, &sempFramingUblox, &sempFramingUnicoreBinary,
+};
+static const SEMP_PARSE_ROUTINE parsersTable[PROTOCOLS] = {
+    sempFramingRtcmPreamble, sempNmeaPreamble, sempFramingUbloxPreamble,
+    sempFramingUnicoreBinaryPreamble,
+};
+static const char * const parserNames[PROTOCOLS] = {"RTCM3", "NMEA", "u-blox", "Unicore-BIN"};
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendRtcm(uint16_t message, uint16_t length) {
+    static uint8_t frame[6 + 1023];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message);
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (frame[4] & 0x0f));
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    appendBytes(frame, 6 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    static uint8_t frame[24 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+// 混合数据流, 含错误字节, 各数据流的种子不同
+static void buildStream(uint32_t seed) {
+    SEMP_NMEA_FIX fix;
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.quality = 4;
+    fix.satellites = 21;
+
+    g_streamLength = 0;
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 16384); epoch++) {
+        seed = seed * 1103515245 + 12345;
+        fix.timeMs = 45296000 + epoch * 100;
+        appendRtcm(1077, 200 + ((seed >> 16) % 400));
+        appendUnicoreBinary(1000 + (epoch & 0xff), 96 + ((seed >> 12) % 200));
+        appendUblox(0x01, 0x07, 92);
+        appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        appendRtcm(1087, 100 + ((seed >> 20) % 300));
+    }
+    for (int i = 0; i < 200; i++) {
+        seed = seed * 1103515245 + 12345;
+        g_stream[(seed >> 4) % g_streamLength] ^= (uint8_t)(1 << (seed & 7));
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void printReport(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void referenceEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    g_expected[type].frames++;
+    g_expected[type].bytes += parse->msg_length;
+}
+
+bool referenceBadCrc(SEMP_PARSE_STATE *parse) {
+    g_expected[parse->parser_type].badFrames++;
+    g_expected[parse->parser_type].badBytes += parse->msg_length;
+    return true;
+}
+
+//----------------------------------------
+// 比较
+//----------------------------------------
+static double secondsSince(const struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// The byte counts of the NMEA sentences differ, the parser replaces the terminators
+static int compareWithParser(const SEMP_SCAN_REPORT *report) {
+    const SEMP_SCAN_PROTOCOL *scan;
+    uint64_t total = report->garbageBytes;
+    int failures = 0;
+
+    for (int i = 0; i < PROTOCOLS; i++) {
+        scan = &report->protocols[i];
+        total += scan->bytes + scan->badBytes;
+        if ((scan->frames != g_expected[i].frames) || (scan->badFrames != g_expected[i].badFrames)
+            || (scanProtocols[i] && ((scan->bytes != g_expected[i].bytes)
+                                     || (scan->badBytes != g_expected[i].badBytes)))) {
+            printf("  %s: 扫描 %llu / %llu 帧, 解析 %llu / %llu 帧 (有效 / CRC错误)\n",
+                   parserNames[i], (unsigned long long)scan->frames,
+                   (unsigned long long)scan->badFrames,
+                   (unsigned long long)g_expected[i].frames,
+                   (unsigned long long)g_expected[i].badFrames);
+            failures++;
+        }
+    }
+    if (total != report->bytes) {
+        printf("  字节数不一致: %llu, 输入 %llu\n", (unsigned long long)total,
+               (unsigned long long)report->bytes);
+        failures++;
+    }
+    return failures;
+}
+
+static int compareReports(const SEMP_SCAN_REPORT *report, const SEMP_SCAN_REPORT *expected) {
+    if ((report->garbageBytes != expected->garbageBytes)
+        || memcmp(report->protocols, expected->protocols, sizeof(report->protocols))
+        || (report->regionCount != expected->regionCount)
+        || (report->regionCount && memcmp(report->regions, expected->regions,
+                                          report->regionCount * sizeof(SEMP_SCAN_REGION)))) {
+        printf("  %d 线程的结果与单线程不一致\n", report->threads);
+        return 1;
+    }
+    return 0;
+}
+
+// Scan with several thread counts, the results must match the single thread scan
+static int scanThreads(const uint8_t *data, size_t length, const SEMP_SCAN_REPORT *expected) {
+    static const uint16_t threads[] = {2, 3, 4, 7, 16};
+    SEMP_SCAN_REPORT *report;
+    struct timespec start;
+    double seconds;
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        report = sempScanBuffer(scanProtocols, PROTOCOLS, data, length, threads[i],
+                                BUFFER_LENGTH, printReport);
+        seconds = secondsSince(&start);
+        if (!report)
+            return failures + 1;
+        printf("  %2d 线程: %.0f MB/s, 块边界重新扫描 %llu 字节\n", report->threads,
+               length / 1e6 / seconds, (unsigned long long)report->alignBytes);
+        failures += compareReports(report, expected);
+        sempScanFreeReport(&report);
+    }
+    return failures;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main(int argc, char **argv) {
+    SEMP_SCAN_REPORT *expected;
+    SEMP_SCAN_REPORT *report;
+    SEMP_PARSE_STATE *parse;
+    struct timespec start;
+    double parseSeconds;
+    double scanSeconds;
+    uint32_t seed = 99;
+    int failures = 0;
+
+    if (argc >= 2) {
+        report = sempScanFile(scanProtocols, PROTOCOLS, argv[1],
+                              (argc > 2) ? (uint16_t)atoi(argv[2]) : 0, BUFFER_LENGTH,
+                              printReport);
+        sempScanPrintReport(report, scanProtocols, 20, printReport);
+        if (!report)
+            return -1;
+        sempScanFreeReport(&report);
+        return 0;
+    }
+
+    printf("=================================\n");
+    printf("  归档数据完整性扫描测试 v1.0\n");
+    printf("=================================\n");
+
+    g_stream = (uint8_t *)malloc(STREAM_BYTES);
+    if (!g_stream)
+        return -1;
+    buildStream(7);
+
+    // Reference: the parser with the same framing, bad frames counted
+    parse = sempBeginParser("Reference", parsersTable, PROTOCOLS, parserNames, PROTOCOLS,
+                            0, BUFFER_LENGTH, referenceEomCallback, NULL, NULL,
+                            referenceBadCrc);
+    if (!parse)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sempParseBuffer(parse, g_stream, g_streamLength);
+    parseSeconds = secondsSince(&start);
+    sempStopParser(&parse);
+
+    // Single thread scan
+    printf("\n混合数据流 %.1f MB:\n", g_streamLength / 1e6);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    expected = sempScanBuffer(scanProtocols, PROTOCOLS, g_stream, g_streamLength, 1,
+                              BUFFER_LENGTH, printReport);
+    scanSeconds = secondsSince(&start);
+    if (!expected)
+        return -1;
+    sempScanPrintReport(expected, scanProtocols, 8, printReport);
+    printf("  逐字节解析 %.0f MB/s, 单线程扫描 %.0f MB/s\n",
+           g_streamLength / 1e6 / parseSeconds, g_streamLength / 1e6 / scanSeconds);
+    failures += compareWithParser(expected);
+    failures += scanThreads(g_stream, g_streamLength, expected);
+    sempScanFreeReport(&expected);
+
+    // Random bytes, many false preambles cross the chunk boundaries
+    printf("\n随机数据 %d MB:\n", RANDOM_BYTES / (1024 * 1024));
+    for (size_t i = 0; i < RANDOM_BYTES; i++) {
+        seed = seed * 1103515245 + 12345;
+        g_stream[i] = (uint8_t)(seed >> 16);
+    }
+    expected = sempScanBuffer(scanProtocols, PROTOCOLS, g_stream, RANDOM_BYTES, 1,
+                              BUFFER_LENGTH, printReport);
+    if (!expected)
+        return -1;
+    printf("  无效字节 %llu, 损坏区域 %llu\n", (unsigned long long)expected->garbageBytes,
+           (unsigned long long)expected->regionCount);
+    failures += scanThreads(g_stream, RANDOM_BYTES, expected);
+    sempScanFreeReport(&expected);
+
+    free(g_stream);
+    printf("\n--- 归档数据完整性扫描测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,354 @@
+/**
+ * @file snapshot_test.c
+ * @brief 解析器快照迁移测试程序
+ * @details 生成混合协议数据流, 在每一个字节偏移处保存解析器快照, 由新分配的
+ *          解析器恢复后继续解析剩余数据, 检查输出的帧序列与不迁移时完全相同.
+ *          通用分帧协议的快照不含描述表地址, 恢复到同一索引为其他协议的
+ *          解析器表时被拒绝
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../Message_Parser.h"
+#include "../Message_Snapshot.h"
+#include "../Message_Framing.h"
+#include "../Message_NmeaWriter.h"
+#include "../Message_RtcmEncoder.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+#include "../Parse_Unicore_Hash.h"
+
+#define STREAM_BYTES    8192
+#define MAX_FRAMES      256
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+typedef struct {
+    uint16_t type;
+    uint16_t length;
+    uint64_t hash;
+} FrameRecord;
+
+typedef struct {
+    FrameRecord frames[MAX_FRAMES];
+    int frameCount;
+} FrameLog;
+
+static uint8_t g_stream[STREAM_BYTES];
+static size_t g_streamLength;
+static FrameLog g_expected;
+static FrameLog g_migrated;
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    memcpy(&g_stream[g_streamLength], data, length);
+    g_streamLength += length;
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    uint8_t frame[8 + 64];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    uint8_t frame[24 + 64 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+static void appendUnicoreHash(const char *body) {
+    char sentence[128];
+    uint32_t crc = semp_util_crc32(0, (const uint8_t *)body, strlen(body));
+    int length = snprintf(sentence, sizeof(sentence), "#%s*%08x\r\n", body, crc);
+    appendBytes(sentence, length);
+}
+
+static void buildStream(void) {
+    SEMP_NMEA_FIX fix;
+    SEMP_RTCM_1005 station;
+    SEMP_RTCM_MSM_OBS obs[4];
+    SEMP_RTCM_MSM msm;
+    uint8_t frame[SEMP_RTCM_MAX_FRAME_BYTES];
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.quality = 4;
+    fix.satellites = 21;
+    fix.hdop = 70;
+    fix.differentialAge = 12;
+    fix.station = 7;
+    fix.timeMs = 45296000;
+    memset(&station, 0, sizeof(station));
+    station.station = 7;
+    station.gps = true;
+    station.x = -1288398.5;
+    station.y = -4721697.1;
+    station.z = 4078625.3;
+    for (int i = 0; i < 4; i++) {
+        memset(&obs[i], 0, sizeof(obs[i]));
+        obs[i].satellite = 3 + i * 5;
+        obs[i].signal = 2;
+        obs[i].pseudorange = 21000000.0 + i * 850123.25;
+        obs[i].phaserange = obs[i].pseudorange + 0.37;
+        obs[i].cnr = 44;
+    }
+    memset(&msm, 0, sizeof(msm));
+    msm.message = 1074;
+    msm.station = 7;
+    msm.obsCount = 4;
+    msm.obs = obs;
+
+    for (int epoch = 0; epoch < 3; epoch++) {
+        msm.epochTime = 45296000 + epoch * 1000;
+        fix.timeMs = msm.epochTime;
+        appendBytes(frame, sempRtcmEncodeMsm(frame, sizeof(frame), &msm));
+        appendBytes(frame, sempRtcmEncode1005(frame, sizeof(frame), &station));
+        appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        appendUblox(0x01, 0x07, 40 + epoch);
+        appendBytes("\x01\x02garbage", 9);
+        appendUnicoreBinary(1000 + epoch, 32);
+        appendBytes(sentence, sempNmeaWriteRmc(sentence, sizeof(sentence), "GN", &fix));
+        appendUnicoreHash("BESTNAVA,COM1,0,72.5,FINESTEERING,2300,1000.000,SOLVED");
+        appendBytes("\xb5\x62\x01", 3);
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void snapshotEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    FrameLog *log = (FrameLog *)parse->userContext;
+    FrameRecord *record;
+
+    if (log->frameCount < MAX_FRAMES) {
+        record = &log->frames[log->frameCount++];
+        record->type = type;
+        record->length = parse->msg_length;
+        record->hash = semp_util_hash64(parse->buffer, parse->msg_length, 0);
+    }
+}
+
+void snapshotPrintError(const char *format, ...) {
+}
+
+//----------------------------------------
+// 测试用例
+//----------------------------------------
+
+// Migrate the stream at every byte offset, compare with the unmigrated frames
+static int migrateStream(const SEMP_PARSE_ROUTINE *parsersTable, const char **parserNamesTable,
+                         uint8_t parserCount, bool lazy, int *cuts, size_t *largestSnapshot) {
+    uint8_t blob[SEMP_SNAPSHOT_HEADER_BYTES + sizeof(SEMP_SCRATCH_PAD) + 2048 + SEMP_SNAPSHOT_CRC_BYTES];
+    int failures = 0;
+
+    // 1. 不迁移时的帧序列
+    SEMP_PARSE_STATE *parser = sempBeginParser("Reference", parsersTable, parserCount,
+                                               parserNamesTable, parserCount, 0, 2048,
+                                               snapshotEomCallback, snapshotPrintError,
+                                               NULL, NULL);
+    if (!parser) {
+        printf("解析器初始化失败!\n");
+        return 1;
+    }
+    memset(&g_expected, 0, sizeof(g_expected));
+    parser->userContext = &g_expected;
+    sempEnableLazyValidation(parser, lazy);
+    for (size_t i = 0; i < g_streamLength; i++)
+        sempParseNextByte(parser, g_stream[i]);
+    sempStopParser(&parser);
+
+    // 2. 在每个字节偏移处迁移
+    for (size_t cut = 0; cut <= g_streamLength; cut++) {
+        SEMP_PARSE_STATE *source = sempBeginParser("Source", parsersTable, parserCount,
+                                                   parserNamesTable, parserCount, 0, 2048,
+                                                   snapshotEomCallback, snapshotPrintError,
+                                                   NULL, NULL);
+        memset(&g_migrated, 0, sizeof(g_migrated));
+        source->userContext = &g_migrated;
+        sempEnableLazyValidation(source, lazy);
+
+        for (size_t i = 0; i < cut; i++)
+            sempParseNextByte(source, g_stream[i]);
+        size_t length = sempSnapshotSave(source, blob, sizeof(blob));
+        if (length > *largestSnapshot)
+            *largestSnapshot = length;
+        sempStopParser(&source);
+
+        // The target is allocated after the source is gone
+        SEMP_PARSE_STATE *target = sempBeginParser("Target", parsersTable, parserCount,
+                                                   parserNamesTable, parserCount, 0, 2048,
+                                                   snapshotEomCallback, snapshotPrintError,
+                                                   NULL, NULL);
+        target->userContext = &g_migrated;
+        if ((!length) || (!sempSnapshotRestore(target, blob, length))) {
+            printf("  偏移 %zu: 快照保存或恢复失败\n", cut);
+            failures++;
+        }
+        for (size_t i = cut; i < g_streamLength; i++)
+            sempParseNextByte(target, g_stream[i]);
+        sempStopParser(&target);
+
+        if ((g_migrated.frameCount != g_expected.frameCount)
+            || memcmp(g_migrated.frames, g_expected.frames,
+                      g_expected.frameCount * sizeof(FrameRecord))) {
+            if (failures < 10)
+                printf("  偏移 %zu: 帧序列不一致 (%d / %d 帧)\n",
+                       cut, g_migrated.frameCount, g_expected.frameCount);
+            failures++;
+        }
+        (*cuts)++;
+    }
+    printf("%s模式: %d 帧, %zu 个切分点\n", lazy ? "延迟校验" : "逐字节校验",
+           g_expected.frameCount, g_streamLength + 1);
+    return failures;
+}
+
+// A framing snapshot does not carry the descriptor address, the restore
+// finds it in the target's parsers table or refuses the snapshot
+static int testFramingTables(const SEMP_PARSE_ROUTINE *parsersTable, const char **parserNamesTable,
+                             uint8_t parserCount) {
+    static const SEMP_PARSE_ROUTINE rtcmTable[] = {
+        sempNmeaPreamble, sempFramingUbloxPreamble, sempFramingRtcmPreamble,
+        sempFramingUnicoreBinaryPreamble, sempUnicoreHashPreamble,
+    };
+    static const SEMP_PARSE_ROUTINE ubloxTable[] = {
+        sempNmeaPreamble, sempFramingRtcmPreamble, sempUbloxPreamble,
+        sempFramingUnicoreBinaryPreamble, sempUnicoreHashPreamble,
+    };
+    static const SEMP_PARSE_ROUTINE * const otherTables[] = {rtcmTable, ubloxTable};
+    uint8_t blob[SEMP_SNAPSHOT_HEADER_BYTES + sizeof(SEMP_SCRATCH_PAD) + 2048 + SEMP_SNAPSHOT_CRC_BYTES];
+    const uint8_t *descriptor;
+    size_t offset;
+    size_t length;
+    int failures = 0;
+
+    // Stop inside the first u-blox frame
+    for (offset = 0; (g_stream[offset] != 0xb5) || (g_stream[offset + 1] != 0x62); offset++)
+        ;
+    offset += 10;
+
+    SEMP_PARSE_STATE *source = sempBeginParser("Source", parsersTable, parserCount,
+                                               parserNamesTable, parserCount, 0, 2048,
+                                               snapshotEomCallback, snapshotPrintError,
+                                               NULL, NULL);
+    memset(&g_migrated, 0, sizeof(g_migrated));
+    source->userContext = &g_migrated;
+    for (size_t i = 0; i < offset; i++)
+        sempParseNextByte(source, g_stream[i]);
+    length = sempSnapshotSave(source, blob, sizeof(blob));
+    sempStopParser(&source);
+
+    // The descriptor address is not in the snapshot
+    descriptor = &blob[SEMP_SNAPSHOT_HEADER_BYTES + offsetof(SEMP_SCRATCH_PAD, framing.descriptor)];
+    for (size_t i = 0; i < sizeof(void *); i++)
+        if (descriptor[i]) {
+            printf("  快照中保存了描述表地址\n");
+            failures++;
+            break;
+        }
+
+    // Another protocol at the same index of the parsers table
+    for (int table = 0; table < 2; table++) {
+        SEMP_PARSE_STATE *target = sempBeginParser("Target", otherTables[table], parserCount,
+                                                   parserNamesTable, parserCount, 0, 2048,
+                                                   snapshotEomCallback, snapshotPrintError,
+                                                   NULL, NULL);
+        if ((!length) || sempSnapshotRestore(target, blob, length)) {
+            printf("  解析器表 %d: 不同协议的表项接受了快照\n", table);
+            failures++;
+        }
+        sempStopParser(&target);
+    }
+    printf("通用分帧快照: 偏移 %zu, 快照 %zu 字节, 失败 %d\n", offset, length, failures);
+    return failures;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    const SEMP_PARSE_ROUTINE parsersTable[] = {
+        sempNmeaPreamble,
+        sempRtcmPreamble,
+        sempUbloxPreamble,
+        sempUnicoreBinaryPreamble,
+        sempUnicoreHashPreamble,
+    };
+    const SEMP_PARSE_ROUTINE framingTable[] = {
+        sempNmeaPreamble,
+        sempFramingRtcmPreamble,
+        sempFramingUbloxPreamble,
+        sempFramingUnicoreBinaryPreamble,
+        sempUnicoreHashPreamble,
+    };
+    const char *parserNamesTable[] = {
+        "NMEA", "RTCM3", "u-blox", "Unicore-BIN", "Unicore-HASH"
+    };
+    const uint8_t parserCount = sizeof(parsersTable) / sizeof(parsersTable[0]);
+    size_t largestSnapshot = 0;
+    int failures = 0;
+    int cuts = 0;
+
+    printf("=================================\n");
+    printf("  解析器快照迁移测试 v1.0\n");
+    printf("=================================\n");
+
+    buildStream();
+
+    for (int lazy = 0; lazy < 2; lazy++)
+        failures += migrateStream(parsersTable, parserNamesTable, parserCount, lazy,
+                                  &cuts, &largestSnapshot);
+
+    // Described protocols restored into a freshly allocated parser
+    printf("\n通用分帧协议:\n");
+    for (int lazy = 0; lazy < 2; lazy++)
+        failures += migrateStream(framingTable, parserNamesTable, parserCount, lazy,
+                                  &cuts, &largestSnapshot);
+    failures += testFramingTables(framingTable, parserNamesTable, parserCount);
+
+    printf("\n--- 快照迁移测试总结 ---\n");
+    printf("数据流: %zu 字节, 迁移 %d 次, 最大快照 %zu 字节\n", g_streamLength, cuts, largestSnapshot);
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,381 @@
+/**
+ * @file split_tool.c
+ * @brief 按协议拆分原始数据文件工具与一致性测试程序
+ * @details 带参数运行时拆分指定文件:
+ *              split_tool <输入文件> <输出文件前缀> [direct]
+ *          生成 <前缀>.rtcm、<前缀>.nmea、<前缀>.ubx 和 <前缀>.unicore.
+ *          不带参数时生成含错误字节的混合数据文件, 以mmap零拷贝、分块读取
+ *          和O_DIRECT三种方式拆分, 输出文件与逐字节解析得到的帧逐字节比较.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../Message_Parser.h"
+#include "../Message_Split.h"
+#include "../Message_NmeaWriter.h"
+#include "../Parse_NMEA.h"
+#include "../Parse_RTCM.h"
+#include "../Parse_UBLOX.h"
+#include "../Parse_Unicore_Binary.h"
+
+#define STREAM_BYTES    (64 * 1024 * 1024)
+#define READ_BYTES      65521       // Chunk size, frames cross the chunks
+#define PROTOCOLS       4
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+static uint8_t *g_stream;
+static size_t g_streamLength;
+
+// Frames of each protocol from the byte by byte parse
+static uint8_t *g_expected[PROTOCOLS];
+static size_t g_expectedLength[PROTOCOLS];
+static uint64_t g_expectedBad;
+
+static const SEMP_PARSE_ROUTINE parsersTable[] = {
+    sempRtcmPreamble, sempNmeaPreamble, sempUbloxPreamble, sempUnicoreBinaryPreamble,
+};
+static const char * const parserNames[] = {"RTCM3", "NMEA", "u-blox", "Unicore-BIN"};
+static const char * const extensions[] = {"rtcm", "nmea", "ubx", "unicore"};
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static void appendBytes(const void *data, size_t length) {
+    if ((g_streamLength + length) <= STREAM_BYTES) {
+        memcpy(&g_stream[g_streamLength], data, length);
+        g_streamLength += length;
+    }
+}
+
+static void appendUblox(uint8_t messageClass, uint8_t id, uint16_t length) {
+    static uint8_t frame[8 + 4096];
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t)length;
+    frame[5] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[6 + i] = (uint8_t)(i * 13 + id);
+    for (uint16_t i = 2; i < 6 + length; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + length] = ckA;
+    frame[7 + length] = ckB;
+    appendBytes(frame, 8 + length);
+}
+
+static void appendRtcm(uint16_t message, uint16_t length) {
+    static uint8_t frame[6 + 1023];
+    uint32_t crc;
+
+    frame[0] = 0xd3;
+    frame[1] = (uint8_t)(length >> 8);
+    frame[2] = (uint8_t)length;
+    for (uint16_t i = 0; i < length; i++)
+        frame[3 + i] = (uint8_t)(i * 7 + message);
+    frame[3] = (uint8_t)(message >> 4);
+    frame[4] = (uint8_t)((message << 4) | (frame[4] & 0x0f));
+    crc = sempRtcmCrc24q(frame, 3 + length);
+    frame[3 + length] = (uint8_t)(crc >> 16);
+    frame[4 + length] = (uint8_t)(crc >> 8);
+    frame[5 + length] = (uint8_t)crc;
+    appendBytes(frame, 6 + length);
+}
+
+static void appendUnicoreBinary(uint16_t id, uint16_t length) {
+    static uint8_t frame[24 + 4096 + 4];
+    uint32_t crc;
+
+    memset(frame, 0, 24);
+    frame[0] = 0xaa;
+    frame[1] = 0x44;
+    frame[2] = 0xb5;
+    frame[4] = (uint8_t)id;
+    frame[5] = (uint8_t)(id >> 8);
+    frame[6] = (uint8_t)length;
+    frame[7] = (uint8_t)(length >> 8);
+    for (uint16_t i = 0; i < length; i++)
+        frame[24 + i] = (uint8_t)(i + id);
+    crc = semp_util_crc32(0, frame, 24 + length);
+    memcpy(&frame[24 + length], &crc, 4);
+    appendBytes(frame, 28 + length);
+}
+
+// 混合数据流, 含错误字节, 各数据流的种子不同
+static void buildStream(uint32_t seed) {
+    SEMP_NMEA_FIX fix;
+    char sentence[SEMP_NMEA_MAX_SENTENCE];
+
+    memset(&fix, 0, sizeof(fix));
+    sempNmeaSetPosition(&fix, 40.0583, -105.2153, 1620.5);
+    fix.quality = 4;
+    fix.satellites = 21;
+
+    g_streamLength = 0;
+    for (int epoch = 0; g_streamLength < (STREAM_BYTES - 16384); epoch++) {
+        seed = seed * 1103515245 + 12345;
+        fix.timeMs = 45296000 + epoch * 100;
+        appendRtcm(1077, 200 + ((seed >> 16) % 400));
+        appendUnicoreBinary(1000 + (epoch & 0xff), 96 + ((seed >> 12) % 200));
+        appendUblox(0x01, 0x07, 92);
+        appendBytes(sentence, sempNmeaWriteGga(sentence, sizeof(sentence), "GN", &fix));
+        appendRtcm(1087, 100 + ((seed >> 20) % 300));
+    }
+    for (int i = 0; i < 200; i++) {
+        seed = seed * 1103515245 + 12345;
+        g_stream[(seed >> 4) % g_streamLength] ^= (uint8_t)(1 << (seed & 7));
+    }
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void printError(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+//----------------------------------------
+// 参考结果
+//----------------------------------------
+void referenceEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    SEMP_FRAME frame;
+
+    sempGetFrame(parse, type, &frame);
+    if (!sempFrameValidate(&frame)) {
+        g_expectedBad++;
+        return;
+    }
+    memcpy(&g_expected[type][g_expectedLength[type]], frame.buffer, frame.length);
+    g_expectedLength[type] += frame.length;
+}
+
+static bool buildReference(void) {
+    SEMP_PARSE_STATE *parse;
+
+    parse = sempBeginParser("Reference", parsersTable, PROTOCOLS, parserNames, PROTOCOLS,
+                            0, 3000, referenceEomCallback, NULL, NULL, NULL);
+    if (!parse)
+        return false;
+
+    // Deliver the bad frames to count them
+    sempEnableLazyValidation(parse, true);
+    for (int i = 0; i < PROTOCOLS; i++) {
+        g_expected[i] = (uint8_t *)malloc(STREAM_BYTES);
+        if (!g_expected[i])
+            return false;
+    }
+    for (size_t i = 0; i < g_streamLength; i++)
+        sempParseNextByte(parse, g_stream[i]);
+    sempStopParser(&parse);
+    return true;
+}
+
+//----------------------------------------
+// 拆分
+//----------------------------------------
+static double secondsSince(const struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static SEMP_SPLIT * beginSplit(const char *prefix, bool direct) {
+    char fileName[512];
+    SEMP_SPLIT *split;
+
+    split = sempSplitBegin(parsersTable, PROTOCOLS, parserNames, PROTOCOLS, 3000, printError);
+    for (uint16_t i = 0; split && (i < PROTOCOLS); i++) {
+        snprintf(fileName, sizeof(fileName), "%s.%s", prefix, extensions[i]);
+        if (!sempSplitOpenOutput(split, i, fileName, direct))
+            sempSplitStop(&split);
+    }
+    return split;
+}
+
+static void printStats(SEMP_SPLIT *split, double seconds, size_t inputBytes) {
+    SEMP_SPLIT_STATS stats;
+
+    for (uint16_t i = 0; i < PROTOCOLS; i++) {
+        sempSplitGetStats(split, i, &stats);
+        printf("  %-12s %8llu 帧 %10llu 字节, CRC错误 %llu, 复制 %llu 帧, %llu 次写入\n",
+               parserNames[i], (unsigned long long)stats.frames,
+               (unsigned long long)stats.bytes, (unsigned long long)stats.badFrames,
+               (unsigned long long)stats.copiedFrames, (unsigned long long)stats.writes);
+    }
+    printf("  %.1f MB, %.3f 秒, %.0f MB/s\n", inputBytes / 1e6, seconds,
+           inputBytes / 1e6 / seconds);
+}
+
+// Compare the output files with the reference frames
+static int checkOutputs(SEMP_SPLIT *split, const char *prefix, bool zeroCopy) {
+    SEMP_SPLIT_STATS stats;
+    char fileName[512];
+    uint64_t bad = 0;
+    uint8_t *data;
+    FILE *file;
+    size_t length;
+    int failures = 0;
+
+    data = (uint8_t *)malloc(STREAM_BYTES + 1);
+    if (!data)
+        return 1;
+    for (uint16_t i = 0; i < PROTOCOLS; i++) {
+        snprintf(fileName, sizeof(fileName), "%s.%s", prefix, extensions[i]);
+        file = fopen(fileName, "rb");
+        length = file ? fread(data, 1, STREAM_BYTES + 1, file) : 0;
+        if (file)
+            fclose(file);
+        if ((length != g_expectedLength[i]) || memcmp(data, g_expected[i], length)) {
+            printf("  %s: %zu 字节, 应为 %zu 字节, 内容不一致\n", fileName, length,
+                   g_expectedLength[i]);
+            failures++;
+        }
+        sempSplitGetStats(split, i, &stats);
+        bad += stats.badFrames;
+        if (zeroCopy && stats.copiedFrames) {
+            printf("  %s: 复制了 %llu 帧\n", parserNames[i],
+                   (unsigned long long)stats.copiedFrames);
+            failures++;
+        }
+        unlink(fileName);
+    }
+    if (bad != g_expectedBad) {
+        printf("  CRC错误 %llu 帧, 应为 %llu 帧\n", (unsigned long long)bad,
+               (unsigned long long)g_expectedBad);
+        failures++;
+    }
+    free(data);
+    return failures;
+}
+
+// Split the named file into the prefix.protocol files
+static int splitFile(const char *inputName, const char *prefix, bool direct) {
+    struct timespec start;
+    SEMP_SPLIT *split;
+    struct stat status;
+    bool success;
+
+    if (stat(inputName, &status)) {
+        printf("无法打开 %s\n", inputName);
+        return -1;
+    }
+    split = beginSplit(prefix, direct);
+    if (!split)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    success = sempSplitFile(split, inputName) && sempSplitFinish(split);
+    printStats(split, secondsSince(&start), status.st_size);
+    sempSplitStop(&split);
+    return success ? 0 : -1;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main(int argc, char **argv) {
+    char directory[] = "/tmp/split_XXXXXX";
+    char inputName[64];
+    char prefix[64];
+    struct timespec start;
+    SEMP_SPLIT *split;
+    uint8_t *chunk;
+    ssize_t bytes;
+    FILE *file;
+    int failures = 0;
+    int fd;
+
+    if (argc >= 3)
+        return splitFile(argv[1], argv[2], (argc > 3) && (!strcmp(argv[3], "direct")));
+
+    printf("=================================\n");
+    printf("  按协议拆分工具测试 v1.0\n");
+    printf("=================================\n");
+
+    g_stream = (uint8_t *)malloc(STREAM_BYTES);
+    chunk = (uint8_t *)malloc(READ_BYTES);
+    if ((!g_stream) || (!chunk) || (!mkdtemp(directory)))
+        return -1;
+    buildStream(2024);
+    if (!buildReference())
+        return -1;
+    snprintf(inputName, sizeof(inputName), "%s/input.bin", directory);
+    snprintf(prefix, sizeof(prefix), "%s/split", directory);
+    file = fopen(inputName, "wb");
+    if ((!file) || (fwrite(g_stream, 1, g_streamLength, file) != g_streamLength))
+        return -1;
+    fclose(file);
+
+    // mmap, the frames are written from the mapped input
+    printf("\nmmap输入, writev输出:\n");
+    split = beginSplit(prefix, false);
+    if (!split)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!(sempSplitFile(split, inputName) && sempSplitFinish(split)))
+        failures++;
+    printStats(split, secondsSince(&start), g_streamLength);
+    failures += checkOutputs(split, prefix, true);
+    sempSplitStop(&split);
+
+    // Chunked reads, the frames crossing the chunks are copied
+    printf("\n分块读取输入 (%d 字节):\n", READ_BYTES);
+    split = beginSplit(prefix, false);
+    fd = open(inputName, O_RDONLY);
+    if ((!split) || (fd < 0))
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while ((bytes = read(fd, chunk, READ_BYTES)) > 0)
+        if (!sempSplitInput(split, chunk, bytes))
+            failures++;
+    close(fd);
+    if (!sempSplitFinish(split))
+        failures++;
+    printStats(split, secondsSince(&start), g_streamLength);
+    failures += checkOutputs(split, prefix, false);
+    sempSplitStop(&split);
+
+    // O_DIRECT through the aligned staging
+    printf("\nmmap输入, O_DIRECT输出:\n");
+    split = beginSplit(prefix, true);
+    if (!split)
+        printf("  文件系统不支持O_DIRECT, 跳过\n");
+    else {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (!(sempSplitFile(split, inputName) && sempSplitFinish(split)))
+            failures++;
+        printStats(split, secondsSince(&start), g_streamLength);
+        failures += checkOutputs(split, prefix, false);
+        sempSplitStop(&split);
+    }
+
+    unlink(inputName);
+    rmdir(directory);
+    for (int i = 0; i < PROTOCOLS; i++)
+        free(g_expected[i]);
+    free(chunk);
+    free(g_stream);
+    printf("\n--- 按协议拆分测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
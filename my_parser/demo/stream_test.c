@@ -0,0 +1,203 @@
+/**
+ * @file stream_test.c
+ * @brief 大帧分段输出测试程序
+ * @details 使用256字节缓冲区解析负载长度248 - 65535字节的u-blox帧.
+ *          放得下的帧交给eomCallback, 其余的帧经sempStreamSpill/sempStreamChunk
+ *          分段交给chunkCallback, 检查分段按顺序连续、拼接后与原帧相同、
+ *          只有最后一段带final且校验结果为VALID. 负载或校验和被破坏的帧
+ *          最后一段的校验结果为BAD_CRC, 其后的帧仍能正常解析.
+ * @version 1.0
+ * @date 2024-12
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../Message_Parser.h"
+#include "../Parse_UBLOX.h"
+
+#define BUFFER_BYTES        SEMP_MINIMUM_BUFFER_LENGTH
+#define MIN_PAYLOAD         (BUFFER_BYTES - 8)
+#define MAX_PAYLOAD         65535
+#define MAX_FRAME_BYTES     (MAX_PAYLOAD + 8)
+#define SMALL_PAYLOAD       16
+
+//----------------------------------------
+// 测试状态
+//----------------------------------------
+typedef struct {
+    uint8_t *frame;             // Frame passed to the parser
+    uint32_t length;
+    uint8_t *assembled;         // Chunks copied at their offsets
+    uint32_t assembledLength;
+    int chunks;
+    int finals;
+    uint8_t verdict;
+    int frames;                 // Frames passed to the eomCallback
+    uint16_t lastLength;
+    int errors;                 // Chunks out of order or past the frame
+} StreamLog;
+
+static StreamLog g_log;
+
+//----------------------------------------
+// 测试数据生成
+//----------------------------------------
+static uint32_t buildUblox(uint8_t *frame, uint32_t payload, uint32_t seed) {
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = 0x02;
+    frame[3] = 0x15;
+    frame[4] = (uint8_t)payload;
+    frame[5] = (uint8_t)(payload >> 8);
+    for (uint32_t i = 0; i < payload; i++)
+        frame[6 + i] = (uint8_t)((i * 131 + seed) ^ (i >> 8));
+    for (uint32_t i = 2; i < 6 + payload; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[6 + payload] = ckA;
+    frame[7 + payload] = ckB;
+    return payload + 8;
+}
+
+//----------------------------------------
+// 回调函数
+//----------------------------------------
+void streamEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
+    g_log.frames++;
+    g_log.lastLength = parse->msg_length;
+}
+
+void streamChunkCallback(SEMP_PARSE_STATE *parse, const SEMP_CHUNK *chunk) {
+    // Each chunk continues where the previous one ended
+    if ((chunk->offset != g_log.assembledLength) || g_log.finals
+        || ((chunk->offset + chunk->length) > MAX_FRAME_BYTES)
+        || ((!chunk->final) && (chunk->verdict != SEMP_FRAME_UNVALIDATED))) {
+        g_log.errors++;
+        return;
+    }
+    memcpy(&g_log.assembled[chunk->offset], chunk->data, chunk->length);
+    g_log.assembledLength += chunk->length;
+    g_log.chunks++;
+    if (chunk->final) {
+        g_log.finals++;
+        g_log.verdict = chunk->verdict;
+    }
+}
+
+void printError(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static const SEMP_PARSE_ROUTINE parsersTable[] = {sempUbloxPreamble};
+static const char * const parserNames[] = {"u-blox"};
+
+//----------------------------------------
+// 测试用例
+//----------------------------------------
+
+// Parse one frame followed by a small frame, check the delivery
+static int parseFrame(SEMP_PARSE_STATE *parse, uint32_t payload, int corrupt,
+                      uint8_t expectedVerdict) {
+    uint8_t small[SMALL_PAYLOAD + 8];
+    bool streamed;
+    int failures = 0;
+
+    memset(&g_log.chunks, 0, sizeof(g_log) - offsetof(StreamLog, chunks));
+    g_log.assembledLength = 0;
+    g_log.length = buildUblox(g_log.frame, payload, payload);
+    if (corrupt)
+        g_log.frame[corrupt] ^= 0x10;
+    streamed = (g_log.length > BUFFER_BYTES);
+
+    // Pieces of varying size cross the chunk boundaries
+    for (uint32_t offset = 0, piece = 1; offset < g_log.length; piece = piece * 3 % 1021) {
+        if (piece > (g_log.length - offset))
+            piece = g_log.length - offset;
+        sempParseBuffer(parse, &g_log.frame[offset], piece);
+        offset += piece;
+    }
+
+    if (streamed) {
+        if (g_log.errors || (g_log.finals != 1) || g_log.frames
+            || (g_log.verdict != expectedVerdict) || (g_log.assembledLength != g_log.length)
+            || memcmp(g_log.assembled, g_log.frame, g_log.length)) {
+            printf("  负载 %u: %d 段, %d 个final, 校验 %d, 拼接 %u / %u 字节, 错误 %d\n",
+                   payload, g_log.chunks, g_log.finals, g_log.verdict, g_log.assembledLength,
+                   g_log.length, g_log.errors);
+            failures++;
+        }
+    } else if (g_log.chunks || g_log.errors
+               || (g_log.frames != (expectedVerdict == SEMP_FRAME_VALID))) {
+        printf("  负载 %u: 缓冲区内的帧被分段或未交付\n", payload);
+        failures++;
+    }
+
+    // The parser is back in sync after the frame
+    g_log.frames = 0;
+    sempParseBuffer(parse, small, buildUblox(small, SMALL_PAYLOAD, 0));
+    if ((g_log.frames != 1) || (g_log.lastLength != sizeof(small))
+        || (g_log.finals != (streamed ? 1 : 0))) {
+        printf("  负载 %u: 之后的小帧没有交付\n", payload);
+        failures++;
+    }
+    return failures;
+}
+
+//----------------------------------------
+// 主函数
+//----------------------------------------
+int main() {
+    SEMP_PARSE_STATE *parse;
+    uint32_t streamed = 0;
+    int failures = 0;
+
+    printf("=================================\n");
+    printf("  大帧分段输出测试 v1.0\n");
+    printf("=================================\n");
+
+    g_log.frame = (uint8_t *)malloc(MAX_FRAME_BYTES);
+    g_log.assembled = (uint8_t *)malloc(MAX_FRAME_BYTES);
+    parse = sempBeginParser("Stream", parsersTable, 1, parserNames, 1, 0, BUFFER_BYTES,
+                            streamEomCallback, printError, NULL, NULL);
+    if ((!parse) || (!g_log.frame) || (!g_log.assembled))
+        return -1;
+    sempEnableStreaming(parse, streamChunkCallback);
+
+    // Every payload length, the first does not need streaming
+    for (uint32_t payload = MIN_PAYLOAD; payload <= MAX_PAYLOAD; payload++) {
+        failures += parseFrame(parse, payload, 0, SEMP_FRAME_VALID);
+        streamed += (payload + 8) > BUFFER_BYTES;
+        if (failures > 10)
+            break;
+    }
+    printf("负载 %d - %d 字节: %u 帧分段输出, 失败 %d\n", MIN_PAYLOAD, MAX_PAYLOAD, streamed,
+           failures);
+
+    // Damaged payload and checksum bytes, the whole frame is still passed on
+    static const uint32_t damaged[] = {MIN_PAYLOAD + 1, 1000, 4093, MAX_PAYLOAD};
+    for (size_t i = 0; i < sizeof(damaged) / sizeof(damaged[0]); i++) {
+        failures += parseFrame(parse, damaged[i], 6, SEMP_FRAME_BAD_CRC);
+        failures += parseFrame(parse, damaged[i], 6 + damaged[i] / 2, SEMP_FRAME_BAD_CRC);
+        failures += parseFrame(parse, damaged[i], 6 + damaged[i], SEMP_FRAME_BAD_CRC);
+        failures += parseFrame(parse, damaged[i], 7 + damaged[i], SEMP_FRAME_BAD_CRC);
+    }
+    printf("损坏的帧: %zu 帧, 失败累计 %d\n", 4 * sizeof(damaged) / sizeof(damaged[0]), failures);
+
+    sempStopParser(&parse);
+    free(g_log.frame);
+    free(g_log.assembled);
+
+    printf("\n--- 大帧分段输出测试总结 ---\n");
+    printf("失败: %d\n", failures);
+    printf("=======================\n");
+    return failures ? -1 : 0;
+}
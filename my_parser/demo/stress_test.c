@@ -2,6 +2,8 @@
  * @file stress_test.c
  * @brief 解析器压力测试程序
  * @details 从文件读取混合协议数据流，测试解析器的稳定性和准确性
+ *          用法: stress_test [输入文件 [输出文件 [检查点文件 [检查点间隔MB]]]]
+ *          指定检查点文件时, 中断(Ctrl-C或被终止)后重新运行从最后的检查点继续
  * @version 1.0
  * @date 2024-12
  */
@@ -9,7 +11,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <signal.h>
+#include <stdarg.h>
 #include "../Message_Parser.h"
+#include "../Message_Replay.h"
 #include "../Parse_NMEA.h"
 #include "../Parse_RTCM.h"
 #include "../Parse_UBLOX.h"
@@ -27,6 +32,7 @@ typedef struct {
 } StressTestState;
 
 StressTestState g_stress_state;
+SEMP_REPLAY *g_replay;
 
 //----------------------------------------
 // 回调函数
@@ -35,6 +41,21 @@ void stressEomCallback(SEMP_PARSE_STATE *parse, uint16_t type) {
     if (type < MAX_PROTOCOL_TYPES) {
         g_stress_state.success_counts[type]++;
     }
+
+    // 输出解析成功的消息
+    sempReplayWrite(g_replay, parse->buffer, parse->msg_length);
+}
+
+void stressPrintReplayError(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+void stressStopSignal(int signal) {
+    sempReplayRequestStop(g_replay);
 }
 
 void stressPrintError(const char *format, ...) {
@@ -44,7 +65,13 @@ void stressPrintError(const char *format, ...) {
 //----------------------------------------
 // 主函数
 //----------------------------------------
-int main() {
+int main(int argc, char *argv[]) {
+    const char *inputName = (argc > 1) ? argv[1] : "custom_parser/demo/mixed_data.bin";
+    const char *outputName = (argc > 2) ? argv[2] : NULL;
+    const char *checkpointName = (argc > 3) ? argv[3] : NULL;
+    uint32_t checkpointMegabytes = (argc > 4) ? (uint32_t)atoi(argv[4]) : 64;
+    bool completed;
+
     printf("=================================\n");
     printf("  解析器压力测试 v1.0\n");
     printf("=================================\n");
@@ -84,22 +111,29 @@ int main() {
         return -1;
     }
 
-    // 3. 打开并读取测试数据文件
-    FILE *fp = fopen("custom_parser/demo/mixed_data.bin", "rb");
-    if (!fp) {
-        perror("错误: 无法打开 'mixed_data.bin'");
+    // 3. 打开测试数据文件, 有检查点时从检查点继续
+    g_replay = sempReplayBegin(parser, inputName, outputName, checkpointName,
+                               checkpointMegabytes, stressPrintReplayError);
+    if (!g_replay) {
+        printf("错误: 无法回放 '%s'\n", inputName);
         sempStopParser(&parser);
         return -1;
     }
 
-    printf("正在处理 'mixed_data.bin'...\n");
+    if (sempReplayGetResumeOffset(g_replay))
+        printf("从检查点继续处理 '%s', 偏移 %llu...\n", inputName,
+               (unsigned long long)sempReplayGetResumeOffset(g_replay));
+    else
+        printf("正在处理 '%s'...\n", inputName);
 
-    int byte;
-    while ((byte = fgetc(fp)) != EOF) {
-        sempParseNextByte(parser, (uint8_t)byte);
-        g_stress_state.total_bytes_processed++;
-    }
-    fclose(fp);
+    signal(SIGINT, stressStopSignal);
+    signal(SIGTERM, stressStopSignal);
+    completed = sempReplayRun(g_replay);
+    g_stress_state.total_bytes_processed = (long)(sempReplayGetOffset(g_replay)
+                                                  - sempReplayGetResumeOffset(g_replay));
+    if (!completed)
+        printf("回放中断于偏移 %llu, 重新运行以继续\n",
+               (unsigned long long)sempReplayGetOffset(g_replay));
 
     // 4. 打印总结
     printf("\n--- 压力测试总结 ---\n");
@@ -119,7 +153,8 @@ int main() {
     printf("=======================\n");
 
     // 5. 清理
+    sempReplayStop(&g_replay);
     sempStopParser(&parser);
 
-    return 0;
+    return completed ? 0 : 1;
 } 
\ No newline at end of file